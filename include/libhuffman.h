@@ -19,13 +19,29 @@ extern "C" {
  #define LIBHUFFMAN_CALLCONV
 #endif // ndef LIBHUFFMAN_CALLCONV
 
+// Codes are up to 32 bits long; define LIBHUFFMAN_CODE64 to build the library for codes up to 64 bits long
+#ifndef libhuffman_code_t
+ #ifdef LIBHUFFMAN_CODE64
+  typedef uint64_t	libhuffman_code_t;
+ #else
+  typedef uint32_t	libhuffman_code_t;
+ #endif // def LIBHUFFMAN_CODE64
+ #define libhuffman_code_t	libhuffman_code_t
+#endif	// libhuffman_code_t
+#ifndef libhuffman_value_t
+ typedef uint16_t	libhuffman_value_t;
+ #define libhuffman_value_t	libhuffman_value_t
+#endif // libhuffman_value_t
+
 
 typedef struct libhuffman_binary		libhuffman_binary;
 typedef struct libhuffman_block			libhuffman_block;
 typedef struct libhuffman_client		libhuffman_client;
+typedef struct libhuffman_code_desc		libhuffman_code_desc;
 typedef struct libhuffman_context		libhuffman_context;
 typedef struct libhuffman_decoder		libhuffman_decoder;
 typedef struct libhuffman_decoder_table	libhuffman_decoder_table;
+typedef struct libhuffman_encode_context	libhuffman_encode_context;
 typedef struct libhuffman_encoder		libhuffman_encoder;
 typedef struct libhuffman_encoder_table	libhuffman_encoder_table;
 typedef struct libhuffman_stream		libhuffman_stream;
@@ -33,13 +49,51 @@ typedef struct libhuffman_stream		libhuffman_stream;
 
 struct libhuffman_decoder_table {
 	btl_context	bit_context;
+
+	libhuffman_context *	context;		//< context used to allocate the attached layout
+	void *					layout_memory;	//< tables and entries of the attached layout, nullptr if not attached or static
+	size_t					layout_memory_size;
 };
 f2_status_t f2_callconv libhuffman_binary_initialize( libhuffman_decoder_table * thisp );
 f2_status_t f2_callconv libhuffman_binary_deinitialize( libhuffman_decoder_table * thisp );
 
+//! Table of the frozen decode layout
+typedef struct libhuffman_layout_table {
+	uint32_t	first_entry;	//< index of the first table entry in the entry arrays of the layout
+	uint32_t	parent_table;	//< index of the parent table; the root table is the first one and refers to itself
+	uint32_t	parent_index;	//< index of the entry in the parent table
+	uint32_t	l2_table_size;	//< log2 of number of table entries
+} libhuffman_layout_table;
+
+//! Frozen decode layout: built decoder tables in position-independent form, ready to be attached without building
+typedef struct libhuffman_decoder_layout {
+	const libhuffman_layout_table *	tables;			//< tables, each parent precedes its subtables
+	size_t							table_count;
+	const uint8_t *					entry_types;	//< btl_entry_type of each entry; callback entries can't be frozen
+	const uint32_t *				entry_values;	//< subtable index, or code descriptor index for data entries
+	size_t							entry_count;
+} libhuffman_decoder_layout;
+
+#define LIBHUFFMAN_MAX_LAYOUT_L2_TABLE_SIZE	24	//< maximum log2 size of a frozen table
+#define LIBHUFFMAN_DEFAULT_LAYOUT_L2_TABLE_SIZE	9	//< default log2 size limit of built tables
+
+f2_status_t f2_callconv libhuffman_decoder_layout_build( libhuffman_context * context, unsigned l2_max_table_size,
+	const libhuffman_code_desc * desc_array, size_t desc_count, libhuffman_decoder_layout * layout );
+f2_status_t f2_callconv libhuffman_decoder_layout_validate( const libhuffman_decoder_layout * layout, size_t desc_count );
+f2_status_t f2_callconv libhuffman_decoder_layout_release( libhuffman_context * context, libhuffman_decoder_layout * layout );
+f2_status_t f2_callconv libhuffman_decoder_layout_get_entry_bits( const libhuffman_decoder_layout * layout, uint8_t * entry_bits );
+f2_status_t f2_callconv libhuffman_decoder_table_freeze( const libhuffman_decoder_table * thisp, libhuffman_context * context,
+	libhuffman_decoder_layout * layout );
+f2_status_t f2_callconv libhuffman_decoder_table_attach_layout( libhuffman_decoder_table * thisp, libhuffman_context * context,
+	const libhuffman_decoder_layout * layout, const libhuffman_code_desc * desc_array );
+f2_status_t f2_callconv libhuffman_decoder_table_attach_tables( libhuffman_decoder_table * thisp, libhuffman_context * context,
+	const btl_table * root_tables, size_t root_count );
+f2_status_t f2_callconv libhuffman_decoder_table_detach_layout( libhuffman_decoder_table * thisp );
+
 struct libhuffman_block {
 	size_t		bit_offset;
-	unsigned	bit_length;
+	uint64_t	bit_length;
+	size_t		symbol_count;	//< number of codes in the block (blocks of a stream have roughly equal counts)
 };
 
 struct libhuffman_stream {
@@ -53,11 +107,20 @@ struct libhuffman_stream {
 	void *				data;
 	size_t				data_bit_offset;
 	size_t				data_bit_count;
+
+	#define LIBHUFFMAN_STREAM_F_INTERLEAVED	0x0001	//< blocks (lanes) are interleaved in 32-bit words, see libhuffman_stream_interleave
+	unsigned			flags;
 };
 f2_status_t f2_callconv libhuffman_stream_set_block_count( libhuffman_stream * thisp, size_t block_count );
 f2_status_t f2_callconv libhuffman_stream_set_block( libhuffman_stream * thisp, size_t block_index, size_t bit_offset, size_t bit_count );
+f2_status_t f2_callconv libhuffman_stream_set_flags( libhuffman_stream * thisp, unsigned flags );
 f2_status_t	f2_callconv libhuffman_stream_decode( libhuffman_stream * stream, f2_ostream * outp );
 
+#define LIBHUFFMAN_LANE_WORD_BITS	32			//< size of the lane word in the interleaved layout, in bits
+f2_status_t f2_callconv libhuffman_stream_get_interleaved_size( const libhuffman_stream * thisp, size_t * size );
+f2_status_t f2_callconv libhuffman_stream_interleave( libhuffman_stream * thisp, void * dst, size_t dst_size );
+f2_status_t f2_callconv libhuffman_stream_deinterleave_block( const libhuffman_stream * thisp, size_t block_index, void * dst, size_t dst_size );
+
 struct libhuffman_binary {
 	libhuffman_context *context;
 	libhuffman_decoder_table *	default_table;
@@ -94,6 +157,204 @@ f2_status_t	f2_callconv libhuffman_context_initialize( libhuffman_context * this
 f2_status_t	f2_callconv libhuffman_context_deinitialize( libhuffman_context * thisp );
 f2_status_t f2_callconv libhuffman_context_set_client( libhuffman_context * thisp, libhuffman_client * client );
 
+#define LIBHUFFMAN_MAX_CODE_LENGTH		(sizeof(libhuffman_code_t)*8)	//< maximum length of the generated code, in bits
+
+f2_status_t f2_callconv libhuffman_build_code_lengths( f2_allocator * allocator, const uint64_t * counts, size_t symbol_count,
+	unsigned max_length, uint8_t * lengths );
+f2_status_t f2_callconv libhuffman_build_canonical_codes( const uint8_t * lengths, size_t symbol_count, libhuffman_code_t * codes );
+libhuffman_code_t f2_callconv libhuffman_reverse_code( libhuffman_code_t bits, unsigned length );
+
+#define LIBHUFFMAN_MAX_TABLE_COUNT		16		//< maximum number of tables in the multitable file
+
+//! Assignment of code tables to source segments
+typedef struct libhuffman_multitable_plan {
+	libhuffman_context *	context;			//< owner context
+	unsigned				value_bit_size;		//< size of the source symbol, in bits
+	unsigned				max_code_length;	//< maximum length of generated codes
+	size_t					segment_count;		//< number of source segments (output streams)
+	size_t					max_table_count;	//< maximum number of tables
+	size_t					table_count;		//< number of built tables
+	uint64_t *				segment_histograms;	//< symbol counts, 2^value_bit_size per segment
+	uint64_t *				table_histograms;	//< merged symbol counts, 2^value_bit_size per table
+	uint8_t *				code_lengths;		//< code lengths, 2^value_bit_size per table
+	size_t *				segment_tables;		//< table index of each segment
+	uint64_t				total_bit_count;	//< size of all coded segments, in bits
+} libhuffman_multitable_plan;
+f2_status_t f2_callconv libhuffman_multitable_plan_initialize( libhuffman_multitable_plan * thisp, libhuffman_context * context,
+	unsigned value_bit_size, size_t segment_count, size_t max_table_count );
+f2_status_t f2_callconv libhuffman_multitable_plan_deinitialize( libhuffman_multitable_plan * thisp );
+f2_status_t f2_callconv libhuffman_multitable_plan_count( libhuffman_multitable_plan * thisp, size_t segment_index,
+	const void * data, size_t size );
+f2_status_t f2_callconv libhuffman_multitable_plan_build( libhuffman_multitable_plan * thisp );
+f2_status_t f2_callconv libhuffman_multitable_plan_get_code_descs( const libhuffman_multitable_plan * thisp, size_t table_index,
+	libhuffman_code_desc * desc_array, size_t * desc_count );
+f2_status_t f2_callconv libhuffman_multitable_plan_write_table( const libhuffman_multitable_plan * thisp, size_t table_index,
+	f2_ostream * ostream );
+
+//! Code replacing `count' successive copies of a symbol
+typedef struct libhuffman_run_code {
+	uint64_t			count;				//< number of symbols in the run
+	libhuffman_code_t	code;				//< Huffman code
+	uint8_t				length;				//< length of the Huffman code, in bits
+	uint8_t				terminating;		//< non-0 if the code ends a run (T.4 terminating code, the symbol has codes of runs 0..count)
+} libhuffman_run_code;
+
+//! Table of run codes used by the run-length encoding mode
+typedef struct libhuffman_run_table {
+	libhuffman_context *	context;		//< owner context
+	unsigned				value_bit_size;	//< size of the source symbol, in bits
+	libhuffman_run_code *	codes;			//< run codes grouped by symbol, longest runs first
+	size_t *				first;			//< index of the first code of each symbol, 2^value_bit_size + 1 entries
+	size_t					code_count;		//< total number of run codes
+} libhuffman_run_table;
+f2_status_t f2_callconv libhuffman_run_table_initialize( libhuffman_run_table * thisp, libhuffman_context * context,
+	unsigned value_bit_size, const libhuffman_code_desc * desc_array, size_t desc_count );
+f2_status_t f2_callconv libhuffman_run_table_deinitialize( libhuffman_run_table * thisp );
+
+//! callback that called each time a new code is fetched
+typedef f2_bool_t (LIBHUFFMAN_CALLCONV * libhuffman_code_callback)(
+	ptrdiff_t param
+	);
+
+struct libhuffman_encode_context {
+	libhuffman_context *		context;
+	libhuffman_encoder_table *	table;
+	f2_istream *		istream;
+	f2_ostream *		ostream;
+	libhuffman_code_callback	callback;
+	unsigned					value_bit_size;
+	libhuffman_stream *			stream;			//< optional stream receiving block boundaries
+	size_t						lane_count;		//< number of blocks the stream is split in (0 or 1 = no splitting)
+	const libhuffman_run_table *run_table;		//< optional run table; if set, runs of equal symbols are encoded
+};
+f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_initialize_encode_context( libhuffman_encode_context * encode_context,
+	libhuffman_context * context, libhuffman_encoder_table * table, f2_istream * istream, f2_ostream * ostream );
+f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_deinitialize_encode_context( libhuffman_encode_context * encode_context );
+
+/**
+ * @brief Split encoded data in blocks for lockstep decoding.
+ * @param[in] encode_context (libhuffman_encode_context *) pointer to the initialized encode context.
+ * @param[in] stream (libhuffman_stream *) stream which block table receives block boundaries.
+ * @param[in] lane_count (size_t) number of decoder lanes (blocks); 0 or 1 disables splitting.
+ * @return (f2_status_t) operation status code.
+ *
+ *	Blocks are balanced by number of codes rather than by bit length, so all lanes of
+ * an interleaved or SIMD decoder finish at the same iteration.
+ */
+f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_set_encode_context_lanes( libhuffman_encode_context * encode_context,
+	libhuffman_stream * stream, size_t lane_count );
+
+f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_build_encoder_table( libhuffman_encode_context * context );
+
+f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_encode( libhuffman_encode_context * context );
+
+/**
+ * @brief Switch encoder to the run-length mode.
+ * @param[in] encode_context (libhuffman_encode_context *) pointer to the initialized encode context.
+ * @param[in] run_table (const libhuffman_run_table *) run table, or nullptr to encode symbol by symbol.
+ * @return (f2_status_t) operation status code.
+ *
+ *	Each run of equal symbols is split greedily: the longest run code that fits is emitted as many times as
+ * it fits, then shorter ones follow down to the terminating code.
+ */
+f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_set_encode_context_run_table( libhuffman_encode_context * encode_context,
+	const libhuffman_run_table * run_table );
+
+#define LIBHUFFMAN_FAX_MAKEUP_ACTION	"MU"	//< action of extended make-up codes common to both colors, run is 1792 + 64 * parameter
+#define LIBHUFFMAN_FAX_EOL_ACTION		"EOL"	//< action of the end-of-line code
+#define LIBHUFFMAN_FAX_MAX_MAKEUP_RUN	2560	//< longest run of a single make-up code, in pixels
+
+#define LIBHUFFMAN_FAX_WHITE			0		//< lookup table of white run codes
+#define LIBHUFFMAN_FAX_BLACK			1		//< lookup table of black run codes
+#define LIBHUFFMAN_FAX_MODE				2		//< lookup table of two-dimensional mode codes
+#define LIBHUFFMAN_FAX_LOOKUP_COUNT		3
+#define LIBHUFFMAN_FAX_VERTICAL_BIAS	3		//< value of vertical mode entries is the offset of a1 from b1 plus this
+#define LIBHUFFMAN_FAX_COLOR_COUNT		2
+#define LIBHUFFMAN_FAX_TERMINATING_COUNT	64	//< terminating codes are runs 0..63
+#define LIBHUFFMAN_FAX_MAKEUP_COUNT		(LIBHUFFMAN_FAX_MAX_MAKEUP_RUN / 64)	//< make-up codes are runs 64, 128, ..., 2560
+
+//! Entry of fax code lookup tables
+typedef struct libhuffman_fax_entry {
+	uint16_t	value;			//< run length, in pixels, biased vertical offset, or index of the first subtable entry
+	uint8_t		length;			//< code length including bits of parent tables, or log2 of the subtable size
+	uint8_t		type;			//< LIBHUFFMAN_FAX_ET_*
+	#define LIBHUFFMAN_FAX_ET_INVALID		0	//< no code starts with these bits
+	#define LIBHUFFMAN_FAX_ET_TERMINATING	1	//< run shorter than 64 pixels, ends the run of the color
+	#define LIBHUFFMAN_FAX_ET_MAKEUP		2	//< multiple of 64 pixels, a terminating code follows
+	#define LIBHUFFMAN_FAX_ET_EOL			3	//< end of line
+	#define LIBHUFFMAN_FAX_ET_SUBTABLE		4	//< code continues in the subtable
+	#define LIBHUFFMAN_FAX_ET_PASS			5	//< pass mode: the run of the current color extends to b2
+	#define LIBHUFFMAN_FAX_ET_HORIZONTAL	6	//< horizontal mode: two runs follow, of the current color and of the other one
+	#define LIBHUFFMAN_FAX_ET_VERTICAL		7	//< vertical mode: a1 is b1 plus a biased offset
+} libhuffman_fax_entry;
+
+//! Fax code of a run, as the encoder emits it
+typedef struct libhuffman_fax_code {
+	uint16_t	bits;			//< code bits, the first transmitted bit in bit 0
+	uint8_t		length;			//< code length, 0 if the table doesn't have the code
+} libhuffman_fax_code;
+
+//! Fax code tables: white and black run codes in T.4 bit order and two-dimensional mode codes
+typedef struct libhuffman_fax_table {
+	libhuffman_context *	context;		//< owner context
+	libhuffman_fax_entry *	entries;		//< entries of all lookup tables and their subtables
+	size_t					entry_count;
+	uint32_t				root_first[LIBHUFFMAN_FAX_LOOKUP_COUNT];	//< first entry of the root table of each lookup
+	uint8_t					root_l2_size[LIBHUFFMAN_FAX_LOOKUP_COUNT];	//< log2 of the root table size of each lookup
+	libhuffman_fax_code		terminating[LIBHUFFMAN_FAX_COLOR_COUNT][LIBHUFFMAN_FAX_TERMINATING_COUNT];	//< encoder codes of runs 0..63
+	libhuffman_fax_code		makeup[LIBHUFFMAN_FAX_COLOR_COUNT][LIBHUFFMAN_FAX_MAKEUP_COUNT];	//< encoder codes of runs 64 * (index + 1)
+	libhuffman_fax_code		eol;			//< encoder code of EOL
+} libhuffman_fax_table;
+f2_status_t f2_callconv libhuffman_fax_table_initialize( libhuffman_fax_table * thisp, libhuffman_context * context,
+	const libhuffman_code_desc * desc_array, size_t desc_count );
+f2_status_t f2_callconv libhuffman_fax_table_deinitialize( libhuffman_fax_table * thisp );
+
+//! Fax page: coded data and the bitmap receiving decoded rows
+typedef struct libhuffman_fax_page {
+	const void *	data;				//< coded data
+	size_t			data_size;			//< size of coded data, in bytes
+	uint8_t *		bitmap;				//< packed 1-bpp rows, the first pixel in bit 7, 1 is black
+	size_t			stride;				//< distance between bitmap rows, in bytes
+	size_t			width;				//< row width, in pixels
+	size_t			max_row_count;		//< number of rows the bitmap can hold
+	unsigned		coding;				//< LIBHUFFMAN_FAX_CODING_*
+	#define LIBHUFFMAN_FAX_CODING_G3_1D		0	//< T.4 one-dimensional (Modified Huffman)
+	#define LIBHUFFMAN_FAX_CODING_G3_2D		1	//< T.4 two-dimensional (Modified READ): EOL and a tag bit, 1 = 1D row, 0 = 2D row
+	#define LIBHUFFMAN_FAX_CODING_G4		2	//< T.6 (Modified Modified READ): 2D rows without EOL, ended by EOFB
+	unsigned		flags;				//< LIBHUFFMAN_FAX_F_*
+	#define LIBHUFFMAN_FAX_F_MSB_FIRST		0x0001	//< the first bit is bit 7 of a byte (TIFF FillOrder 1); otherwise bit 0
+	#define LIBHUFFMAN_FAX_F_BYTE_ALIGNED	0x0002	//< rows start at byte boundaries and have no EOL (TIFF Modified Huffman RLE)
+	size_t			row_count;			//< [out] number of decoded rows
+	size_t			damaged_row_count;	//< [out] rows cut by invalid codes or premature EOL and completed with white
+} libhuffman_fax_page;
+f2_status_t f2_callconv libhuffman_fax_decode( const libhuffman_fax_table * table, libhuffman_fax_page * page );
+
+//! Row group of a T.4 page: rows from an EOL code up to the next group, decoded independently of other groups
+typedef struct libhuffman_fax_row_group {
+	size_t			bit_offset;			//< offset of the group in coded data, in bits
+	size_t			first_row;			//< index of the first row of the group
+	size_t			row_count;			//< number of rows up to the next group; the last group extends to the bitmap end
+	size_t			decoded_row_count;	//< [out] number of decoded rows
+	size_t			damaged_row_count;	//< [out] number of damaged rows
+} libhuffman_fax_row_group;
+f2_status_t f2_callconv libhuffman_fax_split( const libhuffman_fax_page * page, libhuffman_fax_row_group * groups,
+	size_t max_group_count, size_t * group_count );
+f2_status_t f2_callconv libhuffman_fax_decode_group( const libhuffman_fax_table * table, const libhuffman_fax_page * page,
+	libhuffman_fax_row_group * group );
+
+//! Fax encoding: bitmap rows and the buffer receiving coded data
+typedef struct libhuffman_fax_encode_page {
+	const uint8_t *	bitmap;				//< packed 1-bpp rows, the first pixel in bit 7, 1 is black
+	size_t			stride;				//< distance between bitmap rows, in bytes
+	size_t			width;				//< row width, in pixels
+	size_t			row_count;			//< number of rows to encode
+	unsigned		flags;				//< LIBHUFFMAN_FAX_F_*
+	void *			data;				//< buffer receiving coded data
+	size_t			data_capacity;		//< size of the buffer, in bytes
+	size_t			data_size;			//< [out] size of coded data, in bytes
+} libhuffman_fax_encode_page;
+f2_status_t f2_callconv libhuffman_fax_encode( const libhuffman_fax_table * table, libhuffman_fax_encode_page * page );
+
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -115,15 +376,6 @@ typedef struct libhuffman_encoder_table_entry	libhuffman_encoder_table_entry;
  #define LIBHUFFMAN_CALLCONV
 #endif // ndef LIBHUFFMAN_CALLCONV
 
-#ifndef libhuffman_code_t
- typedef uint32_t	libhuffman_code_t;
- #define libhuffman_code_t	libhuffman_code_t
-#endif	// libhuffman_code_t
-#ifndef libhuffman_value_t
- typedef uint16_t	libhuffman_value_t;
- #define libhuffman_value_t	libhuffman_value_t
-#endif // libhuffman_value_t
-
 ///! Bit run definition
 typedef struct libhuffman_bit_run
 {
@@ -388,11 +640,6 @@ struct libhuffman_decoder_table {
 	uint8_t		l2_max_count;	// log2 of maximum size of the table, if not 0; otherwise size is not limited
 };
 
-///! callback that called each time a new code is fetched
-typedef f2_bool_t (LIBHUFFMAN_CALLCONV * libhuffman_code_callback)(
-	ptrdiff_t param
-	);
-
 struct libhuffman_decoder_table_entry {
 	union {
 		const libhuffman_decoder_table *sub_table;	//< sub-table that decodes bits that didn't fit this table
@@ -614,25 +861,6 @@ f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_encoder_table_append_code(
 	unsigned					run_length
 	);
 
-
-
-typedef struct libhuffman_encode_context {
-	libhuffman_context *		context;
-	libhuffman_encoder_table *	table;
-	f2_istream *		istream;
-	f2_ostream *		ostream;
-	libhuffman_code_callback	callback;
-	unsigned					value_bit_size;
-} libhuffman_encode_context;
-
-f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_initialize_encode_context( libhuffman_encode_context * encode_context,
-	libhuffman_context * context, libhuffman_encoder_table * table, f2_istream * istream, f2_ostream * ostream );
-f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_deinitialize_encode_context( libhuffman_encode_context * encode_context );
-
-f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_build_encoder_table( libhuffman_encode_context * context );
-
-f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_encode( libhuffman_encode_context * context );
-
 #endif // 0
 
 #ifdef __cplusplus
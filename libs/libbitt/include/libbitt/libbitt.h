@@ -6,6 +6,7 @@
  * Copyright (c) duox.
  * Licensed under the MIT License.
  */
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef _MSC_VER
@@ -26,6 +27,7 @@ typedef enum btl_entry_type			btl_entry_type;
 typedef struct btl_table			btl_table;
 typedef struct btl_entry_data		btl_entry_data;
 typedef struct btl_entry_ref		btl_entry_ref;
+typedef struct btl_sparse_key		btl_sparse_key;
 typedef struct btl_context			btl_context;
 
 //! Operation result codes
@@ -41,6 +43,7 @@ enum btl_result_t {
 	BTL_ERROR_INVALID_SIZE,
 	BTL_ERROR_NULL_CALLBACK,
 	BTL_ERROR_UNRELATED,
+	BTL_ERROR_SPARSE_TABLE,
 };
 
 //! Generic allocator
@@ -100,7 +103,13 @@ enum btl_entry_type {
 	btl_et_subtable,	//< btl_entry_data::table is valid
 	btl_et_callback,	//< btl_entry_data::callback and btl_entry_data::callback_param are valid
 	btl_et_data,		//< btl_entry_data::entry_ptr_param and btl_entry_data::entry_int_param are valid
+	btl_et_switch_root,	//< data entry; the next code is decoded with root table 0 (see BTL_ET_SWITCH_ROOT)
 };
+//! Type of the data entry that selects root table _root_index for the next code; types of all roots follow btl_et_switch_root
+#define BTL_ET_SWITCH_ROOT( _root_index )	((uint8_t) (btl_et_switch_root + (_root_index)))
+//! Type of the data entry followed by _bit_count raw bits; the decoded integer is entry_int_param plus the bits
+#define BTL_ET_EXTRA_BITS( _bit_count )		((uint8_t) (BTL_ET_SWITCH_ROOT( BTL_MAX_ROOT_COUNT ) + (_bit_count)))
+#define BTL_MAX_EXTRA_BIT_COUNT	32		//< maximum number of raw bits after a code
 //! Table entry data; data for all entries are located in the btl_table::entry_data array.
 struct btl_entry_data {
 	union {
@@ -117,6 +126,12 @@ struct btl_entry_data {
 struct btl_entry_ref {
 	btl_table *		table;				//< table that contains the entry
 	unsigned		index;				//< zero-based position of the entry in the table
+	unsigned		bit_count;			//< number of index bits used by the entry; shorter codes occupy several entries
+};
+//! Key of a sparse table entry: the entry is selected by indices whose bits under mask equal bits
+struct btl_sparse_key {
+	uint32_t		bits;				//< significant index bits
+	uint32_t		mask;				//< mask of the significant bits; shorter codes have fewer bits set
 };
 //! Table object
 struct btl_table {
@@ -128,9 +143,13 @@ struct btl_table {
 	uint8_t			l2_table_size;		//< log2 of number of entries in the `entry_type' and `entry_data' arrays (0 = not set)
 
 	#define BTL_TABLE_F_EXT_ARRAYS	0x01	//< arrays were set by the btl_table_set_arrays function
+	#define BTL_TABLE_F_SPARSE		0x02	//< arrays hold sparse_count entries matched by sparse_keys (see btl_compact_tables)
 	uint8_t			flags;				//< state flags
+	btl_sparse_key *sparse_keys;		//< pointer to sparse_count keys of a sparse table
+	unsigned		sparse_count;		//< number of entries of a sparse table
+	unsigned char *	entry_bits;			//< pointer to numbers of index bits taken by codes of non-subtable entries, parallel to `entry_type'
 };
-#define BTL_TABLE_INITIALZIE()	{ (unsigned char *)NULL, (btl_entry_data *)NULL, (btl_context *) NULL, (btl_table *)NULL, 0, 0, 0 }
+#define BTL_TABLE_INITIALZIE()	{ (unsigned char *)NULL, (btl_entry_data *)NULL, (btl_context *) NULL, (btl_table *)NULL, 0, 0, 0, (btl_sparse_key *)NULL, 0, (unsigned char *)NULL }
 btl_result_t	btl_table_initialize( btl_table * table, btl_context * context, btl_table * parent_table, unsigned parent_index );
 #define btl_table_initialize( _table, _context, _parent_table, _parent_index )	(\
 	NULL == (_table) ?\
@@ -143,6 +162,9 @@ btl_result_t	btl_table_initialize( btl_table * table, btl_context * context, btl
 			(_table)->parent_index = _parent_index,\
 			(_table)->l2_table_size = 0,\
 			(_table)->flags = 0,\
+			(_table)->sparse_keys = NULL,\
+			(_table)->sparse_count = 0,\
+			(_table)->entry_bits = NULL,\
 			BTL_SUCCESS\
 		)\
 	)
@@ -150,38 +172,33 @@ btl_result_t	btl_table_deinitialize( btl_table * table );
 btl_result_t	btl_table_valid( btl_table * table );
 
 btl_result_t	btl_table_set_size( btl_table * table, size_t l2_entry_count );
-btl_result_t	btl_table_set_arrays( btl_table * table, unsigned char * entry_type, btl_entry_data * entry_data, size_t entry_count );
+btl_result_t	btl_table_set_arrays( btl_table * table, unsigned char * entry_type, btl_entry_data * entry_data, unsigned char * entry_bits, size_t entry_count );
+
+#define BTL_DEFAULT_SPARSE_ENTRY_COUNT	8	//< default maximum number of entries of a sparse table
+
+#define BTL_MAX_ROOT_COUNT	4		//< maximum number of root tables in the context
 
 struct btl_context {
-	btl_table				root_table;
+	btl_table				root_table;			//< root table 0
 	btl_heap_allocator *	heap_allocator;		//< raw memory allocator
 	btl_table_allocator *	table_allocator;	//< table object allocator
+	btl_table				extra_root_tables[BTL_MAX_ROOT_COUNT - 1];	//< root tables 1..BTL_MAX_ROOT_COUNT-1
 };
-#define BTL_CONTEXT_INITIALZIE()	{ BTL_TABLE_INITIALIZE(), NULL }
+#define btl_context_root_table( context, _root_index )	\
+	(0 == (_root_index) ? &(context)->root_table : &(context)->extra_root_tables[(_root_index) - 1])
 btl_result_t	btl_context_initialize( btl_context * context );
-#define btl_context_initialize( context )	(\
-	NULL == (context) ?\
-		BTL_ERROR_INVALID_PARAMETER :\
-		(\
-			(context)->allocator = NULL,\
-			btl_table_initialize( &(context)->root_table )\
-		)\
-	)
 btl_result_t	btl_context_deinitialize( btl_context * context );
-#define btl_context_deinitialize( context )	(\
-	NULL == (context) ?\
-		BTL_ERROR_INVALID_PARAMETER :\
-		(\
-			btl_table_deinitialize( &(context)->root_table )\
-		)\
-	)
 
 btl_result_t	btl_append_imm_entry( btl_context * context, uint64_t bit_value, unsigned bit_count, btl_entry_ref * ref );
 btl_result_t	btl_append_ptr_entry( btl_context * context, const void * value, size_t bit_count, btl_entry_ref * ref );
+btl_result_t	btl_append_root_imm_entry( btl_context * context, unsigned root_index, uint64_t bit_value, unsigned bit_count, btl_entry_ref * ref );
+btl_result_t	btl_append_root_ptr_entry( btl_context * context, unsigned root_index, const void * value, size_t bit_count, btl_entry_ref * ref );
+btl_result_t	btl_set_entry( btl_entry_ref * ref, uint8_t entry_type, const void * entry_ptr_param, size_t entry_int_param );
 //btl_result_t	btl_remove_imm_entry( btl_context * context, uint64_t bit_value, unsigned bit_count );
 //btl_result_t	btl_remove_ptr_entry( btl_context * context, const void * value, size_t bit_count );
 //btl_result_t	btl_remove_ref_entry( btl_context * context, btl_entry_ref * ref );
 btl_result_t	btl_remove_all_entries( btl_context * context );
+btl_result_t	btl_compact_tables( btl_context * context, unsigned max_sparse_count );
 
 btl_result_t	btl_find_imm_entry64( btl_context * context, uint64_t bit_value, unsigned bit_count, btl_entry_ref * ref );
 btl_result_t	btl_find_imm_entry32( btl_context * context, uint32_t bit_value, unsigned bit_count, btl_entry_ref * ref );
@@ -190,7 +207,7 @@ btl_result_t	btl_find_ptr_entry( btl_context * context, const void * value, size
 btl_result_t	btl_is_entry_ref_valid( btl_context * context, btl_entry_ref * ref );
 btl_result_t	btl_is_entry_tbl_valid( btl_context * context, btl_table * table, unsigned index );
 
-btl_result_t	btl_decode( btl_context * context,
+btl_result_t	btl_decode( btl_context * context, unsigned * root_index,
 	btl_decode_callback decode_callback, void * callback_param,
 	const void * data, unsigned data_bit_offset, size_t data_bit_count );
 
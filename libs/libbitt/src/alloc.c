@@ -108,7 +108,7 @@ static btl_result_t BTL_CALLBACK btl_table_allocator_alloc_table(
 	table = NULL;
 	result = allocator->alloc(
 		allocator,		// thisp
-		&table,			// pointer to object
+		(void **) &table,			// pointer to object
 		sizeof(*table)	// allocate specified number of bytes
 		);
 	if( BTL_SUCCESS != result )
@@ -133,7 +133,7 @@ static btl_result_t BTL_CALLBACK btl_table_allocator_alloc_table(
 	{
 		allocator->alloc(
 			allocator,	// thisp
-			&table,		// pointer to object
+			(void **) &table,		// pointer to object
 			0			// release the memory
 			);
 		return result;
@@ -179,7 +179,7 @@ static btl_result_t BTL_CALLBACK btl_table_allocator_release_table(
 
 	result = allocator->alloc(
 		allocator,		// thisp
-		&table,			// pointer to object
+		(void **) &table,			// pointer to object
 		0				// free memory
 		);
 	if( BTL_SUCCESS != result )
@@ -39,16 +39,16 @@ btl_result_t btl_bitfield_iterator_initialize(
 		bit_offset %= 8;			// leave partial bits only
 	}
 
-	// Initialize the object
+	// Initialize the object; the last byte holds bit bit_offset + bit_count - 1
 	iterator->data			= (const uint8_t *) data;
-	iterator->data_end		= iterator->data + (bit_count + 7) / 8;
+	iterator->data_end		= iterator->data + (bit_offset + bit_count + 7) / 8;
 	iterator->acc			= 0;
 	iterator->acc_bits_left	= 0;
 	iterator->data_bits_left= bit_count;
 
 	// Load first bits in the accumulator
 	if( 0 != bit_offset ) {
-		iterator->acc = (uint32_t) *iterator->data >> bit_offset;
+		iterator->acc = (uint64_t) *iterator->data >> bit_offset;
 
 		++ iterator->data;
 		iterator->acc_bits_left = 8 - bit_offset; 
@@ -63,7 +63,7 @@ btl_result_t btl_bitfield_iterator_initialize(
  *
  * @param[in] iterator (btl_bitfield_iterator *) iterator object.
  * @param[in] value_ptr (uint32_t *) pointer to variable receiving bit field value.
- * @param[in] required_size (unsigned) required number of bis in the bitfield.
+ * @param[in] required_size (unsigned) required number of bis in the bitfield, 1..32.
  * @param[in] acquired_size_ptr (unsigned *) pointer to receiving number of bits copied (can be less than required_size).
  *
  * @return (btl_result_t) operation status code.
@@ -76,11 +76,12 @@ btl_result_t btl_bitfield_iterator_fetch(
 	)
 {
 	unsigned fetch_bit_count;
+	uint64_t value;
 
 	// Check current state
 	debugbreak_if( NULL == iterator )
 		return BTL_ERROR_INVALID_PARAMETER;
-	debugbreak_if( 0 == required_size )
+	debugbreak_if( 0 == required_size || 32 < required_size )
 		return BTL_ERROR_INVALID_PARAMETER;
 
 	if( 0 == iterator->data_bits_left )
@@ -91,30 +92,38 @@ btl_result_t btl_bitfield_iterator_fetch(
 		required_size:							// there enough bits
 		(unsigned) iterator->data_bits_left;	// not enough bits, fetch what's left
 
-	// Load accumulator with full bytes if more bits are needed
-	if( iterator->acc_bits_left < fetch_bit_count )
-	{
-		uint32_t load = 0;
-
-		size_t avail_bytes;
-		size_t avail_bits = sizeof(iterator->acc) - iterator->acc_bits_left;
-		size_t full_space_left = (iterator->data_end - iterator->data)*8;
-		if( avail_bits > full_space_left )
-			avail_bits = full_space_left;
-
-		avail_bytes = (avail_bits + 7) / 8;
-		small_memcpy( &load, iterator->data, avail_bytes );
+	// Take bits from the accumulator; reload it with up to 8 full bytes if more bits are needed
+	if( iterator->acc_bits_left >= fetch_bit_count ) {
+		value = iterator->acc;
+		iterator->acc >>= fetch_bit_count;
+		iterator->acc_bits_left -= fetch_bit_count;
+	} else {
+		unsigned low_bit_count = iterator->acc_bits_left;
+		size_t i, avail_bytes = (size_t) (iterator->data_end - iterator->data);
+		if( avail_bytes > sizeof(iterator->acc) )
+			avail_bytes = sizeof(iterator->acc);
+
+		value = iterator->acc;
+		iterator->acc = 0;
+		for( i = 0; i < avail_bytes; ++ i )
+			iterator->acc |= (uint64_t) iterator->data[i] << (i * 8);
 		iterator->data += avail_bytes;
-
-		iterator->acc |= load << iterator->acc_bits_left;
+		iterator->acc_bits_left = (unsigned) avail_bytes * 8;
+
+		// data_end covers data_bits_left, so the reloaded bytes contain the rest of the bitfield unless the
+		// iterator is damaged
+		debugbreak_if( iterator->acc_bits_left < fetch_bit_count - low_bit_count )
+			return BTL_ERROR_INVALID_DATA;
+		value |= iterator->acc << low_bit_count;
+		iterator->acc >>= fetch_bit_count - low_bit_count;
+		iterator->acc_bits_left -= fetch_bit_count - low_bit_count;
 	}
+	iterator->data_bits_left -= fetch_bit_count;
 
 	// Store data
 	if( NULL != value_ptr ) {
-		*value_ptr = iterator->acc & ((1 << fetch_bit_count) - 1);
+		*value_ptr = (uint32_t) (value & (((uint64_t) 1 << fetch_bit_count) - 1));
 	}
-	iterator->acc >>= fetch_bit_count;
-	iterator->data_bits_left -= fetch_bit_count;
 
 	// Done
 	if( NULL != acquired_size_ptr )
@@ -124,4 +133,47 @@ btl_result_t btl_bitfield_iterator_fetch(
 	return BTL_SUCCESS;
 }
 
+/**
+ * @brief Return the last fetched bits to the data array.
+ *
+ * @param[in] iterator (btl_bitfield_iterator *) iterator object.
+ * @param[in] bit_count (unsigned) number of bits to return, no more than the last fetch acquired.
+ *
+ * @return (btl_result_t) operation status code.
+ *
+ *	The accumulator always holds the bits that immediately precede iterator->data, so the iterator steps back
+ * over them and the returned bits and reloads the partial byte; the next fetch starts with the returned bits.
+ */
+btl_result_t btl_bitfield_iterator_unfetch(
+	btl_bitfield_iterator *	iterator,
+	unsigned				bit_count
+	)
+{
+	unsigned back_bit_count;
+
+	// Check current state
+	debugbreak_if( NULL == iterator )
+		return BTL_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 32 < bit_count )
+		return BTL_ERROR_INVALID_PARAMETER;
+	if( 0 == bit_count )
+		return BTL_SUCCESS;
+
+	// Step back to the byte that holds the first returned bit
+	back_bit_count = iterator->acc_bits_left + bit_count;
+	iterator->data -= (back_bit_count + 7) / 8;
+	iterator->acc = 0;
+	iterator->acc_bits_left = 0;
+	if( 0 != back_bit_count % 8 ) {
+		iterator->acc = (uint64_t) *iterator->data >> (8 - back_bit_count % 8);
+
+		++ iterator->data;
+		iterator->acc_bits_left = back_bit_count % 8;
+	}
+	iterator->data_bits_left += bit_count;
+
+	// Exit
+	return BTL_SUCCESS;
+}
+
 /*END OF bitfield.c*/
@@ -10,10 +10,10 @@
  * @param[in] context (btl_context *) pointer to uninitialized context object.
  * @return (btl_result) status code.
  */
-#undef btl_context_initialize
 btl_result_t btl_context_initialize( btl_context * context )
 {
 	btl_result_t result;
+	unsigned i;
 
 	// Check current state
 	debugbreak_if( NULL == context )
@@ -21,10 +21,13 @@ btl_result_t btl_context_initialize( btl_context * context )
 
 	// Initialize the object
 	context->heap_allocator = NULL;
+	context->table_allocator = NULL;
 
-	result = btl_table_initialize( &context->root_table, context, NULL, 0 );
-	if( 0 != result )
-		return result;
+	for( i = 0; i < BTL_MAX_ROOT_COUNT; ++ i ) {
+		result = btl_table_initialize( btl_context_root_table( context, i ), context, NULL, 0 );
+		if( 0 != result )
+			return result;
+	}
 
 	// Exit
 	return BTL_SUCCESS;
@@ -34,22 +37,14 @@ btl_result_t btl_context_initialize( btl_context * context )
  * @param[in] context (btl_context *) pointer to initialized context object.
  * @return (btl_result) status code.
  */
-#undef btl_context_deinitialize
 btl_result_t btl_context_deinitialize( btl_context * context )
 {
-	btl_result_t result;
-
 	// Check current state
 	debugbreak_if( NULL == context )
 		return BTL_ERROR_INVALID_PARAMETER;
 
 	// Deinitialize the object
-	result = btl_table_deinitialize( &context->root_table );
-	if( 0 != result )
-		return result;
-
-	// Exit
-	return BTL_SUCCESS;
+	return btl_remove_all_entries( context );
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -69,7 +64,7 @@ btl_result_t btl_append_imm_entry(
 	btl_entry_ref *	ref
 	)
 {
-	return btl_append_ptr_entry( context, &bit_value, bit_count, ref );
+	return btl_append_root_ptr_entry( context, 0, &bit_value, bit_count, ref );
 }
 /**
  * @brief Append long element.
@@ -80,7 +75,49 @@ btl_result_t btl_append_imm_entry(
  * @return (btl_result) status code.
  */
 btl_result_t btl_append_ptr_entry(
+	btl_context *	context,
+	const void *	value,
+	size_t			bit_count,
+	btl_entry_ref *	ref
+	)
+{
+	return btl_append_root_ptr_entry( context, 0, value, bit_count, ref );
+}
+/**
+ * @brief Append immediate element to the specified root table.
+ * @param[in] context (btl_context *) pointer to the context object.
+ * @param[in] root_index (unsigned) zero-based index of the root table.
+ * @param[in] bit_value (uint64_t) bit sequence in the form of an immediate integer.
+ * @param[in] bit_count (unsigned) number of bits in the sequence.
+ * @param[out] ref (btl_entry_ref *) optional pointer to the new entry "address".
+ * @return (btl_result) status code.
+ */
+btl_result_t btl_append_root_imm_entry(
+	btl_context *	context,
+	unsigned		root_index,
+	uint64_t		bit_value,
+	unsigned		bit_count,
+	btl_entry_ref *	ref
+	)
+{
+	return btl_append_root_ptr_entry( context, root_index, &bit_value, bit_count, ref );
+}
+/**
+ * @brief Append long element to the specified root table.
+ * @param[in] context (btl_context *) pointer to the context object.
+ * @param[in] root_index (unsigned) zero-based index of the root table.
+ * @param[in] value (const void *) bit sequence in the form of a byte array.
+ * @param[in] bit_count (unsigned) number of bits in the sequence.
+ * @param[out] ref (btl_entry_ref *) optional pointer to the new entry "address".
+ * @return (btl_result) status code.
+ *
+ *	A sequence shorter than the table it ends in occupies all entries whose low index bits equal the sequence, since
+ * the decoder indexes the table with the bits that follow the code as well; entry_bits keeps the sequence length, so
+ * the decoder returns the following bits to the stream.
+ */
+btl_result_t btl_append_root_ptr_entry(
 	btl_context *	context,	//< pointer to context object
+	unsigned		root_index,	//< root table the sequence starts in
 	const void *	value,		//< pointer to bits
 	size_t			bit_count,	//< number of bits pointed to
 	btl_entry_ref *	ref			//< pointer to optional structure receiving entry parameters
@@ -94,11 +131,13 @@ btl_result_t btl_append_ptr_entry(
 	btl_entry_data * entry_data;
 	unsigned index_bit_count;
 	uint32_t index = (uint32_t) -1;
+	unsigned i, count;
 
 	// Check current state and prepare
 	if( NULL != ref ) {
 		ref->table = NULL;
 		ref->index = (unsigned) -1;
+		ref->bit_count = 0;
 	}
 
 	debugbreak_if( NULL == context )
@@ -107,8 +146,10 @@ btl_result_t btl_append_ptr_entry(
 		return BTL_ERROR_INVALID_PARAMETER;
 	debugbreak_if( 0 == bit_count )
 		return BTL_ERROR_INVALID_PARAMETER;
+	debugbreak_if( root_index >= BTL_MAX_ROOT_COUNT )
+		return BTL_ERROR_INVALID_PARAMETER;
 
-	table = &context->root_table;
+	table = btl_context_root_table( context, root_index );
 
 	// Generate entry sequence
 	btl_bitfield_iterator_initialize( &iterator, value, 0, bit_count );
@@ -125,6 +166,8 @@ btl_result_t btl_append_ptr_entry(
 			return result;
 		debugbreak_if( index >= (1UL << table->l2_table_size) )
 			return BTL_ERROR_INVALID_PARAMETER;
+		if( 0 != (table->flags & BTL_TABLE_F_SPARSE) )		// sparse tables are final (see btl_compact_tables)
+			return BTL_ERROR_SPARSE_TABLE;
 
 		// Check entry status
 		entry_type = &table->entry_type[index];
@@ -158,27 +201,72 @@ btl_result_t btl_append_ptr_entry(
 		table = subtable;
 	}
 
-	// If bits exactly fit the table, create a single normal (non-subtable) entry
-	if( table->l2_table_size == index_bit_count ) {
+	// Create a normal (non-subtable) entry at every index that starts with the remaining bits
+	count = 1U << (table->l2_table_size - index_bit_count);
+	for( i = 1; i < count; ++ i ) {
+		if( (uint8_t) btl_et_unused != table->entry_type[index | (i << index_bit_count)] )
+			return BTL_ERROR_ENTRY_ALREADY_OCCUPIED;
+	}
+	for( i = 0; i < count; ++ i ) {
+		entry_data = &table->entry_data[index | (i << index_bit_count)];
 		entry_data->entry_ptr_param = NULL;
 		entry_data->entry_int_param = 0;
-		*entry_type = btl_et_data;
-	}
-	// If bits are less than the the table size, create a group of normal (non-subtable) entries
-	else if( table->l2_table_size > index_bit_count ) {
-		unsigned diff = table->l2_table_size - index_bit_count;
-		unsigned i, count = 1 << diff;
-		for( i = 0; i < count; ++ i ) {
-			entry_data[i].entry_ptr_param = NULL;
-			entry_data[i].entry_int_param = 0;
-			entry_type[i] = btl_et_data;
-		}
+		table->entry_type[index | (i << index_bit_count)] = btl_et_data;
+		table->entry_bits[index | (i << index_bit_count)] = (unsigned char) index_bit_count;
 	}
 
 	// Done
 	if( NULL != ref ) {
 		ref->table = table;
 		ref->index = index;
+		ref->bit_count = index_bit_count;
+	}
+
+	// Exit
+	return BTL_SUCCESS;
+}
+
+/**
+ * @brief Set type and data of an appended entry.
+ * @param[in] ref (btl_entry_ref *) entry "address" returned by the append function.
+ * @param[in] entry_type (uint8_t) btl_et_data, BTL_ET_SWITCH_ROOT( n ) or BTL_ET_EXTRA_BITS( n ).
+ * @param[in] entry_ptr_param (const void *) data pointer.
+ * @param[in] entry_int_param (size_t) data integer.
+ * @return (btl_result) status code.
+ *
+ *	All entries occupied by a short sequence are set.
+ */
+btl_result_t btl_set_entry(
+	btl_entry_ref *	ref,
+	uint8_t			entry_type,
+	const void *	entry_ptr_param,
+	size_t			entry_int_param
+	)
+{
+	btl_table * table;
+	unsigned i, count, index;
+
+	// Check current state
+	debugbreak_if( NULL == ref || NULL == ref->table )
+		return BTL_ERROR_INVALID_PARAMETER;
+	debugbreak_if( entry_type < (uint8_t) btl_et_data || entry_type > BTL_ET_EXTRA_BITS( BTL_MAX_EXTRA_BIT_COUNT ) )
+		return BTL_ERROR_INVALID_PARAMETER;
+	debugbreak_if( ref->bit_count > ref->table->l2_table_size || ref->index >= (1U << ref->bit_count) )
+		return BTL_ERROR_INVALID_PARAMETER;
+
+	// Set all entries; sparse tables have a single entry per code
+	table = ref->table;
+	count = 1U << (table->l2_table_size - ref->bit_count);
+	if( 0 != (table->flags & BTL_TABLE_F_SPARSE) ) {
+		debugbreak_if( ref->index >= table->sparse_count )
+			return BTL_ERROR_INVALID_PARAMETER;
+		count = 1;
+	}
+	for( i = 0; i < count; ++ i ) {
+		index = ref->index | (i << ref->bit_count);
+		table->entry_data[index].entry_ptr_param = entry_ptr_param;
+		table->entry_data[index].entry_int_param = entry_int_param;
+		table->entry_type[index] = entry_type;
 	}
 
 	// Exit
@@ -220,12 +308,22 @@ btl_result_t btl_remove_ref_entry(
 btl_result_t btl_remove_all_entries(
 	btl_context *	context
 ) {
+	btl_result_t result;
+	unsigned i;
+
 	// Check current state
 	debugbreak_if( NULL == context )
 		return BTL_ERROR_INVALID_PARAMETER;
 
+	// Deinitialize all root tables
+	for( i = 0; i < BTL_MAX_ROOT_COUNT; ++ i ) {
+		result = btl_table_deinitialize( btl_context_root_table( context, i ) );
+		if( 0 != result )
+			return result;
+	}
+
 	// Exit
-	return btl_table_deinitialize( &context->root_table );
+	return BTL_SUCCESS;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -244,7 +342,7 @@ btl_result_t btl_find_imm_entry64(
 	unsigned		bit_count,
 	btl_entry_ref *	ref
 ) {
-	debugbreak_if( bit_count > sizeof(bit_value) )
+	debugbreak_if( bit_count > sizeof(bit_value) * 8 )
 		return BTL_ERROR_INVALID_PARAMETER;
 
 	return btl_find_ptr_entry(
@@ -268,7 +366,7 @@ btl_result_t btl_find_imm_entry32(
 	unsigned		bit_count,
 	btl_entry_ref *	ref
 ) {
-	debugbreak_if( bit_count > sizeof(bit_value) )
+	debugbreak_if( bit_count > sizeof(bit_value) * 8 )
 		return BTL_ERROR_INVALID_PARAMETER;
 
 	return btl_find_ptr_entry(
@@ -304,6 +402,7 @@ btl_result_t btl_find_ptr_entry(
 	if( NULL != ref ) {
 		ref->table = NULL;
 		ref->index = (unsigned) -1;
+		ref->bit_count = 0;
 	}
 
 	debugbreak_if( NULL == context )
@@ -331,6 +430,14 @@ btl_result_t btl_find_ptr_entry(
 		if( index >= (1UL << table->l2_table_size) )
 			return BTL_ERROR_INVALID_PARAMETER;
 
+		// Sparse tables are searched for the key that matches the index
+		if( 0 != (table->flags & BTL_TABLE_F_SPARSE) ) {
+			index = btl_table_find_sparse( table, index );
+			if( index == table->sparse_count )
+				return BTL_ERROR_INVALID_PARAMETER;
+			index_bit_count = table->l2_table_size;
+		}
+
 		// Check entry status
 		entry_type = &table->entry_type[index];
 		entry_data = &table->entry_data[index];
@@ -344,6 +451,7 @@ btl_result_t btl_find_ptr_entry(
 	if( NULL != ref ) {
 		ref->table = table;
 		ref->index = index;
+		ref->bit_count = index_bit_count;
 	}
 
 	if( !btl_bitfield_iterator_finished( &iterator ) )// if no more bits left, leave the loop
@@ -385,6 +493,7 @@ btl_result_t btl_is_entry_tbl_valid(
 )
 {
 	btl_result_t result;
+	unsigned i;
 
 	// Check current state
 	debugbreak_if( NULL == context )
@@ -393,7 +502,7 @@ btl_result_t btl_is_entry_tbl_valid(
 		return BTL_ERROR_INVALID_PARAMETER;
 
 	// Loop checking entire hierarchy of the tables
-	do {
+	for(;;) {
 
 		// Check table validity
 		result = btl_table_valid( table );
@@ -401,16 +510,21 @@ btl_result_t btl_is_entry_tbl_valid(
 			return result;
 
 		// Check index validity
-		if( index >= (1UL << table->l2_table_size) )
+		if( index >= (0 != (table->flags & BTL_TABLE_F_SPARSE) ? table->sparse_count : 1UL << table->l2_table_size) )
 			return BTL_ERROR_INVALID_SIZE;
 
 		// Move level up
+		if( NULL == table->parent_table )
+			break;
 		index = table->parent_index;
 		table = table->parent_table;
 
-	} while( NULL != table );
+	}
 
-	if( &context->root_table != table )	// the last table must be the root table of the context
+	// The last table must be a root table of the context
+	for( i = 0; i < BTL_MAX_ROOT_COUNT && btl_context_root_table( context, i ) != table; ++ i )
+		;
+	if( BTL_MAX_ROOT_COUNT == i )
 		return BTL_ERROR_UNRELATED;
 
 	// Exit
@@ -422,15 +536,29 @@ btl_result_t btl_is_entry_tbl_valid(
 /**
  * @brief Pefform bufer decode.
  * @param[in] context (btl_context *) context object.
+ * @param[in,out] root_index (unsigned *) optional root table of the first code, receives root table of the next code.
  * @param[in] decode_callback (btl_decode_callback) callback to be called each time an entry is decoded.
  * @param[in] callback_param (void *) decode callback parameter.
  * @param[in] data (const void *) data buffer.
  * @param[in] data_bit_offset (size_t) offset of first valid bit.
  * @param[in] data_bit_count (size_t) number of valid bits in the data buffer.
  * @return (btl_result) status code.
+ *
+ *	Each table is indexed with l2_table_size bits; index bits beyond the code of the found entry (entry_bits) are
+ * returned to the stream, they start the extra bits or the next code. A code cut by the end of data fails with
+ * BTL_ERROR_NO_MORE_DATA.
+ *
+ *	The first code is decoded with root table *root_index, or with root table 0 if root_index is NULL. A
+ * BTL_ET_SWITCH_ROOT entry is decoded as a data entry and selects the root table of the following codes; the
+ * selection is stored back to *root_index, so the next call may continue with the same table. A BTL_ET_EXTRA_BITS( n )
+ * entry takes n raw bits that follow the code (first bit is the least significant one) and passes their value added
+ * to entry_int_param, e.g. a DEFLATE length.
+ *
+ *	Decoding doesn't modify the context, so several threads may decode with the same tables at once.
  */
 btl_result_t btl_decode(
 	btl_context *		context,
+	unsigned *			root_index_ptr,
 	btl_decode_callback	decode_callback,
 	void *				callback_param,
 	const void *		data,
@@ -438,13 +566,17 @@ btl_result_t btl_decode(
 	size_t				data_bit_count
 )
 {
-	btl_result_t result;
+	btl_result_t result = BTL_SUCCESS;
 	btl_bitfield_iterator iterator;
+	btl_table *		roots[BTL_MAX_ROOT_COUNT];
+	btl_table *		root;
 	btl_table *		table;
 	uint8_t			entry_type;
 	btl_entry_data *entry_data;
 	unsigned		index_bit_count;
 	uint32_t		index = (uint32_t) -1;
+	uint32_t		extra_bits;
+	unsigned		root_index = NULL == root_index_ptr ? 0 : *root_index_ptr, i;
 
 	// Check current state
 	debugbreak_if( NULL == context )
@@ -453,13 +585,19 @@ btl_result_t btl_decode(
 		return BTL_ERROR_INVALID_PARAMETER;
 	debugbreak_if( NULL == data )
 		return BTL_ERROR_INVALID_PARAMETER;
+	debugbreak_if( root_index >= BTL_MAX_ROOT_COUNT )
+		return BTL_ERROR_INVALID_PARAMETER;
+
+	for( i = 0; i < BTL_MAX_ROOT_COUNT; ++ i )
+		roots[i] = btl_context_root_table( context, i );
+	root = roots[root_index];
 
 	// Generate entry sequence
 	btl_bitfield_iterator_initialize( &iterator, data, data_bit_offset, data_bit_count );
 	for(;;)
 	{
-		// Start new bit sequence from the root table
-		table = &context->root_table;
+		// Start new bit sequence from the current root table
+		table = root;
 
 		// If entire buffer is passed, exit
 		if( btl_bitfield_iterator_finished( &iterator ) )
@@ -480,6 +618,15 @@ btl_result_t btl_decode(
 			debugbreak_if( index >= (1UL << table->l2_table_size) )
 				return BTL_ERROR_INVALID_DATA;
 
+			// Sparse tables are searched for the key that matches the index; nothing matches unused entries
+			if( 0 != (table->flags & BTL_TABLE_F_SPARSE) ) {
+				index = btl_table_find_sparse( table, index );
+				if( index == table->sparse_count ) {
+					entry_type = (uint8_t) btl_et_unused;
+					break;
+				}
+			}
+
 			// Check entry status
 			entry_type =  table->entry_type[index];
 			entry_data = &table->entry_data[index];
@@ -490,6 +637,17 @@ btl_result_t btl_decode(
 			table = entry_data->table;
 		}
 
+		// Return index bits that follow the code; callback entries take the whole index
+		if( (uint8_t) btl_et_data <= entry_type ) {
+			if( table->entry_bits[index] > index_bit_count ) {
+				result = BTL_ERROR_NO_MORE_DATA;
+				break;
+			}
+			result = btl_bitfield_iterator_unfetch( &iterator, index_bit_count - table->entry_bits[index] );
+			if( BTL_SUCCESS != result )
+				break;
+		}
+
 		// If it's a callback entry, call the entry callback
 		if( (uint8_t) btl_et_callback == entry_type )
 		{
@@ -497,7 +655,7 @@ btl_result_t btl_decode(
 				return BTL_ERROR_NULL_CALLBACK;
 
 			result = (*entry_data->callback)(
-				entry_data->m_callback_param,
+				entry_data->callback_param,
 				table,
 				index
 			);
@@ -508,17 +666,51 @@ btl_result_t btl_decode(
 				entry_data->entry_ptr_param,
 				entry_data->entry_int_param
 			);
+		// Extra bits entries add raw bits following the code to the data integer
+		} else if( BTL_ET_EXTRA_BITS( 0 ) <= entry_type ) {
+			extra_bits = 0;
+			index_bit_count = entry_type - BTL_ET_EXTRA_BITS( 0 );
+			if( 0 != index_bit_count ) {
+				result = btl_bitfield_iterator_fetch(
+					&iterator,
+					&extra_bits,
+					index_bit_count,
+					&i
+				);
+				if( BTL_SUCCESS != result )
+					break;
+				if( i != index_bit_count ) {
+					result = BTL_ERROR_NO_MORE_DATA;
+					break;
+				}
+			}
+			result = (*decode_callback)(
+				callback_param,
+				entry_data->entry_ptr_param,
+				entry_data->entry_int_param + extra_bits
+			);
+		// Switch entries also select the root table of the next code
+		} else if( (uint8_t) btl_et_switch_root <= entry_type ) {
+			result = (*decode_callback)(
+				callback_param,
+				entry_data->entry_ptr_param,
+				entry_data->entry_int_param
+			);
+			root_index = entry_type - (uint8_t) btl_et_switch_root;
+			root = roots[root_index];
 		}
 
 		// Process callback result
 		if( BTL_STOP == result )
 			break;
 		if( BTL_SUCCESS != result )
-			return result;
+			break;
 	}
 
 	// Exit
-	return BTL_SUCCESS;
+	if( NULL != root_index_ptr )
+		*root_index_ptr = root_index;
+	return BTL_SUCCESS == result || BTL_STOP == result ? BTL_SUCCESS : result;
 }
 
 /*END OF context.c*/
@@ -7,6 +7,7 @@
 
 extern btl_heap_allocator	default_heap_allocator;
 extern btl_table_allocator	default_table_allocator;
+#define btl_get_heap_allocator( context )	(NULL != (context)->heap_allocator ? (context)->heap_allocator : &default_heap_allocator)
 
 #define ASSERT(expr)
 
@@ -24,7 +25,7 @@ struct btl_bitfield_iterator {
 	const uint8_t *	data_end;		//< pointer to the end of bit buffer (a first byte after the last byte)
 	size_t			data_bits_left;	//< total bits left in acc and in the data array
 	unsigned		acc_bits_left;	//< number of bits left in the accumulator
-	uint32_t		acc;			//< accumulator (work area)
+	uint64_t		acc;			//< accumulator (work area); holds a 32-bit fetch and the start of the next one
 };
 btl_result_t btl_bitfield_iterator_initialize(
 	btl_bitfield_iterator *	iterator,
@@ -38,6 +39,10 @@ btl_result_t btl_bitfield_iterator_fetch(
 	unsigned				required_size,
 	unsigned *				acquired_size
 	);
+btl_result_t btl_bitfield_iterator_unfetch(
+	btl_bitfield_iterator *	iterator,
+	unsigned				bit_count
+	);
 #define btl_bitfield_iterator_finished( iterator )		(NULL == (iterator) || 0 == (iterator)->data_bits_left)
 
 // table.c
@@ -54,5 +59,9 @@ btl_result_t btl_table_destroy(
 btl_result_t _btl_table_release_arrays(
 	btl_table *		table
 	);
+unsigned btl_table_find_sparse(
+	const btl_table *	table,
+	uint32_t			index
+	);
 
 /*END OF internal.h*/
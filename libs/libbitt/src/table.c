@@ -3,6 +3,7 @@
  *
  * @brief Table related functions.
  */
+#include <string.h>
 #include "internal.h"
 
 /**
@@ -100,7 +101,7 @@ btl_result_t btl_table_destroy(
 		return BTL_ERROR_INVALID_PARAMETER;
 	context = table->context;
 
-	debugbreak_if( &context->root_table == table )
+	debugbreak_if( NULL == table->parent_table )	// root tables are not allocated
 		return BTL_ERROR_INVALID_PARAMETER;
 
 	if( NULL != context->table_allocator ) {
@@ -163,6 +164,9 @@ btl_result_t btl_table_initialize(
 	table->parent_index = parent_index;
 	table->l2_table_size = 0;
 	table->flags = 0;
+	table->sparse_keys = NULL;
+	table->sparse_count = 0;
+	table->entry_bits = NULL;
 
 	// Exit
 	return BTL_SUCCESS;
@@ -186,7 +190,7 @@ btl_result_t btl_table_deinitialize(
 	// Clean up the table object
 	if( 0 != table->l2_table_size ) {
 		size_t i;
-		size_t count = 1UL << table->l2_table_size;
+		size_t count = 0 != (table->flags & BTL_TABLE_F_SPARSE) ? table->sparse_count : 1UL << table->l2_table_size;
 
 		// Delete all nested tables
 		for( i = 0; i < count; ++ i ) {
@@ -236,6 +240,7 @@ btl_result_t btl_table_valid(
 btl_result_t _btl_table_release_arrays(
 	btl_table *	table
 	) {
+	btl_heap_allocator * allocator;
 
 	// Check current state
 	debugbreak_if( NULL == table )
@@ -243,23 +248,44 @@ btl_result_t _btl_table_release_arrays(
 	if( 0 == table->l2_table_size )
 		return BTL_SUCCESS;
 
-	// Release buffers
-	if( table->flags & BTL_TABLE_F_EXT_ARRAYS ) {
+	// Release buffers; external arrays are owned by the client
+	if( 0 == (table->flags & BTL_TABLE_F_EXT_ARRAYS) ) {
+		allocator = btl_get_heap_allocator( table->context );
 
-		table->context->heap_allocator->alloc(
-			table->context->heap_allocator,
-			&table->entry_type,
+		allocator->alloc(
+			allocator,
+			(void **) &table->entry_type,
 			0
 			);
 
-		table->context->heap_allocator->alloc(
-			table->context->heap_allocator,
-			&table->entry_data,
+		allocator->alloc(
+			allocator,
+			(void **) &table->entry_data,
 			0
 			);
+
+		allocator->alloc(
+			allocator,
+			(void **) &table->entry_bits,
+			0
+			);
+
+		if( NULL != table->sparse_keys ) {
+			allocator->alloc(
+				allocator,
+				(void **) &table->sparse_keys,
+				0
+				);
+		}
 	}
 
+	table->entry_type = NULL;
+	table->entry_data = NULL;
 	table->l2_table_size = 0;
+	table->flags &= ~(BTL_TABLE_F_EXT_ARRAYS | BTL_TABLE_F_SPARSE);
+	table->sparse_keys = NULL;
+	table->sparse_count = 0;
+	table->entry_bits = NULL;
 
 	// Exit
 	return BTL_SUCCESS;
@@ -276,6 +302,7 @@ btl_result_t btl_table_set_size(
 	size_t		l2_entry_count
 ) {
 	btl_result_t result;
+	btl_heap_allocator * allocator;
 
 	// Check current state
 	debugbreak_if( NULL == table )
@@ -288,30 +315,53 @@ btl_result_t btl_table_set_size(
 	if( BTL_SUCCESS != result )
 		return result;
 
-	// Set new data
+	// Set new data; all entries are initially unused
 	if( 0 != l2_entry_count ) {
-		result = table->context->heap_allocator->alloc(
-			table->context->heap_allocator,
-			&table->entry_type,
-			1 << l2_entry_count
+		allocator = btl_get_heap_allocator( table->context );
+
+		result = allocator->alloc(
+			allocator,
+			(void **) &table->entry_type,
+			(size_t) 1 << l2_entry_count
 			);
 		if( BTL_SUCCESS != result )
 			return result;
 
-		result = table->context->heap_allocator->alloc(
-			table->context->heap_allocator,
-			&table->entry_data,
-			1 << l2_entry_count
+		result = allocator->alloc(
+			allocator,
+			(void **) &table->entry_data,
+			sizeof(btl_entry_data) << l2_entry_count
 			);
 		if( BTL_SUCCESS != result ) {
-			table->context->heap_allocator->alloc(
-				table->context->heap_allocator,
-				&table->entry_type,
+			allocator->alloc(
+				allocator,
+				(void **) &table->entry_type,
 				0
 				);
 			return result;
 		}
 
+		result = allocator->alloc(
+			allocator,
+			(void **) &table->entry_bits,
+			(size_t) 1 << l2_entry_count
+			);
+		if( BTL_SUCCESS != result ) {
+			allocator->alloc(
+				allocator,
+				(void **) &table->entry_data,
+				0
+				);
+			allocator->alloc(
+				allocator,
+				(void **) &table->entry_type,
+				0
+				);
+			return result;
+		}
+
+		memset( table->entry_type, btl_et_unused, (size_t) 1 << l2_entry_count );
+		memset( table->entry_bits, 0, (size_t) 1 << l2_entry_count );
 		table->l2_table_size = (uint8_t) l2_entry_count;
 	}
 
@@ -324,6 +374,7 @@ btl_result_t btl_table_set_size(
  * @param[in] table (btl_table *) pointer to the table object.
  * @param[in] table (unsigned char *) pointer to the array of entry types.
  * @param[in] table (btl_entry_data *) pointer to the array of entry data.
+ * @param[in] entry_bits (unsigned char *) pointer to the array of index bit counts taken by codes of entries.
  * @param[in] entry_count (size_t ) number of entries, should equal to 1 << table->l2_table_size.
  * @return (btl_result_t) status code.
  */
@@ -331,14 +382,16 @@ btl_result_t btl_table_set_arrays(
 	btl_table *		table,
 	unsigned char *	entry_type,
 	btl_entry_data *entry_data,
+	unsigned char *	entry_bits,
 	size_t			entry_count
 ) {
 	btl_result_t result;
+	uint8_t l2_table_size;
 
 	// Check current state
 	debugbreak_if( NULL == table )
 		return BTL_ERROR_INVALID_PARAMETER;
-	debugbreak_if( (NULL == entry_type) != (NULL == entry_data) )
+	debugbreak_if( (NULL == entry_type) != (NULL == entry_data) || (NULL == entry_type) != (NULL == entry_bits) )
 		return BTL_ERROR_INVALID_PARAMETER;
 	debugbreak_if( NULL == entry_type && 0 != entry_count )
 		return BTL_ERROR_INVALID_PARAMETER;
@@ -348,6 +401,7 @@ btl_result_t btl_table_set_arrays(
 		return BTL_ERROR_INVALID_PARAMETER;
 
 	// Release previous data
+	l2_table_size = table->l2_table_size;
 	result = _btl_table_release_arrays( table );
 	if( BTL_SUCCESS != result )
 		return result;
@@ -356,6 +410,8 @@ btl_result_t btl_table_set_arrays(
 	if( 0 != entry_count ) {
 		table->entry_type = entry_type;
 		table->entry_data = entry_data;
+		table->entry_bits = entry_bits;
+		table->l2_table_size = l2_table_size;
 		table->flags |= BTL_TABLE_F_EXT_ARRAYS;
 	}
 
@@ -363,4 +419,238 @@ btl_result_t btl_table_set_arrays(
 	return BTL_SUCCESS;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Find the entry of a sparse table selected by the index.
+ * @param[in] table (const btl_table *) pointer to the sparse table object.
+ * @param[in] index (uint32_t) index fetched for the table.
+ * @return (unsigned) position of the entry in the table arrays; table->sparse_count if no entry matches.
+ *
+ *	Codes are prefix-free, so at most one key matches. The loop doesn't stop at the match, compilers turn it into
+ * compares and selects without branches (and vectorize it where the target allows).
+ */
+unsigned btl_table_find_sparse(
+	const btl_table *	table,
+	uint32_t			index
+) {
+	const btl_sparse_key * keys = table->sparse_keys;
+	unsigned i, found = table->sparse_count;
+
+	for( i = 0; i < table->sparse_count; ++ i )
+		found = (index & keys[i].mask) == keys[i].bits ? i : found;
+
+	return found;
+}
+
+/**
+ * @brief Find the group of entries that repeat the entry at the index.
+ * @internal
+ *
+ *	A code shorter than the table is replicated at all indices that start with it. The group is the one with the
+ * fewest significant bits whose entries are all equal; equal entries of different codes of the same length can be
+ * merged as well.
+ */
+static unsigned _btl_table_group_bit_count(
+	const btl_table *	table,
+	uint32_t			index
+) {
+	const btl_entry_data * entry_data = &table->entry_data[index];
+	uint32_t bit_count, i, other;
+
+	for( bit_count = 0; bit_count < table->l2_table_size; ++ bit_count ) {
+		for( i = 0; i < (1UL << (table->l2_table_size - bit_count)); ++ i ) {
+			other = (index & ((1UL << bit_count) - 1)) | (i << bit_count);
+			if( table->entry_type[other] != table->entry_type[index]
+				|| table->entry_bits[other] != table->entry_bits[index]
+				|| table->entry_data[other].entry_ptr_param != entry_data->entry_ptr_param
+				|| table->entry_data[other].entry_int_param != entry_data->entry_int_param )
+				break;
+		}
+		if( i == (1UL << (table->l2_table_size - bit_count)) )
+			break;
+	}
+
+	return bit_count;
+}
+
+/**
+ * @brief Collect groups of equal entries of a dense table.
+ * @internal
+ *
+ *	Stops after limit groups. If the arrays are given, keys and entries of the groups are stored, and subtables
+ * receive their positions as parent indices.
+ */
+static unsigned _btl_table_collect_groups(
+	btl_table *		table,
+	uint8_t *		covered,
+	unsigned		limit,
+	btl_sparse_key *keys,
+	unsigned char *	entry_type,
+	btl_entry_data *entry_data,
+	unsigned char *	entry_bits
+) {
+	uint32_t index, bit_count, mask, i;
+	unsigned count = 0;
+	size_t size = (size_t) 1 << table->l2_table_size;
+
+	memset( covered, 0, size );
+	for( index = 0; index < size && count < limit; ++ index ) {
+		if( 0 != covered[index] || (uint8_t) btl_et_unused == table->entry_type[index] )
+			continue;
+
+		// Mark all entries of the group
+		bit_count = _btl_table_group_bit_count( table, index );
+		mask = (uint32_t) ((1UL << bit_count) - 1);
+		for( i = 0; i < (1UL << (table->l2_table_size - bit_count)); ++ i )
+			covered[(index & mask) | (i << bit_count)] = 1;
+
+		// Store the group
+		if( NULL != keys ) {
+			keys[count].bits = index & mask;
+			keys[count].mask = mask;
+			entry_type[count] = table->entry_type[index];
+			entry_data[count] = table->entry_data[index];
+			entry_bits[count] = table->entry_bits[index];
+			if( (uint8_t) btl_et_subtable == entry_type[count] )
+				entry_data[count].table->parent_index = count;
+		}
+		++ count;
+	}
+
+	return count;
+}
+
+/**
+ * @brief Convert a dense subtable to the sparse form if it has few enough entries.
+ * @internal
+ */
+static btl_result_t _btl_table_make_sparse(
+	btl_table *		table,
+	unsigned		max_sparse_count
+) {
+	btl_result_t result;
+	btl_heap_allocator * allocator;
+	uint8_t * covered = NULL;
+	btl_sparse_key * keys = NULL;
+	unsigned char * entry_type = NULL;
+	btl_entry_data * entry_data = NULL;
+	unsigned char * entry_bits = NULL;
+	uint8_t l2_table_size = table->l2_table_size;
+	unsigned count;
+
+	// Count groups; keep the table dense if there are too many of them
+	allocator = btl_get_heap_allocator( table->context );
+	result = allocator->alloc( allocator, (void **) &covered, (size_t) 1 << l2_table_size );
+	if( BTL_SUCCESS != result )
+		return result;
+
+	count = _btl_table_collect_groups( table, covered, max_sparse_count + 1, NULL, NULL, NULL, NULL );
+	if( 0 == count || max_sparse_count < count || ((size_t) 1 << l2_table_size) == count ) {
+		allocator->alloc( allocator, (void **) &covered, 0 );
+		return BTL_SUCCESS;
+	}
+
+	// Allocate and fill sparse arrays
+	result = allocator->alloc( allocator, (void **) &keys, count * sizeof(btl_sparse_key) );
+	if( BTL_SUCCESS == result )
+		result = allocator->alloc( allocator, (void **) &entry_type, count );
+	if( BTL_SUCCESS == result )
+		result = allocator->alloc( allocator, (void **) &entry_data, count * sizeof(btl_entry_data) );
+	if( BTL_SUCCESS == result )
+		result = allocator->alloc( allocator, (void **) &entry_bits, count );
+	if( BTL_SUCCESS != result ) {
+		allocator->alloc( allocator, (void **) &entry_bits, 0 );
+		allocator->alloc( allocator, (void **) &entry_data, 0 );
+		allocator->alloc( allocator, (void **) &entry_type, 0 );
+		allocator->alloc( allocator, (void **) &keys, 0 );
+		allocator->alloc( allocator, (void **) &covered, 0 );
+		return result;
+	}
+	(void) _btl_table_collect_groups( table, covered, count, keys, entry_type, entry_data, entry_bits );
+	allocator->alloc( allocator, (void **) &covered, 0 );
+
+	// Replace dense arrays
+	_btl_table_release_arrays( table );
+	table->entry_type = entry_type;
+	table->entry_data = entry_data;
+	table->entry_bits = entry_bits;
+	table->l2_table_size = l2_table_size;
+	table->flags |= BTL_TABLE_F_SPARSE;
+	table->sparse_keys = keys;
+	table->sparse_count = count;
+
+	// Exit
+	return BTL_SUCCESS;
+}
+
+/**
+ * @brief Compact subtables of the table tree.
+ * @internal
+ */
+static btl_result_t _btl_table_compact(
+	btl_table *		table,
+	unsigned		max_sparse_count
+) {
+	btl_result_t result;
+	size_t i, count;
+
+	// Compact nested tables first, their objects stay in place
+	if( 0 == table->l2_table_size )
+		return BTL_SUCCESS;
+	count = 0 != (table->flags & BTL_TABLE_F_SPARSE) ? table->sparse_count : (size_t) 1 << table->l2_table_size;
+	for( i = 0; i < count; ++ i ) {
+		if( (uint8_t) btl_et_subtable == table->entry_type[i] ) {
+			result = _btl_table_compact( table->entry_data[i].table, max_sparse_count );
+			if( BTL_SUCCESS != result )
+				return result;
+		}
+	}
+
+	// Root tables and client arrays stay dense
+	if( NULL == table->parent_table || 0 != (table->flags & (BTL_TABLE_F_EXT_ARRAYS | BTL_TABLE_F_SPARSE)) )
+		return BTL_SUCCESS;
+
+	// Exit
+	return _btl_table_make_sparse( table, max_sparse_count );
+}
+
+/**
+ * @brief Convert subtables with few entries to the sparse form.
+ * @param[in] context (btl_context *) context object.
+ * @param[in] max_sparse_count (unsigned) maximum number of entries of a sparse table; 0 = BTL_DEFAULT_SPARSE_ENTRY_COUNT.
+ * @return (btl_result_t) status code.
+ *
+ *	A dense table has 1 << l2_table_size entries, even if only a few long codes pass through it. A sparse table
+ * keeps one entry per code (a code shorter than the table isn't replicated) with the key that selects it, and
+ * btl_decode compares the fetched index with all keys. Root tables stay dense, so do tables with arrays set by
+ * btl_table_set_arrays.
+ *
+ *	The function is called after all entries have been appended: appending a code that passes through a sparse
+ * table fails with BTL_ERROR_SPARSE_TABLE.
+ */
+btl_result_t btl_compact_tables(
+	btl_context *	context,
+	unsigned		max_sparse_count
+) {
+	btl_result_t result;
+	unsigned i;
+
+	// Check current state
+	debugbreak_if( NULL == context )
+		return BTL_ERROR_INVALID_PARAMETER;
+	if( 0 == max_sparse_count )
+		max_sparse_count = BTL_DEFAULT_SPARSE_ENTRY_COUNT;
+
+	// Compact trees of all root tables
+	for( i = 0; i < BTL_MAX_ROOT_COUNT; ++ i ) {
+		result = _btl_table_compact( btl_context_root_table( context, i ), max_sparse_count );
+		if( BTL_SUCCESS != result )
+			return result;
+	}
+
+	// Exit
+	return BTL_SUCCESS;
+}
+
 /*END OF table.c*/
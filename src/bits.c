@@ -48,4 +48,19 @@ void bitcpy( void * dst_bits, size_t dst_bits_offset, const void * src_bits, uns
 	return;
 }
 
+uint32_t bitload32( const void * src_bits, size_t src_bit_offset, unsigned bit_count )
+{
+	const uint8_t * src = (const uint8_t *) src_bits + src_bit_offset / 8;
+	const unsigned	shift = (unsigned) (src_bit_offset % 8);
+	const unsigned	byte_count = (shift + bit_count + 7) / 8;	// 5 bytes at most
+	uint64_t	value = 0;
+	unsigned	i;
+
+	// Load only bytes that contain requested bits so the end of the buffer is never crossed
+	for( i = 0; i < byte_count; ++ i )
+		value |= (uint64_t) src[i] << (i * 8);
+
+	return (uint32_t) ((value >> shift) & ((UINT64_C(1) << bit_count) - 1));
+}
+
 /*END OF bits.c*/
@@ -0,0 +1,244 @@
+/*codelen.c*/
+#include "pch.h"
+#include "main.h"
+
+/**
+ * @brief Sort symbol indices by ascending symbol count.
+ * @internal
+ *
+ *	Shell sort keeps the library free of the C runtime; alphabets are small enough.
+ */
+static void _sort_by_count( size_t * index, const uint64_t * counts, size_t n )
+{
+	static const size_t gaps[] = { 701, 301, 132, 57, 23, 10, 4, 1 };
+	size_t	g, i, j, gap, value;
+
+	for( g = 0; g < sizeof(gaps) / sizeof(*gaps); ++ g ) {
+		gap = gaps[g];
+		for( i = gap; i < n; ++ i ) {
+			value = index[i];
+			for( j = i; j >= gap && counts[index[j - gap]] > counts[value]; j -= gap )
+				index[j] = index[j - gap];
+			index[j] = value;
+		}
+	}
+}
+
+/**
+ * @brief Calculate Huffman code lengths in place (Moffat and Katajainen).
+ * @internal
+ * @param[in,out] a (uint64_t *) ascending symbol counts on input, code lengths on output.
+ * @param[in] n (size_t) number of symbols, at least 2.
+ */
+static void _calculate_lengths_in_place( uint64_t * a, size_t n )
+{
+	size_t		root, leaf, next, avail, used, depth;
+	ptrdiff_t	t;
+
+	// Build tree: internal nodes replace counts, children point to parents
+	root = 0;
+	leaf = 0;
+	for( next = 0; next < n - 1; ++ next ) {
+
+		// First child
+		if( leaf >= n || (root < next && a[root] < a[leaf]) ) {
+			a[next] = a[root];
+			a[root ++] = next;
+		} else
+			a[next] = a[leaf ++];
+
+		// Second child
+		if( leaf >= n || (root < next && a[root] < a[leaf]) ) {
+			a[next] += a[root];
+			a[root ++] = next;
+		} else
+			a[next] += a[leaf ++];
+	}
+
+	// Convert parent pointers to internal node depths
+	a[n - 2] = 0;
+	for( t = (ptrdiff_t) n - 3; t >= 0; -- t )
+		a[t] = a[a[t]] + 1;
+
+	// Convert internal node depths to leaf depths
+	avail = 1;
+	used = 0;
+	depth = 0;
+	t = (ptrdiff_t) n - 2;
+	next = n;
+	while( 0 < avail ) {
+		while( t >= 0 && a[t] == depth ) {
+			++ used;
+			-- t;
+		}
+		while( avail > used ) {
+			a[-- next] = depth;
+			-- avail;
+		}
+		avail = 2 * used;
+		++ depth;
+		used = 0;
+	}
+}
+
+/**
+ * @brief Build length-limited Huffman code lengths from symbol counts.
+ * @param[in] allocator (f2_allocator *) allocator used for temporary buffers.
+ * @param[in] counts (const uint64_t *) symbol counts.
+ * @param[in] symbol_count (size_t) number of symbols in the alphabet.
+ * @param[in] max_length (unsigned) maximum code length, 1..LIBHUFFMAN_MAX_CODE_LENGTH.
+ * @param[out] lengths (uint8_t *) code lengths; 0 for symbols which never occur.
+ * @return (f2_status_t) operation status code.
+ *
+ *	Lengths that exceed the limit are clamped, then the least frequent symbols are moved one level deeper until
+ * the Kraft inequality holds again.
+ */
+f2_status_t f2_callconv libhuffman_build_code_lengths(
+	f2_allocator *		allocator,
+	const uint64_t *	counts,
+	size_t				symbol_count,
+	unsigned			max_length,
+	uint8_t *			lengths
+) {
+	f2_status_t	status;
+	size_t *	index = nullptr;
+	uint64_t *	work = nullptr;
+	size_t		i, n;
+	uint64_t	kraft;
+
+	// Check current state
+	debugbreak_if( nullptr == allocator || nullptr == counts || nullptr == lengths )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 0 == max_length || LIBHUFFMAN_MAX_CODE_LENGTH < max_length )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	if( 62 < max_length )
+		max_length = 62;	// the Kraft sum below is kept in 64 bits; deeper trees need counts above 2^42 anyway
+
+	// Collect used symbols
+	status = allocator->alloc( allocator, (void **) &index, symbol_count * sizeof(*index), 0 );
+	if( f2_failed( status ) )
+		return status;
+	n = 0;
+	for( i = 0; i < symbol_count; ++ i ) {
+		lengths[i] = 0;
+		if( 0 != counts[i] )
+			index[n ++] = i;
+	}
+	debugbreak_if( (uint64_t) n > ((uint64_t) 1 << max_length) ) {
+		(void) allocator->free( allocator, (void **) &index, symbol_count * sizeof(*index), 0 );
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	}
+
+	// Trivial alphabets
+	if( 2 > n ) {
+		if( 1 == n )
+			lengths[index[0]] = 1;
+		(void) allocator->free( allocator, (void **) &index, symbol_count * sizeof(*index), 0 );
+		return F2_STATUS_SUCCESS;
+	}
+
+	// Calculate unlimited lengths
+	status = allocator->alloc( allocator, (void **) &work, n * sizeof(*work), 0 );
+	if( f2_failed( status ) ) {
+		(void) allocator->free( allocator, (void **) &index, symbol_count * sizeof(*index), 0 );
+		return status;
+	}
+	_sort_by_count( index, counts, n );
+	for( i = 0; i < n; ++ i )
+		work[i] = counts[index[i]];
+	_calculate_lengths_in_place( work, n );
+
+	// Limit lengths
+	kraft = 0;
+	for( i = 0; i < n; ++ i ) {
+		if( work[i] > max_length )
+			work[i] = max_length;
+		kraft += (uint64_t) 1 << (max_length - work[i]);
+	}
+	while( kraft > ((uint64_t) 1 << max_length) ) {
+		for( i = 0; i < n; ++ i ) {
+			if( work[i] < max_length ) {
+				++ work[i];
+				kraft -= (uint64_t) 1 << (max_length - work[i]);
+				break;
+			}
+		}
+	}
+
+	// Store lengths
+	for( i = 0; i < n; ++ i )
+		lengths[index[i]] = (uint8_t) work[i];
+
+	// Exit
+	(void) allocator->free( allocator, (void **) &work, n * sizeof(*work), 0 );
+	(void) allocator->free( allocator, (void **) &index, symbol_count * sizeof(*index), 0 );
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Reverse order of code bits.
+ * @param[in] bits (libhuffman_code_t) code bits.
+ * @param[in] length (unsigned) code length, in bits.
+ * @return (libhuffman_code_t) code with bit 0 swapped with bit length-1 and so on.
+ *
+ *	Table files write codes in transmission order while the library keeps the first transmitted bit in bit 0 of
+ * the code value; this converts between the two.
+ */
+libhuffman_code_t f2_callconv libhuffman_reverse_code( libhuffman_code_t bits, unsigned length )
+{
+	libhuffman_code_t	reversed = 0;
+
+	for( ; 0 != length; -- length, bits >>= 1 )
+		reversed = (libhuffman_code_t) ((reversed << 1) | (bits & 1));
+	return reversed;
+}
+
+/**
+ * @brief Assign canonical codes to code lengths.
+ * @param[in] lengths (const uint8_t *) code lengths, 0 for unused symbols.
+ * @param[in] symbol_count (size_t) number of symbols in the alphabet.
+ * @param[out] codes (libhuffman_code_t *) codes; the first transmitted bit is bit 0 of the code value, which is the
+ *		last digit of the code in the text table format.
+ * @return (f2_status_t) operation status code.
+ */
+f2_status_t f2_callconv libhuffman_build_canonical_codes(
+	const uint8_t *		lengths,
+	size_t				symbol_count,
+	libhuffman_code_t *	codes
+) {
+	unsigned			length_counts[LIBHUFFMAN_MAX_CODE_LENGTH + 1] = { 0 };
+	libhuffman_code_t	next_code[LIBHUFFMAN_MAX_CODE_LENGTH + 1];
+	libhuffman_code_t	code;
+	unsigned			length;
+	size_t				i;
+
+	// Check current state
+	debugbreak_if( nullptr == lengths || nullptr == codes )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Count codes of each length
+	for( i = 0; i < symbol_count; ++ i ) {
+		debugbreak_if( LIBHUFFMAN_MAX_CODE_LENGTH < lengths[i] )
+			return F2_STATUS_ERROR_INVALID_PARAMETER;
+		++ length_counts[lengths[i]];
+	}
+	length_counts[0] = 0;
+
+	// Calculate first code of each length
+	code = 0;
+	for( length = 1; length <= LIBHUFFMAN_MAX_CODE_LENGTH; ++ length ) {
+		code = (code + length_counts[length - 1]) << 1;
+		next_code[length] = code;
+	}
+
+	// Assign codes, reversed so that the most significant bit of the canonical code is transmitted first
+	for( i = 0; i < symbol_count; ++ i ) {
+		code = 0 == lengths[i] ? 0 : next_code[lengths[i]] ++;
+		codes[i] = libhuffman_reverse_code( code, lengths[i] );
+	}
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/*END OF codelen.c*/
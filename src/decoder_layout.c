@@ -0,0 +1,677 @@
+/*decoder_layout.c*/
+/** @file
+ * @brief Frozen decode layout: built decoder tables stored and attached without building.
+ *
+ */
+#include "pch.h"
+#include "main.h"
+
+/**
+ * @brief Get size of the memory block that holds all arrays of the layout.
+ * @internal
+ */
+static size_t _layout_memory_size( size_t table_count, size_t entry_count )
+{
+	return table_count * sizeof(libhuffman_layout_table) + entry_count * (sizeof(uint32_t) + sizeof(uint8_t));
+}
+
+/**
+ * @brief Count tables and entries of the built table tree.
+ * @internal
+ */
+static f2_status_t _count_tables( const btl_table * table, size_t * table_count, size_t * entry_count )
+{
+	f2_status_t	status;
+	size_t		i, count;
+
+	debugbreak_if( 0 == table->l2_table_size || LIBHUFFMAN_MAX_LAYOUT_L2_TABLE_SIZE < table->l2_table_size )
+		return F2_STATUS_ERROR_INVALID_DATA;
+	if( 0 != (table->flags & BTL_TABLE_F_SPARSE) )
+		return F2_STATUS_ERROR_INVALID_DATA;	// layouts are dense, freeze before btl_compact_tables
+	count = (size_t) 1 << table->l2_table_size;
+	++ *table_count;
+	*entry_count += count;
+
+	for( i = 0; i < count; ++ i ) {
+		if( (uint8_t) btl_et_callback == table->entry_type[i] )
+			return F2_STATUS_ERROR_INVALID_DATA;	// function pointers can't be frozen
+		if( (uint8_t) btl_et_subtable == table->entry_type[i] ) {
+			status = _count_tables( table->entry_data[i].table, table_count, entry_count );
+			if( f2_failed( status ) )
+				return status;
+		}
+	}
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Check that the layout is consistent, so it can be attached safely.
+ * @param[in] layout (const libhuffman_decoder_layout *) layout to check.
+ * @param[in] desc_count (size_t) number of code descriptors data entries refer to; (size_t) -1 to skip the check.
+ * @return (f2_status_t) operation status code; F2_STATUS_ERROR_INVALID_DATA if the layout is damaged.
+ *
+ *	Each subtable entry and the parent fields of the subtable must refer to each other, and subtables always follow
+ * their parents, so the tables form a tree.
+ */
+f2_status_t f2_callconv libhuffman_decoder_layout_validate(
+	const libhuffman_decoder_layout *	layout,
+	size_t								desc_count
+) {
+	const libhuffman_layout_table *	table;
+	const libhuffman_layout_table *	subtable;
+	size_t		t, i, count;
+	uint32_t	value;
+
+	// Check current state
+	debugbreak_if( nullptr == layout )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	if( 0 == layout->table_count || nullptr == layout->tables || nullptr == layout->entry_types || nullptr == layout->entry_values )
+		return F2_STATUS_ERROR_INVALID_DATA;
+	if( 0 != layout->tables[0].parent_table )
+		return F2_STATUS_ERROR_INVALID_DATA;
+
+	// Check tables
+	for( t = 0; t < layout->table_count; ++ t ) {
+		table = &layout->tables[t];
+		if( 0 == table->l2_table_size || LIBHUFFMAN_MAX_LAYOUT_L2_TABLE_SIZE < table->l2_table_size )
+			return F2_STATUS_ERROR_INVALID_DATA;
+		count = (size_t) 1 << table->l2_table_size;
+		if( table->first_entry > layout->entry_count || count > layout->entry_count - table->first_entry )
+			return F2_STATUS_ERROR_INVALID_DATA;
+
+		// Check entries
+		for( i = 0; i < count; ++ i ) {
+			value = layout->entry_values[table->first_entry + i];
+			switch( layout->entry_types[table->first_entry + i] ) {
+			case btl_et_unused:
+				break;
+			case btl_et_subtable:
+				if( value <= t || value >= layout->table_count )
+					return F2_STATUS_ERROR_INVALID_DATA;
+				subtable = &layout->tables[value];
+				if( subtable->parent_table != t || subtable->parent_index != i )
+					return F2_STATUS_ERROR_INVALID_DATA;
+				break;
+			case btl_et_data:
+				if( (size_t) -1 != desc_count && value >= desc_count )
+					return F2_STATUS_ERROR_INVALID_DATA;
+				break;
+			default:
+				return F2_STATUS_ERROR_INVALID_DATA;
+			}
+		}
+
+		// Check the way back to the parent
+		if( 0 != t ) {
+			if( table->parent_table >= t || table->parent_index >= ((size_t) 1 << layout->tables[table->parent_table].l2_table_size) )
+				return F2_STATUS_ERROR_INVALID_DATA;
+			i = layout->tables[table->parent_table].first_entry + table->parent_index;
+			if( (uint8_t) btl_et_subtable != layout->entry_types[i] || t != layout->entry_values[i] )
+				return F2_STATUS_ERROR_INVALID_DATA;
+		}
+	}
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Release layout created by libhuffman_decoder_table_freeze.
+ * @param[in] context (libhuffman_context *) context used to freeze the table.
+ * @param[in] layout (libhuffman_decoder_layout *) layout to release.
+ * @return (f2_status_t) operation status code.
+ */
+f2_status_t f2_callconv libhuffman_decoder_layout_release(
+	libhuffman_context *		context,
+	libhuffman_decoder_layout *	layout
+) {
+	void *	memory;
+
+	// Check current state
+	debugbreak_if( nullptr == context || nullptr == layout )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Release memory
+	if( nullptr != layout->tables ) {
+		memory = (void *) layout->tables;
+		(void) context->allocator->free( context->allocator, &memory,
+			_layout_memory_size( layout->table_count, layout->entry_count ), 0 );
+	}
+	memset( layout, 0, sizeof(*layout) );
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Store built decoder table in position-independent form.
+ * @param[in] thisp (const libhuffman_decoder_table *) decoder table with built tables.
+ * @param[in] context (libhuffman_context *) context used to allocate the layout.
+ * @param[out] layout (libhuffman_decoder_layout *) layout; release it with libhuffman_decoder_layout_release.
+ * @return (f2_status_t) operation status code.
+ *
+ *	Tables are stored in breadth-first order. Data entries keep their entry_int_param, which is the index of the code
+ * descriptor the entry decodes to.
+ */
+f2_status_t f2_callconv libhuffman_decoder_table_freeze(
+	const libhuffman_decoder_table *	thisp,
+	libhuffman_context *				context,
+	libhuffman_decoder_layout *			layout
+) {
+	f2_status_t					status;
+	f2_allocator *				allocator;
+	const btl_table **			queue = nullptr;
+	const btl_table *			table;
+	void *						memory = nullptr;
+	libhuffman_layout_table *	tables;
+	uint32_t *					entry_values;
+	uint8_t *					entry_types;
+	size_t						table_count = 0, entry_count = 0, next_table, next_entry, t, i, count;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp || nullptr == context || nullptr == layout )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	memset( layout, 0, sizeof(*layout) );
+	debugbreak_if( 0 == thisp->bit_context.root_table.l2_table_size )
+		return F2_STATUS_ERROR_INVALID_STATE;
+	allocator = context->allocator;
+
+	// Allocate layout
+	status = _count_tables( &thisp->bit_context.root_table, &table_count, &entry_count );
+	if( f2_failed( status ) )
+		return status;
+	debugbreak_if( (uint32_t) -1 < entry_count )
+		return F2_STATUS_ERROR_INVALID_DATA;
+	status = allocator->alloc( allocator, &memory, _layout_memory_size( table_count, entry_count ), F2_AF_CLEAR_MEM );
+	if( f2_failed( status ) )
+		return status;
+	status = allocator->alloc( allocator, (void **) &queue, table_count * sizeof(*queue), 0 );
+	if( f2_failed( status ) ) {
+		(void) allocator->free( allocator, &memory, _layout_memory_size( table_count, entry_count ), 0 );
+		return status;
+	}
+	tables = (libhuffman_layout_table *) memory;
+	entry_values = (uint32_t *) (tables + table_count);
+	entry_types = (uint8_t *) (entry_values + entry_count);
+
+	// Store tables in breadth-first order; the queue is indexed by the table index
+	queue[0] = &thisp->bit_context.root_table;
+	tables[0].l2_table_size = queue[0]->l2_table_size;
+	next_table = 1;
+	next_entry = (size_t) 1 << queue[0]->l2_table_size;
+	for( t = 0; t < next_table && !f2_failed( status ); ++ t ) {
+		table = queue[t];
+		count = (size_t) 1 << table->l2_table_size;
+		for( i = 0; i < count; ++ i ) {
+			entry_types[tables[t].first_entry + i] = table->entry_type[i];
+			if( (uint8_t) btl_et_subtable == table->entry_type[i] ) {
+				queue[next_table] = table->entry_data[i].table;
+				tables[next_table].first_entry = (uint32_t) next_entry;
+				tables[next_table].parent_table = (uint32_t) t;
+				tables[next_table].parent_index = (uint32_t) i;
+				tables[next_table].l2_table_size = queue[next_table]->l2_table_size;
+				next_entry += (size_t) 1 << queue[next_table]->l2_table_size;
+				entry_values[tables[t].first_entry + i] = (uint32_t) next_table ++;
+			} else if( (uint8_t) btl_et_data == table->entry_type[i] ) {
+				if( (uint32_t) -1 < table->entry_data[i].entry_int_param ) {
+					status = F2_STATUS_ERROR_INVALID_DATA;
+					break;
+				}
+				entry_values[tables[t].first_entry + i] = (uint32_t) table->entry_data[i].entry_int_param;
+			}
+		}
+	}
+	(void) allocator->free( allocator, (void **) &queue, table_count * sizeof(*queue), 0 );
+	if( f2_failed( status ) ) {
+		(void) allocator->free( allocator, &memory, _layout_memory_size( table_count, entry_count ), 0 );
+		return status;
+	}
+
+	// Done
+	layout->tables = tables;
+	layout->table_count = table_count;
+	layout->entry_types = entry_types;
+	layout->entry_values = entry_values;
+	layout->entry_count = entry_count;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Table being built by libhuffman_decoder_layout_build.
+ * @internal
+ */
+typedef struct _build_table {
+	libhuffman_code_t	prefix;			//< code bits that select the table
+	unsigned			prefix_length;	//< number of code bits consumed by parent tables
+	unsigned			l2_table_size;
+	size_t				first_entry;	//< index of the first entry, set when the table is filled
+	size_t				parent_table;
+	size_t				parent_index;
+} _build_table;
+
+/**
+ * @brief Grow entry arrays of the layout being built.
+ * @internal
+ */
+static f2_status_t _grow_entries( f2_allocator * allocator, uint8_t ** entry_types, uint32_t ** entry_values,
+	size_t * capacity, size_t required )
+{
+	f2_status_t	status;
+	uint8_t *	new_types = nullptr;
+	uint32_t *	new_values = nullptr;
+	size_t		new_capacity;
+
+	if( required <= *capacity )
+		return F2_STATUS_SUCCESS;
+	for( new_capacity = 0 == *capacity ? 256 : *capacity; new_capacity < required; new_capacity *= 2 )
+		;
+
+	status = allocator->alloc( allocator, (void **) &new_types, new_capacity, 0 );
+	if( f2_failed( status ) )
+		return status;
+	status = allocator->alloc( allocator, (void **) &new_values, new_capacity * sizeof(uint32_t), 0 );
+	if( f2_failed( status ) ) {
+		(void) allocator->free( allocator, (void **) &new_types, new_capacity, 0 );
+		return status;
+	}
+	if( 0 != *capacity ) {
+		f2_memcpy( new_types, *entry_types, *capacity );
+		f2_memcpy( new_values, *entry_values, *capacity * sizeof(uint32_t) );
+		(void) allocator->free( allocator, (void **) entry_types, *capacity, 0 );
+		(void) allocator->free( allocator, (void **) entry_values, *capacity * sizeof(uint32_t), 0 );
+	}
+	*entry_types = new_types;
+	*entry_values = new_values;
+	*capacity = new_capacity;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Build decoder layout from code descriptors.
+ * @param[in] context (libhuffman_context *) context used to allocate the layout.
+ * @param[in] l2_max_table_size (unsigned) log2 of the maximum table size; 0 = LIBHUFFMAN_DEFAULT_LAYOUT_L2_TABLE_SIZE.
+ * @param[in] desc_array (const libhuffman_code_desc *) code descriptors; the first transmitted bit of the code is
+ *		bit 0 of code.bits, as it's written by the encoder.
+ * @param[in] desc_count (size_t) number of descriptors.
+ * @param[out] layout (libhuffman_decoder_layout *) layout; release it with libhuffman_decoder_layout_release.
+ * @return (f2_status_t) operation status code; F2_STATUS_ERROR_INVALID_DATA if a code is a prefix of another one.
+ *
+ *	Each table is indexed by the next code bits, the first one in bit 0. Codes shorter than the table occupy all
+ * entries that start with them; longer codes go to subtables sized by the longest code they hold.
+ */
+f2_status_t f2_callconv libhuffman_decoder_layout_build(
+	libhuffman_context *			context,
+	unsigned						l2_max_table_size,
+	const libhuffman_code_desc *	desc_array,
+	size_t							desc_count,
+	libhuffman_decoder_layout *		layout
+) {
+	f2_status_t					status;
+	f2_allocator *				allocator;
+	_build_table *				tables = nullptr;
+	uint8_t *					entry_types = nullptr;
+	uint32_t *					entry_values = nullptr;
+	void *						memory = nullptr;
+	libhuffman_layout_table *	out_tables;
+	size_t						table_count, table_capacity, entry_count = 0, entry_capacity = 0, first_entry;
+	size_t						t, i, k, count, index, sub;
+	unsigned					max_length, root_length, rest_length;
+	libhuffman_code_t			rest;
+
+	// Check current state
+	debugbreak_if( nullptr == context || nullptr == layout || (nullptr == desc_array && 0 != desc_count) )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	memset( layout, 0, sizeof(*layout) );
+	if( 0 == l2_max_table_size )
+		l2_max_table_size = LIBHUFFMAN_DEFAULT_LAYOUT_L2_TABLE_SIZE;
+	debugbreak_if( LIBHUFFMAN_MAX_LAYOUT_L2_TABLE_SIZE < l2_max_table_size || (uint32_t) -1 <= desc_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	allocator = context->allocator;
+
+	// Size root table by the longest code
+	max_length = 0;
+	for( i = 0; i < desc_count; ++ i ) {
+		debugbreak_if( 0 == desc_array[i].code.length || LIBHUFFMAN_MAX_CODE_LENGTH < desc_array[i].code.length )
+			return F2_STATUS_ERROR_INVALID_PARAMETER;
+		if( max_length < desc_array[i].code.length )
+			max_length = desc_array[i].code.length;
+	}
+	if( 0 == max_length )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	root_length = max_length < l2_max_table_size ? max_length : l2_max_table_size;
+
+	// Each subtable consumes at least one code bit and is created by a code that passes through it,
+	// so a code can't create more subtables than it has bits left after the root table
+	table_capacity = 1;
+	for( i = 0; i < desc_count; ++ i ) {
+		if( desc_array[i].code.length > root_length )
+			table_capacity += desc_array[i].code.length - root_length;
+	}
+	status = allocator->alloc( allocator, (void **) &tables, table_capacity * sizeof(*tables), F2_AF_CLEAR_MEM );
+	if( f2_failed( status ) )
+		return status;
+	tables[0].l2_table_size = root_length;
+	table_count = 1;
+
+	// Fill tables in breadth-first order, so subtables are sized before they are filled
+	for( t = 0; t < table_count && !f2_failed( status ); ++ t ) {
+		count = (size_t) 1 << tables[t].l2_table_size;
+		first_entry = entry_count;
+		tables[t].first_entry = first_entry;
+		status = _grow_entries( allocator, &entry_types, &entry_values, &entry_capacity, entry_count + count );
+		if( f2_failed( status ) )
+			break;
+		memset( entry_types + first_entry, btl_et_unused, count );
+		memset( entry_values + first_entry, 0, count * sizeof(uint32_t) );
+		entry_count += count;
+
+		for( i = 0; i < desc_count && !f2_failed( status ); ++ i ) {
+			if( desc_array[i].code.length <= tables[t].prefix_length )
+				continue;
+			if( 0 != tables[t].prefix_length &&
+				(desc_array[i].code.bits & (((libhuffman_code_t) 2 << (tables[t].prefix_length - 1)) - 1)) != tables[t].prefix )
+				continue;
+			rest = (libhuffman_code_t) ((uint64_t) desc_array[i].code.bits >> tables[t].prefix_length);
+			rest_length = desc_array[i].code.length - tables[t].prefix_length;
+
+			if( rest_length <= tables[t].l2_table_size ) {
+				// Code ends in this table: occupy all entries that start with it
+				index = rest & (((size_t) 1 << rest_length) - 1);
+				for( k = 0; k < ((size_t) 1 << (tables[t].l2_table_size - rest_length)); ++ k ) {
+					if( (uint8_t) btl_et_unused != entry_types[first_entry + (index | (k << rest_length))] ) {
+						status = F2_STATUS_ERROR_INVALID_DATA;
+						break;
+					}
+					entry_types[first_entry + (index | (k << rest_length))] = (uint8_t) btl_et_data;
+					entry_values[first_entry + (index | (k << rest_length))] = (uint32_t) i;
+				}
+			} else {
+				// Code continues in a subtable
+				index = rest & (((size_t) 1 << tables[t].l2_table_size) - 1);
+				rest_length -= tables[t].l2_table_size;
+				if( rest_length > l2_max_table_size )
+					rest_length = l2_max_table_size;
+				if( (uint8_t) btl_et_unused == entry_types[first_entry + index] ) {
+					sub = table_count ++;
+					tables[sub].prefix = (libhuffman_code_t) (desc_array[i].code.bits &
+						(((uint64_t) 1 << (tables[t].prefix_length + tables[t].l2_table_size)) - 1));
+					tables[sub].prefix_length = tables[t].prefix_length + tables[t].l2_table_size;
+					tables[sub].l2_table_size = rest_length;
+					tables[sub].parent_table = t;
+					tables[sub].parent_index = index;
+					entry_types[first_entry + index] = (uint8_t) btl_et_subtable;
+					entry_values[first_entry + index] = (uint32_t) sub;
+				} else if( (uint8_t) btl_et_subtable == entry_types[first_entry + index] ) {
+					sub = entry_values[first_entry + index];
+					if( tables[sub].l2_table_size < rest_length )
+						tables[sub].l2_table_size = rest_length;
+				} else
+					status = F2_STATUS_ERROR_INVALID_DATA;
+			}
+		}
+	}
+
+	// Store layout in a single block
+	if( !f2_failed( status ) && (uint32_t) -1 < entry_count )
+		status = F2_STATUS_ERROR_INVALID_DATA;
+	if( !f2_failed( status ) )
+		status = allocator->alloc( allocator, &memory, _layout_memory_size( table_count, entry_count ), 0 );
+	if( !f2_failed( status ) ) {
+		out_tables = (libhuffman_layout_table *) memory;
+		for( t = 0; t < table_count; ++ t ) {
+			out_tables[t].first_entry = (uint32_t) tables[t].first_entry;
+			out_tables[t].parent_table = (uint32_t) tables[t].parent_table;
+			out_tables[t].parent_index = (uint32_t) tables[t].parent_index;
+			out_tables[t].l2_table_size = tables[t].l2_table_size;
+		}
+		layout->tables = out_tables;
+		layout->table_count = table_count;
+		layout->entry_values = (const uint32_t *) (out_tables + table_count);
+		layout->entry_types = (const uint8_t *) (layout->entry_values + entry_count);
+		layout->entry_count = entry_count;
+		f2_memcpy( (void *) layout->entry_values, entry_values, entry_count * sizeof(uint32_t) );
+		f2_memcpy( (void *) layout->entry_types, entry_types, entry_count );
+	}
+
+	// Exit
+	if( 0 != entry_capacity ) {
+		(void) allocator->free( allocator, (void **) &entry_types, entry_capacity, 0 );
+		(void) allocator->free( allocator, (void **) &entry_values, entry_capacity * sizeof(uint32_t), 0 );
+	}
+	(void) allocator->free( allocator, (void **) &tables, table_capacity * sizeof(*tables), 0 );
+	return status;
+}
+
+/**
+ * @brief Get number of index bits taken by the code of the data entry.
+ * @internal
+ *
+ *	A code shorter than the table is replicated at all indices that start with it, so the code ends after the highest
+ * index bit that selects a different entry.
+ */
+static unsigned _entry_bit_count( const uint8_t * entry_types, const uint32_t * entry_values, unsigned l2_table_size, size_t index )
+{
+	unsigned	bit_count;
+	size_t		other;
+
+	for( bit_count = l2_table_size; 0 != bit_count; -- bit_count ) {
+		other = index ^ ((size_t) 1 << (bit_count - 1));
+		if( entry_types[other] != entry_types[index] || entry_values[other] != entry_values[index] )
+			break;
+	}
+	return bit_count;
+}
+
+/**
+ * @brief Get numbers of index bits taken by codes of the layout entries.
+ * @param[in] layout (const libhuffman_decoder_layout *) layout checked with libhuffman_decoder_layout_validate.
+ * @param[out] entry_bits (uint8_t *) array of layout->entry_count elements receiving btl_table::entry_bits of each entry;
+ *		0 for subtable and unused entries.
+ * @return (f2_status_t) operation status code.
+ */
+f2_status_t f2_callconv libhuffman_decoder_layout_get_entry_bits(
+	const libhuffman_decoder_layout *	layout,
+	uint8_t *							entry_bits
+) {
+	const libhuffman_layout_table *	table;
+	size_t		t, i, count;
+
+	// Check current state
+	debugbreak_if( nullptr == layout || (nullptr == entry_bits && 0 != layout->entry_count) )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Fill bit counts of data entries
+	memset( entry_bits, 0, layout->entry_count );
+	for( t = 0; t < layout->table_count; ++ t ) {
+		table = &layout->tables[t];
+		count = (size_t) 1 << table->l2_table_size;
+		for( i = 0; i < count; ++ i ) {
+			if( (uint8_t) btl_et_data <= layout->entry_types[table->first_entry + i] )
+				entry_bits[table->first_entry + i] = (uint8_t) _entry_bit_count( layout->entry_types + table->first_entry,
+					layout->entry_values + table->first_entry, table->l2_table_size, i );
+		}
+	}
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Attach frozen layout to the decoder table.
+ * @param[in] thisp (libhuffman_decoder_table *) decoder table without built tables.
+ * @param[in] context (libhuffman_context *) context used to allocate table objects.
+ * @param[in] layout (const libhuffman_decoder_layout *) layout; it isn't referenced after the call.
+ * @param[in] desc_array (const libhuffman_code_desc *) optional code descriptors; if given, entry_ptr_param of
+ *		data entries points to the descriptor.
+ * @return (f2_status_t) operation status code.
+ *
+ *	All table objects and entries are allocated in a single block and filled linearly, nothing is inserted code by code.
+ * The table must be detached with libhuffman_decoder_table_detach_layout instead of btl_context_deinitialize.
+ */
+f2_status_t f2_callconv libhuffman_decoder_table_attach_layout(
+	libhuffman_decoder_table *			thisp,
+	libhuffman_context *				context,
+	const libhuffman_decoder_layout *	layout,
+	const libhuffman_code_desc *		desc_array
+) {
+	f2_status_t		status;
+	void *			memory = nullptr;
+	size_t			memory_size, t, i, count;
+	btl_table *		subtables;
+	btl_table *		table;
+	btl_entry_data *entry_data;
+	uint8_t *		entry_types;
+	uint8_t *		entry_bits;
+	uint32_t		value;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp || nullptr == context || nullptr == layout )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr != thisp->layout_memory || 0 != thisp->bit_context.root_table.l2_table_size )
+		return F2_STATUS_ERROR_INVALID_STATE;
+	status = libhuffman_decoder_layout_validate( layout, (size_t) -1 );
+	if( f2_failed( status ) )
+		return status;
+
+	// Allocate table objects and entries
+	memory_size = (layout->table_count - 1) * sizeof(btl_table) + layout->entry_count * (sizeof(btl_entry_data) + 2 * sizeof(uint8_t));
+	status = context->allocator->alloc( context->allocator, &memory, memory_size, 0 );
+	if( f2_failed( status ) )
+		return status;
+	subtables = (btl_table *) memory;
+	entry_data = (btl_entry_data *) (subtables + layout->table_count - 1);
+	entry_types = (uint8_t *) (entry_data + layout->entry_count);
+	entry_bits = entry_types + layout->entry_count;
+	f2_memcpy( entry_types, layout->entry_types, layout->entry_count );
+	(void) libhuffman_decoder_layout_get_entry_bits( layout, entry_bits );
+
+	// Fill tables; subtable t is stored at subtables[t - 1] since the root table is a part of the context
+	for( t = 0; t < layout->table_count; ++ t ) {
+		table = 0 == t ? &thisp->bit_context.root_table : &subtables[t - 1];
+		table->entry_type = entry_types + layout->tables[t].first_entry;
+		table->entry_data = entry_data + layout->tables[t].first_entry;
+		table->entry_bits = entry_bits + layout->tables[t].first_entry;
+		table->context = &thisp->bit_context;
+		table->parent_table = 0 == t ? NULL : 0 == layout->tables[t].parent_table ?
+			&thisp->bit_context.root_table : &subtables[layout->tables[t].parent_table - 1];
+		table->parent_index = layout->tables[t].parent_index;
+		table->l2_table_size = (uint8_t) layout->tables[t].l2_table_size;
+		table->flags = BTL_TABLE_F_EXT_ARRAYS;
+		table->sparse_keys = NULL;
+		table->sparse_count = 0;
+
+		count = (size_t) 1 << table->l2_table_size;
+		for( i = 0; i < count; ++ i ) {
+			value = layout->entry_values[layout->tables[t].first_entry + i];
+			switch( table->entry_type[i] ) {
+			case btl_et_subtable:
+				table->entry_data[i].table = &subtables[value - 1];
+				table->entry_data[i].callback_param = NULL;
+				break;
+			case btl_et_data:
+				table->entry_data[i].entry_ptr_param = nullptr == desc_array ? NULL : &desc_array[value];
+				table->entry_data[i].entry_int_param = value;
+				break;
+			default:
+				table->entry_data[i].entry_ptr_param = NULL;
+				table->entry_data[i].entry_int_param = 0;
+				break;
+			}
+		}
+	}
+
+	// Done
+	thisp->context = context;
+	thisp->layout_memory = memory;
+	thisp->layout_memory_size = memory_size;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Attach prebuilt static tables to the decoder table.
+ * @param[in] thisp (libhuffman_decoder_table *) decoder table without built tables.
+ * @param[in] context (libhuffman_context *) library context.
+ * @param[in] root_tables (const btl_table *) root_count root tables; they and all their subtables and entries must stay
+ *		valid while the table is attached and are never written.
+ * @param[in] root_count (size_t) number of root tables, up to BTL_MAX_ROOT_COUNT.
+ * @return (f2_status_t) operation status code.
+ *
+ *	Root table objects are copied to the bit context, nothing is allocated or converted; this is how tables generated
+ * by the huffman compile mode are used. The table must be detached with libhuffman_decoder_table_detach_layout.
+ */
+f2_status_t f2_callconv libhuffman_decoder_table_attach_tables(
+	libhuffman_decoder_table *	thisp,
+	libhuffman_context *		context,
+	const btl_table *			root_tables,
+	size_t						root_count
+) {
+	btl_table *	root;
+	size_t		r;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp || nullptr == context || nullptr == root_tables )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 0 == root_count || BTL_MAX_ROOT_COUNT < root_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	for( r = 0; r < BTL_MAX_ROOT_COUNT; ++ r ) {
+		debugbreak_if( 0 != btl_context_root_table( &thisp->bit_context, r )->l2_table_size )
+			return F2_STATUS_ERROR_INVALID_STATE;
+	}
+	debugbreak_if( nullptr != thisp->layout_memory )
+		return F2_STATUS_ERROR_INVALID_STATE;
+
+	// Copy root tables
+	for( r = 0; r < root_count; ++ r ) {
+		debugbreak_if( 0 == root_tables[r].l2_table_size || 0 == (root_tables[r].flags & BTL_TABLE_F_EXT_ARRAYS) )
+			return F2_STATUS_ERROR_INVALID_PARAMETER;
+	}
+	for( r = 0; r < root_count; ++ r ) {
+		root = btl_context_root_table( &thisp->bit_context, r );
+		*root = root_tables[r];
+		root->context = &thisp->bit_context;
+	}
+	thisp->context = context;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Detach layout attached with libhuffman_decoder_table_attach_layout or libhuffman_decoder_table_attach_tables.
+ * @param[in] thisp (libhuffman_decoder_table *) decoder table.
+ * @return (f2_status_t) operation status code.
+ */
+f2_status_t f2_callconv libhuffman_decoder_table_detach_layout(
+	libhuffman_decoder_table *	thisp
+) {
+	size_t	r;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == thisp->layout_memory && 0 == thisp->bit_context.root_table.l2_table_size )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
+
+	// Reset root tables, subtables are a part of the layout memory or static data
+	for( r = 0; r < BTL_MAX_ROOT_COUNT; ++ r )
+		(void) btl_table_initialize( btl_context_root_table( &thisp->bit_context, r ), &thisp->bit_context, NULL, 0 );
+
+	// Release memory
+	if( nullptr != thisp->layout_memory )
+		(void) thisp->context->allocator->free( thisp->context->allocator, &thisp->layout_memory, thisp->layout_memory_size, 0 );
+	thisp->layout_memory = nullptr;
+	thisp->layout_memory_size = 0;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/*END OF decoder_layout.c*/
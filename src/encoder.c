@@ -22,6 +22,9 @@ f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_initialize_encode_context( libhuffman
 	encode_context->table	= root_table;
 	encode_context->istream = istream;
 	encode_context->ostream = ostream;
+	encode_context->stream	= nullptr;
+	encode_context->lane_count = 0;
+	encode_context->run_table = nullptr;
 
 	// Exit
 	return F2_STATUS_SUCCESS;
@@ -39,192 +42,826 @@ f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_deinitialize_encode_context( libhuffm
 	return F2_STATUS_SUCCESS;
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-static f2_status_t _store_bit_run( libhuffman_encode_context * encode_context, unsigned index )
+f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_set_encode_context_lanes( libhuffman_encode_context * encode_context,
+	libhuffman_stream * stream, size_t lane_count )
 {
-	libhuffman_encoder_table * const	table = encode_context->table;
-	uint8_t bit_length;
-	libhuffman_code_t bit_runs;
+	// Check current state
+	debugbreak_if( nullptr == encode_context )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == stream && 1 < lane_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set up splitting
+	encode_context->stream = stream;
+	encode_context->lane_count = lane_count;
 
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_set_encode_context_run_table( libhuffman_encode_context * encode_context,
+	const libhuffman_run_table * run_table )
+{
 	// Check current state
-	debugbreak_if( index >= table->size )
+	debugbreak_if( nullptr == encode_context )
 		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr != run_table && nullptr == run_table->context )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
 
-	bit_runs = table->codes[index];
-	bit_length = table->code_lengths[index];
+	// Set run table
+	encode_context->run_table = run_table;
 
-	// Place bit field
-	// TODO
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///! State of splitting encoded data in blocks of roughly equal number of codes
+typedef struct _block_splitter {
+	libhuffman_block *	block;			//< current block, nullptr if splitting is disabled or not started
+	libhuffman_block *	block_end;		//< end of the stream block table
+	uint64_t			symbol_count;	//< total number of symbols in the source data
+	uint64_t			symbol_index;	//< index of the symbol being encoded
+	uint64_t			next_boundary;	//< index of the first symbol of the next block
+	size_t				lane_count;		//< number of blocks
+	size_t				block_index;	//< index of the next block
+} _block_splitter;
+
+/**
+ * @brief Calculate index of the first symbol of the block.
+ * @internal
+ *
+ *	Block sizes differ in one symbol at most; the calculation is split to avoid overflow.
+ */
+static uint64_t _block_first_symbol( const _block_splitter * splitter, size_t block_index )
+{
+	const uint64_t per_block = splitter->symbol_count / splitter->lane_count;
+	const uint64_t remainder = splitter->symbol_count % splitter->lane_count;
+	return block_index * per_block + (block_index * remainder) / splitter->lane_count;
+}
+
+static f2_status_t _block_splitter_initialize( _block_splitter * splitter, libhuffman_encode_context * encode_context )
+{
+	f2_status_t	status;
+	uint64_t	data_size;
+
+	splitter->block = nullptr;
+	splitter->block_end = nullptr;
+	splitter->symbol_count = 0;
+	splitter->symbol_index = 0;
+	splitter->next_boundary = (uint64_t) -1;	// never reached
+	splitter->lane_count = encode_context->lane_count;
+	splitter->block_index = 0;
+	if( nullptr == encode_context->stream || 2 > encode_context->lane_count )
+		return F2_STATUS_SUCCESS;
+
+	// Calculate number of symbols to distribute among blocks
+	status = encode_context->istream->get_size( encode_context->istream, &data_size );
+	if( f2_failed( status ) )
+		return status;
+	splitter->symbol_count = data_size * 8 / encode_context->value_bit_size;
+	if( splitter->symbol_count < splitter->lane_count )
+		splitter->lane_count = (size_t) splitter->symbol_count;	// don't produce empty blocks
+
+	// Allocate block table, releasing the one left from a previous encode
+	if( 0 != encode_context->stream->block_count ) {
+		status = libhuffman_stream_set_block_count( encode_context->stream, 0 );
+		if( f2_failed( status ) )
+			return status;
+	}
+	status = libhuffman_stream_set_block_count( encode_context->stream, splitter->lane_count );
+	if( f2_failed( status ) )
+		return status;
+	splitter->block_end = encode_context->stream->blocks + splitter->lane_count;
+	splitter->next_boundary = 0;
 
 	// Exit
 	return F2_STATUS_SUCCESS;
 }
 
-f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_encode( libhuffman_encode_context * encode_context )
+/**
+ * @brief Close current block and open the next one.
+ * @internal
+ * @param[in] splitter (_block_splitter *) splitter state.
+ * @param[in] bit_offset (uint64_t) number of bits emitted so far.
+ */
+static void _block_splitter_next_block( _block_splitter * splitter, uint64_t bit_offset )
+{
+	libhuffman_block * block = splitter->block;
+
+	if( nullptr != block )
+		block->bit_length = bit_offset - block->bit_offset;
+	block = nullptr == block ? splitter->block_end - splitter->lane_count : block + 1;
+	block->bit_offset = (size_t) bit_offset;
+	block->bit_length = 0;
+
+	++ splitter->block_index;
+	block->symbol_count = (size_t) (
+		(splitter->block_index < splitter->lane_count ? _block_first_symbol( splitter, splitter->block_index ) : splitter->symbol_count) -
+		splitter->symbol_index
+		);
+	splitter->next_boundary = splitter->block_index < splitter->lane_count ?
+		splitter->symbol_index + block->symbol_count :
+		(uint64_t) -1;
+	splitter->block = block;
+}
+
+static void _block_splitter_finish( _block_splitter * splitter, uint64_t bit_offset )
+{
+	if( nullptr != splitter->block )
+		splitter->block->bit_length = bit_offset - splitter->block->bit_offset;
+}
+
+///! Destination of encoded bytes: the output stream or, for interleaved streams, a growing memory buffer
+typedef struct _output_sink {
+	f2_ostream *	ostream;		//< output stream
+	f2_allocator *	allocator;		//< allocator of the memory buffer, nullptr if bytes go straight to the output stream
+	uint8_t *		data;			//< memory buffer
+	size_t			size;			//< number of bytes stored in the buffer
+	size_t			capacity;		//< size of the buffer
+} _output_sink;
+
+static f2_status_t _output_sink_write( _output_sink * sink, const void * data, size_t size )
 {
 	f2_status_t	status;
+	size_t		nwritten;
+	void *		new_data;
+	size_t		new_capacity;
+
+	// Write directly
+	if( nullptr == sink->allocator ) {
+		status = sink->ostream->write( sink->ostream, data, size, &nwritten );
+		debugbreak_if( f2_failed(status) )
+			return status;
+		return F2_STATUS_SUCCESS;
+	}
 
-	f2_istream * istream;
-	f2_ostream * ostream;
+	// Grow buffer
+	if( sink->size + size > sink->capacity ) {
+		new_capacity = 0 == sink->capacity ? 4096 : sink->capacity * 2;
+		while( new_capacity < sink->size + size )
+			new_capacity *= 2;
+
+		status = sink->allocator->alloc( sink->allocator, &new_data, new_capacity, 0 );
+		if( f2_failed( status ) )
+			return status;
+		if( 0 != sink->size )
+			f2_memcpy( new_data, sink->data, sink->size );
+		if( nullptr != sink->data )
+			(void) sink->allocator->free( sink->allocator, (void **) &sink->data, sink->capacity, 0 );
+
+		sink->data = (uint8_t *) new_data;
+		sink->capacity = new_capacity;
+	}
+
+	// Append data
+	f2_memcpy( sink->data + sink->size, data, size );
+	sink->size += size;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
 
-	libhuffman_encoder_table *	table;
+/**
+ * @brief Interleave buffered data while writing it to the output stream.
+ * @internal
+ *
+ *	Lane words are gathered from the buffered contiguous blocks row by row, so no interleaved copy of the stream
+ * is made. Like after any encoding, the stream doesn't refer to the written data; its block table, bit count and
+ * LIBHUFFMAN_STREAM_F_INTERLEAVED flag describe the written layout once all words are out.
+ */
+static f2_status_t _output_sink_flush_interleaved( _output_sink * sink, libhuffman_stream * stream )
+{
+	f2_status_t			status;
+	libhuffman_block *	block;
+	uint8_t				buf[256];
+	size_t				interleaved_size, word_count, word_index, block_index, buf_size = 0, nwritten;
+	uint64_t			lane_bit_offset;
+	uint32_t			word;
+	unsigned			bit_count;
 
 	// Check current state
-	debugbreak_if( nullptr == encode_context )
-		return F2_STATUS_ERROR_INVALID_PARAMETER;
-	istream = encode_context->istream;
-	ostream = encode_context->ostream;
-	table = encode_context->table;
+	if( nullptr == sink->allocator )
+		return F2_STATUS_SUCCESS;
+	status = libhuffman_stream_get_interleaved_size( stream, &interleaved_size );
+	if( f2_failed( status ) )
+		return status;
+	word_count = interleaved_size / stream->block_count / (LIBHUFFMAN_LANE_WORD_BITS / 8);
+
+	// Write word N of every lane, shorter lanes are padded with zero words
+	for( word_index = 0; word_index < word_count; ++ word_index ) {
+		lane_bit_offset = (uint64_t) word_index * LIBHUFFMAN_LANE_WORD_BITS;
+		for( block_index = 0; block_index < stream->block_count; ++ block_index ) {
+			block = &stream->blocks[block_index];
+			bit_count = lane_bit_offset >= block->bit_length ? 0 :
+				block->bit_length - lane_bit_offset < LIBHUFFMAN_LANE_WORD_BITS ? (unsigned) (block->bit_length - lane_bit_offset) :
+				LIBHUFFMAN_LANE_WORD_BITS;
+			word = 0 == bit_count ? 0 : bitload32( sink->data, (size_t) (block->bit_offset + lane_bit_offset), bit_count );
+
+			buf[buf_size + 0] = (uint8_t) (word);
+			buf[buf_size + 1] = (uint8_t) (word >> 8);
+			buf[buf_size + 2] = (uint8_t) (word >> 16);
+			buf[buf_size + 3] = (uint8_t) (word >> 24);
+			buf_size += 4;
+			if( buf_size == sizeof(buf) ) {
+				status = sink->ostream->write( sink->ostream, buf, buf_size, &nwritten );
+				if( f2_failed( status ) )
+					return status;
+				buf_size = 0;
+			}
+		}
+	}
+	if( 0 != buf_size ) {
+		status = sink->ostream->write( sink->ostream, buf, buf_size, &nwritten );
+		if( f2_failed( status ) )
+			return status;
+	}
 
-	debugbreak_if( nullptr == encode_context->table )
-		return F2_STATUS_ERROR_INVALID_PARAMETER;
-	debugbreak_if( encode_context->value_bit_size != next_power_of_two( encode_context->value_bit_size - 1 ) )
-		return F2_STATUS_ERROR_INVALID_PARAMETER;
-//	debugbreak_if( encode_context->data_size % (encode_context->value_bit_size/8) )
-//		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	// Describe the written layout
+	for( block_index = 0; block_index < stream->block_count; ++ block_index )
+		stream->blocks[block_index].bit_offset = block_index * LIBHUFFMAN_LANE_WORD_BITS;
+	stream->data_bit_offset = 0;
+	stream->data_bit_count = interleaved_size * 8;
+	stream->flags |= LIBHUFFMAN_STREAM_F_INTERLEAVED;
 
-#if 1
-	{
-	unsigned	i;
-	unsigned	mask = (1 << encode_context->value_bit_size) - 1;
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
 
-		  uint64_t accum = 0;
-		  unsigned count = (sizeof(accum) * 8) / encode_context->value_bit_size;
-		  uint8_t src_buf[sizeof(accum) * 16];
-	const uint8_t * src = nullptr;
-	const uint8_t * src_end = nullptr;
-		  size_t nread = 0;
+static void _output_sink_deinitialize( _output_sink * sink )
+{
+	if( nullptr != sink->data )
+		(void) sink->allocator->free( sink->allocator, (void **) &sink->data, sink->capacity, 0 );
+	sink->size = sink->capacity = 0;
+}
 
-	uint8_t		dst_buf[64];
-	uint8_t *	dst = dst_buf;
-	unsigned	dst_bit_offset = 0;
-	uint8_t				bit_length;
-	libhuffman_code_t	bit_runs;
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Run-length encoding
+
+///! Bit writer collecting codes in a 64-bit accumulator
+typedef struct _bit_writer {
+	_output_sink *	sink;			//< destination of complete bytes
+	uint64_t		accum;			//< pending bits, the first one is the least significant
+	unsigned		accum_bits;		//< number of pending bits
+	uint64_t		bit_count;		//< number of bits written so far
+	uint8_t			buf[256];		//< bytes waiting to be passed to the sink
+	size_t			buf_size;		//< number of bytes in the buffer
+} _bit_writer;
+
+static f2_status_t _bit_writer_put( _bit_writer * writer, libhuffman_code_t code, unsigned length )
+{
+	f2_status_t	status;
 
-	while( istream->eof( istream ) ) {
+	// Codes longer than 32 bits (LIBHUFFMAN_CODE64 only) don't fit the accumulator at once, put the low half first
+	if( 32 < LIBHUFFMAN_MAX_CODE_LENGTH && 32 < length ) {
+		status = _bit_writer_put( writer, (libhuffman_code_t) (code & 0xFFFFFFFFU), 32 );
+		if( f2_failed( status ) )
+			return status;
+		code = (libhuffman_code_t) ((uint64_t) code >> 32);
+		length -= 32;
+	}
 
-		// Download data to the input buffer
-		if( src > src_end ) {
-			status = istream->read( istream, src_buf, sizeof(src_buf), &nread );
+	// Append bits
+	writer->accum |= (uint64_t) code << writer->accum_bits;
+	writer->accum_bits += length;
+	writer->bit_count += length;
+
+	// Move complete 32-bit words out, so the accumulator never overflows
+	if( 32 <= writer->accum_bits ) {
+		writer->buf[writer->buf_size + 0] = (uint8_t) (writer->accum);
+		writer->buf[writer->buf_size + 1] = (uint8_t) (writer->accum >> 8);
+		writer->buf[writer->buf_size + 2] = (uint8_t) (writer->accum >> 16);
+		writer->buf[writer->buf_size + 3] = (uint8_t) (writer->accum >> 24);
+		writer->buf_size += 4;
+		writer->accum >>= 32;
+		writer->accum_bits -= 32;
+
+		if( writer->buf_size == sizeof(writer->buf) ) {
+			status = _output_sink_write( writer->sink, writer->buf, writer->buf_size );
 			if( f2_failed( status ) )
 				return status;
-			src		= src_buf;
-			src_end = src_buf + nread / sizeof(*src_buf);
+			writer->buf_size = 0;
 		}
+	}
 
-		// Encode buffer
-		for( ; src < src_end; ++ src )
-		{
-			// Load data
-			if( src_end - src < sizeof(accum) ) {
-				accum = 0;
-				f2_small_memcpy( &accum, src, src_end - src );
-				count = (unsigned) ((src_end - src) * 8) / encode_context->value_bit_size;
-			} else
-				accum = * (uint64_t *) src;
-
-			// Encode
-			for( i = 0; i < count; ++ i ) {
-
-				// Get bit field
-				const unsigned index = (unsigned) (accum & mask);
-				debugbreak_if( index >= table->size )
-					return F2_STATUS_ERROR_INVALID_ALPHABET;
-				bit_runs = table->codes[index];
-				bit_length = table->code_lengths[index];
-
-				// Flush dst buffer if there's no place for storing new run
-				if( bit_length > sizeof(dst_buf)*8 - dst_bit_offset ) {
-					const size_t whole_bytes_used = dst_bit_offset / 8;
-					size_t nwritten;
-					status = ostream->write( ostream, dst_buf, whole_bytes_used, &nwritten );
-					debugbreak_if( f2_failed(status) )
-						return status;
-
-					f2_small_memcpy( dst_buf, dst_buf + whole_bytes_used, sizeof(dst_buf) - whole_bytes_used );
-					dst_bit_offset = dst_bit_offset - whole_bytes_used*8;
-				}
-
-				// Copy bits
-				libhuffman_bitcopy( dst, dst_bit_offset, &bit_runs, bit_length );
-				dst_bit_offset += bit_length;
-
-				// Iterate
-				accum >>= encode_context->value_bit_size;
-			}
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+static f2_status_t _bit_writer_flush( _bit_writer * writer )
+{
+	f2_status_t	status;
+
+	// Move the rest of bits, including the last partial byte
+	while( 0 < writer->accum_bits ) {
+		writer->buf[writer->buf_size ++] = (uint8_t) writer->accum;
+		writer->accum >>= 8;
+		writer->accum_bits = 8 < writer->accum_bits ? writer->accum_bits - 8 : 0;
+	}
+
+	// Write buffer
+	if( 0 == writer->buf_size )
+		return F2_STATUS_SUCCESS;
+	status = _output_sink_write( writer->sink, writer->buf, writer->buf_size );
+	writer->buf_size = 0;
+	return status;
+}
+
+/**
+ * @brief Count successive symbols equal to the pattern, 64 bits per compare.
+ * @internal
+ * @param[in] src (const uint8_t *) source buffer followed by 8 readable bytes.
+ * @param[in] bit_offset (size_t) offset of the first symbol, multiple of value_bit_size.
+ * @param[in] bit_end (size_t) end of source symbols.
+ * @param[in] value_bit_size (unsigned) size of the source symbol, in bits.
+ * @param[in] pattern (uint64_t) the symbol replicated over the whole word.
+ * @return (size_t) number of equal symbols.
+ */
+static size_t _scan_run( const uint8_t * src, size_t bit_offset, size_t bit_end, unsigned value_bit_size, uint64_t pattern )
+{
+	const size_t	start = bit_offset;
+	uint64_t		word, diff;
+	unsigned		shift, valid_bits;
+
+	while( bit_offset < bit_end ) {
+
+		// Load next 57..64 bits; symbols are aligned to the bit 0 of the word after the shift
+		shift = (unsigned) (bit_offset % 8);
+		f2_small_memcpy( &word, src + bit_offset / 8, sizeof(word) );
+		word >>= shift;
+		valid_bits = 64 - shift;
+		if( bit_end - bit_offset < valid_bits )
+			valid_bits = (unsigned) (bit_end - bit_offset);
+
+		// The first differing bit ends the run
+		diff = word ^ pattern;
+		if( 64 > valid_bits )
+			diff &= (UINT64_C(1) << valid_bits) - 1;
+		if( 0 != diff ) {
+			bit_offset += ctz_uint64( diff ) / value_bit_size * value_bit_size;
+			break;
 		}
+		bit_offset += valid_bits;
 	}
-#else
-	// Prepare
-	{
-	unsigned	mask = (1 << encode_context->value_bit_size) - 1;
-	unsigned	i;
-
-	// Decode buffer
-	if( 8 < encode_context->value_bit_size ) {
-		uint16_t src_buf[32];
-		const uint16_t * src = nullptr;
-		const uint16_t * src_end = nullptr;
-			  size_t nread = 0;
-		const unsigned count = (sizeof(uint16_t) * 8) / encode_context->value_bit_size;
-
-		while( istream->eof( istream ) ) {
-
-			// Download data to the input buffer
-			if( src > src_end ) {
-				status = istream->read( istream, src_buf, sizeof(src_buf), &nread );
-				if( f2_failed( status ) )
-					return status;
-				src		= src_buf;
-				src_end = src_buf + nread / sizeof(*src_buf);
 
-			}
+	return (bit_offset - start) / value_bit_size;
+}
 
-			// Encode buffer
-			for( ; src < src_end; ++ src )
-			{
-				uint16_t run = *src;
-				for( i = 0; i < count; ++ i ) {
-					_store_bit_run( encode_context, run & mask );
-					run >>= encode_context->value_bit_size;
-				}
-			}
+/**
+ * @brief Emit codes of a run, longest fitting run codes first.
+ * @internal
+ *
+ *	If the symbol has a code of the empty run, the run always ends with a terminating code, so a run that is a
+ * multiple of a makeup code gets the terminating code of length 0 appended.
+ */
+static f2_status_t _emit_run( _bit_writer * writer, const libhuffman_run_table * table, unsigned symbol, uint64_t length )
+{
+	f2_status_t					status;
+	const libhuffman_run_code *	code = table->codes + table->first[symbol];
+	const libhuffman_run_code *	code_end = table->codes + table->first[symbol + 1];
+	f2_bool_t					terminated = 0;
+	uint64_t					n;
+
+	while( 0 != length ) {
+
+		// Find the longest run code that fits
+		while( code < code_end && (code->count > length || 0 == code->count) )
+			++ code;
+		debugbreak_if( code == code_end )
+			return F2_STATUS_ERROR_INVALID_ALPHABET;
+
+		// Emit it as many times as it fits
+		for( n = length / code->count; 0 < n; -- n ) {
+			status = _bit_writer_put( writer, code->code, code->length );
+			if( f2_failed( status ) )
+				return status;
 		}
-	} else {
-		uint8_t src_buf[32];
-		const uint8_t * src = nullptr;
-		const uint8_t * src_end = nullptr;
-			  size_t nread = 0;
-		const unsigned count = (sizeof( uint8_t) * 8) / encode_context->value_bit_size;
+		length %= code->count;
+		terminated = code->terminating;
+	}
+
+	// Terminate the run
+	if( !terminated && code_end > table->codes + table->first[symbol] && 0 == code_end[-1].count )
+		return _bit_writer_put( writer, code_end[-1].code, code_end[-1].length );
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
 
-		while( istream->eof( istream ) ) {
+/**
+ * @brief Encode source data as runs of equal symbols.
+ * @internal
+ *
+ *	Runs may span input buffers. Stream splitting in lanes and interleaving aren't supported in this mode since
+ * a block boundary would have to break a run.
+ */
+static f2_status_t _encode_runs( libhuffman_encode_context * encode_context )
+{
+	const libhuffman_run_table *	table = encode_context->run_table;
+	const unsigned		value_bit_size = table->value_bit_size;
+	const unsigned		mask = (1U << value_bit_size) - 1;
+	const uint64_t		replicate = ~UINT64_C(0) / ((UINT64_C(1) << value_bit_size) - 1);
+	f2_istream *		istream = encode_context->istream;
+	f2_status_t			status;
+	uint8_t				src_buf[4096 + sizeof(uint64_t)];
+	size_t				pending = 0, nread, bit_offset, bit_end, count;
+	unsigned			symbol = 0;
+	uint64_t			run_length = 0;
+	_output_sink		sink = { encode_context->ostream, nullptr, nullptr, 0, 0 };
+	_bit_writer			writer;
 
-			// Download data to the input buffer
-			if( src > src_end ) {
-				status = istream->read( istream, src_buf, sizeof(src_buf), &nread );
+	// Check current state
+	debugbreak_if( value_bit_size != encode_context->value_bit_size )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 1 < encode_context->lane_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr != encode_context->stream && 0 != (encode_context->stream->flags & LIBHUFFMAN_STREAM_F_INTERLEAVED) )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	memset( &writer, 0, sizeof(writer) );
+	writer.sink = &sink;
+
+	while( !istream->eof( istream ) ) {
+
+		// Download data to the input buffer; padding allows whole-word loads at its end, a partial 16-bit symbol stays for the next read
+		status = istream->read( istream, src_buf + pending, sizeof(src_buf) - sizeof(uint64_t) - pending, &nread );
+		if( f2_failed( status ) )
+			return status;
+		if( 0 == nread )
+			break;
+		nread += pending;
+		memset( src_buf + nread, 0, sizeof(uint64_t) );
+		bit_end = nread * 8 / value_bit_size * value_bit_size;
+
+		// Split buffer in runs
+		for( bit_offset = 0; bit_offset < bit_end; ) {
+			if( 0 == run_length )
+				symbol = ((src_buf[bit_offset / 8] | (src_buf[bit_offset / 8 + 1] << 8)) >> (bit_offset % 8)) & mask;
+
+			count = _scan_run( src_buf, bit_offset, bit_end, value_bit_size, symbol * replicate );
+			run_length += count;
+			bit_offset += count * value_bit_size;
+
+			// Emit the run if it ends in this buffer
+			if( bit_offset < bit_end ) {
+				status = _emit_run( &writer, table, symbol, run_length );
 				if( f2_failed( status ) )
 					return status;
-				src		= src_buf;
-				src_end = src_buf + nread / sizeof(*src_buf);
-
+				run_length = 0;
 			}
+		}
 
-			// Encode buffer
-			for( ; src < src_end; ++ src )
-			{
-				uint8_t run = *src;
-				for( i = 0; i < count; ++ i ) {
-					_store_bit_run( encode_context, run & mask );
-					run >>= encode_context->value_bit_size;
-				}
-			}
+		pending = nread - bit_end / 8;
+		if( 0 != pending )
+			f2_small_memcpy( src_buf, src_buf + nread - pending, pending );
+	}
+
+	// Source must end at a symbol boundary
+	debugbreak_if( 0 != pending )
+		return F2_STATUS_ERROR_INVALID_DATA;
+
+	// Emit the last run
+	if( 0 != run_length ) {
+		status = _emit_run( &writer, table, symbol, run_length );
+		if( f2_failed( status ) )
+			return status;
+	}
+	status = _bit_writer_flush( &writer );
+	if( f2_failed( status ) )
+		return status;
+	if( nullptr != encode_context->stream )
+		encode_context->stream->data_bit_count = (size_t) writer.bit_count;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Symbol encoding kernels
+//
+//	A kernel is picked once per call by the symbol size. Kernels encode a span of symbols that doesn't cross a block
+// boundary, so the block splitter is consulted once per span rather than once per symbol. Missing codes are
+// accumulated without branching and reported at the end of the span.
+
+///! State shared by encoding kernels
+typedef struct _encoder_state {
+	_bit_writer			writer;			//< output bits
+	unsigned			value_bit_size;	//< size of the source symbol, in bits
+	size_t				symbol_count;	//< number of entries in the code arrays
+	libhuffman_code_t *	codes;			//< code of each symbol
+	uint8_t *			lengths;		//< code length of each symbol, 0 if there's no code
+	unsigned			missing;		//< non-0 if a symbol without code was met
+	f2_bool_t			use_pairs;		//< pair table is valid (4-bit symbols only)
+	uint32_t			pair_codes[256];	//< codes of both nibbles of a byte, low nibble first
+	uint8_t				pair_lengths[256];	//< lengths of pair codes
+} _encoder_state;
+
+typedef f2_status_t (* _encode_kernel)( _encoder_state * state, const uint8_t * src, size_t first, size_t count );
+
+static f2_status_t _encoder_state_initialize( _encoder_state * state, libhuffman_encode_context * encode_context,
+	_output_sink * sink )
+{
+	f2_status_t						status;
+	f2_allocator *					allocator = encode_context->context->allocator;
+	const libhuffman_encoder_table *table = encode_context->table;
+	size_t							i;
+
+	// Initialize structure
+	memset( &state->writer, 0, sizeof(state->writer) );
+	state->writer.sink		= sink;
+	state->value_bit_size	= encode_context->value_bit_size;
+	state->symbol_count		= (size_t) 1 << state->value_bit_size;
+	state->missing			= 0;
+	state->use_pairs		= 0;
+
+	// Copy codes to dense arrays covering the whole alphabet, so kernels need no range checks
+	status = allocator->alloc( allocator, (void **) &state->codes, state->symbol_count * sizeof(*state->codes), F2_AF_CLEAR_MEM );
+	if( f2_failed( status ) )
+		return status;
+	status = allocator->alloc( allocator, (void **) &state->lengths, state->symbol_count * sizeof(*state->lengths), F2_AF_CLEAR_MEM );
+	if( f2_failed( status ) ) {
+		(void) allocator->free( allocator, (void **) &state->codes, state->symbol_count * sizeof(*state->codes), 0 );
+		return status;
+	}
+	for( i = 0; i < state->symbol_count && i < table->size; ++ i ) {
+		state->codes[i]		= table->codes[i];
+		state->lengths[i]	= table->code_lengths[i];
+	}
+
+	// Build pair table for 4-bit symbols if all codes exist and a pair fits the bit writer
+	if( 4 == state->value_bit_size ) {
+		state->use_pairs = 1;
+		for( i = 0; i < 16; ++ i ) {
+			if( 0 == state->lengths[i] || 16 < state->lengths[i] )
+				state->use_pairs = 0;
+		}
+		for( i = 0; i < 256 && state->use_pairs; ++ i ) {
+			state->pair_codes[i]	= state->codes[i & 15] | (state->codes[i >> 4] << state->lengths[i & 15]);
+			state->pair_lengths[i]	= (uint8_t) (state->lengths[i & 15] + state->lengths[i >> 4]);
 		}
 	}
-#endif
+
 	// Exit
 	return F2_STATUS_SUCCESS;
-}}
+}
+
+static void _encoder_state_deinitialize( _encoder_state * state, libhuffman_encode_context * encode_context )
+{
+	f2_allocator * allocator = encode_context->context->allocator;
+
+	(void) allocator->free( allocator, (void **) &state->codes, state->symbol_count * sizeof(*state->codes), 0 );
+	(void) allocator->free( allocator, (void **) &state->lengths, state->symbol_count * sizeof(*state->lengths), 0 );
+}
+
+static f2_status_t _emit_symbol( _encoder_state * state, unsigned index )
+{
+	state->missing |= 0 == state->lengths[index];
+	return _bit_writer_put( &state->writer, state->codes[index], state->lengths[index] );
+}
+
+static f2_status_t _encode_16( _encoder_state * state, const uint8_t * src, size_t first, size_t count )
+{
+	f2_status_t		status;
+	const uint8_t *	p = src + first * 2;
+	const uint8_t *	end = p + count * 2;
+
+	for( ; p < end; p += 2 ) {
+		status = _emit_symbol( state, p[0] | (p[1] << 8) );
+		if( f2_failed( status ) )
+			return status;
+	}
+	return F2_STATUS_SUCCESS;
+}
+
+static f2_status_t _encode_8( _encoder_state * state, const uint8_t * src, size_t first, size_t count )
+{
+	f2_status_t		status;
+	const uint8_t *	p = src + first;
+	const uint8_t *	end = p + count;
+
+	for( ; p < end; ++ p ) {
+		status = _emit_symbol( state, *p );
+		if( f2_failed( status ) )
+			return status;
+	}
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Encode 4-bit symbols, a byte (two symbols) per table lookup.
+ * @internal
+ */
+static f2_status_t _encode_4( _encoder_state * state, const uint8_t * src, size_t first, size_t count )
+{
+	f2_status_t		status;
+	const uint8_t *	p = src + first / 2;
+
+	// Odd leading symbol
+	if( 0 != (first & 1) && 0 != count ) {
+		status = _emit_symbol( state, *p ++ >> 4 );
+		if( f2_failed( status ) )
+			return status;
+		-- count;
+	}
+
+	// Whole bytes
+	if( state->use_pairs ) {
+		for( ; 2 <= count; count -= 2, ++ p ) {
+			status = _bit_writer_put( &state->writer, state->pair_codes[*p], state->pair_lengths[*p] );
+			if( f2_failed( status ) )
+				return status;
+		}
+	} else {
+		for( ; 2 <= count; count -= 2, ++ p ) {
+			status = _emit_symbol( state, *p & 15 );
+			if( !f2_failed( status ) )
+				status = _emit_symbol( state, *p >> 4 );
+			if( f2_failed( status ) )
+				return status;
+		}
+	}
+
+	// Odd trailing symbol
+	if( 0 != count )
+		return _emit_symbol( state, *p & 15 );
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Encode 1- or 2-bit symbols, unpacking a 64-bit word per load.
+ * @internal
+ */
+static f2_status_t _encode_packed( _encoder_state * state, const uint8_t * src, size_t first, size_t count, const unsigned bits )
+{
+	f2_status_t		status;
+	const unsigned	mask = (1U << bits) - 1;
+	const unsigned	per_byte = 8 / bits;
+	const uint8_t *	p = src + first / per_byte;
+	unsigned		shift = (unsigned) (first % per_byte) * bits;
+	uint64_t		word;
+	unsigned		i;
+
+	// Leading symbols of the partial byte
+	for( ; 0 != shift && 0 != count; -- count ) {
+		status = _emit_symbol( state, (*p >> shift) & mask );
+		if( f2_failed( status ) )
+			return status;
+		shift += bits;
+		if( 8 == shift ) {
+			shift = 0;
+			++ p;
+		}
+	}
+
+	// Whole words
+	for( ; 64 / bits <= count; count -= 64 / bits, p += sizeof(word) ) {
+		f2_small_memcpy( &word, p, sizeof(word) );
+		for( i = 0; i < 64 / bits; ++ i, word >>= bits ) {
+			status = _emit_symbol( state, (unsigned) word & mask );
+			if( f2_failed( status ) )
+				return status;
+		}
+	}
+
+	// Trailing symbols
+	for( ; 0 != count; -- count ) {
+		status = _emit_symbol( state, (*p >> shift) & mask );
+		if( f2_failed( status ) )
+			return status;
+		shift += bits;
+		if( 8 == shift ) {
+			shift = 0;
+			++ p;
+		}
+	}
+	return F2_STATUS_SUCCESS;
+}
+
+static f2_status_t _encode_2( _encoder_state * state, const uint8_t * src, size_t first, size_t count )
+{
+	return _encode_packed( state, src, first, count, 2 );
+}
+
+static f2_status_t _encode_1( _encoder_state * state, const uint8_t * src, size_t first, size_t count )
+{
+	return _encode_packed( state, src, first, count, 1 );
+}
+
+static _encode_kernel _select_kernel( unsigned value_bit_size )
+{
+	switch( value_bit_size ) {
+	case 1:		return _encode_1;
+	case 2:		return _encode_2;
+	case 4:		return _encode_4;
+	case 8:		return _encode_8;
+	case 16:	return _encode_16;
+	}
+	return nullptr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+f2_status_t	LIBHUFFMAN_CALLCONV libhuffman_encode( libhuffman_encode_context * encode_context )
+{
+	f2_status_t		status;
+	f2_istream *	istream;
+	_encode_kernel	kernel;
+	_encoder_state	state;
+	_block_splitter	splitter;
+	_output_sink	sink;
+	uint8_t			src_buf[4096];
+	size_t			pending = 0, nread, symbol_count, first, count;
+
+	// Check current state
+	debugbreak_if( nullptr == encode_context )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == encode_context->table )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( encode_context->value_bit_size != next_power_of_two( encode_context->value_bit_size - 1 ) )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	istream = encode_context->istream;
+
+	// Encode runs of equal symbols
+	if( nullptr != encode_context->run_table )
+		return _encode_runs( encode_context );
+
+	// Pick kernel
+	kernel = _select_kernel( encode_context->value_bit_size );
+	debugbreak_if( nullptr == kernel )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Prepare
+	status = _block_splitter_initialize( &splitter, encode_context );
+	if( f2_failed( status ) )
+		return status;
+
+	sink.ostream	= encode_context->ostream;
+	sink.allocator	= nullptr;
+	sink.data		= nullptr;
+	sink.size		= 0;
+	sink.capacity	= 0;
+
+	// Interleaved layout needs all lane lengths before the first word is written
+	if( nullptr != splitter.block_end && 0 != (encode_context->stream->flags & LIBHUFFMAN_STREAM_F_INTERLEAVED) ) {
+		encode_context->stream->flags &= ~LIBHUFFMAN_STREAM_F_INTERLEAVED;
+		sink.allocator = encode_context->context->allocator;
+	}
+
+	status = _encoder_state_initialize( &state, encode_context, &sink );
+	if( f2_failed( status ) )
+		return status;
+
+	while( !istream->eof( istream ) ) {
+
+		// Download data to the input buffer; a partial 16-bit symbol stays for the next read
+		status = istream->read( istream, src_buf + pending, sizeof(src_buf) - pending, &nread );
+		if( f2_failed( status ) )
+			goto cleanup;
+		if( 0 == nread )
+			break;
+		nread += pending;
+		symbol_count = nread * 8 / state.value_bit_size;
+
+		// Encode buffer in spans that don't cross block boundaries
+		for( first = 0; first < symbol_count; first += count ) {
+			if( splitter.symbol_index == splitter.next_boundary )
+				_block_splitter_next_block( &splitter, state.writer.bit_count );
+
+			count = symbol_count - first;
+			if( count > splitter.next_boundary - splitter.symbol_index )
+				count = (size_t) (splitter.next_boundary - splitter.symbol_index);
+
+			status = kernel( &state, src_buf, first, count );
+			if( f2_failed( status ) )
+				goto cleanup;
+			if( 0 != state.missing ) {
+				status = F2_STATUS_ERROR_INVALID_ALPHABET;
+				goto cleanup;
+			}
+			splitter.symbol_index += count;
+		}
+
+		pending = nread - symbol_count * state.value_bit_size / 8;
+		if( 0 != pending )
+			f2_small_memcpy( src_buf, src_buf + nread - pending, pending );
+	}
+
+	// Flush the rest of bits, including the last partial byte
+	status = _bit_writer_flush( &state.writer );
+	if( f2_failed( status ) )
+		goto cleanup;
+	_block_splitter_finish( &splitter, state.writer.bit_count );
+	if( nullptr != encode_context->stream )
+		encode_context->stream->data_bit_count = (size_t) state.writer.bit_count;
+
+	// Write interleaved lanes
+	status = _output_sink_flush_interleaved( &sink, encode_context->stream );
+
+cleanup:
+	_encoder_state_deinitialize( &state, encode_context );
+	_output_sink_deinitialize( &sink );
+	return status;
+}
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,1063 @@
+/*fax.c*/
+/** @file
+ * @brief CCITT fax decoding: T.4 one-dimensional (Modified Huffman) and two-dimensional (Modified READ) rows, T.6
+ * (Modified Modified READ) pages.
+ *
+ *	Run codes of each color and mode codes are looked up in tables built by libhuffman_decoder_layout_build and
+ * converted to compact 4-byte entries. Coded bits are read through a 64-bit accumulator with the next bit in bit 0.
+ * Rows are cleared to white and black runs are filled as spans of whole bytes and words, never pixel by pixel.
+ * Changing elements of the reference row are found 64 pixels at a time.
+ *
+ *	The encoder finds run boundaries of bitmap rows with the same changing element search and emits one-dimensional
+ * codes through a 64-bit accumulator, so neither side looks at single pixels.
+ */
+#include "pch.h"
+#include "main.h"
+
+#define LIBHUFFMAN_FAX_EOL_ZERO_COUNT		11		//< zeros of the EOL code before its final 1; more zeros are fill bits
+#define LIBHUFFMAN_FAX_MAKEUP_STEP			64		//< make-up runs are multiples of this
+#define LIBHUFFMAN_FAX_EXT_MAKEUP_RUN		1792	//< run of the first extended make-up code
+#define LIBHUFFMAN_FAX_MEMSET_SPAN			64		//< spans of this many bytes are filled with memset, shorter ones with words
+#define LIBHUFFMAN_FAX_REFILL_BIT_COUNT		32		//< accumulator is refilled below this, more than any code with its subtables
+#define LIBHUFFMAN_FAX_RTC_EOL_COUNT		6		//< EOL codes of RTC written at the page end
+
+//! Run or mode code taken from the code descriptor
+typedef struct _fax_code {
+	uint16_t	run;		//< run length, or biased vertical offset of mode codes
+	uint8_t		type;
+} _fax_code;
+
+//! T.4 two-dimensional mode code; bits are written as in the T.4 table, the first transmitted bit is the most significant
+typedef struct _fax_mode_code {
+	uint16_t	bits;
+	uint8_t		length;
+	uint8_t		type;
+	uint8_t		value;
+} _fax_mode_code;
+
+static const _fax_mode_code _mode_codes[] = {
+	{ 0x001, 4, LIBHUFFMAN_FAX_ET_PASS, 0 },											// 0001
+	{ 0x001, 3, LIBHUFFMAN_FAX_ET_HORIZONTAL, 0 },										// 001
+	{ 0x001, 1, LIBHUFFMAN_FAX_ET_VERTICAL, LIBHUFFMAN_FAX_VERTICAL_BIAS },				// 1, V(0)
+	{ 0x003, 3, LIBHUFFMAN_FAX_ET_VERTICAL, LIBHUFFMAN_FAX_VERTICAL_BIAS + 1 },			// 011, VR(1)
+	{ 0x003, 6, LIBHUFFMAN_FAX_ET_VERTICAL, LIBHUFFMAN_FAX_VERTICAL_BIAS + 2 },			// 000011, VR(2)
+	{ 0x003, 7, LIBHUFFMAN_FAX_ET_VERTICAL, LIBHUFFMAN_FAX_VERTICAL_BIAS + 3 },			// 0000011, VR(3)
+	{ 0x002, 3, LIBHUFFMAN_FAX_ET_VERTICAL, LIBHUFFMAN_FAX_VERTICAL_BIAS - 1 },			// 010, VL(1)
+	{ 0x002, 6, LIBHUFFMAN_FAX_ET_VERTICAL, LIBHUFFMAN_FAX_VERTICAL_BIAS - 2 },			// 000010, VL(2)
+	{ 0x002, 7, LIBHUFFMAN_FAX_ET_VERTICAL, LIBHUFFMAN_FAX_VERTICAL_BIAS - 3 },			// 0000010, VL(3)
+	{ 0x001, 12, LIBHUFFMAN_FAX_ET_EOL, 0 },											// 000000000001, EOL
+};
+#define LIBHUFFMAN_FAX_MODE_CODE_COUNT		(sizeof(_mode_codes) / sizeof(*_mode_codes))
+
+//! Writer of coded bits
+typedef struct _fax_writer {
+	uint8_t *		p;			//< next byte to store
+	uint8_t *		end;
+	uint64_t		acc;		//< pending bits, the first one in bit 0
+	unsigned		bit_count;	//< number of pending bits in acc
+	int				msb_first;	//< bytes are filled from bit 7
+} _fax_writer;
+
+//! Reader of coded bits
+typedef struct _fax_reader {
+	const uint8_t *	p;			//< next byte to load
+	const uint8_t *	end;
+	uint64_t		acc;		//< next bits, the first one in bit 0; bits above bit_count are zeros or the following data
+	unsigned		bit_count;	//< number of loaded bits in acc
+	int				msb_first;	//< bytes are filled from bit 7
+} _fax_reader;
+
+static int _is_action( const libhuffman_escape * escape, const char * name, size_t name_length )
+{
+	return escape->name_length == name_length && 0 == memcmp( escape->name, name, name_length );
+}
+
+/**
+ * @brief Get run code of the lookup table from the code descriptor.
+ * @internal
+ * @return (int) 1 if the code belongs to the lookup table, 0 if it doesn't, -1 if the descriptor is invalid.
+ *
+ *	Run lines "code : run : color" belong to the table of the color; extended make-up and EOL actions belong to both.
+ * Other actions and events are ignored.
+ */
+static int _get_fax_code( const libhuffman_code_desc * desc, unsigned lookup, _fax_code * code )
+{
+	uint64_t	run;
+
+	if( nullptr != desc->escape ) {
+		if( _is_action( desc->escape, LIBHUFFMAN_FAX_EOL_ACTION, sizeof(LIBHUFFMAN_FAX_EOL_ACTION) - 1 ) ) {
+			code->run = 0;
+			code->type = LIBHUFFMAN_FAX_ET_EOL;
+			return 1;
+		}
+		if( !_is_action( desc->escape, LIBHUFFMAN_FAX_MAKEUP_ACTION, sizeof(LIBHUFFMAN_FAX_MAKEUP_ACTION) - 1 ) )
+			return 0;
+		run = LIBHUFFMAN_FAX_EXT_MAKEUP_RUN + (uint64_t) desc->value.bits * LIBHUFFMAN_FAX_MAKEUP_STEP;
+	} else {
+		if( (unsigned) -1 == desc->count || (desc->value.bits & 1) != lookup )
+			return 0;
+		run = desc->count;
+	}
+
+	if( LIBHUFFMAN_FAX_MAKEUP_STEP > run ) {
+		code->type = LIBHUFFMAN_FAX_ET_TERMINATING;
+	} else {
+		if( 0 != run % LIBHUFFMAN_FAX_MAKEUP_STEP || LIBHUFFMAN_FAX_MAX_MAKEUP_RUN < run )
+			return -1;
+		code->type = LIBHUFFMAN_FAX_ET_MAKEUP;
+	}
+	code->run = (uint16_t) run;
+	return 1;
+}
+
+/**
+ * @brief Convert the built layout to fax table entries.
+ * @internal
+ */
+static void _convert_layout( libhuffman_fax_table * thisp, unsigned lookup, size_t first_entry,
+	const libhuffman_decoder_layout * layout, const libhuffman_code_desc * code_descs, const _fax_code * codes )
+{
+	libhuffman_fax_entry *	entry = thisp->entries + first_entry;
+	uint32_t				value;
+	size_t					i;
+
+	thisp->root_first[lookup] = (uint32_t) first_entry;
+	thisp->root_l2_size[lookup] = (uint8_t) layout->tables[0].l2_table_size;
+	for( i = 0; i < layout->entry_count; ++ i, ++ entry ) {
+		value = layout->entry_values[i];
+		switch( layout->entry_types[i] ) {
+		case btl_et_data:
+			entry->value = codes[value].run;
+			entry->length = code_descs[value].code.length;
+			entry->type = codes[value].type;
+			break;
+		case btl_et_subtable:
+			entry->value = (uint16_t) (first_entry + layout->tables[value].first_entry);
+			entry->length = (uint8_t) layout->tables[value].l2_table_size;
+			entry->type = LIBHUFFMAN_FAX_ET_SUBTABLE;
+			break;
+		default:
+			entry->value = 0;
+			entry->length = 0;
+			entry->type = LIBHUFFMAN_FAX_ET_INVALID;
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Store the code for the encoder.
+ * @internal
+ *
+ *	Encoder codes are 16 bits at most, longer codes are left out; T.4 codes are 13 bits at most.
+ */
+static void _set_encoder_code( libhuffman_fax_table * thisp, unsigned color, const _fax_code * code, libhuffman_code_t bits,
+	unsigned length )
+{
+	libhuffman_fax_code *	encoder_code;
+
+	switch( code->type ) {
+	case LIBHUFFMAN_FAX_ET_TERMINATING:
+		encoder_code = &thisp->terminating[color][code->run];
+		break;
+	case LIBHUFFMAN_FAX_ET_MAKEUP:
+		encoder_code = &thisp->makeup[color][code->run / LIBHUFFMAN_FAX_MAKEUP_STEP - 1];
+		break;
+	default:
+		encoder_code = &thisp->eol;
+		break;
+	}
+	if( 16 >= length ) {
+		encoder_code->bits = (uint16_t) bits;
+		encoder_code->length = (uint8_t) length;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Initialize fax table from code descriptors of the CCITT table (data/ccitt-g3.httf).
+ * @param[in] thisp (libhuffman_fax_table *) pointer to the uninitialized object.
+ * @param[in] context (libhuffman_context *) library context.
+ * @param[in] desc_array (const libhuffman_code_desc *) code descriptors: "code : run : color" lines, where color 0 is
+ *		white and 1 is black, LIBHUFFMAN_FAX_MAKEUP_ACTION and LIBHUFFMAN_FAX_EOL_ACTION actions.
+ * @param[in] desc_count (size_t) number of descriptors.
+ * @return (f2_status_t) operation status code; F2_STATUS_ERROR_INVALID_DATA if codes of a color aren't prefix-free
+ *		or a make-up run is invalid.
+ *
+ *	Codes are taken in T.4 order: the first digit of the code in the table file (the most significant bit of
+ * code.bits) is transmitted first. Two-dimensional mode codes are fixed by T.4 and aren't taken from the descriptors;
+ * the uncompressed mode extension isn't supported. Run and EOL codes are also stored for libhuffman_fax_encode.
+ */
+f2_status_t f2_callconv libhuffman_fax_table_initialize(
+	libhuffman_fax_table *			thisp,
+	libhuffman_context *			context,
+	const libhuffman_code_desc *	desc_array,
+	size_t							desc_count
+) {
+	f2_status_t					status = F2_STATUS_SUCCESS;
+	f2_allocator *				allocator;
+	libhuffman_decoder_layout	layouts[LIBHUFFMAN_FAX_LOOKUP_COUNT];
+	libhuffman_code_desc *		code_descs = nullptr;
+	_fax_code *					codes = nullptr;
+	size_t						lookup_size, code_count, entry_count, i;
+	unsigned					lookup;
+	int							result;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp || nullptr == context )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == desc_array || 0 == desc_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Initialize object
+	memset( thisp, 0, sizeof(*thisp) );
+	memset( layouts, 0, sizeof(layouts) );
+	thisp->context = context;
+	allocator = context->allocator;
+	lookup_size = LIBHUFFMAN_FAX_MODE_CODE_COUNT < desc_count ? desc_count : LIBHUFFMAN_FAX_MODE_CODE_COUNT;
+
+	// Allocate codes of all lookup tables
+	status = allocator->alloc( allocator, (void **) &code_descs, LIBHUFFMAN_FAX_LOOKUP_COUNT * lookup_size * sizeof(*code_descs), F2_AF_CLEAR_MEM );
+	if( !f2_failed( status ) )
+		status = allocator->alloc( allocator, (void **) &codes, LIBHUFFMAN_FAX_LOOKUP_COUNT * lookup_size * sizeof(*codes), 0 );
+
+	// Build layout of each lookup table from its codes, first transmitted bit in bit 0
+	for( entry_count = 0, lookup = 0; lookup < LIBHUFFMAN_FAX_LOOKUP_COUNT && !f2_failed( status ); ++ lookup ) {
+		libhuffman_code_desc *	lookup_descs = code_descs + lookup * lookup_size;
+		_fax_code *				lookup_codes = codes + lookup * lookup_size;
+
+		if( LIBHUFFMAN_FAX_MODE == lookup ) {
+			for( code_count = 0; code_count < LIBHUFFMAN_FAX_MODE_CODE_COUNT; ++ code_count ) {
+				lookup_codes[code_count].run = _mode_codes[code_count].value;
+				lookup_codes[code_count].type = _mode_codes[code_count].type;
+				lookup_descs[code_count].code.bits = libhuffman_reverse_code( _mode_codes[code_count].bits, _mode_codes[code_count].length );
+				lookup_descs[code_count].code.length = _mode_codes[code_count].length;
+			}
+			status = libhuffman_decoder_layout_build( context, 0, lookup_descs, code_count, &layouts[lookup] );
+			if( !f2_failed( status ) )
+				entry_count += layouts[lookup].entry_count;
+			continue;
+		}
+		for( code_count = 0, i = 0; i < desc_count; ++ i ) {
+			result = _get_fax_code( &desc_array[i], lookup, &lookup_codes[code_count] );
+			if( 0 > result ) {
+				status = F2_STATUS_ERROR_INVALID_DATA;
+				break;
+			}
+			if( 0 == result )
+				continue;
+			lookup_descs[code_count].code.bits = libhuffman_reverse_code( desc_array[i].code.bits, desc_array[i].code.length );
+			lookup_descs[code_count].code.length = desc_array[i].code.length;
+			_set_encoder_code( thisp, lookup, &lookup_codes[code_count], lookup_descs[code_count].code.bits,
+				lookup_descs[code_count].code.length );
+			++ code_count;
+		}
+		if( !f2_failed( status ) && 0 == code_count )
+			status = F2_STATUS_ERROR_INVALID_DATA;
+		if( !f2_failed( status ) )
+			status = libhuffman_decoder_layout_build( context, 0, lookup_descs, code_count, &layouts[lookup] );
+		if( !f2_failed( status ) )
+			entry_count += layouts[lookup].entry_count;
+	}
+
+	// Store all lookup tables in a single array
+	if( !f2_failed( status ) && (uint16_t) -1 < entry_count )
+		status = F2_STATUS_ERROR_INVALID_DATA;
+	if( !f2_failed( status ) )
+		status = allocator->alloc( allocator, (void **) &thisp->entries, entry_count * sizeof(*thisp->entries), 0 );
+	if( !f2_failed( status ) ) {
+		thisp->entry_count = entry_count;
+		for( entry_count = 0, lookup = 0; lookup < LIBHUFFMAN_FAX_LOOKUP_COUNT; ++ lookup ) {
+			_convert_layout( thisp, lookup, entry_count, &layouts[lookup], code_descs + lookup * lookup_size, codes + lookup * lookup_size );
+			entry_count += layouts[lookup].entry_count;
+		}
+	}
+
+	// Exit
+	for( lookup = 0; lookup < LIBHUFFMAN_FAX_LOOKUP_COUNT; ++ lookup ) {
+		if( nullptr != layouts[lookup].tables )
+			(void) libhuffman_decoder_layout_release( context, &layouts[lookup] );
+	}
+	if( nullptr != codes )
+		(void) allocator->free( allocator, (void **) &codes, LIBHUFFMAN_FAX_LOOKUP_COUNT * lookup_size * sizeof(*codes), 0 );
+	if( nullptr != code_descs )
+		(void) allocator->free( allocator, (void **) &code_descs, LIBHUFFMAN_FAX_LOOKUP_COUNT * lookup_size * sizeof(*code_descs), 0 );
+	if( f2_failed( status ) )
+		(void) libhuffman_fax_table_deinitialize( thisp );
+	return status;
+}
+
+f2_status_t f2_callconv libhuffman_fax_table_deinitialize(
+	libhuffman_fax_table *	thisp
+) {
+	// Check current state
+	debugbreak_if( nullptr == thisp )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == thisp->context )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
+
+	// Release memory
+	if( nullptr != thisp->entries )
+		(void) thisp->context->allocator->free( thisp->context->allocator, (void **) &thisp->entries,
+			thisp->entry_count * sizeof(*thisp->entries), 0 );
+
+	// Deinitialize object
+	thisp->entry_count = 0;
+	thisp->context = nullptr;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bit reader
+
+static void _fax_reader_initialize( _fax_reader * r, const void * data, size_t data_size, unsigned flags )
+{
+	r->p = (const uint8_t *) data;
+	r->end = r->p + data_size;
+	r->acc = 0;
+	r->bit_count = 0;
+	r->msb_first = 0 != (flags & LIBHUFFMAN_FAX_F_MSB_FIRST);
+}
+
+/**
+ * @brief Reverse bits in each byte of the word.
+ * @internal
+ */
+static uint64_t _reverse_byte_bits( uint64_t word )
+{
+	word = ((word >> 4) & UINT64_C(0x0F0F0F0F0F0F0F0F)) | ((word & UINT64_C(0x0F0F0F0F0F0F0F0F)) << 4);
+	word = ((word >> 2) & UINT64_C(0x3333333333333333)) | ((word & UINT64_C(0x3333333333333333)) << 2);
+	word = ((word >> 1) & UINT64_C(0x5555555555555555)) | ((word & UINT64_C(0x5555555555555555)) << 1);
+	return word;
+}
+
+/**
+ * @brief Load the accumulator up to 56..63 bits.
+ * @internal
+ *
+ *	Whole words are loaded while 8 bytes remain: the accumulator receives all bits the word has room for and the
+ * pointer moves by whole bytes only, so the partially loaded byte is loaded again with the same bits next time.
+ */
+static void _fax_refill( _fax_reader * r )
+{
+	uint64_t	word;
+
+	if( r->end - r->p >= (ptrdiff_t) sizeof(word) ) {
+		f2_small_memcpy( &word, r->p, sizeof(word) );
+		if( r->msb_first )
+			word = _reverse_byte_bits( word );
+		r->acc |= word << r->bit_count;
+		r->p += (63 - r->bit_count) >> 3;
+		r->bit_count |= 56;
+	} else {
+		for( ; r->bit_count <= 56 && r->p < r->end; ++ r->p, r->bit_count += 8 ) {
+			word = *r->p;
+			if( r->msb_first )
+				word = _reverse_byte_bits( word );
+			r->acc |= word << r->bit_count;
+		}
+	}
+}
+
+static void _fax_consume( _fax_reader * r, unsigned bit_count )
+{
+	r->acc >>= bit_count;
+	r->bit_count -= bit_count;
+}
+
+static int _fax_exhausted( const _fax_reader * r )
+{
+	return r->p >= r->end && 0 == r->bit_count;
+}
+
+/**
+ * @brief Skip bits up to the next byte boundary.
+ * @internal
+ */
+static void _fax_align( _fax_reader * r )
+{
+	_fax_consume( r, r->bit_count % 8 );
+}
+
+/**
+ * @brief Skip fill bits and EOL codes.
+ * @internal
+ * @return (unsigned) number of skipped EOL codes.
+ *
+ *	EOL is 11 zeros and 1; any number of zeros before it are fill bits, so the trailing zero count of the accumulator
+ * finds EOL with fill at once.
+ */
+static unsigned _fax_skip_eols( _fax_reader * r )
+{
+	unsigned	eol_count = 0, zeros;
+
+	for(;;) {
+		if( LIBHUFFMAN_FAX_REFILL_BIT_COUNT > r->bit_count )
+			_fax_refill( r );
+		zeros = ctz_uint64( r->acc );
+		if( zeros >= r->bit_count ) {
+			// Only zeros are loaded: fill bits continue, or data end
+			if( r->p >= r->end ) {
+				_fax_consume( r, r->bit_count );
+				return eol_count;
+			}
+			_fax_consume( r, r->bit_count - LIBHUFFMAN_FAX_EOL_ZERO_COUNT );
+			continue;
+		}
+		if( LIBHUFFMAN_FAX_EOL_ZERO_COUNT > zeros )
+			return eol_count;
+		_fax_consume( r, zeros + 1 );
+		++ eol_count;
+	}
+}
+
+/**
+ * @brief Skip bits up to the next EOL code, which is left for _fax_skip_eols.
+ * @internal
+ * @return (int) non-0 if EOL is found, 0 at data end.
+ *
+ *	T.4 codes never have 11 zeros in a row, so the first run of 11 zeros starts EOL with its fill bits. Runs are found
+ * in the whole accumulator at once: after ANDing the inverted bits with their copies shifted by 1, 2, 4 and 3 bits,
+ * bit i is set if bits i..i+10 are zeros. The last 10 bits are kept, since a run may continue in the next word.
+ */
+static int _fax_find_eol( _fax_reader * r )
+{
+	uint64_t	zeros;
+
+	for(;;) {
+		_fax_refill( r );
+		zeros = 64 > r->bit_count ? ~r->acc & ((UINT64_C(1) << r->bit_count) - 1) : ~r->acc;
+		zeros &= zeros >> 1;
+		zeros &= zeros >> 2;
+		zeros &= zeros >> 4;
+		zeros &= zeros >> 3;
+		if( 0 != zeros ) {
+			_fax_consume( r, ctz_uint64( zeros ) );
+			return 1;
+		}
+		if( r->p >= r->end ) {
+			_fax_consume( r, r->bit_count );
+			return 0;
+		}
+		_fax_consume( r, r->bit_count - (LIBHUFFMAN_FAX_EOL_ZERO_COUNT - 1) );
+	}
+}
+
+/**
+ * @brief Get offset of the next bit in coded data.
+ * @internal
+ */
+static size_t _fax_bit_offset( const _fax_reader * r, const void * data )
+{
+	return (size_t) (r->p - (const uint8_t *) data) * 8 - r->bit_count;
+}
+
+/**
+ * @brief Look up the next code.
+ * @internal
+ * @return (const libhuffman_fax_entry *) entry of the code; its length is the whole code length.
+ */
+static const libhuffman_fax_entry * _fax_lookup( const libhuffman_fax_table * table, unsigned lookup, uint64_t acc )
+{
+	const libhuffman_fax_entry *	entry;
+	unsigned						shift, l2_size;
+
+	shift = table->root_l2_size[lookup];
+	entry = &table->entries[table->root_first[lookup] + (size_t) (acc & ((1U << shift) - 1))];
+	while( LIBHUFFMAN_FAX_ET_SUBTABLE == entry->type ) {
+		l2_size = entry->length;
+		entry = &table->entries[entry->value + (size_t) ((acc >> shift) & ((1U << l2_size) - 1))];
+		shift += l2_size;
+	}
+	return entry;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rows
+
+/**
+ * @brief Set pixels [x0, x1) of the row to black.
+ * @internal
+ *
+ *	Partial bytes at the ends are masked, whole bytes between them are stored as 64-bit words, or with memset (which
+ * libc implements with vector stores) for long spans.
+ */
+static void _fax_fill_span( uint8_t * row, size_t x0, size_t x1 )
+{
+	uint8_t *		p = row + x0 / 8;
+	uint8_t * const	last = row + (x1 - 1) / 8;
+	const uint8_t	head = (uint8_t) (0xFF >> (x0 % 8));
+	const uint8_t	tail = (uint8_t) (0xFF << (7 - (x1 - 1) % 8));
+	const uint64_t	ones = UINT64_MAX;
+	size_t			count;
+
+	if( p == last ) {
+		*p |= head & tail;
+		return;
+	}
+	*p ++ |= head;
+	count = (size_t) (last - p);
+	if( LIBHUFFMAN_FAX_MEMSET_SPAN <= count )
+		memset( p, 0xFF, count );
+	else {
+		for( ; 8 <= count; count -= 8, p += 8 )
+			f2_small_memcpy( p, &ones, sizeof(ones) );
+		for( ; 0 != count; -- count )
+			*p ++ = 0xFF;
+	}
+	*last |= tail;
+}
+
+/**
+ * @brief Load 64 pixels of the row from the byte, the first pixel in the most significant bit.
+ * @internal
+ *
+ *	Bytes past the row end are zeros (white).
+ */
+static uint64_t _fax_load_pixels( const uint8_t * row, size_t byte_index, size_t row_size )
+{
+	const uint8_t *	p = row + byte_index;
+	uint64_t		word = 0;
+	size_t			count, i;
+
+	if( 8 <= row_size - byte_index )
+		return ((uint64_t) p[0] << 56) | ((uint64_t) p[1] << 48) | ((uint64_t) p[2] << 40) | ((uint64_t) p[3] << 32) |
+			((uint64_t) p[4] << 24) | ((uint64_t) p[5] << 16) | ((uint64_t) p[6] << 8) | (uint64_t) p[7];
+	for( count = row_size - byte_index, i = 0; i < count; ++ i )
+		word |= (uint64_t) p[i] << (56 - 8 * i);
+	return word;
+}
+
+/**
+ * @brief Find the first changing element of the reference row at or after x whose pixel has the color.
+ * @internal
+ * @param[in] ref (const uint8_t *) reference row; nullptr is the imaginary white row.
+ * @return (size_t) position of the changing element, width if there is none.
+ *
+ *	A pixel changes to black where it's black and its left neighbour is white, and to white vice versa. Left
+ * neighbours of 64 pixels are their word shifted right by one with the last pixel of the previous byte on top, and
+ * the leading zero count of the changes is the position of the first one. Pixel -1 is white.
+ */
+static size_t _fax_find_change( const uint8_t * ref, size_t width, size_t x, unsigned color )
+{
+	const size_t	row_size = (width + 7) / 8;
+	size_t			byte_index = x / 8;
+	uint64_t		pixels, left, changes, mask = UINT64_MAX >> (x % 8);
+
+	if( nullptr == ref )
+		return width;
+	for( ; byte_index < row_size; byte_index += 8, mask = UINT64_MAX ) {
+		pixels = _fax_load_pixels( ref, byte_index, row_size );
+		left = (pixels >> 1) | (0 != byte_index ? (uint64_t) (ref[byte_index - 1] & 1) << 63 : 0);
+		changes = (LIBHUFFMAN_FAX_BLACK == color ? pixels & ~left : ~pixels & left) & mask;
+		if( 0 != changes ) {
+			x = byte_index * 8 + clz_uint64( changes );
+			return x < width ? x : width;
+		}
+	}
+	return width;
+}
+
+/**
+ * @brief Decode run of the color: make-up codes and the terminating code.
+ * @internal
+ * @return (int) 0 on success, -1 if an invalid code or EOL is met (the code is left unread).
+ */
+static int _fax_decode_run( _fax_reader * r, const libhuffman_fax_table * table, unsigned color, size_t * run )
+{
+	const libhuffman_fax_entry *	entry;
+
+	*run = 0;
+	do {
+		if( LIBHUFFMAN_FAX_REFILL_BIT_COUNT > r->bit_count )
+			_fax_refill( r );
+		entry = _fax_lookup( table, color, r->acc );
+		if( (LIBHUFFMAN_FAX_ET_TERMINATING != entry->type && LIBHUFFMAN_FAX_ET_MAKEUP != entry->type) ||
+			entry->length > r->bit_count )
+			return -1;
+		_fax_consume( r, entry->length );
+		*run += entry->value;
+	} while( LIBHUFFMAN_FAX_ET_MAKEUP == entry->type );
+	return 0;
+}
+
+/**
+ * @brief Decode one-dimensional row: alternating white and black runs, the first one is white.
+ * @internal
+ * @return (int) 0 on success, -1 if the row is damaged: an invalid code or EOL is met before the row end (the code
+ *		is left unread), or runs exceed the row width. The rest of a damaged row is white.
+ */
+static int _fax_decode_row_1d( _fax_reader * r, const libhuffman_fax_table * table, uint8_t * row, size_t width )
+{
+	size_t		x = 0, run;
+	unsigned	color = LIBHUFFMAN_FAX_WHITE;
+
+	memset( row, 0, (width + 7) / 8 );
+	while( x < width ) {
+		if( 0 != _fax_decode_run( r, table, color, &run ) )
+			return -1;
+
+		// White pixels are already cleared
+		if( run > width - x ) {
+			if( LIBHUFFMAN_FAX_BLACK == color )
+				_fax_fill_span( row, x, width );
+			return -1;
+		}
+		if( LIBHUFFMAN_FAX_BLACK == color && 0 != run )
+			_fax_fill_span( row, x, x + run );
+		x += run;
+		color ^= 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Decode two-dimensional row relative to the reference row.
+ * @internal
+ * @param[in] ref (const uint8_t *) reference row, nullptr for the imaginary white row above the first T.6 row.
+ * @return (int) 0 on success, -1 if the row is damaged: an invalid code or EOL is met before the row end (the code
+ *		is left unread), or a changing element is out of the row. The rest of a damaged row is white.
+ *
+ *	a0 starts before the first pixel, so b1 is searched from pixel 0 and the first horizontal run starts there.
+ */
+static int _fax_decode_row_2d( _fax_reader * r, const libhuffman_fax_table * table, const uint8_t * ref, uint8_t * row,
+	size_t width )
+{
+	const libhuffman_fax_entry *	entry;
+	size_t							a0 = 0, a1, b1, b2, run1, run2;
+	unsigned						color = LIBHUFFMAN_FAX_WHITE;
+	int								start = 1;
+
+	memset( row, 0, (width + 7) / 8 );
+	while( a0 < width ) {
+		if( LIBHUFFMAN_FAX_REFILL_BIT_COUNT > r->bit_count )
+			_fax_refill( r );
+		entry = _fax_lookup( table, LIBHUFFMAN_FAX_MODE, r->acc );
+		if( LIBHUFFMAN_FAX_ET_PASS > entry->type || entry->length > r->bit_count )
+			return -1;
+		_fax_consume( r, entry->length );
+		b1 = _fax_find_change( ref, width, start ? 0 : a0 + 1, color ^ 1 );
+		start = 0;
+
+		switch( entry->type ) {
+		case LIBHUFFMAN_FAX_ET_PASS:
+			b2 = b1 < width ? _fax_find_change( ref, width, b1 + 1, color ) : width;
+			if( LIBHUFFMAN_FAX_BLACK == color && a0 < b2 )
+				_fax_fill_span( row, a0, b2 );
+			a0 = b2;
+			break;
+
+		case LIBHUFFMAN_FAX_ET_HORIZONTAL:
+			if( 0 != _fax_decode_run( r, table, color, &run1 ) || 0 != _fax_decode_run( r, table, color ^ 1, &run2 ) )
+				return -1;
+			if( run1 > width - a0 || run2 > width - a0 - run1 )
+				return -1;
+			if( 0 != run1 && LIBHUFFMAN_FAX_BLACK == color )
+				_fax_fill_span( row, a0, a0 + run1 );
+			if( 0 != run2 && LIBHUFFMAN_FAX_WHITE == color )
+				_fax_fill_span( row, a0 + run1, a0 + run1 + run2 );
+			a0 += run1 + run2;
+			break;
+
+		default:
+			// Vertical mode: a1 is within 3 pixels of b1
+			if( b1 + entry->value < LIBHUFFMAN_FAX_VERTICAL_BIAS )
+				return -1;
+			a1 = b1 + entry->value - LIBHUFFMAN_FAX_VERTICAL_BIAS;
+			if( a1 < a0 || a1 > width )
+				return -1;
+			if( LIBHUFFMAN_FAX_BLACK == color && a0 < a1 )
+				_fax_fill_span( row, a0, a1 );
+			a0 = a1;
+			color ^= 1;
+			break;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Decode rows [first_row, end_row) of the page.
+ * @internal
+ * @return (size_t) index past the last decoded row.
+ */
+static size_t _fax_decode_rows( const libhuffman_fax_table * table, const libhuffman_fax_page * page, _fax_reader * r,
+	size_t first_row, size_t end_row, size_t * damaged_row_count )
+{
+	uint8_t *	row;
+	size_t		y;
+	unsigned	eol_count, tag;
+	int			result;
+
+	for( y = first_row; y < end_row; ) {
+		if( 0 != (page->flags & LIBHUFFMAN_FAX_F_BYTE_ALIGNED) )
+			_fax_align( r );
+		eol_count = _fax_skip_eols( r );
+		if( _fax_exhausted( r ) )
+			break;
+		if( LIBHUFFMAN_FAX_CODING_G4 == page->coding ? 0 != eol_count : 2 <= eol_count && 0 != y )
+			break;
+
+		row = page->bitmap + y * page->stride;
+		switch( page->coding ) {
+		case LIBHUFFMAN_FAX_CODING_G3_2D:
+			// The tag bit after EOL selects the coding of the row: 1 is one-dimensional, 0 is two-dimensional
+			if( 0 == r->bit_count )
+				_fax_refill( r );
+			tag = (unsigned) (r->acc & 1);
+			_fax_consume( r, 1 );
+			if( 0 != tag )
+				result = _fax_decode_row_1d( r, table, row, page->width );
+			else
+				result = _fax_decode_row_2d( r, table, 0 != y ? row - page->stride : nullptr, row, page->width );
+			break;
+		case LIBHUFFMAN_FAX_CODING_G4:
+			result = _fax_decode_row_2d( r, table, 0 != y ? row - page->stride : nullptr, row, page->width );
+			break;
+		default:
+			result = _fax_decode_row_1d( r, table, row, page->width );
+			break;
+		}
+
+		++ y;
+		if( 0 != result ) {
+			++ *damaged_row_count;
+			if( LIBHUFFMAN_FAX_CODING_G4 == page->coding || 0 != (page->flags & LIBHUFFMAN_FAX_F_BYTE_ALIGNED) ||
+				!_fax_find_eol( r ) )
+				break;
+		}
+	}
+	return y;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Decode T.4 or T.6 page.
+ * @param[in] table (const libhuffman_fax_table *) fax table.
+ * @param[in,out] page (libhuffman_fax_page *) page; row_count and damaged_row_count receive the result.
+ * @return (f2_status_t) operation status code.
+ *
+ *	Rows may be preceded by EOL codes with any number of fill bits, so pages with and without EncodedByteAlign are
+ * decoded alike. Decoding stops at data end, at RTC (two or more EOL codes in a row), at T.6 EOFB or when the bitmap
+ * is full. A damaged row is completed with white and decoding resumes at the next EOL; rows without EOL codes
+ * (LIBHUFFMAN_FAX_F_BYTE_ALIGNED, T.6) can't be resynchronized, so decoding stops at the damaged row. A
+ * two-dimensional row refers to the previous row of the bitmap as decoded, damaged or not.
+ */
+f2_status_t f2_callconv libhuffman_fax_decode(
+	const libhuffman_fax_table *	table,
+	libhuffman_fax_page *			page
+) {
+	_fax_reader	reader;
+
+	// Check current state
+	debugbreak_if( nullptr == table || nullptr == page )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == table->entries )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
+	debugbreak_if( nullptr == page->data && 0 != page->data_size )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 0 == page->width || page->stride < (page->width + 7) / 8 )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == page->bitmap && 0 != page->max_row_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( LIBHUFFMAN_FAX_CODING_G4 < page->coding )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	page->damaged_row_count = 0;
+	_fax_reader_initialize( &reader, page->data, page->data_size, page->flags );
+
+	// Decode rows
+	page->row_count = _fax_decode_rows( table, page, &reader, 0, page->max_row_count, &page->damaged_row_count );
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Split T.4 page in row groups that can be decoded independently.
+ * @param[in] page (const libhuffman_fax_page *) page; row_count and damaged_row_count aren't used.
+ * @param[out] groups (libhuffman_fax_row_group *) groups in row order; decoded_row_count and damaged_row_count are
+ *		cleared.
+ * @param[in] max_group_count (size_t) maximum number of groups.
+ * @param[out] group_count (size_t *) number of groups, at least 1.
+ * @return (f2_status_t) operation status code.
+ *
+ *	Groups start at EOL codes following roughly equal shares of coded data, and rows are numbered by counting EOL
+ * codes on the way, which takes a few word operations per 50 bits (see _fax_find_eol) instead of decoding. A
+ * two-dimensional page is split only before one-dimensional rows, since other rows refer to the previous one.
+ * Pages without EOL codes (LIBHUFFMAN_FAX_F_BYTE_ALIGNED, T.6) make a single group. The last group extends to the
+ * bitmap end and ends at RTC like the whole page.
+ */
+f2_status_t f2_callconv libhuffman_fax_split(
+	const libhuffman_fax_page *		page,
+	libhuffman_fax_row_group *		groups,
+	size_t							max_group_count,
+	size_t *						group_count
+) {
+	_fax_reader	reader;
+	size_t		count = 1, share, bit_offset, y, i;
+	unsigned	eol_count;
+
+	// Check current state
+	debugbreak_if( nullptr == page || nullptr == groups || 0 == max_group_count || nullptr == group_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == page->data && 0 != page->data_size )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( LIBHUFFMAN_FAX_CODING_G4 < page->coding )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	share = page->data_size * 8 / max_group_count;
+	groups[0].bit_offset = 0;
+	groups[0].first_row = 0;
+
+	// Count rows by EOL codes; the first row starts after leading EOL codes
+	if( LIBHUFFMAN_FAX_CODING_G4 != page->coding && 0 == (page->flags & LIBHUFFMAN_FAX_F_BYTE_ALIGNED) ) {
+		_fax_reader_initialize( &reader, page->data, page->data_size, page->flags );
+		(void) _fax_skip_eols( &reader );
+		for( y = 1; y < page->max_row_count && count < max_group_count; ++ y ) {
+			if( !_fax_find_eol( &reader ) )
+				break;
+			bit_offset = _fax_bit_offset( &reader, page->data );
+			eol_count = _fax_skip_eols( &reader );
+			if( _fax_exhausted( &reader ) || 2 <= eol_count )
+				break;
+			if( bit_offset < count * share )
+				continue;
+			if( LIBHUFFMAN_FAX_CODING_G3_2D == page->coding ) {
+				if( 0 == reader.bit_count )
+					_fax_refill( &reader );
+				if( 0 == (reader.acc & 1) )
+					continue;
+			}
+			groups[count].bit_offset = bit_offset;
+			groups[count].first_row = y;
+			++ count;
+		}
+	}
+
+	// Rows of each group reach the next one
+	for( i = 0; i < count; ++ i ) {
+		groups[i].row_count = (i + 1 < count ? groups[i + 1].first_row : page->max_row_count) - groups[i].first_row;
+		groups[i].decoded_row_count = 0;
+		groups[i].damaged_row_count = 0;
+	}
+	*group_count = count;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Decode rows of the group into their place in the page bitmap.
+ * @param[in] table (const libhuffman_fax_table *) fax table.
+ * @param[in] page (const libhuffman_fax_page *) page; row_count and damaged_row_count aren't changed.
+ * @param[in,out] group (libhuffman_fax_row_group *) group made by libhuffman_fax_split; decoded_row_count and
+ *		damaged_row_count receive the result.
+ * @return (f2_status_t) operation status code.
+ *
+ *	Groups write disjoint rows and only read the table and coded data, so groups of a page may be decoded by
+ * concurrent threads. The page has first_row + decoded_row_count rows of the last group which has decoded rows. For
+ * undamaged data the result is the same as that of libhuffman_fax_decode; in damaged data rows are placed by EOL
+ * codes, while libhuffman_fax_decode also counts garbage it decodes as a row before the next EOL.
+ */
+f2_status_t f2_callconv libhuffman_fax_decode_group(
+	const libhuffman_fax_table *	table,
+	const libhuffman_fax_page *		page,
+	libhuffman_fax_row_group *		group
+) {
+	_fax_reader	reader;
+
+	// Check current state
+	debugbreak_if( nullptr == table || nullptr == page || nullptr == group )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == table->entries )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
+	debugbreak_if( nullptr == page->data && 0 != page->data_size )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 0 == page->width || page->stride < (page->width + 7) / 8 )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == page->bitmap && 0 != page->max_row_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( LIBHUFFMAN_FAX_CODING_G4 < page->coding )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( group->first_row > page->max_row_count || group->row_count > page->max_row_count - group->first_row )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( group->bit_offset > page->data_size * 8 )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	group->damaged_row_count = 0;
+	_fax_reader_initialize( &reader, (const uint8_t *) page->data + group->bit_offset / 8, page->data_size - group->bit_offset / 8,
+		page->flags );
+	_fax_refill( &reader );
+	_fax_consume( &reader, (unsigned) (group->bit_offset % 8) );
+
+	// Decode rows
+	group->decoded_row_count = _fax_decode_rows( table, page, &reader, group->first_row, group->first_row + group->row_count,
+		&group->damaged_row_count ) - group->first_row;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Encoding
+
+static void _fax_writer_initialize( _fax_writer * w, void * data, size_t data_capacity, unsigned flags )
+{
+	w->p = (uint8_t *) data;
+	w->end = w->p + data_capacity;
+	w->acc = 0;
+	w->bit_count = 0;
+	w->msb_first = 0 != (flags & LIBHUFFMAN_FAX_F_MSB_FIRST);
+}
+
+/**
+ * @brief Store complete bytes of the accumulator.
+ * @internal
+ *
+ *	While 8 bytes of room remain the whole accumulator is stored as a word, including the partial byte, which is
+ * stored again with the following bits next time.
+ */
+static f2_status_t _fax_writer_drain( _fax_writer * w )
+{
+	const size_t	count = w->bit_count / 8;
+	const uint64_t	word = w->msb_first ? _reverse_byte_bits( w->acc ) : w->acc;
+	size_t			i;
+
+	if( w->end - w->p >= (ptrdiff_t) sizeof(word) )
+		f2_small_memcpy( w->p, &word, sizeof(word) );
+	else {
+		if( (size_t) (w->end - w->p) < count )
+			return F2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+		for( i = 0; i < count; ++ i )
+			w->p[i] = (uint8_t) (word >> (8 * i));
+	}
+	w->p += count;
+	w->acc >>= 8 * count;
+	w->bit_count -= (unsigned) (8 * count);
+	return F2_STATUS_SUCCESS;
+}
+
+static f2_status_t _fax_put( _fax_writer * w, const libhuffman_fax_code * code )
+{
+	debugbreak_if( 0 == code->length )
+		return F2_STATUS_ERROR_INVALID_ALPHABET;
+	w->acc |= (uint64_t) code->bits << w->bit_count;
+	w->bit_count += code->length;
+	return 32 <= w->bit_count ? _fax_writer_drain( w ) : F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Pad pending bits with zeros up to the next byte boundary.
+ * @internal
+ */
+static void _fax_writer_align( _fax_writer * w )
+{
+	w->bit_count = (w->bit_count + 7) & ~7U;
+}
+
+/**
+ * @brief Emit run of the color: 2560-pixel make-up codes, the make-up code of the rest and the terminating code.
+ * @internal
+ */
+static f2_status_t _fax_put_run( _fax_writer * w, const libhuffman_fax_table * table, unsigned color, size_t run )
+{
+	f2_status_t	status;
+	size_t		makeup_count;
+
+	while( LIBHUFFMAN_FAX_MAKEUP_STEP <= run ) {
+		makeup_count = LIBHUFFMAN_FAX_MAX_MAKEUP_RUN < run ? LIBHUFFMAN_FAX_MAKEUP_COUNT : run / LIBHUFFMAN_FAX_MAKEUP_STEP;
+		status = _fax_put( w, &table->makeup[color][makeup_count - 1] );
+		if( f2_failed( status ) )
+			return status;
+		run -= makeup_count * LIBHUFFMAN_FAX_MAKEUP_STEP;
+	}
+	return _fax_put( w, &table->terminating[color][run] );
+}
+
+/**
+ * @brief Encode one-dimensional row.
+ * @internal
+ *
+ *	Each run ends at the first changing element to the other color, so runs are found 64 pixels at a time; a row
+ * starting with black begins with an empty white run.
+ */
+static f2_status_t _fax_encode_row_1d( _fax_writer * w, const libhuffman_fax_table * table, const uint8_t * row, size_t width )
+{
+	f2_status_t	status;
+	size_t		x = 0, x1;
+	unsigned	color = LIBHUFFMAN_FAX_WHITE;
+
+	while( x < width ) {
+		x1 = _fax_find_change( row, width, x, color ^ 1 );
+		status = _fax_put_run( w, table, color, x1 - x );
+		if( f2_failed( status ) )
+			return status;
+		x = x1;
+		color ^= 1;
+	}
+	return F2_STATUS_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Encode T.4 one-dimensional page.
+ * @param[in] table (const libhuffman_fax_table *) fax table.
+ * @param[in,out] page (libhuffman_fax_encode_page *) page; data_size receives the size of coded data.
+ * @return (f2_status_t) operation status code; F2_STATUS_ERROR_INSUFFICIENT_MEMORY if coded data don't fit the
+ *		buffer, F2_STATUS_ERROR_INVALID_ALPHABET if the table lacks a needed code.
+ *
+ *	Each row follows EOL and the page ends with RTC (six EOL codes); with LIBHUFFMAN_FAX_F_BYTE_ALIGNED rows start at
+ * byte boundaries without EOL codes (TIFF Modified Huffman RLE). Pixels past the row width are ignored.
+ */
+f2_status_t f2_callconv libhuffman_fax_encode(
+	const libhuffman_fax_table *	table,
+	libhuffman_fax_encode_page *	page
+) {
+	f2_status_t	status = F2_STATUS_SUCCESS;
+	_fax_writer	writer;
+	size_t		y;
+	unsigned	i;
+
+	// Check current state
+	debugbreak_if( nullptr == table || nullptr == page )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == table->entries )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
+	debugbreak_if( 0 == page->width || page->stride < (page->width + 7) / 8 )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == page->bitmap && 0 != page->row_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == page->data && 0 != page->data_capacity )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	page->data_size = 0;
+	_fax_writer_initialize( &writer, page->data, page->data_capacity, page->flags );
+
+	// Encode rows
+	for( y = 0; y < page->row_count && !f2_failed( status ); ++ y ) {
+		if( 0 != (page->flags & LIBHUFFMAN_FAX_F_BYTE_ALIGNED) )
+			_fax_writer_align( &writer );
+		else
+			status = _fax_put( &writer, &table->eol );
+		if( !f2_failed( status ) )
+			status = _fax_encode_row_1d( &writer, table, page->bitmap + y * page->stride, page->width );
+	}
+
+	// Return to control, then store the last partial byte
+	if( 0 == (page->flags & LIBHUFFMAN_FAX_F_BYTE_ALIGNED) ) {
+		for( i = 0; i < LIBHUFFMAN_FAX_RTC_EOL_COUNT && !f2_failed( status ); ++ i )
+			status = _fax_put( &writer, &table->eol );
+	}
+	if( !f2_failed( status ) ) {
+		_fax_writer_align( &writer );
+		status = _fax_writer_drain( &writer );
+	}
+
+	// Exit
+	page->data_size = (size_t) (writer.p - (uint8_t *) page->data);
+	return status;
+}
+
+/*END OF fax.c*/
@@ -2,6 +2,10 @@
 #include "pch.h"
 #include "main.h"
 
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif // def _MSC_VER
+
 unsigned next_power_of_two( unsigned long v )
 {
     v--;
@@ -30,4 +34,28 @@ unsigned log2_uint64( uint64_t n )
     #undef S
 }
 
+unsigned ctz_uint64( uint64_t n )
+{
+#if defined( _MSC_VER ) && defined( _M_X64 )
+	unsigned long index;
+	return _BitScanForward64( &index, n ) ? (unsigned) index : 64;
+#elif defined( __GNUC__ )
+	return 0 == n ? 64 : (unsigned) __builtin_ctzll( n );
+#else
+	return 0 == n ? 64 : log2_uint64( n & (0 - n) );
+#endif
+}
+
+unsigned clz_uint64( uint64_t n )
+{
+#if defined( _MSC_VER ) && defined( _M_X64 )
+	unsigned long index;
+	return _BitScanReverse64( &index, n ) ? 63 - (unsigned) index : 64;
+#elif defined( __GNUC__ )
+	return 0 == n ? 64 : (unsigned) __builtin_clzll( n );
+#else
+	return 0 == n ? 64 : 63 - log2_uint64( n );
+#endif
+}
+
 /*END OF main.c*/
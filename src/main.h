@@ -6,5 +6,7 @@
 
 unsigned next_power_of_two( unsigned long v );
 unsigned log2_uint64( uint64_t n );
+unsigned ctz_uint64( uint64_t n );
+unsigned clz_uint64( uint64_t n );
 
 /*END OF main.h*/
@@ -0,0 +1,467 @@
+/*multitable.c*/
+#include "pch.h"
+#include "main.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Multi-table encoding plan
+//
+//	Source data are split in segments (one segment per output stream). Segments are clustered by similarity of their
+// histograms with k-means, where the distance from a segment to a table is the number of bits the segment takes when
+// coded with this table. Initial tables are seeded greedily: a new table is built from the segment that loses most
+// bits with the tables chosen so far, provided the loss exceeds the cost of storing one more table.
+
+#define LIBHUFFMAN_MULTITABLE_ITERATIONS	8		//< maximum number of k-means refinement passes
+
+static size_t _plan_symbol_count( const libhuffman_multitable_plan * plan )
+{
+	return (size_t) 1 << plan->value_bit_size;
+}
+
+static uint64_t _bit_count( const uint64_t * counts, const uint8_t * lengths, size_t symbol_count )
+{
+	uint64_t	bit_count = 0;
+	size_t		i;
+
+	for( i = 0; i < symbol_count; ++ i )
+		bit_count += counts[i] * lengths[i];
+	return bit_count;
+}
+
+/**
+ * @brief Number of bits the segment takes with the table.
+ * @internal
+ *
+ *	Tables built by the plan have codes for all symbols, so the cost is always finite.
+ */
+static uint64_t _segment_cost( const libhuffman_multitable_plan * plan, size_t segment_index, size_t table_index )
+{
+	const size_t symbol_count = _plan_symbol_count( plan );
+	return _bit_count(
+		plan->segment_histograms + segment_index * symbol_count,
+		plan->code_lengths + table_index * symbol_count,
+		symbol_count
+	);
+}
+
+/**
+ * @brief Rebuild code lengths of the table from histograms of the segments assigned to it.
+ * @internal
+ *
+ *	Each count is incremented so every symbol gets a code, and any segment can be coded with any table.
+ */
+static f2_status_t _build_table( libhuffman_multitable_plan * plan, size_t table_index, size_t single_segment )
+{
+	const size_t	symbol_count = _plan_symbol_count( plan );
+	uint64_t *		histogram = plan->table_histograms + table_index * symbol_count;
+	const uint64_t *segment_histogram;
+	size_t			segment_index, i;
+
+	// Merge histograms
+	for( i = 0; i < symbol_count; ++ i )
+		histogram[i] = 1;
+	for( segment_index = 0; segment_index < plan->segment_count; ++ segment_index ) {
+		if( (size_t) -1 != single_segment ? segment_index != single_segment : plan->segment_tables[segment_index] != table_index )
+			continue;
+		segment_histogram = plan->segment_histograms + segment_index * symbol_count;
+		for( i = 0; i < symbol_count; ++ i )
+			histogram[i] += segment_histogram[i];
+	}
+
+	// Build code lengths
+	return libhuffman_build_code_lengths(
+		plan->context->allocator,
+		histogram,
+		symbol_count,
+		plan->max_code_length,
+		plan->code_lengths + table_index * symbol_count
+	);
+}
+
+/**
+ * @brief Assign each segment the cheapest table.
+ * @internal
+ * @return (size_t) number of segments that changed their table.
+ */
+static size_t _assign_segments( libhuffman_multitable_plan * plan, uint64_t * segment_costs )
+{
+	size_t		segment_index, table_index, best_table, changed = 0;
+	uint64_t	cost, best_cost;
+
+	plan->total_bit_count = 0;
+	for( segment_index = 0; segment_index < plan->segment_count; ++ segment_index ) {
+		best_table = 0;
+		best_cost = _segment_cost( plan, segment_index, 0 );
+		for( table_index = 1; table_index < plan->table_count; ++ table_index ) {
+			cost = _segment_cost( plan, segment_index, table_index );
+			if( cost < best_cost ) {
+				best_cost = cost;
+				best_table = table_index;
+			}
+		}
+
+		if( plan->segment_tables[segment_index] != best_table ) {
+			plan->segment_tables[segment_index] = best_table;
+			++ changed;
+		}
+		if( nullptr != segment_costs )
+			segment_costs[segment_index] = best_cost;
+		plan->total_bit_count += best_cost;
+	}
+
+	return changed;
+}
+
+/**
+ * @brief Remove tables no segment is assigned to.
+ * @internal
+ */
+static void _compact_tables( libhuffman_multitable_plan * plan )
+{
+	const size_t	symbol_count = _plan_symbol_count( plan );
+	size_t			table_index, segment_index, new_count = 0;
+	size_t			use_count;
+
+	for( table_index = 0; table_index < plan->table_count; ++ table_index ) {
+		use_count = 0;
+		for( segment_index = 0; segment_index < plan->segment_count; ++ segment_index ) {
+			if( plan->segment_tables[segment_index] == table_index ) {
+				plan->segment_tables[segment_index] = new_count;
+				++ use_count;
+			}
+		}
+		if( 0 == use_count )
+			continue;
+
+		if( new_count != table_index ) {
+			f2_memcpy( plan->code_lengths + new_count * symbol_count, plan->code_lengths + table_index * symbol_count,
+				symbol_count * sizeof(*plan->code_lengths) );
+			f2_memcpy( plan->table_histograms + new_count * symbol_count, plan->table_histograms + table_index * symbol_count,
+				symbol_count * sizeof(*plan->table_histograms) );
+		}
+		++ new_count;
+	}
+	plan->table_count = new_count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Initialize multi-table plan.
+ * @param[in] thisp (libhuffman_multitable_plan *) pointer to the uninitialized object.
+ * @param[in] context (libhuffman_context *) library context.
+ * @param[in] value_bit_size (unsigned) size of the source symbol, in bits: 1, 2, 4, 8 or 16.
+ * @param[in] segment_count (size_t) number of source segments (output streams).
+ * @param[in] max_table_count (size_t) maximum number of tables, 1..LIBHUFFMAN_MAX_TABLE_COUNT.
+ * @return (f2_status_t) operation status code.
+ */
+f2_status_t f2_callconv libhuffman_multitable_plan_initialize(
+	libhuffman_multitable_plan *	thisp,
+	libhuffman_context *			context,
+	unsigned						value_bit_size,
+	size_t							segment_count,
+	size_t							max_table_count
+) {
+	f2_status_t		status;
+	f2_allocator *	allocator;
+	size_t			symbol_count;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp || nullptr == context )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 0 == value_bit_size || 16 < value_bit_size || value_bit_size != next_power_of_two( value_bit_size - 1 ) )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 0 == segment_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 0 == max_table_count || LIBHUFFMAN_MAX_TABLE_COUNT < max_table_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Initialize object
+	memset( thisp, 0, sizeof(*thisp) );
+	thisp->context = context;
+	thisp->value_bit_size = value_bit_size;
+	thisp->segment_count = segment_count;
+	thisp->max_table_count = max_table_count < segment_count ? max_table_count : segment_count;
+	thisp->max_code_length = value_bit_size < 15 ? 15 : value_bit_size + 4;
+	allocator = context->allocator;
+	symbol_count = _plan_symbol_count( thisp );
+
+	// Allocate memory
+	status = allocator->alloc( allocator, (void **) &thisp->segment_histograms,
+		segment_count * symbol_count * sizeof(*thisp->segment_histograms), F2_AF_CLEAR_MEM );
+	if( !f2_failed( status ) )
+		status = allocator->alloc( allocator, (void **) &thisp->table_histograms,
+			thisp->max_table_count * symbol_count * sizeof(*thisp->table_histograms), F2_AF_CLEAR_MEM );
+	if( !f2_failed( status ) )
+		status = allocator->alloc( allocator, (void **) &thisp->code_lengths,
+			thisp->max_table_count * symbol_count * sizeof(*thisp->code_lengths), F2_AF_CLEAR_MEM );
+	if( !f2_failed( status ) )
+		status = allocator->alloc( allocator, (void **) &thisp->segment_tables,
+			segment_count * sizeof(*thisp->segment_tables), F2_AF_CLEAR_MEM );
+	if( f2_failed( status ) ) {
+		(void) libhuffman_multitable_plan_deinitialize( thisp );
+		return status;
+	}
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+f2_status_t f2_callconv libhuffman_multitable_plan_deinitialize(
+	libhuffman_multitable_plan *	thisp
+) {
+	f2_allocator *	allocator;
+	size_t			symbol_count;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == thisp->context )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
+	allocator = thisp->context->allocator;
+	symbol_count = _plan_symbol_count( thisp );
+
+	// Release memory
+	if( nullptr != thisp->segment_histograms )
+		(void) allocator->free( allocator, (void **) &thisp->segment_histograms,
+			thisp->segment_count * symbol_count * sizeof(*thisp->segment_histograms), 0 );
+	if( nullptr != thisp->table_histograms )
+		(void) allocator->free( allocator, (void **) &thisp->table_histograms,
+			thisp->max_table_count * symbol_count * sizeof(*thisp->table_histograms), 0 );
+	if( nullptr != thisp->code_lengths )
+		(void) allocator->free( allocator, (void **) &thisp->code_lengths,
+			thisp->max_table_count * symbol_count * sizeof(*thisp->code_lengths), 0 );
+	if( nullptr != thisp->segment_tables )
+		(void) allocator->free( allocator, (void **) &thisp->segment_tables,
+			thisp->segment_count * sizeof(*thisp->segment_tables), 0 );
+
+	// Deinitialize object
+	thisp->context = nullptr;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Account source data in the histogram of the segment.
+ * @param[in] thisp (libhuffman_multitable_plan *) pointer to the initialized object.
+ * @param[in] segment_index (size_t) index of the segment.
+ * @param[in] data (const void *) source data; symbols are taken starting from the least significant bits.
+ * @param[in] size (size_t) size of source data, in bytes.
+ * @return (f2_status_t) operation status code.
+ */
+f2_status_t f2_callconv libhuffman_multitable_plan_count(
+	libhuffman_multitable_plan *	thisp,
+	size_t							segment_index,
+	const void *					data,
+	size_t							size
+) {
+	const uint8_t *	src = (const uint8_t *) data;
+	const uint8_t *	src_end = src + size;
+	uint64_t *		histogram;
+	unsigned		shift, mask;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp || (nullptr == data && 0 != size) )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == thisp->context )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
+	debugbreak_if( segment_index >= thisp->segment_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	histogram = thisp->segment_histograms + segment_index * _plan_symbol_count( thisp );
+
+	// Count symbols
+	if( 16 == thisp->value_bit_size ) {
+		for( ; src + 1 < src_end; src += 2 )
+			++ histogram[src[0] | (src[1] << 8)];
+	} else if( 8 == thisp->value_bit_size ) {
+		for( ; src < src_end; ++ src )
+			++ histogram[*src];
+	} else {
+		mask = (1U << thisp->value_bit_size) - 1;
+		for( ; src < src_end; ++ src ) {
+			for( shift = 0; shift < 8; shift += thisp->value_bit_size )
+				++ histogram[(*src >> shift) & mask];
+		}
+	}
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Cluster segments and build tables.
+ * @param[in] thisp (libhuffman_multitable_plan *) pointer to the initialized object with all segments counted.
+ * @return (f2_status_t) operation status code.
+ *
+ *	On exit, table_count holds the number of tables actually needed, segment_tables maps each segment to its
+ * table, and total_bit_count holds the size of all coded segments, in bits.
+ */
+f2_status_t f2_callconv libhuffman_multitable_plan_build(
+	libhuffman_multitable_plan *	thisp
+) {
+	f2_status_t		status;
+	f2_allocator *	allocator;
+	uint64_t *		segment_costs = nullptr;
+	uint64_t		own_cost, loss, best_loss, table_cost;
+	size_t			segment_index, table_index, best_segment, iteration;
+	const size_t	symbol_count = nullptr == thisp ? 0 : _plan_symbol_count( thisp );
+
+	// Check current state
+	debugbreak_if( nullptr == thisp )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == thisp->context )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
+	allocator = thisp->context->allocator;
+
+	status = allocator->alloc( allocator, (void **) &segment_costs, thisp->segment_count * sizeof(*segment_costs), 0 );
+	if( f2_failed( status ) )
+		return status;
+
+	// Start with a single table built from all data
+	memset( thisp->segment_tables, 0, thisp->segment_count * sizeof(*thisp->segment_tables) );
+	thisp->table_count = 1;
+	status = _build_table( thisp, 0, (size_t) -1 );
+	if( f2_failed( status ) )
+		goto cleanup;
+	(void) _assign_segments( thisp, segment_costs );
+
+	// Seed more tables from the segments coded worst
+	table_cost = (uint64_t) symbol_count * 8;		// stored code lengths
+	while( thisp->table_count < thisp->max_table_count ) {
+		best_segment = (size_t) -1;
+		best_loss = table_cost;
+		for( segment_index = 0; segment_index < thisp->segment_count; ++ segment_index ) {
+			status = _build_table( thisp, thisp->table_count, segment_index );
+			if( f2_failed( status ) )
+				goto cleanup;
+			own_cost = _segment_cost( thisp, segment_index, thisp->table_count );
+			loss = segment_costs[segment_index] > own_cost ? segment_costs[segment_index] - own_cost : 0;
+			if( loss > best_loss ) {
+				best_loss = loss;
+				best_segment = segment_index;
+			}
+		}
+		if( (size_t) -1 == best_segment )
+			break;
+
+		status = _build_table( thisp, thisp->table_count, best_segment );
+		if( f2_failed( status ) )
+			goto cleanup;
+		++ thisp->table_count;
+		(void) _assign_segments( thisp, segment_costs );
+	}
+
+	// Refine clusters
+	for( iteration = 0; iteration < LIBHUFFMAN_MULTITABLE_ITERATIONS; ++ iteration ) {
+		_compact_tables( thisp );
+		for( table_index = 0; table_index < thisp->table_count; ++ table_index ) {
+			status = _build_table( thisp, table_index, (size_t) -1 );
+			if( f2_failed( status ) )
+				goto cleanup;
+		}
+		if( 0 == _assign_segments( thisp, nullptr ) )
+			break;
+	}
+	_compact_tables( thisp );
+
+cleanup:
+	(void) allocator->free( allocator, (void **) &segment_costs, thisp->segment_count * sizeof(*segment_costs), 0 );
+	return status;
+}
+
+/**
+ * @brief Get code descriptors of the table.
+ * @param[in] thisp (const libhuffman_multitable_plan *) pointer to the built plan.
+ * @param[in] table_index (size_t) index of the table.
+ * @param[out] desc_array (libhuffman_code_desc *) array of 2^value_bit_size descriptors.
+ * @param[out] desc_count (size_t *) number of stored descriptors.
+ * @return (f2_status_t) operation status code.
+ *
+ *	Codes are canonical, so the table is fully described by its code lengths.
+ */
+f2_status_t f2_callconv libhuffman_multitable_plan_get_code_descs(
+	const libhuffman_multitable_plan *	thisp,
+	size_t								table_index,
+	libhuffman_code_desc *				desc_array,
+	size_t *							desc_count
+) {
+	f2_status_t			status;
+	f2_allocator *		allocator;
+	libhuffman_code_t *	codes = nullptr;
+	const uint8_t *		lengths;
+	size_t				symbol_count, i, n = 0;
+
+	// Check current state
+	debugbreak_if( nullptr == desc_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	*desc_count = 0;
+	debugbreak_if( nullptr == thisp || nullptr == desc_array )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( table_index >= thisp->table_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	allocator = thisp->context->allocator;
+	symbol_count = _plan_symbol_count( thisp );
+	lengths = thisp->code_lengths + table_index * symbol_count;
+
+	// Assign codes
+	status = allocator->alloc( allocator, (void **) &codes, symbol_count * sizeof(*codes), 0 );
+	if( f2_failed( status ) )
+		return status;
+	status = libhuffman_build_canonical_codes( lengths, symbol_count, codes );
+
+	// Fill descriptors
+	if( !f2_failed( status ) ) {
+		for( i = 0; i < symbol_count; ++ i ) {
+			if( 0 == lengths[i] )
+				continue;
+			memset( &desc_array[n], 0, sizeof(*desc_array) );
+			desc_array[n].code.bits		= codes[i];
+			desc_array[n].code.length	= lengths[i];
+			desc_array[n].value.bits	= (libhuffman_code_t) i;
+			desc_array[n].value.length	= (uint8_t) thisp->value_bit_size;
+			desc_array[n].count			= 1;
+			++ n;
+		}
+		*desc_count = n;
+	}
+
+	// Exit
+	(void) allocator->free( allocator, (void **) &codes, symbol_count * sizeof(*codes), 0 );
+	return status;
+}
+
+/**
+ * @brief Write the table in the form stored in the TABLES section.
+ * @param[in] thisp (const libhuffman_multitable_plan *) pointer to the built plan.
+ * @param[in] table_index (size_t) index of the table.
+ * @param[in] ostream (f2_ostream *) output stream.
+ * @return (f2_status_t) operation status code.
+ *
+ *	A table is stored as value bit size (1 byte) followed by 2^value_bit_size code lengths (1 byte each);
+ * codes are canonical.
+ */
+f2_status_t f2_callconv libhuffman_multitable_plan_write_table(
+	const libhuffman_multitable_plan *	thisp,
+	size_t								table_index,
+	f2_ostream *						ostream
+) {
+	f2_status_t	status;
+	uint8_t		value_bit_size;
+	size_t		symbol_count, nwritten;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp || nullptr == ostream )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( table_index >= thisp->table_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	symbol_count = _plan_symbol_count( thisp );
+
+	// Write table
+	value_bit_size = (uint8_t) thisp->value_bit_size;
+	status = ostream->write( ostream, &value_bit_size, sizeof(value_bit_size), &nwritten );
+	if( f2_failed( status ) )
+		return status;
+	return ostream->write( ostream, thisp->code_lengths + table_index * symbol_count, symbol_count, &nwritten );
+}
+
+/*END OF multitable.c*/
@@ -9,6 +9,7 @@
 typedef int	int_t;
 
 void bitcpy( void * dst, size_t dst_bit_offset, const void * src, unsigned src_bit_count );
+uint32_t bitload32( const void * src, size_t src_bit_offset, unsigned bit_count );
 #define libhuffman_bitcopy( dst, dst_bit_offset, src, src_bit_count )	bitcpy( dst, dst_bit_offset, src, src_bit_count )
 
 /*END OF pch.h*/
@@ -0,0 +1,173 @@
+/*run_table.c*/
+#include "pch.h"
+#include "main.h"
+
+/**
+ * @brief Get number of value symbols the descriptor represents.
+ * @internal
+ * @return (f2_bool_t) non-0 if the descriptor is a run; run_length receives the number of successive symbols
+ *		replaced with the code, 0 for a terminating code of an empty run.
+ *
+ *	A value longer than the symbol is accepted only if it repeats the same symbol, so "4 : 01" and "1 : 01010101"
+ * both give the same run of 4 symbols "01" when symbols are 2 bits long.
+ */
+static f2_bool_t _desc_run_length( const libhuffman_code_desc * desc, unsigned value_bit_size, libhuffman_code_t * symbol,
+	uint64_t * run_length )
+{
+	const libhuffman_code_t	mask = (libhuffman_code_t) ((1ULL << value_bit_size) - 1);
+	unsigned				value_length = 0 == desc->value.length ? value_bit_size : desc->value.length;
+	unsigned				shift;
+
+	// Skip events
+	if( (unsigned) -1 == desc->count || nullptr != desc->escape )
+		return 0;
+	if( 0 != value_length % value_bit_size )
+		return 0;
+
+	// Check that the value consists of the same symbol
+	*symbol = desc->value.bits & mask;
+	for( shift = value_bit_size; shift < value_length; shift += value_bit_size ) {
+		if( ((desc->value.bits >> shift) & mask) != *symbol )
+			return 0;
+	}
+
+	// Exit
+	*run_length = (uint64_t) desc->count * (value_length / value_bit_size);
+	return 1;
+}
+
+/**
+ * @brief Initialize run table from code descriptors.
+ * @param[in] thisp (libhuffman_run_table *) pointer to the uninitialized object.
+ * @param[in] context (libhuffman_context *) library context.
+ * @param[in] value_bit_size (unsigned) size of the source symbol, in bits: 1, 2, 4, 8 or 16.
+ * @param[in] desc_array (const libhuffman_code_desc *) code descriptors; count field gives the run length.
+ * @param[in] desc_count (size_t) number of descriptors.
+ * @return (f2_status_t) operation status code.
+ *
+ *	Descriptors that aren't runs of a single symbol (events, escapes, mixed values) are ignored. If a symbol has
+ * a code of the empty run, its codes of successive runs 0..N are terminating codes and every run ends with one;
+ * N is left out if it divides the next longer run, as the makeup code 64 of T.4.
+ */
+f2_status_t f2_callconv libhuffman_run_table_initialize(
+	libhuffman_run_table *			thisp,
+	libhuffman_context *			context,
+	unsigned						value_bit_size,
+	const libhuffman_code_desc *	desc_array,
+	size_t							desc_count
+) {
+	f2_status_t			status;
+	f2_allocator *		allocator;
+	libhuffman_run_code	run_code;
+	libhuffman_code_t	symbol;
+	uint64_t			run_length;
+	size_t				symbol_count, i, j;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp || nullptr == context )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == desc_array && 0 != desc_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 0 == value_bit_size || 16 < value_bit_size || value_bit_size != next_power_of_two( value_bit_size - 1 ) )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Initialize object
+	thisp->context = context;
+	thisp->value_bit_size = value_bit_size;
+	thisp->codes = nullptr;
+	thisp->first = nullptr;
+	thisp->code_count = 0;
+	allocator = context->allocator;
+	symbol_count = (size_t) 1 << value_bit_size;
+
+	// Count codes of each symbol
+	status = allocator->alloc( allocator, (void **) &thisp->first, (symbol_count + 1) * sizeof(*thisp->first), F2_AF_CLEAR_MEM );
+	if( f2_failed( status ) )
+		return status;
+	for( i = 0; i < desc_count; ++ i ) {
+		if( _desc_run_length( &desc_array[i], value_bit_size, &symbol, &run_length ) ) {
+			++ thisp->first[symbol + 1];
+			++ thisp->code_count;
+		}
+	}
+	for( i = 0; i < symbol_count; ++ i )
+		thisp->first[i + 1] += thisp->first[i];
+
+	// Store codes grouped by symbol
+	if( 0 != thisp->code_count ) {
+		status = allocator->alloc( allocator, (void **) &thisp->codes, thisp->code_count * sizeof(*thisp->codes), 0 );
+		if( f2_failed( status ) ) {
+			(void) libhuffman_run_table_deinitialize( thisp );
+			return status;
+		}
+	}
+	for( i = 0; i < desc_count; ++ i ) {
+		if( !_desc_run_length( &desc_array[i], value_bit_size, &symbol, &run_length ) )
+			continue;
+
+		// Place code; first[symbol] temporarily points past the last stored code of the symbol
+		run_code.count	= run_length;
+		run_code.code	= desc_array[i].code.bits;
+		run_code.length	= desc_array[i].code.length;
+		run_code.terminating = 0;
+		thisp->codes[thisp->first[symbol] ++] = run_code;
+	}
+
+	// Restore group starts
+	for( i = symbol_count; i > 0; -- i )
+		thisp->first[i] = thisp->first[i - 1];
+	thisp->first[0] = 0;
+
+	// Sort each group by descending run length so the longest fitting run is found first
+	for( symbol = 0; symbol < symbol_count; ++ symbol ) {
+		for( i = thisp->first[symbol] + 1; i < thisp->first[symbol + 1]; ++ i ) {
+			run_code = thisp->codes[i];
+			for( j = i; j > thisp->first[symbol] && thisp->codes[j - 1].count < run_code.count; -- j )
+				thisp->codes[j] = thisp->codes[j - 1];
+			thisp->codes[j] = run_code;
+		}
+
+		// Mark terminating codes: runs 0, 1, 2... up to the first gap, the shortest runs are the last ones
+		run_length = 0;
+		for( i = thisp->first[symbol + 1]; i > thisp->first[symbol] && thisp->codes[i - 1].count == run_length; -- i ) {
+			thisp->codes[i - 1].terminating = 1;
+			++ run_length;
+		}
+
+		// The longest run of the sequence is a makeup code if it divides the next run (64 and 128 in T.4)
+		if( 1 < run_length && i > thisp->first[symbol] && 0 == thisp->codes[i - 1].count % thisp->codes[i].count )
+			thisp->codes[i].terminating = 0;
+	}
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+f2_status_t f2_callconv libhuffman_run_table_deinitialize(
+	libhuffman_run_table *	thisp
+) {
+	f2_allocator *	allocator;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == thisp->context )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
+	allocator = thisp->context->allocator;
+
+	// Release memory
+	if( nullptr != thisp->codes )
+		(void) allocator->free( allocator, (void **) &thisp->codes, thisp->code_count * sizeof(*thisp->codes), 0 );
+	if( nullptr != thisp->first )
+		(void) allocator->free( allocator, (void **) &thisp->first,
+			(((size_t) 1 << thisp->value_bit_size) + 1) * sizeof(*thisp->first), 0 );
+
+	// Deinitialize object
+	thisp->code_count = 0;
+	thisp->context = nullptr;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/*END OF run_table.c*/
@@ -73,6 +73,170 @@ f2_status_t f2_callconv libhuffman_stream_set_block(
 	return F2_STATUS_SUCCESS;
 }
 
+f2_status_t f2_callconv libhuffman_stream_set_flags(
+	libhuffman_stream *	thisp,
+	unsigned			flags
+) {
+	// Check current state
+	debugbreak_if( nullptr == thisp )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set flags
+	thisp->flags = flags;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Lane-interleaved layout
+//
+//	Each block of the stream is a lane of the SIMD decoder. Lane bits are cut in 32-bit little-endian words, and the
+// word N of the lane L is stored at the word index N * block_count + L, so the decoder refills all lanes with a single
+// contiguous vector load. Lanes shorter than the longest one are padded with zero words. After interleaving, block
+// bit offsets point to the first bit of the lane (that is, L * 32), while bit lengths and code counts are preserved.
+
+static size_t _lane_word_count( const libhuffman_stream * stream )
+{
+	size_t		i;
+	uint64_t	bit_length = 0;
+
+	for( i = 0; i < stream->block_count; ++ i ) {
+		if( stream->blocks[i].bit_length > bit_length )
+			bit_length = stream->blocks[i].bit_length;
+	}
+	return (size_t) ((bit_length + LIBHUFFMAN_LANE_WORD_BITS - 1) / LIBHUFFMAN_LANE_WORD_BITS);
+}
+
+static void _store_le32( uint8_t * dst, uint32_t value )
+{
+	dst[0] = (uint8_t) (value);
+	dst[1] = (uint8_t) (value >> 8);
+	dst[2] = (uint8_t) (value >> 16);
+	dst[3] = (uint8_t) (value >> 24);
+}
+
+f2_status_t f2_callconv libhuffman_stream_get_interleaved_size(
+	const libhuffman_stream *	thisp,
+	size_t *					size
+) {
+	// Check current state
+	debugbreak_if( nullptr == size )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	*size = 0;
+	debugbreak_if( nullptr == thisp )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == thisp->blocks || 0 == thisp->block_count )
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
+
+	// Calculate size
+	*size = _lane_word_count( thisp ) * thisp->block_count * (LIBHUFFMAN_LANE_WORD_BITS / 8);
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Convert stream with contiguous blocks to the lane-interleaved layout.
+ * @param[in] thisp (libhuffman_stream *) stream which blocks are contiguous bit ranges of the stream data.
+ * @param[in] dst (void *) buffer receiving interleaved data.
+ * @param[in] dst_size (size_t) size of the buffer, see libhuffman_stream_get_interleaved_size.
+ * @return (f2_status_t) operation status code.
+ *
+ *	On success, the stream refers to the interleaved data in `dst'.
+ */
+f2_status_t f2_callconv libhuffman_stream_interleave(
+	libhuffman_stream *	thisp,
+	void *				dst,
+	size_t				dst_size
+) {
+	f2_status_t	status;
+	size_t		required_size, word_count, block_index, word_index;
+	uint8_t *	dst_word;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp || nullptr == dst )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 0 != (thisp->flags & LIBHUFFMAN_STREAM_F_INTERLEAVED) )
+		return F2_STATUS_ERROR_INVALID_STATE;
+
+	status = libhuffman_stream_get_interleaved_size( thisp, &required_size );
+	if( f2_failed( status ) )
+		return status;
+	debugbreak_if( dst_size < required_size )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Distribute lane words
+	word_count = _lane_word_count( thisp );
+	for( block_index = 0; block_index < thisp->block_count; ++ block_index ) {
+		libhuffman_block * block = &thisp->blocks[block_index];
+		size_t bit_offset = thisp->data_bit_offset + block->bit_offset;
+		uint64_t bits_left = block->bit_length;
+
+		dst_word = (uint8_t *) dst + block_index * (LIBHUFFMAN_LANE_WORD_BITS / 8);
+		for( word_index = 0; word_index < word_count; ++ word_index ) {
+			const unsigned bit_count = bits_left < LIBHUFFMAN_LANE_WORD_BITS ? (unsigned) bits_left : LIBHUFFMAN_LANE_WORD_BITS;
+
+			_store_le32( dst_word, 0 == bit_count ? 0 : bitload32( thisp->data, bit_offset, bit_count ) );
+			bit_offset += bit_count;
+			bits_left -= bit_count;
+			dst_word += thisp->block_count * (LIBHUFFMAN_LANE_WORD_BITS / 8);
+		}
+		block->bit_offset = block_index * LIBHUFFMAN_LANE_WORD_BITS;
+	}
+
+	// Refer to the new layout
+	thisp->data = dst;
+	thisp->data_bit_offset = 0;
+	thisp->data_bit_count = required_size * 8;
+	thisp->flags |= LIBHUFFMAN_STREAM_F_INTERLEAVED;
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Gather words of the lane of the interleaved stream in a contiguous bit sequence.
+ * @param[in] thisp (const libhuffman_stream *) interleaved stream.
+ * @param[in] block_index (size_t) lane index.
+ * @param[in] dst (void *) buffer receiving lane bits, starting with bit 0.
+ * @param[in] dst_size (size_t) size of the buffer; at least lane word count * 4 bytes are required.
+ * @return (f2_status_t) operation status code.
+ */
+f2_status_t f2_callconv libhuffman_stream_deinterleave_block(
+	const libhuffman_stream *	thisp,
+	size_t						block_index,
+	void *						dst,
+	size_t						dst_size
+) {
+	size_t			word_count, word_index;
+	const uint8_t *	src_word;
+	uint8_t *		dst_word = (uint8_t *) dst;
+
+	// Check current state
+	debugbreak_if( nullptr == thisp || nullptr == dst )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( 0 == (thisp->flags & LIBHUFFMAN_STREAM_F_INTERLEAVED) )
+		return F2_STATUS_ERROR_INVALID_STATE;
+	debugbreak_if( block_index >= thisp->block_count )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	word_count = _lane_word_count( thisp );
+	debugbreak_if( dst_size < word_count * (LIBHUFFMAN_LANE_WORD_BITS / 8) )
+		return F2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Gather lane words
+	src_word = (const uint8_t *) thisp->data + thisp->blocks[block_index].bit_offset / 8;
+	for( word_index = 0; word_index < word_count; ++ word_index ) {
+		f2_small_memcpy( dst_word, src_word, LIBHUFFMAN_LANE_WORD_BITS / 8 );
+		dst_word += LIBHUFFMAN_LANE_WORD_BITS / 8;
+		src_word += thisp->block_count * (LIBHUFFMAN_LANE_WORD_BITS / 8);
+	}
+
+	// Exit
+	return F2_STATUS_SUCCESS;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 static btl_result_t BTL_CALLBACK bit_decode_callback(
@@ -87,6 +251,61 @@ static btl_result_t BTL_CALLBACK bit_decode_callback(
 	return BTL_SUCCESS;
 }
 
+/**
+ * @brief Decode interleaved stream lane by lane.
+ * @internal
+ *
+ *	This is the reference path for decoders that don't process lanes simultaneously: each lane is gathered
+ * in a contiguous buffer and decoded in the block order, so the output is the same as for the contiguous layout.
+ */
+static f2_status_t _decode_interleaved(
+	libhuffman_stream *			stream,
+	libhuffman_decoder_table *	table
+) {
+	f2_status_t		status;
+	btl_result_t	result;
+	f2_allocator *	allocator = stream->binary->context->allocator;
+	void *			lane_data = nullptr;
+	size_t			lane_size, block_index;
+	unsigned		root_index = 0;		// blocks split the code sequence, the next block continues with the same root
+
+	// Allocate lane buffer
+	lane_size = _lane_word_count( stream ) * (LIBHUFFMAN_LANE_WORD_BITS / 8);
+	if( 0 == lane_size )
+		return F2_STATUS_SUCCESS;
+	status = allocator->alloc( allocator, &lane_data, lane_size, 0 );
+	if( f2_failed( status ) )
+		return status;
+
+	// Decode all lanes
+	for( block_index = 0; block_index < stream->block_count; ++ block_index ) {
+		if( 0 == stream->blocks[block_index].bit_length )
+			continue;
+
+		status = libhuffman_stream_deinterleave_block( stream, block_index, lane_data, lane_size );
+		if( f2_failed( status ) )
+			break;
+
+		result = btl_decode(
+			&table->bit_context,
+			&root_index,
+			bit_decode_callback,
+			stream,
+			lane_data,
+			0,
+			(size_t) stream->blocks[block_index].bit_length
+		);
+		if( result < 0 ) {
+			status = F2_STATUS_ERROR_INVALID_DATA;
+			break;
+		}
+	}
+
+	// Exit
+	(void) allocator->free( allocator, &lane_data, lane_size, 0 );
+	return status;
+}
+
 f2_status_t	f2_callconv libhuffman_stream_decode(
 	libhuffman_stream *	stream,
 	f2_ostream *		outp
@@ -108,10 +327,16 @@ f2_status_t	f2_callconv libhuffman_stream_decode(
 	binary = stream->binary;
 	debugbreak_if( nullptr == binary )
 		return F2_STATUS_ERROR_INVALID_PARAMETER;
+	debugbreak_if( nullptr == stream->data )	// encoded streams describe data written to the output stream
+		return F2_STATUS_ERROR_NOT_INITIALIZED;
 
 	// Perform decode
+	if( 0 != (stream->flags & LIBHUFFMAN_STREAM_F_INTERLEAVED) )
+		return _decode_interleaved( stream, table );
+
 	result = btl_decode(
 		&table->bit_context,
+		nullptr,
 		bit_decode_callback,
 		stream,
 		stream->data,
@@ -0,0 +1,223 @@
+/*bitt.c*/
+/** @file
+ * @brief libbitt kernels: bitfield iterator, table build and btl_decode.
+ *
+ *	btl_decode consumes the full width of every table it visits, so decode tables hold all codes of one length that
+ * is a multiple of the root width. The code length and the root width set the number of lookups per symbol, which
+ * is what layout changes of btl_table trade against memory.
+ */
+#include "mbench.h"
+#include "../../../libs/libbitt/src/internal.h"
+
+static const unsigned _fetch_widths[] = { 1, 4, 8, 12, 16, 24, 32 };
+
+//! Decode table shapes: code length and root width
+static const struct {
+	unsigned	code_length;
+	unsigned	root_width;
+} _shapes[] = {
+	{ 8, 1 }, { 8, 2 }, { 8, 4 }, { 8, 8 }, { 16, 4 }, { 16, 8 }, { 16, 16 },
+};
+
+typedef struct _bitt_kernel {
+	const mbench_corpus *	corpus;
+	btl_context				context;
+	unsigned				code_length;
+	unsigned				width;			//< fetch or root table width
+	size_t					bit_count;		//< number of corpus bits processed
+	uint64_t				sum;			//< sum of fetched or decoded values
+} _bitt_kernel;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Append all codes of code_length bits, the data entry of each code holds the code value.
+ * @internal
+ */
+static btl_result_t _append_codes( btl_context * context, unsigned code_length, unsigned root_width )
+{
+	btl_result_t	result;
+	btl_entry_ref	ref;
+	uint64_t		value;
+
+	result = btl_table_set_size( &context->root_table, root_width );
+	for( value = 0; value < ((uint64_t) 1 << code_length) && BTL_SUCCESS == result; ++ value ) {
+		result = btl_append_imm_entry( context, value, code_length, &ref );
+		if( BTL_SUCCESS == result )
+			ref.table->entry_data[ref.index].entry_int_param = (size_t) value;
+	}
+	return result;
+}
+
+static int _run_fetch( void * param )
+{
+	_bitt_kernel *			kernel = (_bitt_kernel *) param;
+	btl_bitfield_iterator	iterator;
+	uint32_t				value;
+	uint64_t				sum = 0;
+
+	if( BTL_SUCCESS != btl_bitfield_iterator_initialize( &iterator, kernel->corpus->data, 0, kernel->bit_count ) )
+		return -1;
+	while( !btl_bitfield_iterator_finished( &iterator ) ) {
+		if( BTL_SUCCESS != btl_bitfield_iterator_fetch( &iterator, &value, kernel->width, NULL ) )
+			return -1;
+		sum += value;
+	}
+	kernel->sum = sum;
+	return 0;
+}
+
+static int _setup_build( void * param )
+{
+	return BTL_SUCCESS == btl_context_initialize( &((_bitt_kernel *) param)->context ) ? 0 : -1;
+}
+static int _run_build( void * param )
+{
+	_bitt_kernel *	kernel = (_bitt_kernel *) param;
+
+	return BTL_SUCCESS == _append_codes( &kernel->context, kernel->code_length, kernel->width ) ? 0 : -1;
+}
+static void _teardown_build( void * param )
+{
+	(void) btl_context_deinitialize( &((_bitt_kernel *) param)->context );
+}
+
+static btl_result_t BTL_CALLBACK _decode_callback( void * param, const void * entry_ptr_param, size_t entry_int_param )
+{
+	*(uint64_t *) param += entry_int_param;
+	(void) entry_ptr_param;
+	return BTL_SUCCESS;
+}
+static int _run_decode( void * param )
+{
+	_bitt_kernel *	kernel = (_bitt_kernel *) param;
+
+	kernel->sum = 0;
+	return BTL_SUCCESS == btl_decode( &kernel->context, NULL, _decode_callback, &kernel->sum, kernel->corpus->data, 0, kernel->bit_count ) ? 0 : -1;
+}
+
+/**
+ * @brief Get sum of all little-endian fields of field_size bits, the reference result of fetch and decode kernels.
+ * @internal
+ */
+static uint64_t _sum_fields( const uint8_t * data, size_t bit_count, unsigned field_size )
+{
+	uint64_t	sum = 0, value;
+	size_t		offset, i;
+
+	for( offset = 0; offset < bit_count; offset += field_size ) {
+		for( value = 0, i = 0; i < field_size && offset + i < bit_count; ++ i )
+			value |= (uint64_t) ((data[(offset + i) / 8] >> ((offset + i) % 8)) & 1) << i;
+		sum += value;
+	}
+	return sum;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Run libbitt kernels.
+ * @param[in] options (const mbench_options *) command line options.
+ * @param[in] corpora (const mbench_corpus *) MBENCH_CORPUS_COUNT corpora.
+ * @return (int) 0 on success, -1 on failure.
+ *
+ *	Fetch and decode results are checked against a bit-by-bit reference before timing.
+ */
+int mbench_run_bitt( const mbench_options * options, const mbench_corpus * corpora )
+{
+	_bitt_kernel	kernel;
+	mbench_kernel	desc;
+	char			name[MBENCH_MAX_NAME_LENGTH + 1];
+	size_t			i, c;
+	int				result = 0;
+
+	// Bitfield iterator over uniform data
+	for( i = 0; i < sizeof(_fetch_widths) / sizeof(*_fetch_widths) && 0 == result; ++ i ) {
+		snprintf( name, sizeof(name), "fetch/w%u", _fetch_widths[i] );
+		if( !mbench_selected( options, name ) )
+			continue;
+		memset( &kernel, 0, sizeof(kernel) );
+		kernel.corpus = &corpora[MBENCH_CORPUS_UNIFORM];
+		kernel.width = _fetch_widths[i];
+		kernel.bit_count = kernel.corpus->size * 8 / kernel.width * kernel.width;
+		result = _run_fetch( &kernel );
+		if( 0 == result && kernel.sum != _sum_fields( kernel.corpus->data, kernel.bit_count, kernel.width ) ) {
+			fprintf( stderr, "%s: error: btl_bitfield_iterator_fetch returned wrong fields\n", name );
+			result = -1;
+		}
+		desc.name = name;
+		desc.op_count = kernel.bit_count / kernel.width;
+		desc.byte_count = kernel.bit_count / 8;
+		desc.setup = NULL;
+		desc.run = _run_fetch;
+		desc.teardown = NULL;
+		desc.param = &kernel;
+		if( 0 == result )
+			result = mbench_measure( options, &desc );
+	}
+
+	// Table build
+	for( i = 0; i < sizeof(_shapes) / sizeof(*_shapes) && 0 == result; ++ i ) {
+		snprintf( name, sizeof(name), "btl_append/L%u/w%u", _shapes[i].code_length, _shapes[i].root_width );
+		memset( &kernel, 0, sizeof(kernel) );
+		kernel.code_length = _shapes[i].code_length;
+		kernel.width = _shapes[i].root_width;
+		desc.name = name;
+		desc.op_count = (size_t) 1 << kernel.code_length;
+		desc.byte_count = 0;
+		desc.setup = _setup_build;
+		desc.run = _run_build;
+		desc.teardown = _teardown_build;
+		desc.param = &kernel;
+		result = mbench_measure( options, &desc );
+	}
+
+	// Decode of every corpus with every table shape
+	for( i = 0; i < sizeof(_shapes) / sizeof(*_shapes) && 0 == result; ++ i ) {
+		for( c = 0; c < MBENCH_CORPUS_COUNT; ++ c ) {
+			snprintf( name, sizeof(name), "btl_decode/L%u/w%u/%s", _shapes[i].code_length, _shapes[i].root_width,
+				mbench_corpus_name( (mbench_corpus_kind) c ) );
+			if( mbench_selected( options, name ) )
+				break;
+		}
+		if( MBENCH_CORPUS_COUNT == c )	// don't build tables which aren't measured
+			continue;
+		memset( &kernel, 0, sizeof(kernel) );
+		kernel.code_length = _shapes[i].code_length;
+		kernel.width = _shapes[i].root_width;
+		if( BTL_SUCCESS != btl_context_initialize( &kernel.context )
+			|| BTL_SUCCESS != _append_codes( &kernel.context, kernel.code_length, kernel.width ) ) {
+			fprintf( stderr, "btl_decode/L%u/w%u: error: can't build table\n", kernel.code_length, kernel.width );
+			(void) btl_context_deinitialize( &kernel.context );
+			return -1;
+		}
+		for( c = 0; c < MBENCH_CORPUS_COUNT && 0 == result; ++ c ) {
+			snprintf( name, sizeof(name), "btl_decode/L%u/w%u/%s", kernel.code_length, kernel.width,
+				mbench_corpus_name( (mbench_corpus_kind) c ) );
+			if( !mbench_selected( options, name ) )
+				continue;
+			kernel.corpus = &corpora[c];
+			kernel.bit_count = kernel.corpus->size * 8 / kernel.code_length * kernel.code_length;
+			result = _run_decode( &kernel );
+			if( 0 == result && kernel.sum != _sum_fields( kernel.corpus->data, kernel.bit_count, kernel.code_length ) ) {
+				fprintf( stderr, "%s: error: btl_decode returned wrong symbols\n", name );
+				result = -1;
+			}
+			desc.name = name;
+			desc.op_count = kernel.bit_count / kernel.code_length;
+			desc.byte_count = kernel.bit_count / 8;
+			desc.setup = NULL;
+			desc.run = _run_decode;
+			desc.teardown = NULL;
+			desc.param = &kernel;
+			if( 0 == result )
+				result = mbench_measure( options, &desc );
+		}
+		(void) btl_context_deinitialize( &kernel.context );
+	}
+
+	// Exit
+	return result;
+}
+
+/*END OF bitt.c*/
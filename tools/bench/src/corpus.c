@@ -0,0 +1,169 @@
+/*corpus.c*/
+/** @file
+ * @brief Deterministic synthetic corpora.
+ *
+ *	Generators depend on the seed only, so the same corpus is measured by every build and on every machine.
+ */
+#include <math.h>
+#include "mbench.h"
+
+#define MBENCH_SYMBOL_COUNT			256		//< number of byte values
+#define MBENCH_RUNS_ROW_WIDTH		1728	//< width of the bitmap row in pixels (T.4 A4 row)
+#define MBENCH_RUNS_WHITE_MEAN		48.0	//< mean length of white runs, in pixels
+#define MBENCH_RUNS_BLACK_MEAN		6.0		//< mean length of black runs, in pixels
+
+static const char * const _corpus_names[MBENCH_CORPUS_COUNT] = {
+	"uniform", "geometric", "zipf", "runs"
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Random numbers
+
+void mbench_random_seed( mbench_random * thisp, uint64_t seed )
+{
+	thisp->state = 0 == seed ? 0x9E3779B97F4A7C15ULL : seed;	// xorshift state must not be 0
+}
+uint64_t mbench_random_next( mbench_random * thisp )
+{
+	thisp->state ^= thisp->state >> 12;
+	thisp->state ^= thisp->state << 25;
+	thisp->state ^= thisp->state >> 27;
+	return thisp->state * 0x2545F4914F6CDD1DULL;
+}
+/**
+ * @brief Get random number uniformly distributed in [0, 1).
+ */
+double mbench_random_real( mbench_random * thisp )
+{
+	return (double) (mbench_random_next( thisp ) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Generators
+
+static void _generate_uniform( uint8_t * data, size_t size, mbench_random * random )
+{
+	size_t i;
+
+	for( i = 0; i < size; ++ i )
+		data[i] = (uint8_t) (mbench_random_next( random ) >> 56);
+}
+static void _generate_geometric( uint8_t * data, size_t size, mbench_random * random )
+{
+	uint64_t	value;
+	size_t		i;
+	uint8_t		n;
+
+	// Number of trailing zeros of a random word has the geometric distribution
+	for( i = 0; i < size; ++ i ) {
+		value = mbench_random_next( random );
+		for( n = 0; n < 63 && 0 == (value & 1); ++ n )
+			value >>= 1;
+		data[i] = n;
+	}
+}
+static void _generate_zipf( uint8_t * data, size_t size, mbench_random * random )
+{
+	double	cdf[MBENCH_SYMBOL_COUNT];
+	double	sum, u;
+	size_t	i, lo, hi, mid;
+
+	for( sum = 0, i = 0; i < MBENCH_SYMBOL_COUNT; ++ i )
+		cdf[i] = sum += 1.0 / (double) (i + 1);
+	for( i = 0; i < MBENCH_SYMBOL_COUNT; ++ i )
+		cdf[i] /= sum;
+
+	// Inverse of the distribution function: first symbol which cdf exceeds u
+	for( i = 0; i < size; ++ i ) {
+		u = mbench_random_real( random );
+		for( lo = 0, hi = MBENCH_SYMBOL_COUNT - 1; lo < hi; ) {
+			mid = (lo + hi) / 2;
+			if( cdf[mid] > u )
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		data[i] = (uint8_t) lo;
+	}
+}
+/**
+ * @brief Generate bitmap rows of runs with exponentially distributed lengths.
+ * @internal
+ *
+ *	Pixels are packed most significant bit first, 1 is black. Every row starts with a white run, as T.4 requires,
+ * and runs are cut at the row end.
+ */
+static void _generate_runs( uint8_t * data, size_t size, mbench_random * random )
+{
+	const size_t	row_size = MBENCH_RUNS_ROW_WIDTH / 8;
+	size_t			row, x, run, i;
+	int				black;
+
+	memset( data, 0, size );
+	for( row = 0; row < size; row += row_size ) {
+		for( black = 0, x = 0; x < MBENCH_RUNS_ROW_WIDTH && row + x / 8 < size; black = !black, x += run ) {
+			run = 1 + (size_t) (-log( 1.0 - mbench_random_real( random ) ) * (black ? MBENCH_RUNS_BLACK_MEAN : MBENCH_RUNS_WHITE_MEAN));
+			if( run > MBENCH_RUNS_ROW_WIDTH - x )
+				run = MBENCH_RUNS_ROW_WIDTH - x;
+			if( !black )
+				continue;
+			for( i = x; i < x + run && row + i / 8 < size; ++ i )
+				data[row + i / 8] |= (uint8_t) (0x80 >> (i % 8));
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char * mbench_corpus_name( mbench_corpus_kind kind )
+{
+	return (unsigned) kind < MBENCH_CORPUS_COUNT ? _corpus_names[kind] : "?";
+}
+
+/**
+ * @brief Generate corpus.
+ * @param[out] thisp (mbench_corpus *) corpus object.
+ * @param[in] kind (mbench_corpus_kind) kind of data.
+ * @param[in] size (size_t) corpus size, in bytes.
+ * @param[in] seed (uint64_t) random generator seed; each kind mixes it with its own constant.
+ * @return (int) 0 on success, -1 on failure.
+ */
+int mbench_corpus_generate( mbench_corpus * thisp, mbench_corpus_kind kind, size_t size, uint64_t seed )
+{
+	mbench_random	random;
+
+	// Check current state
+	if( NULL == thisp || (unsigned) kind >= MBENCH_CORPUS_COUNT || 0 == size )
+		return -1;
+
+	// Allocate memory
+	thisp->kind = kind;
+	thisp->size = size;
+	thisp->data = (uint8_t *) malloc( size );
+	if( NULL == thisp->data )
+		return -1;
+
+	// Generate data
+	mbench_random_seed( &random, seed ^ ((uint64_t) (kind + 1) * 0x9E3779B97F4A7C15ULL) );
+	switch( kind ) {
+	case MBENCH_CORPUS_UNIFORM:		_generate_uniform( thisp->data, size, &random ); break;
+	case MBENCH_CORPUS_GEOMETRIC:	_generate_geometric( thisp->data, size, &random ); break;
+	case MBENCH_CORPUS_ZIPF:		_generate_zipf( thisp->data, size, &random ); break;
+	case MBENCH_CORPUS_RUNS:		_generate_runs( thisp->data, size, &random ); break;
+	default:						break;
+	}
+
+	// Exit
+	return 0;
+}
+
+void mbench_corpus_release( mbench_corpus * thisp )
+{
+	if( NULL == thisp )
+		return;
+	free( thisp->data );
+	thisp->data = NULL;
+	thisp->size = 0;
+}
+
+/*END OF corpus.c*/
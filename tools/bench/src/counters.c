@@ -0,0 +1,153 @@
+/*counters.c*/
+/** @file
+ * @brief Hardware performance counters around kernel runs (Linux perf_event_open).
+ *
+ *	Every counter is opened as a separate event, so a counter the CPU or the virtual machine doesn't provide (L1d
+ * misses are often missing under hypervisors) doesn't take the others with it. Counters count user mode only, the
+ * kernel part of page faults and interrupts isn't attributed to kernels.
+ */
+#include "mbench.h"
+
+#if defined( __linux__ )
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif // defined( __linux__ )
+
+static const char * _counter_names[MBENCH_COUNTER_COUNT] = {
+	"cyc/op",
+	"ins/op",
+	"L1dm/op",
+	"brm/op",
+};
+
+const char * mbench_counter_name( mbench_counter_kind kind )
+{
+	return (unsigned) kind < MBENCH_COUNTER_COUNT ? _counter_names[kind] : "";
+}
+
+#if defined( __linux__ )
+
+static int _open_event( mbench_counter_kind kind )
+{
+	struct perf_event_attr	attr;
+
+	memset( &attr, 0, sizeof(attr) );
+	attr.size = sizeof(attr);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	switch( kind ) {
+	case MBENCH_COUNTER_CYCLES:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case MBENCH_COUNTER_INSTRUCTIONS:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case MBENCH_COUNTER_L1D_MISSES:
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	case MBENCH_COUNTER_BRANCH_MISSES:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	default:
+		return -1;
+	}
+	return (int) syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+#endif // defined( __linux__ )
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Open hardware counters of the calling thread.
+ * @param[out] thisp (mbench_counters *) counters.
+ * @return (int) number of available counters, 0 if counters aren't allowed (perf_event_paranoid, seccomp of
+ * containers) or the platform doesn't have them.
+ */
+int mbench_counters_open( mbench_counters * thisp )
+{
+	int	available = 0;
+	int	k;
+
+	for( k = 0; k < MBENCH_COUNTER_COUNT; ++ k ) {
+#if defined( __linux__ )
+		thisp->fds[k] = _open_event( (mbench_counter_kind) k );
+#else
+		thisp->fds[k] = -1;
+#endif // defined( __linux__ )
+		if( 0 <= thisp->fds[k] )
+			++ available;
+	}
+	return available;
+}
+
+void mbench_counters_close( mbench_counters * thisp )
+{
+	int	k;
+
+	for( k = 0; k < MBENCH_COUNTER_COUNT; ++ k ) {
+#if defined( __linux__ )
+		if( 0 <= thisp->fds[k] )
+			(void) close( thisp->fds[k] );
+#endif // defined( __linux__ )
+		thisp->fds[k] = -1;
+	}
+}
+
+/**
+ * @brief Reset and enable counters.
+ */
+void mbench_counters_start( mbench_counters * thisp )
+{
+	int	k;
+
+	for( k = 0; k < MBENCH_COUNTER_COUNT; ++ k ) {
+#if defined( __linux__ )
+		if( 0 <= thisp->fds[k] ) {
+			(void) ioctl( thisp->fds[k], PERF_EVENT_IOC_RESET, 0 );
+			(void) ioctl( thisp->fds[k], PERF_EVENT_IOC_ENABLE, 0 );
+		}
+#endif // defined( __linux__ )
+	}
+}
+
+/**
+ * @brief Disable counters and read their values.
+ * @param[in] thisp (mbench_counters *) counters.
+ * @param[out] values (uint64_t *) MBENCH_COUNTER_COUNT values; MBENCH_COUNTER_NONE if the counter isn't available
+ * or hasn't been scheduled on the PMU.
+ *
+ *	When there are more events than PMU registers the kernel multiplexes them, values are scaled by the time the
+ * counter has actually run.
+ */
+void mbench_counters_stop( mbench_counters * thisp, uint64_t * values )
+{
+	int	k;
+#if defined( __linux__ )
+	uint64_t	data[3];	// value, time enabled, time running
+
+	for( k = 0; k < MBENCH_COUNTER_COUNT; ++ k ) {
+		if( 0 <= thisp->fds[k] )
+			(void) ioctl( thisp->fds[k], PERF_EVENT_IOC_DISABLE, 0 );
+	}
+#endif // defined( __linux__ )
+
+	for( k = 0; k < MBENCH_COUNTER_COUNT; ++ k ) {
+		values[k] = MBENCH_COUNTER_NONE;
+#if defined( __linux__ )
+		if( 0 > thisp->fds[k] || (ssize_t) sizeof(data) != read( thisp->fds[k], data, sizeof(data) ) || 0 == data[2] )
+			continue;
+		values[k] = data[2] < data[1] ? (uint64_t) ((double) data[0] * (double) data[1] / (double) data[2]) : data[0];
+#endif // defined( __linux__ )
+	}
+}
+
+/*END OF counters.c*/
@@ -0,0 +1,228 @@
+/*huffman.c*/
+/** @file
+ * @brief libhuffman kernels: libhuffman_encode with the optimal table of each corpus and bitcpy.
+ *
+ *	Built with MBENCH_LIBHUFFMAN only, since libhuffman needs libf2.
+ */
+#include "mbench.h"
+
+#if defined( MBENCH_LIBHUFFMAN )
+
+#include <libhuffman.h>
+
+void bitcpy( void * dst, size_t dst_bit_offset, const void * src, unsigned src_bit_count );
+
+#define MBENCH_SYMBOL_COUNT			256		//< number of byte values
+#define MBENCH_MAX_CODE_LENGTH		15		//< length limit of derived tables
+#define MBENCH_BITCPY_COUNT			65536	//< number of bit sequences copied by the bitcpy kernel
+
+typedef struct _encode_kernel {
+	libhuffman_context *		context;
+	libhuffman_encoder_table *	table;
+	const mbench_corpus *		corpus;
+	uint8_t *					output;			//< encoded data, large enough for any corpus encoding
+	size_t						output_size;
+	size_t						output_capacity;
+} _encode_kernel;
+
+typedef struct _bitcpy_kernel {
+	const uint8_t *	src;
+	uint8_t *		dst;
+	const uint8_t *	lengths;			//< lengths of copied sequences, 1..32 bits
+	size_t			count;
+} _bitcpy_kernel;
+
+//! Output stream writing to the preallocated buffer of the encode kernel
+typedef struct _output_ostream {
+	libf2_ostream		ostream;
+	_encode_kernel *	kernel;
+} _output_ostream;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static libf2_status_t libf2_callconv _output_ostream_write( libf2_ostream * ostream, const void * data, size_t size, size_t * nwritten )
+{
+	_encode_kernel * kernel = ((_output_ostream *) ostream)->kernel;
+
+	*nwritten = 0;
+	if( size > kernel->output_capacity - kernel->output_size )
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	memcpy( kernel->output + kernel->output_size, data, size );
+	kernel->output_size += size;
+	*nwritten = size;
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Build encoder table with length-limited canonical codes of the corpus histogram.
+ * @internal
+ */
+static libf2_status_t _build_encoder_table( libhuffman_context * context, libhuffman_encoder_table * table, const mbench_corpus * corpus )
+{
+	libf2_status_t			status;
+	libhuffman_code_desc	desc_array[MBENCH_SYMBOL_COUNT];
+	uint64_t				histogram[MBENCH_SYMBOL_COUNT];
+	uint8_t					lengths[MBENCH_SYMBOL_COUNT];
+	libhuffman_code_t		codes[MBENCH_SYMBOL_COUNT];
+	size_t					i, n;
+
+	memset( histogram, 0, sizeof(histogram) );
+	for( i = 0; i < corpus->size; ++ i )
+		++ histogram[corpus->data[i]];
+	status = libhuffman_build_code_lengths( context->allocator, histogram, MBENCH_SYMBOL_COUNT, MBENCH_MAX_CODE_LENGTH, lengths );
+	if( libf2_succeeded( status ) )
+		status = libhuffman_build_canonical_codes( lengths, MBENCH_SYMBOL_COUNT, codes );
+	if( libf2_failed( status ) )
+		return status;
+
+	memset( desc_array, 0, sizeof(desc_array) );
+	for( n = 0, i = 0; i < MBENCH_SYMBOL_COUNT; ++ i ) {
+		if( 0 == lengths[i] )
+			continue;
+		desc_array[n].code.bits		= codes[i];
+		desc_array[n].code.length	= lengths[i];
+		desc_array[n].value.bits	= (libhuffman_code_t) i;
+		desc_array[n].value.length	= 8;
+		desc_array[n].count			= 1;
+		++ n;
+	}
+	status = libhuffman_initialize_encoder_table( table, context, 0 );
+	__debugbreak_ifnot( libf2_succeeded( status ) ) {
+		status = libhuffman_encoder_table_append_codes( table, desc_array, n );
+		if( libf2_failed( status ) )
+			(void) libhuffman_deinitialize_encoder_table( table );
+	}
+	return status;
+}
+
+static int _run_encode( void * param )
+{
+	_encode_kernel *			kernel = (_encode_kernel *) param;
+	libf2_status_t				status;
+	libf2_static_memory_istream	istream;
+	_output_ostream				ostream;
+	libhuffman_encode_context	encode_context;
+
+	memset( &ostream, 0, sizeof(ostream) );
+	ostream.ostream.write = _output_ostream_write;
+	ostream.kernel = kernel;
+	kernel->output_size = 0;
+
+	status = libf2_static_buffer_istream_initialize( &istream, kernel->corpus->data, kernel->corpus->size );
+	__debugbreak_ifnot( libf2_succeeded( status ) ) {
+		status = libhuffman_initialize_encode_context( &encode_context, kernel->context, kernel->table, &istream.istream, &ostream.ostream );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			encode_context.value_bit_size = 8;
+			status = libhuffman_encode( &encode_context );
+			(void) libhuffman_deinitialize_encode_context( &encode_context );
+		}
+		(void) libf2_static_buffer_istream_deinitialize( &istream );
+	}
+	return libf2_succeeded( status ) ? 0 : -1;
+}
+
+static int _run_bitcpy( void * param )
+{
+	_bitcpy_kernel *	kernel = (_bitcpy_kernel *) param;
+	size_t				i, src_offset, dst_offset;
+
+	for( src_offset = 0, dst_offset = 0, i = 0; i < kernel->count; ++ i ) {
+		bitcpy( kernel->dst, dst_offset, kernel->src + src_offset, kernel->lengths[i] );
+		src_offset += 4;
+		dst_offset += kernel->lengths[i];
+	}
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Run libhuffman kernels.
+ * @param[in] options (const mbench_options *) command line options.
+ * @param[in] corpora (const mbench_corpus *) MBENCH_CORPUS_COUNT corpora.
+ * @return (int) 0 on success, -1 on failure.
+ *
+ *	Each corpus is encoded with its own optimal table, so the encoder runs with the code length distribution the
+ * corpus would really have. bitcpy copies sequences of random length to consecutive unaligned destinations, as the
+ * encoder stores codes.
+ */
+int mbench_run_huffman( const mbench_options * options, const mbench_corpus * corpora )
+{
+	libhuffman_context			context;
+	libhuffman_encoder_table	table;
+	_encode_kernel				encode;
+	_bitcpy_kernel				copy;
+	mbench_kernel				desc;
+	mbench_random				random;
+	uint8_t *					lengths;
+	char						name[MBENCH_MAX_NAME_LENGTH + 1];
+	size_t						c, i, bit_count;
+	int							result = 0;
+
+	libhuffman_initialize_context( &context, nullptr );
+
+	// libhuffman_encode of every corpus
+	for( c = 0; c < MBENCH_CORPUS_COUNT && 0 == result; ++ c ) {
+		snprintf( name, sizeof(name), "libhuffman_encode/%s", mbench_corpus_name( (mbench_corpus_kind) c ) );
+		if( !mbench_selected( options, name ) )
+			continue;
+		if( libf2_failed( _build_encoder_table( &context, &table, &corpora[c] ) ) ) {
+			fprintf( stderr, "%s: error: can't build encoder table\n", name );
+			return -1;
+		}
+		memset( &encode, 0, sizeof(encode) );
+		encode.context = &context;
+		encode.table = &table;
+		encode.corpus = &corpora[c];
+		encode.output_capacity = corpora[c].size * MBENCH_MAX_CODE_LENGTH / 8 + 64;
+		encode.output = (uint8_t *) malloc( encode.output_capacity );
+		if( nullptr == encode.output )
+			result = -1;
+		else {
+			desc.name = name;
+			desc.op_count = corpora[c].size;
+			desc.byte_count = corpora[c].size;
+			desc.setup = NULL;
+			desc.run = _run_encode;
+			desc.teardown = NULL;
+			desc.param = &encode;
+			result = mbench_measure( options, &desc );
+			free( encode.output );
+		}
+		(void) libhuffman_deinitialize_encoder_table( &table );
+	}
+
+	// bitcpy of random length sequences from uniform data
+	snprintf( name, sizeof(name), "bitcpy/1-32" );
+	if( 0 == result && mbench_selected( options, name ) ) {
+		copy.count = corpora[MBENCH_CORPUS_UNIFORM].size / 4 < MBENCH_BITCPY_COUNT ? corpora[MBENCH_CORPUS_UNIFORM].size / 4 : MBENCH_BITCPY_COUNT;
+		lengths = (uint8_t *) malloc( copy.count + 1 );
+		copy.dst = (uint8_t *) calloc( copy.count + 1, 4 );
+		if( nullptr == lengths || nullptr == copy.dst )
+			result = -1;
+		else {
+			mbench_random_seed( &random, options->seed );
+			for( bit_count = 0, i = 0; i < copy.count; ++ i )
+				bit_count += lengths[i] = (uint8_t) (1 + mbench_random_next( &random ) % 32);
+			copy.src = corpora[MBENCH_CORPUS_UNIFORM].data;
+			copy.lengths = lengths;
+			desc.name = name;
+			desc.op_count = copy.count;
+			desc.byte_count = bit_count / 8;
+			desc.setup = NULL;
+			desc.run = _run_bitcpy;
+			desc.teardown = NULL;
+			desc.param = &copy;
+			result = mbench_measure( options, &desc );
+		}
+		free( lengths );
+		free( copy.dst );
+	}
+
+	// Exit
+	return result;
+}
+
+#endif // defined( MBENCH_LIBHUFFMAN )
+
+/*END OF huffman.c*/
@@ -0,0 +1,124 @@
+/*main.c*/
+/** @file
+ * @brief Micro-benchmark suite entry point.
+ */
+#include "mbench.h"
+
+static mbench_counters	_counters;
+
+static void _usage( void )
+{
+	printf(
+		"MBENCH [{switch}]\n"
+		"\n"
+		"Switches:\n"
+		"-?	--help			: display command line help.\n"
+		"	--counters		: report hardware counters per operation (Linux perf_event_open).\n"
+		"	--filter TEXT	: run only kernels which names contain TEXT.\n"
+		"	--samples N		: time each kernel N times (default %u).\n"
+		"	--seed N		: seed of corpus generators (default %u).\n"
+		"	--size N		: size of each corpus, in bytes (default %u).\n",
+		(unsigned) MBENCH_DEFAULT_SAMPLE_COUNT, (unsigned) MBENCH_DEFAULT_SEED, (unsigned) MBENCH_DEFAULT_CORPUS_SIZE );
+}
+
+/**
+ * @brief Parse command line.
+ * @internal
+ * @return (int) 0 on success, 1 if help was requested, -1 on invalid command line.
+ */
+static int _parse_command_line( mbench_options * options, int argc, char ** argv )
+{
+	unsigned long long	value;
+	char *				end;
+	int					i;
+
+	options->corpus_size = MBENCH_DEFAULT_CORPUS_SIZE;
+	options->sample_count = MBENCH_DEFAULT_SAMPLE_COUNT;
+	options->seed = MBENCH_DEFAULT_SEED;
+	options->filter = NULL;
+	options->counters = NULL;
+
+	for( i = 1; i < argc; ++ i ) {
+		if( 0 == strcmp( argv[i], "-?" ) || 0 == strcmp( argv[i], "--help" ) )
+			return 1;
+		if( 0 == strcmp( argv[i], "--counters" ) ) {
+			options->counters = &_counters;
+			continue;
+		}
+		if( i + 1 >= argc ) {
+			fprintf( stderr, "error: %s: unknown switch or missing argument\n", argv[i] );
+			return -1;
+		}
+		if( 0 == strcmp( argv[i], "--filter" ) ) {
+			options->filter = argv[++ i];
+			continue;
+		}
+		value = strtoull( argv[i + 1], &end, 0 );
+		if( end == argv[i + 1] || '\0' != *end ) {
+			fprintf( stderr, "error: %s: invalid number '%s'\n", argv[i], argv[i + 1] );
+			return -1;
+		}
+		if( 0 == strcmp( argv[i], "--samples" ) && 0 != value )
+			options->sample_count = (size_t) value;
+		else if( 0 == strcmp( argv[i], "--seed" ) )
+			options->seed = (uint64_t) value;
+		else if( 0 == strcmp( argv[i], "--size" ) && 0 != value )
+			options->corpus_size = (size_t) value;
+		else {
+			fprintf( stderr, "error: %s: unknown switch or invalid argument\n", argv[i] );
+			return -1;
+		}
+		++ i;
+	}
+	return 0;
+}
+
+int main( int argc, char ** argv )
+{
+	mbench_options	options;
+	mbench_corpus	corpora[MBENCH_CORPUS_COUNT];
+	int				result;
+	size_t			i;
+
+	// Parse command line
+	result = _parse_command_line( &options, argc, argv );
+	if( 0 != result ) {
+		_usage();
+		return 0 < result ? 0 : 1;
+	}
+
+	// Open hardware counters; without them only time is measured
+	if( NULL != options.counters && 0 == mbench_counters_open( options.counters ) ) {
+		fprintf( stderr, "warning: hardware counters aren't available (perf_event_paranoid, container or platform), "
+			"measuring time only\n" );
+		options.counters = NULL;
+	}
+
+	// Generate corpora
+	memset( corpora, 0, sizeof(corpora) );
+	for( i = 0; i < MBENCH_CORPUS_COUNT && 0 == result; ++ i )
+		result = mbench_corpus_generate( &corpora[i], (mbench_corpus_kind) i, options.corpus_size, options.seed );
+	if( 0 != result )
+		fprintf( stderr, "error: insufficient memory for corpora\n" );
+
+	// Run kernels
+	if( 0 == result ) {
+		printf( "corpus size %u bytes, %u samples, seed %llu\n\n", (unsigned) options.corpus_size,
+			(unsigned) options.sample_count, (unsigned long long) options.seed );
+		mbench_report_header( &options );
+		result = mbench_run_bitt( &options, corpora );
+#if defined( MBENCH_LIBHUFFMAN )
+		if( 0 == result )
+			result = mbench_run_huffman( &options, corpora );
+#endif // defined( MBENCH_LIBHUFFMAN )
+	}
+
+	// Exit
+	for( i = 0; i < MBENCH_CORPUS_COUNT; ++ i )
+		mbench_corpus_release( &corpora[i] );
+	if( NULL != options.counters )
+		mbench_counters_close( options.counters );
+	return 0 == result ? 0 : 1;
+}
+
+/*END OF main.c*/
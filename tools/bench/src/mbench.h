@@ -0,0 +1,99 @@
+/*mbench.h*/
+/** @file
+ * @brief Micro-benchmark suite of libbitt and libhuffman hot paths.
+ *
+ *	Every kernel is run sample_count times over a synthetic corpus; a sample is timed as a whole and divided by the
+ * number of operations it performs, so the report gives median and 99th percentile time per operation.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MBENCH_DEFAULT_CORPUS_SIZE		(1024 * 1024)	//< default size of each corpus, in bytes
+#define MBENCH_DEFAULT_SAMPLE_COUNT		101				//< default number of timed samples of each kernel
+#define MBENCH_DEFAULT_SEED				1				//< default seed of corpus generators
+#define MBENCH_MAX_NAME_LENGTH			63				//< maximum length of a kernel name
+
+//! Synthetic corpus kinds
+typedef enum mbench_corpus_kind {
+	MBENCH_CORPUS_UNIFORM,		//< independent uniformly distributed bytes: 8 bits of entropy per byte
+	MBENCH_CORPUS_GEOMETRIC,	//< byte n has probability 2^-(n+1): a few short codes take all the data
+	MBENCH_CORPUS_ZIPF,			//< byte n has probability proportional to 1/(n+1), like text alphabets
+	MBENCH_CORPUS_RUNS,			//< packed 1-bpp rows of alternating white and black runs, like CCITT pages
+	MBENCH_CORPUS_COUNT
+} mbench_corpus_kind;
+
+//! Generated corpus
+typedef struct mbench_corpus {
+	mbench_corpus_kind	kind;
+	uint8_t *			data;
+	size_t				size;
+} mbench_corpus;
+
+//! Deterministic random number generator (xorshift64*), the same sequence on every platform
+typedef struct mbench_random {
+	uint64_t	state;
+} mbench_random;
+
+void		mbench_random_seed( mbench_random * thisp, uint64_t seed );
+uint64_t	mbench_random_next( mbench_random * thisp );
+double		mbench_random_real( mbench_random * thisp );
+
+const char *mbench_corpus_name( mbench_corpus_kind kind );
+int			mbench_corpus_generate( mbench_corpus * thisp, mbench_corpus_kind kind, size_t size, uint64_t seed );
+void		mbench_corpus_release( mbench_corpus * thisp );
+
+//! Hardware counters
+typedef enum mbench_counter_kind {
+	MBENCH_COUNTER_CYCLES,
+	MBENCH_COUNTER_INSTRUCTIONS,
+	MBENCH_COUNTER_L1D_MISSES,		//< L1 data cache read misses
+	MBENCH_COUNTER_BRANCH_MISSES,	//< mispredicted branches
+	MBENCH_COUNTER_COUNT
+} mbench_counter_kind;
+
+#define MBENCH_COUNTER_NONE		UINT64_MAX		//< value of a counter which isn't available
+
+//! Open hardware counters of the calling thread
+typedef struct mbench_counters {
+	int		fds[MBENCH_COUNTER_COUNT];		//< perf_event_open descriptors, -1 if the counter isn't available
+} mbench_counters;
+
+const char *mbench_counter_name( mbench_counter_kind kind );
+int			mbench_counters_open( mbench_counters * thisp );
+void		mbench_counters_close( mbench_counters * thisp );
+void		mbench_counters_start( mbench_counters * thisp );
+void		mbench_counters_stop( mbench_counters * thisp, uint64_t * values );
+
+//! Command line options
+typedef struct mbench_options {
+	size_t				corpus_size;	//< size of each corpus, in bytes
+	size_t				sample_count;	//< number of timed samples of each kernel
+	uint64_t			seed;			//< seed of corpus generators
+	const char *		filter;			//< run only kernels which names contain this string, NULL to run all
+	mbench_counters *	counters;		//< hardware counters read around each run, NULL if not requested or not allowed
+} mbench_options;
+
+//! Benchmark kernel: run is timed, setup and teardown are called around each sample and aren't timed
+typedef struct mbench_kernel {
+	const char *	name;
+	size_t			op_count;		//< number of operations performed by one run
+	size_t			byte_count;		//< number of bytes processed by one run, 0 if throughput doesn't apply
+	int				(*setup)( void * param );		//< optional
+	int				(*run)( void * param );
+	void			(*teardown)( void * param );	//< optional
+	void *			param;
+} mbench_kernel;
+
+int		mbench_selected( const mbench_options * options, const char * name );
+int		mbench_measure( const mbench_options * options, const mbench_kernel * kernel );
+void	mbench_report_header( const mbench_options * options );
+
+int		mbench_run_bitt( const mbench_options * options, const mbench_corpus * corpora );
+#if defined( MBENCH_LIBHUFFMAN )
+int		mbench_run_huffman( const mbench_options * options, const mbench_corpus * corpora );
+#endif // defined( MBENCH_LIBHUFFMAN )
+
+/*END OF mbench.h*/
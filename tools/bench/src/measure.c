@@ -0,0 +1,133 @@
+/*measure.c*/
+/** @file
+ * @brief Kernel timing and report.
+ */
+#include "mbench.h"
+
+#if defined( _WIN32 )
+# include <windows.h>
+#else
+# include <time.h>
+#endif // defined( _WIN32 )
+
+#define MBENCH_PERCENTILE		99		//< tail percentile reported next to the median
+
+static double _get_time( void )
+{
+#if defined( _WIN32 )
+	LARGE_INTEGER	counter, frequency;
+
+	(void) QueryPerformanceCounter( &counter );
+	(void) QueryPerformanceFrequency( &frequency );
+	return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+	struct timespec	ts;
+
+	(void) clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif // defined( _WIN32 )
+}
+
+static int _compare_doubles( const void * a, const void * b )
+{
+	const double x = *(const double *) a, y = *(const double *) b;
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Check whether the kernel is selected by the command line filter.
+ */
+int mbench_selected( const mbench_options * options, const char * name )
+{
+	return NULL == options->filter || NULL != strstr( name, options->filter );
+}
+
+void mbench_report_header( const mbench_options * options )
+{
+	int	k;
+
+	printf( "%-32s %10s %12s %12s %10s", "kernel", "ops", "median ns/op", "p99 ns/op", "MB/s" );
+	for( k = 0; NULL != options->counters && k < MBENCH_COUNTER_COUNT; ++ k )
+		printf( " %9s", mbench_counter_name( (mbench_counter_kind) k ) );
+	printf( "\n" );
+}
+
+/**
+ * @brief Time kernel and write its report line.
+ * @param[in] options (const mbench_options *) command line options.
+ * @param[in] kernel (const mbench_kernel *) kernel to run.
+ * @return (int) 0 on success, -1 if the kernel has failed.
+ *
+ *	The first run warms up caches and branch predictors and isn't counted. Samples are sorted, the median shows the
+ * typical cost and the 99th percentile shows interference (interrupts, frequency changes, page faults).
+ *	With hardware counters, counters are read around each counted run (outside of the timed interval) and reported
+ * as means per operation over all samples; a counter which isn't available for some sample is reported as '-'.
+ */
+int mbench_measure( const mbench_options * options, const mbench_kernel * kernel )
+{
+	double *	samples;
+	double		start, end, median, tail;
+	uint64_t	values[MBENCH_COUNTER_COUNT], totals[MBENCH_COUNTER_COUNT];
+	size_t		count, i;
+	int			k, result = 0;
+
+	// Check current state
+	if( !mbench_selected( options, kernel->name ) )
+		return 0;
+	count = 0 == options->sample_count ? 1 : options->sample_count;
+	samples = (double *) malloc( count * sizeof(*samples) );
+	if( NULL == samples )
+		return -1;
+
+	// Take samples
+	memset( totals, 0, sizeof(totals) );
+	for( i = 0; i <= count && 0 == result; ++ i ) {
+		if( NULL != kernel->setup )
+			result = kernel->setup( kernel->param );
+		if( 0 != result )
+			break;
+		if( NULL != options->counters )
+			mbench_counters_start( options->counters );
+		start = _get_time();
+		result = kernel->run( kernel->param );
+		end = _get_time();
+		if( NULL != options->counters )
+			mbench_counters_stop( options->counters, values );
+		if( 0 != i ) {
+			samples[i - 1] = end - start;
+			for( k = 0; NULL != options->counters && k < MBENCH_COUNTER_COUNT; ++ k )
+				totals[k] = MBENCH_COUNTER_NONE == values[k] || MBENCH_COUNTER_NONE == totals[k] ? MBENCH_COUNTER_NONE : totals[k] + values[k];
+		}
+		if( NULL != kernel->teardown )
+			kernel->teardown( kernel->param );
+	}
+
+	// Report
+	if( 0 == result ) {
+		qsort( samples, count, sizeof(*samples), _compare_doubles );
+		median = samples[count / 2];
+		tail = samples[(count * MBENCH_PERCENTILE + 99) / 100 - 1];
+		printf( "%-32s %10u %12.3f %12.3f ", kernel->name, (unsigned) kernel->op_count,
+			median * 1e9 / (double) kernel->op_count, tail * 1e9 / (double) kernel->op_count );
+		if( 0 != kernel->byte_count && median > 0 )
+			printf( "%10.1f", (double) kernel->byte_count / median / 1e6 );
+		else
+			printf( "%10s", "-" );
+		for( k = 0; NULL != options->counters && k < MBENCH_COUNTER_COUNT; ++ k ) {
+			if( MBENCH_COUNTER_NONE != totals[k] )
+				printf( " %9.3f", (double) totals[k] / (double) count / (double) kernel->op_count );
+			else
+				printf( " %9s", "-" );
+		}
+		printf( "\n" );
+	} else
+		fprintf( stderr, "%s: error: kernel has failed\n", kernel->name );
+
+	// Exit
+	free( samples );
+	return result;
+}
+
+/*END OF measure.c*/
@@ -0,0 +1,285 @@
+/*codes.c*/
+/** @file
+ * @brief Matching tables: length-limited Huffman codes of the model, HTTF and encoded stream output.
+ */
+#include "gencorpus.h"
+
+#define GENCORPUS_FREQUENCY_SCALE	281474976710656.0	//< 2^48, scale of model probabilities converted to integer frequencies
+
+typedef struct _leaf {
+	uint64_t	frequency;
+	size_t		symbol;
+} _leaf;
+
+static int _compare_leaves( const void * a, const void * b )
+{
+	const _leaf * x = (const _leaf *) a, * y = (const _leaf *) b;
+
+	if( x->frequency != y->frequency )
+		return x->frequency < y->frequency ? -1 : 1;
+	return x->symbol < y->symbol ? 1 : x->symbol > y->symbol ? -1 : 0;		// lower symbols get shorter codes on ties
+}
+
+/**
+ * @brief Build Huffman code lengths limited to max_length bits.
+ * @internal
+ *
+ *	Leaves sorted by frequency are merged with the two-queue method. If the tree is too deep, pairs of the deepest
+ * leaves are moved up as in JPEG (ITU T.81 K.3), then lengths are given to symbols in frequency order again.
+ */
+static int _build_lengths( const uint64_t * frequencies, size_t n, unsigned max_length, uint8_t * lengths )
+{
+	_leaf *		leaves;
+	uint64_t *	weights;
+	size_t *	parents, * depths, * counts;
+	size_t		i, j, k, leaf, node, a, b, max_depth;
+
+	if( 1 == n ) {
+		lengths[0] = 1;
+		return 0;
+	}
+	if( max_length < 64 && n > ((size_t) 1 << max_length) )
+		return -1;
+
+	leaves = (_leaf *) malloc( n * sizeof(*leaves) );
+	weights = (uint64_t *) malloc( 2 * n * sizeof(*weights) );
+	parents = (size_t *) malloc( 2 * n * sizeof(*parents) );
+	depths = (size_t *) malloc( 2 * n * sizeof(*depths) );
+	counts = (size_t *) calloc( n + 1, sizeof(*counts) );
+	if( NULL == leaves || NULL == weights || NULL == parents || NULL == depths || NULL == counts ) {
+		free( leaves ); free( weights ); free( parents ); free( depths ); free( counts );
+		return -1;
+	}
+
+	// Merge two lightest of sorted leaves and created nodes, which are created in nondecreasing weight order
+	for( i = 0; i < n; ++ i ) {
+		leaves[i].frequency = frequencies[i];
+		leaves[i].symbol = i;
+	}
+	qsort( leaves, n, sizeof(*leaves), _compare_leaves );
+	for( i = 0; i < n; ++ i )
+		weights[i] = leaves[i].frequency;
+	for( leaf = 0, node = n, k = n; k < 2 * n - 1; ++ k ) {
+		a = leaf < n && (node >= k || weights[leaf] <= weights[node]) ? leaf ++ : node ++;
+		b = leaf < n && (node >= k || weights[leaf] <= weights[node]) ? leaf ++ : node ++;
+		weights[k] = weights[a] + weights[b];
+		parents[a] = parents[b] = k;
+	}
+	depths[2 * n - 2] = 0;
+	for( max_depth = 0, k = 2 * n - 2; k-- > 0; ) {
+		depths[k] = depths[parents[k]] + 1;
+		if( k < n ) {
+			++ counts[depths[k]];
+			if( max_depth < depths[k] )
+				max_depth = depths[k];
+		}
+	}
+
+	// Limit lengths: a pair of deepest leaves becomes a leaf and a child of a former shallower leaf
+	for( i = max_depth; i > max_length; -- i ) {
+		while( 0 != counts[i] ) {
+			for( j = i - 2; 0 == counts[j]; -- j )
+				;
+			counts[i] -= 2;
+			counts[i - 1] += 1;
+			counts[j + 1] += 2;
+			counts[j] -= 1;
+		}
+	}
+
+	// Most frequent symbols get shortest lengths
+	for( k = n, i = 1; i <= max_depth && i <= max_length; ++ i ) {
+		for( j = 0; j < counts[i]; ++ j )
+			lengths[leaves[-- k].symbol] = (uint8_t) i;
+	}
+
+	free( leaves ); free( weights ); free( parents ); free( depths ); free( counts );
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Build canonical codes of the model weights.
+ * @param[in,out] model (gencorpus_model *) model; codes receives one code per weight.
+ * @return (int) 0 on success, -1 on failure.
+ */
+int gencorpus_build_codes( gencorpus_model * model )
+{
+	uint64_t *	frequencies;
+	uint8_t *	lengths;
+	uint32_t	next_codes[GENCORPUS_MAX_CODE_LENGTH + 2], code;
+	size_t		counts[GENCORPUS_MAX_CODE_LENGTH + 1];
+	size_t		n, i;
+	unsigned	j;
+	double		sum;
+	int			result;
+
+	// Convert probabilities to frequencies, every symbol gets a code
+	n = model->symbol_count + (model->escape ? 1 : 0);
+	frequencies = (uint64_t *) malloc( n * sizeof(*frequencies) );
+	lengths = (uint8_t *) malloc( n );
+	model->codes = (gencorpus_code *) calloc( n, sizeof(*model->codes) );
+	result = NULL == frequencies || NULL == lengths || NULL == model->codes ? -1 : 0;
+	if( 0 == result ) {
+		for( sum = 0, i = 0; i < n; ++ i )
+			sum += model->weights[i];
+		for( i = 0; i < n; ++ i ) {
+			frequencies[i] = (uint64_t) (model->weights[i] / sum * GENCORPUS_FREQUENCY_SCALE);
+			if( 0 == frequencies[i] )
+				frequencies[i] = 1;
+		}
+		result = _build_lengths( frequencies, n, model->max_code_length, lengths );
+	}
+
+	// Assign canonical codes in symbol order; they're reversed since the decoder takes bit 0 of the code first
+	if( 0 == result ) {
+		memset( counts, 0, sizeof(counts) );
+		for( i = 0; i < n; ++ i )
+			++ counts[lengths[i]];
+		for( code = 0, next_codes[1] = 0, i = 2; i <= GENCORPUS_MAX_CODE_LENGTH + 1; ++ i )
+			next_codes[i] = code = (code + (uint32_t) counts[i - 1]) << 1;
+		for( i = 0; i < n; ++ i ) {
+			code = next_codes[lengths[i]] ++;
+			for( model->codes[i].bits = 0, j = 0; j < lengths[i]; ++ j, code >>= 1 )
+				model->codes[i].bits = (model->codes[i].bits << 1) | (code & 1);
+			model->codes[i].length = lengths[i];
+		}
+	}
+
+	free( frequencies );
+	free( lengths );
+	return result;
+}
+
+static void _write_bits( FILE * f, uint32_t bits, unsigned length )
+{
+	while( 0 != length -- )
+		fputc( '0' + (int) ((bits >> length) & 1), f );
+}
+
+/**
+ * @brief Write model codes as the HTTF table.
+ * @param[in] model (const gencorpus_model *) model with codes.
+ * @param[in] options (const gencorpus_options *) options the model was generated with, written to the header comment.
+ * @param[in] file (const char *) table file name.
+ * @return (int) 0 on success, -1 on failure.
+ */
+int gencorpus_write_table( const gencorpus_model * model, const gencorpus_options * options, const char * file )
+{
+	FILE *		f;
+	size_t		i;
+	unsigned	j;
+	int			result = 0;
+
+	f = fopen( file, "w" );
+	if( NULL == f )
+		return -1;
+
+	// Header
+	fprintf( f, "//%s\n", file );
+	fprintf( f, "/**\n * Generated by gencorpus: %s %g, seed %llu, %u symbols.\n */\n", options->kind_name, options->parameter,
+		(unsigned long long) options->seed, (unsigned) model->size );
+	fprintf( f, "HTTF\n1.0\n\n" );
+
+	// Codes
+	for( i = 0; i < model->symbol_count; ++ i ) {
+		_write_bits( f, model->codes[i].bits, model->codes[i].length );
+		for( j = model->codes[i].length; j < model->max_code_length; ++ j )
+			fputc( '\x20', f );
+		fprintf( f, " : 1 : " );
+		_write_bits( f, (uint32_t) i, model->value_bit_size );
+		fputc( '\n', f );
+	}
+	if( model->escape ) {
+		_write_bits( f, model->codes[i].bits, model->codes[i].length );
+		for( j = model->codes[i].length; j < model->max_code_length; ++ j )
+			fputc( '\x20', f );
+		fprintf( f, " : %s : %u\n", GENCORPUS_ESCAPE_NAME, (unsigned) model->escape_interval );
+	}
+
+	// Footer
+	fprintf( f, "END\n" );
+	if( ferror( f ) )
+		result = -1;
+	if( 0 != fclose( f ) )
+		result = -1;
+	return result;
+}
+
+/**
+ * @brief Write the data encoded with model codes, in the order libhuffman_encode stores bits.
+ * @param[in] model (const gencorpus_model *) model with codes and data.
+ * @param[in] file (const char *) stream file name.
+ * @return (int) 0 on success, -1 on failure.
+ *
+ *	Code bits are appended to a little-endian accumulator starting with the least significant bit of the code value,
+ * the last byte is padded with zero bits. With the escape the escape code follows every escape_interval symbols.
+ */
+int gencorpus_write_stream( const gencorpus_model * model, const char * file )
+{
+	FILE *					f;
+	const gencorpus_code *	code;
+	uint64_t				acc = 0;
+	unsigned				acc_bits = 0;
+	size_t					i;
+	int						result = 0;
+
+	f = fopen( file, "wb" );
+	if( NULL == f )
+		return -1;
+
+	for( i = 0; i < model->size; ++ i ) {
+		code = &model->codes[model->symbols[i]];
+		acc |= (uint64_t) code->bits << acc_bits;
+		acc_bits += code->length;
+		if( model->escape && 0 == (i + 1) % model->escape_interval ) {
+			for( ; acc_bits >= 8; acc >>= 8, acc_bits -= 8 )
+				fputc( (int) (acc & 0xFF), f );
+			code = &model->codes[model->symbol_count];
+			acc |= (uint64_t) code->bits << acc_bits;
+			acc_bits += code->length;
+		}
+		for( ; acc_bits >= 8; acc >>= 8, acc_bits -= 8 )
+			fputc( (int) (acc & 0xFF), f );
+	}
+	if( 0 != acc_bits )
+		fputc( (int) (acc & 0xFF), f );
+
+	if( ferror( f ) )
+		result = -1;
+	if( 0 != fclose( f ) )
+		result = -1;
+	return result;
+}
+
+/**
+ * @brief Write generated symbols: bytes, or little-endian 16-bit words for alphabets above 256 symbols.
+ * @param[in] model (const gencorpus_model *) model with data.
+ * @param[in] file (const char *) data file name.
+ * @return (int) 0 on success, -1 on failure.
+ */
+int gencorpus_write_data( const gencorpus_model * model, const char * file )
+{
+	FILE *	f;
+	size_t	i;
+	int		result = 0;
+
+	f = fopen( file, "wb" );
+	if( NULL == f )
+		return -1;
+
+	for( i = 0; i < model->size; ++ i ) {
+		fputc( model->symbols[i] & 0xFF, f );
+		if( 16 == model->value_bit_size )
+			fputc( model->symbols[i] >> 8, f );
+	}
+
+	if( ferror( f ) )
+		result = -1;
+	if( 0 != fclose( f ) )
+		result = -1;
+	return result;
+}
+
+/*END OF codes.c*/
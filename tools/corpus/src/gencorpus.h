@@ -0,0 +1,66 @@
+/*gencorpus.h*/
+/** @file
+ * @brief Deterministic corpus generator: benchmark and tuning inputs with matching HTTF tables.
+ */
+#include "../../bench/src/mbench.h"
+
+#define GENCORPUS_MAX_CODE_LENGTH			32				//< maximum code length, as LIBHUFFMAN_MAX_CODE_LENGTH
+#define GENCORPUS_DEFAULT_MAX_CODE_LENGTH	15				//< default length limit of derived tables
+#define GENCORPUS_DEFAULT_SIZE				(1024 * 1024)	//< default number of generated symbols (bytes for bitmaps)
+#define GENCORPUS_MAX_SYMBOL_COUNT			65536			//< maximum alphabet size, symbols are 16 bits wide
+#define GENCORPUS_DEFAULT_ROW_WIDTH			1728			//< default bitmap row width, in pixels (T.4 A4 row)
+#define GENCORPUS_ESCAPE_NAME				"ESC"			//< name of the escape action in generated tables
+
+//! Generated inputs
+typedef enum gencorpus_kind {
+	GENCORPUS_ENTROPY,		//< bytes with the given entropy per symbol
+	GENCORPUS_ZIPF,			//< Zipf-distributed alphabet of the given size
+	GENCORPUS_CCITT,		//< bitmap rows of runs distributed as the codes of a CCITT table imply
+	GENCORPUS_MAXLEN,		//< every code of the data has the maximum length
+	GENCORPUS_ESCAPE,		//< Zipf bytes with an escape every N symbols
+} gencorpus_kind;
+
+//! Code of a symbol: bits are the binary digits of the HTTF code line, first digit is the most significant; bit 0 is sent first
+typedef struct gencorpus_code {
+	uint32_t	bits;
+	uint8_t		length;
+} gencorpus_code;
+
+//! Generated model and data
+typedef struct gencorpus_model {
+	size_t			symbol_count;		//< number of data symbols; the escape, if any, follows them
+	unsigned		value_bit_size;		//< 8 or 16
+	double *		weights;			//< symbol_count (+1 with the escape) relative symbol probabilities
+	int				escape;				//< non-0 if the last weight and code belong to the escape
+	size_t			escape_interval;	//< number of data symbols between escapes
+	unsigned		max_code_length;
+	gencorpus_code *codes;
+	uint16_t *		symbols;			//< generated data
+	size_t			size;				//< number of generated symbols
+} gencorpus_model;
+
+//! Command line options
+typedef struct gencorpus_options {
+	gencorpus_kind	kind;
+	const char *	kind_name;
+	double			parameter;			//< entropy, alphabet size, maximum length or escape interval
+	const char *	table_file;			//< CCITT table
+	const char *	prefix;				//< output file name prefix
+	size_t			size;
+	size_t			row_width;
+	unsigned		max_code_length;
+	uint64_t		seed;
+} gencorpus_options;
+
+// codes.c
+int		gencorpus_build_codes( gencorpus_model * model );
+int		gencorpus_write_table( const gencorpus_model * model, const gencorpus_options * options, const char * file );
+int		gencorpus_write_stream( const gencorpus_model * model, const char * file );
+int		gencorpus_write_data( const gencorpus_model * model, const char * file );
+
+// generate.c
+int		gencorpus_generate_model( gencorpus_model * model, const gencorpus_options * options );
+int		gencorpus_generate_bitmap( const gencorpus_options * options, const char * data_file, const char * table_file );
+void	gencorpus_release_model( gencorpus_model * model );
+
+/*END OF gencorpus.h*/
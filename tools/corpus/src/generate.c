@@ -0,0 +1,321 @@
+/*generate.c*/
+/** @file
+ * @brief Corpus models and data generators.
+ */
+#include <math.h>
+#include "gencorpus.h"
+
+#define GENCORPUS_BYTE_SYMBOL_COUNT		256		//< alphabet of byte streams
+#define GENCORPUS_ENTROPY_ITERATIONS	64		//< bisection steps of the entropy model parameter
+#define GENCORPUS_CCITT_MAX_CODES		256		//< maximum number of run codes read from the CCITT table
+
+//! Run code of the CCITT table
+typedef struct _run_code {
+	unsigned	run;		//< number of pixels
+	unsigned	length;		//< code length
+	int			black;
+} _run_code;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Weighted symbols
+
+/**
+ * @brief Convert weights to the cumulative distribution.
+ * @internal
+ */
+static void _make_cdf( const double * weights, size_t n, double * cdf )
+{
+	double	sum;
+	size_t	i;
+
+	for( sum = 0, i = 0; i < n; ++ i )
+		cdf[i] = sum += weights[i];
+	for( i = 0; i < n; ++ i )
+		cdf[i] /= sum;
+}
+static size_t _sample( const double * cdf, size_t n, mbench_random * random )
+{
+	double	u = mbench_random_real( random );
+	size_t	lo, hi, mid;
+
+	for( lo = 0, hi = n - 1; lo < hi; ) {
+		mid = (lo + hi) / 2;
+		if( cdf[mid] > u )
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/**
+ * @brief Set weights r^i of byte values, r is chosen so the entropy is as requested.
+ * @internal
+ *
+ *	Entropy grows with r from 0 bits (r = 0) to 8 bits (r = 1), so r is found by bisection.
+ */
+static void _set_entropy_weights( double * weights, double entropy )
+{
+	double	lo = 0, hi = 1, r, p, sum, h;
+	size_t	i, k;
+
+	for( r = 1, k = 0; k < GENCORPUS_ENTROPY_ITERATIONS; ++ k ) {
+		r = (lo + hi) / 2;
+		for( sum = 0, p = 1, i = 0; i < GENCORPUS_BYTE_SYMBOL_COUNT; ++ i, p *= r )
+			sum += p;
+		for( h = 0, p = 1, i = 0; i < GENCORPUS_BYTE_SYMBOL_COUNT && p > 0; ++ i, p *= r )
+			h -= p / sum * log2( p / sum );
+		if( h < entropy )
+			lo = r;
+		else
+			hi = r;
+	}
+	for( p = 1, i = 0; i < GENCORPUS_BYTE_SYMBOL_COUNT; ++ i, p *= r )
+		weights[i] = p;
+}
+
+/**
+ * @brief Generate model and data of the requested kind.
+ * @param[out] model (gencorpus_model *) model receiving weights and symbols; codes are built by gencorpus_build_codes.
+ * @param[in] options (const gencorpus_options *) command line options.
+ * @return (int) 0 on success, -1 on failure.
+ *
+ *	Weights are the model probabilities rather than counts of the generated data, so every symbol gets a code and
+ * tables of different seeds are the same.
+ */
+int gencorpus_generate_model( gencorpus_model * model, const gencorpus_options * options )
+{
+	mbench_random	random;
+	double *		cdf;
+	size_t			n, i, first;
+
+	memset( model, 0, sizeof(*model) );
+	model->size = options->size;
+	model->value_bit_size = 8;
+	model->max_code_length = options->max_code_length;
+
+	// Alphabet
+	switch( options->kind ) {
+	case GENCORPUS_ZIPF:
+		model->symbol_count = (size_t) options->parameter;
+		if( model->symbol_count > GENCORPUS_BYTE_SYMBOL_COUNT )
+			model->value_bit_size = 16;
+		break;
+	case GENCORPUS_MAXLEN:
+		model->symbol_count = (size_t) options->parameter + 1;	// lengths 1, 2, ..., L, L
+		model->max_code_length = (unsigned) options->parameter;
+		break;
+	case GENCORPUS_ESCAPE:
+		model->symbol_count = GENCORPUS_BYTE_SYMBOL_COUNT;
+		model->escape = 1;
+		model->escape_interval = (size_t) options->parameter;
+		break;
+	default:
+		model->symbol_count = GENCORPUS_BYTE_SYMBOL_COUNT;
+		break;
+	}
+	n = model->symbol_count + (model->escape ? 1 : 0);
+	model->weights = (double *) malloc( n * sizeof(*model->weights) );
+	model->symbols = (uint16_t *) malloc( model->size * sizeof(*model->symbols) );
+	cdf = (double *) malloc( n * sizeof(*cdf) );
+	if( NULL == model->weights || NULL == model->symbols || NULL == cdf ) {
+		free( cdf );
+		return -1;
+	}
+
+	// Weights
+	switch( options->kind ) {
+	case GENCORPUS_ENTROPY:
+		_set_entropy_weights( model->weights, options->parameter );
+		break;
+	case GENCORPUS_MAXLEN:
+		// Dyadic weights: Huffman codes are exactly 1, 2, ..., L, L bits long
+		for( i = 0; i < n; ++ i )
+			model->weights[i] = ldexp( 1.0, -(int) (i + 1 < n ? i + 1 : i) );
+		break;
+	default:
+		for( i = 0; i < model->symbol_count; ++ i )
+			model->weights[i] = 1.0 / (double) (i + 1);
+		if( model->escape ) {
+			model->weights[model->symbol_count] = 0;
+			for( i = 0; i < model->symbol_count; ++ i )
+				model->weights[model->symbol_count] += model->weights[i];
+			model->weights[model->symbol_count] /= (double) model->escape_interval;
+		}
+		break;
+	}
+
+	// Data; the worst case consists of the longest codes only
+	mbench_random_seed( &random, options->seed );
+	first = GENCORPUS_MAXLEN == options->kind ? model->symbol_count - 2 : 0;
+	_make_cdf( model->weights + first, model->symbol_count - first, cdf );
+	for( i = 0; i < model->size; ++ i )
+		model->symbols[i] = (uint16_t) (first + _sample( cdf, model->symbol_count - first, &random ));
+
+	free( cdf );
+	return 0;
+}
+
+void gencorpus_release_model( gencorpus_model * model )
+{
+	free( model->weights );
+	free( model->codes );
+	free( model->symbols );
+	memset( model, 0, sizeof(*model) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CCITT bitmaps
+
+/**
+ * @brief Read run codes of the CCITT table: lines "code : run : color"; actions (make-up extensions, EOL) are skipped.
+ * @internal
+ */
+static size_t _read_run_codes( FILE * f, _run_code * codes )
+{
+	char		line[256];
+	const char *s;
+	char *		end;
+	size_t		count = 0;
+	unsigned	length;
+	unsigned long	run;
+
+	while( count < GENCORPUS_CCITT_MAX_CODES && NULL != fgets( line, sizeof(line), f ) ) {
+		for( s = line, length = 0; '0' == *s || '1' == *s; ++ s )
+			++ length;
+		if( 0 == length )
+			continue;
+		for( ; '\x20' == *s || '\t' == *s; ++ s )
+			;
+		if( ':' != *s ++ )
+			continue;
+		run = strtoul( s, &end, 0 );
+		if( end == s )
+			continue;
+		for( s = end; '\x20' == *s || '\t' == *s; ++ s )
+			;
+		if( ':' != *s ++ )
+			continue;
+		for( ; '\x20' == *s || '\t' == *s; ++ s )
+			;
+		if( '0' != *s && '1' != *s )
+			continue;
+		codes[count].run = (unsigned) run;
+		codes[count].length = length;
+		codes[count].black = '1' == *s;
+		++ count;
+	}
+	return count;
+}
+
+/**
+ * @brief Sample run of the color: optional make-up code and terminating code, probabilities of codes are 2^-length.
+ * @internal
+ */
+static unsigned _sample_run( const _run_code * codes, size_t count, int black, mbench_random * random )
+{
+	double		terminating = 0, makeup = 0, u;
+	unsigned	run = 0;
+	size_t		i;
+	int			pass;
+
+	for( i = 0; i < count; ++ i ) {
+		if( black != codes[i].black )
+			continue;
+		if( codes[i].run < 64 )
+			terminating += ldexp( 1.0, -(int) codes[i].length );
+		else
+			makeup += ldexp( 1.0, -(int) codes[i].length );
+	}
+
+	// Make-up code is absent with the total probability of terminating codes
+	for( pass = 0; pass < 2; ++ pass ) {
+		u = mbench_random_real( random ) * (0 == pass ? terminating + makeup : terminating);
+		if( 0 == pass && u < terminating )
+			continue;
+		if( 0 == pass )
+			u -= terminating;
+		for( i = 0; i < count; ++ i ) {
+			if( black != codes[i].black || (0 == pass) != (codes[i].run >= 64) )
+				continue;
+			u -= ldexp( 1.0, -(int) codes[i].length );
+			if( u < 0 )
+				break;
+		}
+		if( i < count )
+			run += codes[i].run;
+	}
+	return run;
+}
+
+/**
+ * @brief Generate bitmap of runs distributed as codes of the CCITT table, and copy the table as its matching table.
+ * @param[in] options (const gencorpus_options *) command line options; size is the bitmap size, in bytes.
+ * @param[in] data_file (const char *) bitmap file name.
+ * @param[in] table_file (const char *) file name of the table copy.
+ * @return (int) 0 on success, -1 on failure.
+ *
+ *	Pixels are packed most significant bit first, 1 is black, rows are padded to whole bytes. Every row starts with
+ * a white run, runs are cut at the row end.
+ */
+int gencorpus_generate_bitmap( const gencorpus_options * options, const char * data_file, const char * table_file )
+{
+	_run_code		codes[GENCORPUS_CCITT_MAX_CODES];
+	mbench_random	random;
+	uint8_t *		data;
+	FILE *			f;
+	size_t			count, row_size, row, x, run, i;
+	int				black, c, result = 0;
+
+	// Load table
+	f = fopen( options->table_file, "r" );
+	if( NULL == f )
+		return -1;
+	count = _read_run_codes( f, codes );
+	fclose( f );
+	if( 0 == count )
+		return -1;
+
+	// Generate rows
+	row_size = (options->row_width + 7) / 8;
+	data = (uint8_t *) calloc( options->size, 1 );
+	if( NULL == data )
+		return -1;
+	mbench_random_seed( &random, options->seed );
+	for( row = 0; row < options->size; row += row_size ) {
+		for( black = 0, x = 0; x < options->row_width; black = !black, x += run ) {
+			run = _sample_run( codes, count, black, &random );
+			if( run > options->row_width - x )
+				run = options->row_width - x;
+			for( i = x; black && i < x + run && row + i / 8 < options->size; ++ i )
+				data[row + i / 8] |= (uint8_t) (0x80 >> (i % 8));
+		}
+	}
+
+	// Write bitmap and table copy
+	f = fopen( data_file, "wb" );
+	if( NULL == f || options->size != fwrite( data, 1, options->size, f ) )
+		result = -1;
+	if( NULL != f && 0 != fclose( f ) )
+		result = -1;
+	free( data );
+	if( 0 == result ) {
+		FILE * src = fopen( options->table_file, "rb" );
+		f = NULL == src ? NULL : fopen( table_file, "wb" );
+		if( NULL == f )
+			result = -1;
+		else {
+			while( EOF != (c = fgetc( src )) )
+				fputc( c, f );
+			if( ferror( f ) || ferror( src ) )
+				result = -1;
+			if( 0 != fclose( f ) )
+				result = -1;
+		}
+		if( NULL != src )
+			fclose( src );
+	}
+	return result;
+}
+
+/*END OF generate.c*/
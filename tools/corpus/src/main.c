@@ -0,0 +1,175 @@
+/*main.c*/
+/** @file
+ * @brief Corpus generator entry point.
+ */
+#include "gencorpus.h"
+
+#define GENCORPUS_MAX_FILE_NAME_LENGTH		1023
+
+static const struct {
+	const char *	name;
+	gencorpus_kind	kind;
+	double			min_parameter;
+	double			max_parameter;
+} _kinds[] = {
+	{ "entropy",	GENCORPUS_ENTROPY,	0,	8 },
+	{ "zipf",		GENCORPUS_ZIPF,		2,	GENCORPUS_MAX_SYMBOL_COUNT },
+	{ "ccitt",		GENCORPUS_CCITT,	0,	0 },
+	{ "maxlen",		GENCORPUS_MAXLEN,	2,	GENCORPUS_MAX_CODE_LENGTH },
+	{ "escape",		GENCORPUS_ESCAPE,	1,	(double) ((size_t) -1) },
+};
+
+static void _usage( void )
+{
+	printf(
+		"GENCORPUS kind [parameter] [{switch}]\n"
+		"\n"
+		"Kinds:\n"
+		"entropy H	: bytes with H bits of entropy per byte (0..8).\n"
+		"zipf N		: Zipf-distributed alphabet of N symbols (2..65536); symbols above 256 are 16-bit words.\n"
+		"ccitt [FILE]	: 1-bpp bitmap of runs distributed as the codes of the CCITT table FILE imply\n"
+		"			  (default data/ccitt-g3.httf); the table is copied as the matching table.\n"
+		"maxlen L	: codes of 1, 2, ..., L, L bits (2..32) and data of the two L-bit codes only.\n"
+		"escape N	: Zipf bytes with the escape action code after every N symbols.\n"
+		"\n"
+		"Switches:\n"
+		"-?	--help			: display command line help.\n"
+		"-o	--output PREFIX	: output file name prefix (default: kind name).\n"
+		"	--max-length L	: length limit of derived codes (default %u).\n"
+		"	--seed N		: seed of the random generator (default %u).\n"
+		"	--size N		: number of symbols, or bitmap size in bytes (default %u).\n"
+		"	--width N		: bitmap row width, in pixels (default %u).\n",
+		(unsigned) GENCORPUS_DEFAULT_MAX_CODE_LENGTH, (unsigned) MBENCH_DEFAULT_SEED, (unsigned) GENCORPUS_DEFAULT_SIZE,
+		(unsigned) GENCORPUS_DEFAULT_ROW_WIDTH );
+}
+
+/**
+ * @brief Parse command line.
+ * @internal
+ * @return (int) 0 on success, 1 if help was requested, -1 on invalid command line.
+ */
+static int _parse_command_line( gencorpus_options * options, int argc, char ** argv )
+{
+	unsigned long long	value;
+	char *				end;
+	size_t				k;
+	int					i;
+
+	memset( options, 0, sizeof(*options) );
+	options->table_file = "data/ccitt-g3.httf";
+	options->size = GENCORPUS_DEFAULT_SIZE;
+	options->row_width = GENCORPUS_DEFAULT_ROW_WIDTH;
+	options->max_code_length = GENCORPUS_DEFAULT_MAX_CODE_LENGTH;
+	options->seed = MBENCH_DEFAULT_SEED;
+
+	// Kind and parameter
+	if( argc < 2 || 0 == strcmp( argv[1], "-?" ) || 0 == strcmp( argv[1], "--help" ) )
+		return 1;
+	for( k = 0; k < sizeof(_kinds) / sizeof(*_kinds) && 0 != strcmp( argv[1], _kinds[k].name ); ++ k )
+		;
+	if( sizeof(_kinds) / sizeof(*_kinds) == k ) {
+		fprintf( stderr, "error: %s: unknown kind\n", argv[1] );
+		return -1;
+	}
+	options->kind = _kinds[k].kind;
+	options->kind_name = _kinds[k].name;
+	i = 2;
+	if( GENCORPUS_CCITT == options->kind ) {
+		if( i < argc && '-' != argv[i][0] )
+			options->table_file = argv[i ++];
+	} else {
+		options->parameter = i < argc ? strtod( argv[i], &end ) : 0;
+		if( i >= argc || end == argv[i] || '\0' != *end
+			|| options->parameter < _kinds[k].min_parameter || options->parameter > _kinds[k].max_parameter ) {
+			fprintf( stderr, "error: %s: parameter is missing or out of range\n", argv[1] );
+			return -1;
+		}
+		++ i;
+	}
+	options->prefix = options->kind_name;
+
+	// Switches
+	for( ; i < argc; ++ i ) {
+		if( 0 == strcmp( argv[i], "-?" ) || 0 == strcmp( argv[i], "--help" ) )
+			return 1;
+		if( i + 1 >= argc ) {
+			fprintf( stderr, "error: %s: unknown switch or missing argument\n", argv[i] );
+			return -1;
+		}
+		if( 0 == strcmp( argv[i], "-o" ) || 0 == strcmp( argv[i], "--output" ) ) {
+			options->prefix = argv[++ i];
+			continue;
+		}
+		value = strtoull( argv[i + 1], &end, 0 );
+		if( end == argv[i + 1] || '\0' != *end ) {
+			fprintf( stderr, "error: %s: invalid number '%s'\n", argv[i], argv[i + 1] );
+			return -1;
+		}
+		if( 0 == strcmp( argv[i], "--max-length" ) && 0 != value && GENCORPUS_MAX_CODE_LENGTH >= value )
+			options->max_code_length = (unsigned) value;
+		else if( 0 == strcmp( argv[i], "--seed" ) )
+			options->seed = (uint64_t) value;
+		else if( 0 == strcmp( argv[i], "--size" ) && 0 != value )
+			options->size = (size_t) value;
+		else if( 0 == strcmp( argv[i], "--width" ) && 0 != value )
+			options->row_width = (size_t) value;
+		else {
+			fprintf( stderr, "error: %s: unknown switch or invalid argument\n", argv[i] );
+			return -1;
+		}
+		++ i;
+	}
+	return 0;
+}
+
+int main( int argc, char ** argv )
+{
+	gencorpus_options	options;
+	gencorpus_model		model;
+	char				data_file[GENCORPUS_MAX_FILE_NAME_LENGTH + 1];
+	char				table_file[GENCORPUS_MAX_FILE_NAME_LENGTH + 1];
+	char				stream_file[GENCORPUS_MAX_FILE_NAME_LENGTH + 1];
+	int					result;
+
+	// Parse command line
+	result = _parse_command_line( &options, argc, argv );
+	if( 0 != result ) {
+		_usage();
+		return 0 < result ? 0 : 1;
+	}
+	snprintf( data_file, sizeof(data_file), "%s.bin", options.prefix );
+	snprintf( table_file, sizeof(table_file), "%s.httf", options.prefix );
+	snprintf( stream_file, sizeof(stream_file), "%s.huf", options.prefix );
+
+	// Bitmap of runs with the CCITT table
+	if( GENCORPUS_CCITT == options.kind ) {
+		result = gencorpus_generate_bitmap( &options, data_file, table_file );
+		if( 0 != result )
+			fprintf( stderr, "%s: error: can't read table or write %s, %s\n", options.table_file, data_file, table_file );
+		return 0 == result ? 0 : 1;
+	}
+
+	// Symbols with the derived table and the encoded stream
+	result = gencorpus_generate_model( &model, &options );
+	if( 0 == result ) {
+		result = gencorpus_build_codes( &model );
+		if( 0 != result )
+			fprintf( stderr, "error: %u symbols don't fit in %u-bit codes\n", (unsigned) model.symbol_count, model.max_code_length );
+	} else
+		fprintf( stderr, "error: insufficient memory\n" );
+	if( 0 == result ) {
+		result = gencorpus_write_data( &model, data_file );
+		if( 0 == result )
+			result = gencorpus_write_table( &model, &options, table_file );
+		if( 0 == result )
+			result = gencorpus_write_stream( &model, stream_file );
+		if( 0 != result )
+			fprintf( stderr, "error: can't write %s, %s or %s\n", data_file, table_file, stream_file );
+	}
+
+	// Exit
+	gencorpus_release_model( &model );
+	return 0 == result ? 0 : 1;
+}
+
+/*END OF main.c*/
@@ -4,6 +4,9 @@ typedef enum apphuffman_mode_t {
 	APPHUFFMAN_M_UNDEFINED,
 	APPHUFFMAN_M_DECODE,
 	APPHUFFMAN_M_ENCODE,
+	APPHUFFMAN_M_COMPILE,
+	APPHUFFMAN_M_ANALYZE,
+	APPHUFFMAN_M_BENCH,
 } apphuffman_mode_t;
 
 typedef enum apphuffman_table_format_t
@@ -14,12 +17,47 @@ typedef enum apphuffman_table_format_t
 	APPHUFFMAN_TF_INVALID
 } apphuffman_table_format_t;
 
+typedef enum apphuffman_layout_t
+{
+	APPHUFFMAN_L_BLOCKS,		//< blocks are contiguous bit ranges of the stream
+	APPHUFFMAN_L_INTERLEAVED,	//< blocks are interleaved in 32-bit words, one lane per block
+	APPHUFFMAN_L_INVALID
+} apphuffman_layout_t;
+
+#define APPHUFFMAN_STREAMED_SIGNATURE		0x53465548		//< "HUFS", streamed file
+#define APPHUFFMAN_MULTITABLE_SIGNATURE		0x4D465548		//< "HUFM", multitable streamed file
+#define APPHUFFMAN_DIRECTORY_SIGNATURE		0x52494448		//< "HDIR", stream directory
+#define APPHUFFMAN_BLOCK_TABLE_SIGNATURE	0x4B4C4248		//< "HBLK", block table that follows the raw stream split in lanes
+#define APPHUFFMAN_FRAME_SIGNATURE			0x46465548		//< "HUFF", frame of the framed stream
+
+#define APPHUFFMAN_DEFAULT_BLOCK_SIZE		0x100000		//< size of source blocks coded by pipeline workers, in bytes
+#define APPHUFFMAN_MAX_QUEUE_DEPTH			4096			//< maximum number of pipeline reads and writes in flight
+#define APPHUFFMAN_MAX_FRAME_STREAM_COUNT	4096			//< maximum number of streams in a frame of the framed stream
+#define APPHUFFMAN_DEFAULT_ITERATION_COUNT	10				//< number of timed runs of each benchmark phase
+
+#define APPHUFFMAN_TABLE_SIGNATURE			0x46425448		//< "HTBF", binary table file
+#define APPHUFFMAN_TABLE_VERSION_MAJOR		2				//< incompatible changes of the binary table format (2: 64-bit code records)
+#define APPHUFFMAN_TABLE_VERSION_MINOR		1				//< compatible extensions of the binary table format (1: escape names)
+#define APPHUFFMAN_TABLE_F_LAYOUT			0x0001			//< binary table file holds the frozen decode layout
+#define APPHUFFMAN_TABLE_F_ESCAPES			0x0002			//< binary table file holds escape names of action codes
+
 typedef struct apphuffman_context {
 	apphuffman_mode_t			mode;
 	apphuffman_table_format_t	format;
 	char *	table_file;
 	char *	input_file;
 	char *	output_file;
+	size_t	lane_count;		//< number of blocks each stream is split in (0 = not split)
+	apphuffman_layout_t	layout;	//< layout of stream blocks
+	size_t	stream_count;	//< number of streams in the output file (0 = single stream)
+	size_t	table_count;	//< maximum number of generated tables (0 = use external table)
+	int		rle;			//< encode runs of equal values with run codes of the table
+	unsigned	table_bits;	//< log2 size limit of compiled decoder tables (0 = default)
+	size_t	worker_count;	//< number of pipeline worker threads (0 = no pipeline)
+	size_t	block_size;		//< size of source blocks coded by pipeline workers (0 = default)
+	unsigned	queue_depth;	//< number of pipeline reads and writes in flight (0 = synchronous I/O)
+	size_t	iteration_count;	//< number of timed runs of each benchmark phase (0 = default)
+	int		json;			//< write benchmark results as JSON
 } apphuffman_context;
 
 libf2_status_t	apphuffman_initialize_context( apphuffman_context * thisp );
@@ -29,10 +67,23 @@ libf2_status_t	apphuffman_set_context_table_file( apphuffman_context * thisp, co
 libf2_status_t	apphuffman_set_context_input_file( apphuffman_context * thisp, const char * input_file );
 libf2_status_t	apphuffman_set_context_output_file( apphuffman_context * thisp, const char * output_file );
 libf2_status_t	apphuffman_set_context_output_table_mode( apphuffman_context * thisp, format );
+libf2_status_t	apphuffman_set_context_lane_count( apphuffman_context * thisp, size_t lane_count );
+libf2_status_t	apphuffman_set_context_layout( apphuffman_context * thisp, apphuffman_layout_t layout );
+libf2_status_t	apphuffman_set_context_stream_count( apphuffman_context * thisp, size_t stream_count );
+libf2_status_t	apphuffman_set_context_table_count( apphuffman_context * thisp, size_t table_count );
+libf2_status_t	apphuffman_set_context_rle( apphuffman_context * thisp, int rle );
+libf2_status_t	apphuffman_set_context_table_bits( apphuffman_context * thisp, unsigned table_bits );
+libf2_status_t	apphuffman_set_context_worker_count( apphuffman_context * thisp, size_t worker_count );
+libf2_status_t	apphuffman_set_context_block_size( apphuffman_context * thisp, size_t block_size );
+libf2_status_t	apphuffman_set_context_queue_depth( apphuffman_context * thisp, unsigned queue_depth );
+libf2_status_t	apphuffman_set_context_iteration_count( apphuffman_context * thisp, size_t iteration_count );
+libf2_status_t	apphuffman_set_context_json( apphuffman_context * thisp, int json );
 
 libf2_status_t	apphuffman_process_context( apphuffman_context * thisp );
 
-// Helper functions
+// Helper functions; memory variants parse the table in place, file variants map the file
+libf2_status_t	libhuffman_callconv apphuffman_deserialize_encoder_table_memory( libhuffman_encoder_table * table,
+	void * data, size_t data_size, const char * file );
 libf2_status_t	libhuffman_callconv apphuffman_deserialize_encoder_table_file( libhuffman_encoder_table * table,
 	const char * file );
 libf2_status_t	libhuffman_callconv apphuffman_deserialize_encoder_table_stream( libhuffman_encoder_table * table,
@@ -42,10 +93,13 @@ libf2_status_t	libhuffman_callconv apphuffman_deserialize_encoder_table_stream(
 //libf2_status_t	libhuffman_callconv apphuffman_serialize_encoder_table_stream( const libhuffman_encoder_table * table,
 //	libf2_ostream * ostream );
 
+// Decoder table entries refer to the descriptors; free *desc_array_out with free after the table is deinitialized
+libf2_status_t	libhuffman_callconv apphuffman_deserialize_decoder_table_memory( libhuffman_decoder_table * table,
+	void * data, size_t data_size, const char * file, libhuffman_code_desc ** desc_array_out );
 libf2_status_t	libhuffman_callconv apphuffman_deserialize_decoder_table_file( libhuffman_decoder_table * table,
-	const char * file );
+	const char * file, libhuffman_code_desc ** desc_array_out );
 libf2_status_t	libhuffman_callconv apphuffman_deserialize_decoder_table_stream( libhuffman_decoder_table * table,
-	libf2_istream * istream );
+	libf2_istream * istream, libhuffman_code_desc ** desc_array_out );
 //libf2_status_t	libhuffman_callconv apphuffman_serialize_decoder_table_file( const libhuffman_decoder_table * table,
 //	const char * file );
 //libf2_status_t	libhuffman_callconv apphuffman_serialize_decoder_table_stream( const libhuffman_decoder_table * table,
@@ -0,0 +1,439 @@
+/*aio.c*/
+#include "pch.h"
+#include "main.h"
+
+#if defined( __linux__ )
+# include <errno.h>
+# include <linux/io_uring.h>
+# include <sys/syscall.h>
+# include <sys/uio.h>
+#endif // defined( __linux__ )
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Synchronous transfers
+
+/**
+ * @brief Transfer data at the given file offset, or at the current position if offset is (uint64_t) -1.
+ * @internal
+ */
+static libf2_status_t _transfer( int h, uint8_t * data, size_t size, uint64_t offset, int writing )
+{
+	ptrdiff_t	n;
+	size_t		chunk;
+
+	for( ; 0 != size; size -= (size_t) n, data += n ) {
+		chunk = size < 0x40000000 ? size : 0x40000000;
+#if defined( __linux__ )
+		if( (uint64_t) -1 != offset )
+			n = writing ? pwrite( h, data, chunk, (off_t) offset ) : pread( h, data, chunk, (off_t) offset );
+		else
+#else
+		if( (uint64_t) -1 != offset && -1 == _lseeki64( h, (int64_t) offset, SEEK_SET ) )
+			n = -1;
+		else
+#endif // defined( __linux__ )
+			n = writing ? _write( h, data, (unsigned) chunk ) : _read( h, data, (unsigned) chunk );
+		if( n <= 0 )
+			return writing ? LIBF2_STATUS_ERROR_WRITING : LIBF2_STATUS_ERROR_READING;
+		if( (uint64_t) -1 != offset )
+			offset += (uint64_t) n;
+	}
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// io_uring
+
+#if defined( __linux__ ) && defined( __NR_io_uring_setup )
+
+typedef struct _uring {
+	int						fd;
+	unsigned *				sq_head;
+	unsigned *				sq_tail;
+	unsigned *				sq_mask;
+	unsigned *				sq_array;
+	struct io_uring_sqe *	sqes;
+	unsigned *				cq_head;
+	unsigned *				cq_tail;
+	unsigned *				cq_mask;
+	struct io_uring_cqe *	cqes;
+	void *					sq_ring;
+	size_t					sq_ring_size;
+	void *					cq_ring;		//< same as sq_ring with IORING_FEAT_SINGLE_MMAP
+	size_t					cq_ring_size;
+	size_t					sqes_size;
+	unsigned				submit_count;	//< number of queued, not submitted entries
+	struct iovec *			iovecs;			//< registered buffers
+	size_t					iovec_count;
+	struct iovec *			request_iovecs;	//< vectors of non-fixed requests, one per request
+} _uring;
+
+static void _uring_close( _uring * ring )
+{
+	if( nullptr != ring->sqes )
+		(void) munmap( ring->sqes, ring->sqes_size );
+	if( nullptr != ring->cq_ring && ring->cq_ring != ring->sq_ring )
+		(void) munmap( ring->cq_ring, ring->cq_ring_size );
+	if( nullptr != ring->sq_ring )
+		(void) munmap( ring->sq_ring, ring->sq_ring_size );
+	if( -1 != ring->fd )
+		close( ring->fd );
+	free( ring->request_iovecs );
+	free( ring->iovecs );
+	free( ring );
+}
+
+/**
+ * @brief Create the ring and register buffers.
+ * @internal
+ *
+ *	Returns nullptr if io_uring is not available (old kernel, seccomp etc.). Buffers are registered only if the
+ * locked memory limit allows, otherwise all requests use non-fixed buffers.
+ */
+static _uring * _uring_open( unsigned queue_depth, apphuffman_buffer * const * buffers, size_t buffer_count )
+{
+	struct io_uring_params	params;
+	_uring *				ring;
+	uint8_t *				p;
+	size_t					i;
+
+	ring = (_uring *) calloc( 1, sizeof(*ring) );
+	if( nullptr == ring )
+		return nullptr;
+	ring->request_iovecs = (struct iovec *) calloc( queue_depth, sizeof(*ring->request_iovecs) );
+	memset( &params, 0, sizeof(params) );
+	ring->fd = (int) syscall( __NR_io_uring_setup, queue_depth, &params );
+	if( -1 == ring->fd || nullptr == ring->request_iovecs ) {
+		_uring_close( ring );
+		return nullptr;
+	}
+
+	// Map rings
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if( 0 != (params.features & IORING_FEAT_SINGLE_MMAP) && ring->sq_ring_size < ring->cq_ring_size )
+		ring->sq_ring_size = ring->cq_ring_size;
+	p = (uint8_t *) mmap( nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING );
+	if( MAP_FAILED == p ) {
+		_uring_close( ring );
+		return nullptr;
+	}
+	ring->sq_ring = p;
+	ring->sq_head = (unsigned *) (p + params.sq_off.head);
+	ring->sq_tail = (unsigned *) (p + params.sq_off.tail);
+	ring->sq_mask = (unsigned *) (p + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *) (p + params.sq_off.array);
+	if( 0 == (params.features & IORING_FEAT_SINGLE_MMAP) ) {
+		p = (uint8_t *) mmap( nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING );
+		if( MAP_FAILED == p ) {
+			_uring_close( ring );
+			return nullptr;
+		}
+	}
+	ring->cq_ring = p;
+	ring->cq_head = (unsigned *) (p + params.cq_off.head);
+	ring->cq_tail = (unsigned *) (p + params.cq_off.tail);
+	ring->cq_mask = (unsigned *) (p + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *) (p + params.cq_off.cqes);
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = (struct io_uring_sqe *) mmap( nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES );
+	if( MAP_FAILED == (void *) ring->sqes ) {
+		ring->sqes = nullptr;
+		_uring_close( ring );
+		return nullptr;
+	}
+
+	// Register buffers, the kernel pins their pages once instead of on each request
+	if( 0 != buffer_count ) {
+		ring->iovecs = (struct iovec *) calloc( buffer_count, sizeof(*ring->iovecs) );
+		if( nullptr != ring->iovecs ) {
+			for( i = 0; i < buffer_count; ++ i ) {
+				ring->iovecs[i].iov_base = buffers[i]->data;
+				ring->iovecs[i].iov_len = buffers[i]->capacity;
+			}
+			if( 0 == syscall( __NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, ring->iovecs, (unsigned) buffer_count ) )
+				ring->iovec_count = buffer_count;
+		}
+	}
+
+	return ring;
+}
+
+/**
+ * @brief Queue read or write of the request.
+ * @internal
+ *
+ *	Fixed opcodes are used when the request lies in a registered buffer that was not reallocated since registration.
+ */
+static void _uring_queue( _uring * ring, const apphuffman_aio_request * request, size_t request_index )
+{
+	struct io_uring_sqe *	sqe;
+	unsigned				tail, index;
+	size_t					i;
+
+	tail = *ring->sq_tail;
+	index = tail & *ring->sq_mask;
+	sqe = &ring->sqes[index];
+	memset( sqe, 0, sizeof(*sqe) );
+	sqe->fd = request->h;
+	sqe->off = request->offset;
+	sqe->user_data = request_index;
+	for( i = 0; i < ring->iovec_count; ++ i ) {
+		if( ring->iovecs[i].iov_base == request->buffer->data && ring->iovecs[i].iov_len == request->buffer->capacity )
+			break;
+	}
+	if( i < ring->iovec_count ) {
+		sqe->opcode = request->write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+		sqe->addr = (uint64_t) (uintptr_t) request->data;
+		sqe->len = (unsigned) request->size;
+		sqe->buf_index = (uint16_t) i;
+	} else {
+		ring->request_iovecs[request_index].iov_base = request->data;
+		ring->request_iovecs[request_index].iov_len = request->size;
+		sqe->opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+		sqe->addr = (uint64_t) (uintptr_t) &ring->request_iovecs[request_index];
+		sqe->len = 1;
+	}
+	ring->sq_array[index] = index;
+	__atomic_store_n( ring->sq_tail, tail + 1, __ATOMIC_RELEASE );
+	++ ring->submit_count;
+}
+
+/**
+ * @brief Submit queued entries and get the next completion.
+ * @internal
+ * @return 1 if the completion is returned, 0 if there's no completion and wait is 0, -1 on error.
+ */
+static int _uring_reap( _uring * ring, int wait, size_t * request_index, int * result )
+{
+	struct io_uring_cqe *	cqe;
+	unsigned				head;
+	int						n;
+
+	for( ;; ) {
+		head = *ring->cq_head;
+		if( head != __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE ) ) {
+			cqe = &ring->cqes[head & *ring->cq_mask];
+			*request_index = (size_t) cqe->user_data;
+			*result = cqe->res;
+			__atomic_store_n( ring->cq_head, head + 1, __ATOMIC_RELEASE );
+			return 1;
+		}
+		if( !wait && 0 == ring->submit_count )
+			return 0;
+		n = (int) syscall( __NR_io_uring_enter, ring->fd, ring->submit_count, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0 );
+		if( n < 0 ) {
+			if( EINTR == errno || EAGAIN == errno || EBUSY == errno )
+				continue;
+			return -1;
+		}
+		ring->submit_count -= (unsigned) n;
+		if( !wait && head == __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE ) )
+			return 0;
+	}
+}
+
+#endif // defined( __linux__ ) && defined( __NR_io_uring_setup )
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Initialize asynchronous I/O.
+ * @param[out] thisp (apphuffman_aio *) object to initialize.
+ * @param[in] queue_depth (unsigned) maximum number of requests in flight; 0 makes all transfers synchronous.
+ * @param[in] buffers (apphuffman_buffer * const *) buffers to register, may be nullptr.
+ * @param[in] buffer_count (size_t) number of buffers to register.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	On Linux the io_uring ring is used if the kernel allows. Otherwise, and on other platforms, requests are
+ * transferred synchronously by pread/pwrite when submitted and completed in order.
+ */
+libf2_status_t	apphuffman_aio_initialize( apphuffman_aio * thisp, unsigned queue_depth,
+	apphuffman_buffer * const * buffers, size_t buffer_count )
+{
+	unsigned i;
+
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( nullptr == buffers && 0 != buffer_count )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Initialize object
+	memset( thisp, 0, sizeof(*thisp) );
+	thisp->queue_depth = 0 == queue_depth ? 1 : queue_depth;
+	thisp->requests = (apphuffman_aio_request *) calloc( thisp->queue_depth, sizeof(*thisp->requests) );
+	thisp->free_requests = (unsigned *) malloc( thisp->queue_depth * sizeof(*thisp->free_requests) );
+	thisp->completed = (unsigned *) malloc( thisp->queue_depth * sizeof(*thisp->completed) );
+	if( nullptr == thisp->requests || nullptr == thisp->free_requests || nullptr == thisp->completed ) {
+		(void) apphuffman_aio_deinitialize( thisp );
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	}
+	for( i = 0; i < thisp->queue_depth; ++ i )
+		thisp->free_requests[i] = thisp->queue_depth - 1 - i;
+	thisp->free_count = thisp->queue_depth;
+
+#if defined( __linux__ ) && defined( __NR_io_uring_setup )
+	if( 0 != queue_depth )
+		thisp->ring = _uring_open( thisp->queue_depth, buffers, buffer_count );
+#else
+	libf2_unreferenced_parameter( buffers );
+	libf2_unreferenced_parameter( buffer_count );
+#endif // defined( __linux__ ) && defined( __NR_io_uring_setup )
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Deinitialize asynchronous I/O.
+ * @param[in] thisp (apphuffman_aio *) object.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	All requests must be completed.
+ */
+libf2_status_t	apphuffman_aio_deinitialize( apphuffman_aio * thisp )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( 0 != thisp->pending_count )
+		return LIBF2_STATUS_ERROR_INVALID_STATE;
+
+	// Release resources
+#if defined( __linux__ ) && defined( __NR_io_uring_setup )
+	if( nullptr != thisp->ring )
+		_uring_close( (_uring *) thisp->ring );
+#endif // defined( __linux__ ) && defined( __NR_io_uring_setup )
+	free( thisp->completed );
+	free( thisp->free_requests );
+	free( thisp->requests );
+	memset( thisp, 0, sizeof(*thisp) );
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Submit read or write.
+ * @param[in] thisp (apphuffman_aio *) object.
+ * @param[in] h (int) file handle.
+ * @param[in] buffer (apphuffman_buffer *) buffer; size bytes are transferred from or to its data.
+ * @param[in] size (size_t) number of bytes to transfer.
+ * @param[in] offset (uint64_t) file offset; (uint64_t) -1 transfers at the current position, synchronously.
+ * @param[in] writing (int) non-0 to write.
+ * @param[in] tag (void *) non-nullptr value returned on completion.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	The request must not be submitted if apphuffman_aio_is_full returns non-0. Short transfers are resubmitted, so
+ * the completed request has either transferred all data or failed.
+ */
+libf2_status_t	apphuffman_aio_submit( apphuffman_aio * thisp, int h, apphuffman_buffer * buffer, size_t size,
+	uint64_t offset, int writing, void * tag )
+{
+	apphuffman_aio_request *	request;
+	unsigned					request_index;
+
+	// Check current state
+	__debugbreak_if( nullptr == thisp || nullptr == buffer || nullptr == tag )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( size > buffer->capacity )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( 0 == thisp->free_count )
+		return LIBF2_STATUS_ERROR_INVALID_STATE;
+
+	// Fill the request
+	request_index = thisp->free_requests[-- thisp->free_count];
+	request = &thisp->requests[request_index];
+	request->tag = tag;
+	request->buffer = buffer;
+	request->data = buffer->data;
+	request->size = size;
+	request->offset = offset;
+	request->h = h;
+	request->write = writing;
+	request->status = LIBF2_STATUS_SUCCESS;
+	++ thisp->pending_count;
+
+	// Queue the request to the ring, or transfer it right now
+#if defined( __linux__ ) && defined( __NR_io_uring_setup )
+	if( nullptr != thisp->ring && (uint64_t) -1 != offset && 0 != size ) {
+		_uring_queue( (_uring *) thisp->ring, request, request_index );
+		return LIBF2_STATUS_SUCCESS;
+	}
+#endif // defined( __linux__ ) && defined( __NR_io_uring_setup )
+	request->status = _transfer( h, request->data, size, offset, writing );
+	thisp->completed[(thisp->completed_head + thisp->completed_count ++) % thisp->queue_depth] = request_index;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Get the completed request.
+ * @param[in] thisp (apphuffman_aio *) object.
+ * @param[out] tag (void **) variable that receives tag of the completed request, nullptr if none has completed.
+ * @param[in] wait (int) non-0 to wait for completion if some request is pending.
+ * @return (libf2_status_t) status of the completed request.
+ */
+libf2_status_t	apphuffman_aio_complete( apphuffman_aio * thisp, void ** tag, int wait )
+{
+	apphuffman_aio_request *	request;
+	unsigned					request_index;
+
+	// Check current state
+	__debugbreak_if( nullptr == thisp || nullptr == tag )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	*tag = nullptr;
+	if( 0 == thisp->pending_count )
+		return LIBF2_STATUS_SUCCESS;
+
+	// Get completion
+	if( 0 != thisp->completed_count ) {
+		request_index = thisp->completed[thisp->completed_head];
+		thisp->completed_head = (thisp->completed_head + 1) % thisp->queue_depth;
+		-- thisp->completed_count;
+	}
+#if defined( __linux__ ) && defined( __NR_io_uring_setup )
+	else if( nullptr != thisp->ring ) {
+		size_t	index;
+		int		result;
+
+		for( ;; ) {
+			switch( _uring_reap( (_uring *) thisp->ring, wait, &index, &result ) ) {
+			case 0:
+				return LIBF2_STATUS_SUCCESS;
+			case -1:
+				return LIBF2_STATUS_ERROR_INVALID_STATE;
+			}
+			request = &thisp->requests[index];
+			if( result <= 0 ) {
+				request->status = request->write ? LIBF2_STATUS_ERROR_WRITING : LIBF2_STATUS_ERROR_READING;
+				break;
+			}
+			if( (size_t) result == request->size )
+				break;
+
+			// Short transfer, queue the rest
+			request->data += result;
+			request->size -= (size_t) result;
+			request->offset += (uint64_t) result;
+			_uring_queue( (_uring *) thisp->ring, request, index );
+		}
+		request_index = (unsigned) index;
+	}
+#endif // defined( __linux__ ) && defined( __NR_io_uring_setup )
+	else
+		return LIBF2_STATUS_ERROR_INVALID_STATE;
+
+	// Release the request
+	request = &thisp->requests[request_index];
+	*tag = request->tag;
+	thisp->free_requests[thisp->free_count ++] = request_index;
+	-- thisp->pending_count;
+
+	// Exit
+	return request->status;
+}
+
+/*END OF aio.c*/
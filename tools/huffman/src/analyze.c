@@ -0,0 +1,344 @@
+/*analyze.c*/
+#include "pch.h"
+#include "main.h"
+
+#include <math.h>
+
+#define APPHUFFMAN_SYMBOL_COUNT				((size_t) 1 << APPHUFFMAN_VALUE_BIT_SIZE)
+#define APPHUFFMAN_DERIVED_MAX_CODE_LENGTH	15			//< length limit of the derived table, as for multitable tables
+#define APPHUFFMAN_MIN_SPLIT_BLOCK_SIZE		0x10000		//< smaller blocks cost more in directory and hand-off than they gain
+#define APPHUFFMAN_MAX_SPLIT_BLOCK_SIZE		0x1000000	//< larger blocks only delay the first output
+#define APPHUFFMAN_SPLIT_BLOCKS_PER_WORKER	4			//< blocks per worker that keep all workers busy to the end
+
+typedef struct _analysis {
+	apphuffman_context *	app;
+	uint64_t				input_size;
+	size_t					block_size;
+	uint64_t *				histograms;		//< symbol counts, one histogram per worker
+} _analysis;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Statistics
+
+static libf2_status_t _locate_block( apphuffman_pipeline * thisp, size_t index, uint64_t * offset, size_t * size )
+{
+	_analysis * analysis = (_analysis *) thisp->param;
+
+	*offset = (uint64_t) index * analysis->block_size;
+	*size = analysis->input_size - *offset < analysis->block_size ? (size_t) (analysis->input_size - *offset) : analysis->block_size;
+	return LIBF2_STATUS_SUCCESS;
+}
+static libf2_status_t _count_block( apphuffman_pipeline * thisp, size_t worker_index, const apphuffman_buffer * input, apphuffman_buffer * output )
+{
+	uint64_t *	histogram = ((_analysis *) thisp->param)->histograms + worker_index * APPHUFFMAN_SYMBOL_COUNT;
+	size_t		i;
+
+	libf2_unreferenced_parameter( output );
+
+	for( i = 0; i < input->size; ++ i )
+		++ histogram[input->data[i]];
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Count symbols of the input file with the pipeline, each worker fills its own histogram.
+ * @internal
+ */
+static libf2_status_t _count_symbols( _analysis * analysis, uint64_t * histogram )
+{
+	apphuffman_context *	app = analysis->app;
+	apphuffman_pipeline		pipeline;
+	libf2_status_t			status;
+	size_t					worker_count, i, j;
+	int						h;
+
+	// Open input
+	h = _open( app->input_file, _O_RDONLY | _O_BINARY | _O_SEQUENTIAL );
+	if( -1 == h )
+		return LIBF2_STATUS_ERROR_NOT_FOUND;
+	analysis->input_size = (uint64_t) _filelengthi64( h );
+	analysis->block_size = 0 == app->block_size ? APPHUFFMAN_DEFAULT_BLOCK_SIZE : app->block_size;
+	worker_count = 0 == app->worker_count ? apphuffman_get_processor_count() : app->worker_count;
+
+	// Count blocks, nothing is written
+	analysis->histograms = (uint64_t *) calloc( worker_count * APPHUFFMAN_SYMBOL_COUNT, sizeof(*analysis->histograms) );
+	status = nullptr == analysis->histograms ? LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY : LIBF2_STATUS_SUCCESS;
+	if( libf2_succeeded( status ) && 0 != analysis->input_size ) {
+		memset( &pipeline, 0, sizeof(pipeline) );
+		pipeline.locate = _locate_block;
+		pipeline.process = _count_block;
+		pipeline.param = analysis;
+		pipeline.input = h;
+		pipeline.output = -1;
+		pipeline.output_offset = (uint64_t) -1;
+		pipeline.block_count = (size_t) ((analysis->input_size + analysis->block_size - 1) / analysis->block_size);
+		pipeline.block_size = analysis->block_size;
+		pipeline.worker_count = worker_count;
+		pipeline.queue_depth = app->queue_depth;
+		pipeline.job_count = 2 * (worker_count + app->queue_depth) + 2;
+		status = apphuffman_run_pipeline( &pipeline );
+	}
+
+	// Merge histograms
+	for( i = 0; i < APPHUFFMAN_SYMBOL_COUNT; ++ i )
+		histogram[i] = 0;
+	for( j = 0; j < worker_count && libf2_succeeded( status ); ++ j ) {
+		for( i = 0; i < APPHUFFMAN_SYMBOL_COUNT; ++ i )
+			histogram[i] += analysis->histograms[j * APPHUFFMAN_SYMBOL_COUNT + i];
+	}
+	free( analysis->histograms );
+	analysis->histograms = nullptr;
+	_close( h );
+	return status;
+}
+
+/**
+ * @brief Build the optimal table for the histogram: length-limited canonical codes of used symbols.
+ * @internal
+ */
+static libf2_status_t _derive_table( libhuffman_context * context, const uint64_t * histogram,
+	libhuffman_code_desc ** desc_array_out, size_t * desc_count_out )
+{
+	libf2_status_t			status;
+	libhuffman_code_desc *	desc_array;
+	uint8_t					lengths[APPHUFFMAN_SYMBOL_COUNT];
+	libhuffman_code_t		codes[APPHUFFMAN_SYMBOL_COUNT];
+	size_t					i, n;
+
+	status = libhuffman_build_code_lengths( context->allocator, histogram, APPHUFFMAN_SYMBOL_COUNT,
+		APPHUFFMAN_DERIVED_MAX_CODE_LENGTH, lengths );
+	if( libf2_succeeded( status ) )
+		status = libhuffman_build_canonical_codes( lengths, APPHUFFMAN_SYMBOL_COUNT, codes );
+	if( libf2_failed( status ) )
+		return status;
+
+	desc_array = (libhuffman_code_desc *) calloc( APPHUFFMAN_SYMBOL_COUNT, sizeof(*desc_array) );
+	if( nullptr == desc_array )
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	for( n = 0, i = 0; i < APPHUFFMAN_SYMBOL_COUNT; ++ i ) {
+		if( 0 == lengths[i] )
+			continue;
+		desc_array[n].code.bits		= codes[i];
+		desc_array[n].code.length	= lengths[i];
+		desc_array[n].value.bits	= (libhuffman_code_t) i;
+		desc_array[n].value.length	= APPHUFFMAN_VALUE_BIT_SIZE;
+		desc_array[n].count			= 1;
+		++ n;
+	}
+	*desc_array_out = desc_array;
+	*desc_count_out = n;
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Get number of table lookups for each code: depth of the table its data entry is in.
+ * @internal
+ */
+static libf2_status_t _count_lookups( const libhuffman_decoder_layout * layout, size_t desc_count, unsigned * lookups )
+{
+	unsigned *	depths;
+	size_t		i, e, first, last;
+	uint32_t	value;
+
+	depths = (unsigned *) malloc( layout->table_count * sizeof(*depths) );
+	if( nullptr == depths )
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	for( i = 0; i < desc_count; ++ i )
+		lookups[i] = 0;
+
+	// Parents precede subtables, the root refers to itself
+	for( i = 0; i < layout->table_count; ++ i ) {
+		depths[i] = 0 == i ? 1 : depths[layout->tables[i].parent_table] + 1;
+		first = layout->tables[i].first_entry;
+		last = first + ((size_t) 1 << layout->tables[i].l2_table_size);
+		for( e = first; e < last; ++ e ) {
+			value = layout->entry_values[e];
+			if( (uint8_t) btl_et_data == layout->entry_types[e] && value < desc_count && 0 == lookups[value] )
+				lookups[value] = depths[i];
+		}
+	}
+	free( depths );
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Report
+
+/**
+ * @brief Write the report.
+ * @internal
+ */
+static void _report( FILE * f, const _analysis * analysis, const uint64_t * histogram, const char * table_name,
+	const libhuffman_code_desc * desc_array, size_t desc_count, const libhuffman_decoder_layout * layout, const unsigned * lookups )
+{
+	size_t		value_codes[APPHUFFMAN_SYMBOL_COUNT];
+	uint64_t	length_codes[LIBHUFFMAN_MAX_CODE_LENGTH + 1], length_symbols[LIBHUFFMAN_MAX_CODE_LENGTH + 1];
+	uint64_t	total = analysis->input_size, bit_count = 0, lookup_count = 0, missing = 0, block_count;
+	double		entropy = 0, p;
+	size_t		i, k, worker_count, block_size;
+
+	// Codes of single source symbols, the shortest one if there are several
+	for( i = 0; i < APPHUFFMAN_SYMBOL_COUNT; ++ i )
+		value_codes[i] = (size_t) -1;
+	for( i = 0; i <= LIBHUFFMAN_MAX_CODE_LENGTH; ++ i )
+		length_codes[i] = length_symbols[i] = 0;
+	for( k = 0; k < desc_count; ++ k ) {
+		if( desc_array[k].code.length <= LIBHUFFMAN_MAX_CODE_LENGTH )
+			++ length_codes[desc_array[k].code.length];
+		if( 1 != desc_array[k].count || APPHUFFMAN_VALUE_BIT_SIZE != desc_array[k].value.length || nullptr != desc_array[k].escape
+			|| APPHUFFMAN_SYMBOL_COUNT <= desc_array[k].value.bits )
+			continue;
+		i = desc_array[k].value.bits;
+		if( (size_t) -1 == value_codes[i] || desc_array[k].code.length < desc_array[value_codes[i]].code.length )
+			value_codes[i] = k;
+	}
+
+	// Entropy, achieved size and lookups
+	for( i = 0; i < APPHUFFMAN_SYMBOL_COUNT; ++ i ) {
+		if( 0 == histogram[i] )
+			continue;
+		p = (double) histogram[i] / (double) total;
+		entropy -= p * log( p ) / log( 2.0 );
+		if( (size_t) -1 == value_codes[i] ) {
+			missing += histogram[i];
+			continue;
+		}
+		k = value_codes[i];
+		bit_count += histogram[i] * desc_array[k].code.length;
+		lookup_count += histogram[i] * lookups[k];
+		length_symbols[desc_array[k].code.length] += histogram[i];
+	}
+
+	fprintf( f, "File: %s, %llu bytes\n", analysis->app->input_file, (unsigned long long) total );
+	fprintf( f, "Table: %s, %u codes\n", table_name, (unsigned) desc_count );
+	fprintf( f, "\n" );
+	fprintf( f, "Entropy: %.4f bits/symbol (%.0f bytes)\n", entropy, ceil( entropy * (double) total / 8 ) );
+	if( 0 != total && 0 == missing )
+		fprintf( f, "Achieved: %.4f bits/symbol (%llu bytes, %.2f%% over entropy)\n", (double) bit_count / (double) total,
+			(unsigned long long) ((bit_count + 7) / 8), 0 == entropy ? 0 : ((double) bit_count / (double) total / entropy - 1) * 100 );
+	else if( 0 != missing )
+		fprintf( f, "Achieved: not encodable, %llu symbols have no code in the table\n", (unsigned long long) missing );
+	fprintf( f, "Lookups: %.4f per symbol, root width %u bits\n", 0 == total - missing ? 0 : (double) lookup_count / (double) (total - missing),
+		0 == layout->table_count ? 0 : (unsigned) layout->tables[0].l2_table_size );
+	fprintf( f, "Memory: %u tables, %u entries, %u bytes of frozen layout\n", (unsigned) layout->table_count, (unsigned) layout->entry_count,
+		(unsigned) (layout->table_count * sizeof(libhuffman_layout_table) + layout->entry_count * (sizeof(uint32_t) + sizeof(uint8_t))) );
+
+	// Parallel split: enough blocks to keep workers busy, none of them too small
+	worker_count = apphuffman_get_processor_count();
+	if( total < (uint64_t) APPHUFFMAN_MIN_SPLIT_BLOCK_SIZE * APPHUFFMAN_SPLIT_BLOCKS_PER_WORKER * worker_count )
+		worker_count = (size_t) (total / ((uint64_t) APPHUFFMAN_MIN_SPLIT_BLOCK_SIZE * APPHUFFMAN_SPLIT_BLOCKS_PER_WORKER));
+	if( 0 == worker_count )
+		fprintf( f, "Split: input is too small to split, single stream\n" );
+	else {
+		for( block_size = APPHUFFMAN_MIN_SPLIT_BLOCK_SIZE; block_size < APPHUFFMAN_MAX_SPLIT_BLOCK_SIZE
+			&& (uint64_t) block_size * 2 * APPHUFFMAN_SPLIT_BLOCKS_PER_WORKER * worker_count <= total; block_size *= 2 )
+			;
+		block_count = (total + block_size - 1) / block_size;
+		fprintf( f, "Split: --threads %u --blocksize %u (%llu blocks, %llu bytes of stream directory)\n",
+			(unsigned) worker_count, (unsigned) block_size, (unsigned long long) block_count, (unsigned long long) (4 * block_count + 16) );
+	}
+
+	// Code length distribution
+	fprintf( f, "\nLENGTH\tCODES\tSYMBOLS\tSHARE\n" );
+	for( i = 1; i <= LIBHUFFMAN_MAX_CODE_LENGTH; ++ i ) {
+		if( 0 != length_codes[i] )
+			fprintf( f, "%u\t%llu\t%llu\t%.2f%%\n", (unsigned) i, (unsigned long long) length_codes[i],
+				(unsigned long long) length_symbols[i], 0 == total ? 0 : 100 * (double) length_symbols[i] / (double) total );
+	}
+
+	// Histogram
+	fprintf( f, "\nVALUE\tCOUNT\tSHARE\tLENGTH\n" );
+	for( i = 0; i < APPHUFFMAN_SYMBOL_COUNT; ++ i ) {
+		if( 0 == histogram[i] )
+			continue;
+		fprintf( f, "0x%02X\t%llu\t%.2f%%\t", (unsigned) i, (unsigned long long) histogram[i], 100 * (double) histogram[i] / (double) total );
+		if( (size_t) -1 == value_codes[i] )
+			fprintf( f, "-\n" );
+		else
+			fprintf( f, "%u\n", (unsigned) desc_array[value_codes[i]].code.length );
+	}
+}
+
+/**
+ * @brief Analyze input file and report statistics for the table or the optimal one derived from the data.
+ * @param[in] thisp (apphuffman_context *) application context; input_file is analyzed, table_file is optional,
+ * the report goes to output_file (or stdout).
+ * @return (libf2_status_t) operation status code.
+ *
+ *	Symbols are counted by the pipeline, worker_count threads (all processors if 0) while the next blocks are read.
+ * The report holds entropy against achieved bits per symbol, expected lookups per symbol and memory of the decoder
+ * tables built with table_bits root width, the suggested parallel split, code length distribution and histogram.
+ */
+libf2_status_t	apphuffman_analyze( apphuffman_context * thisp )
+{
+	libf2_status_t				status;
+	libhuffman_context			context;
+	_analysis					analysis;
+	uint64_t					histogram[APPHUFFMAN_SYMBOL_COUNT];
+	libhuffman_code_desc *		desc_array = nullptr;
+	size_t						desc_count = 0;
+	libhuffman_decoder_layout	layout;
+	unsigned *					lookups = nullptr;
+	FILE *						f;
+
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( nullptr == thisp->input_file )
+		return LIBF2_STATUS_ERROR_INVALID_STATE;
+
+	// Count symbols
+	memset( &analysis, 0, sizeof(analysis) );
+	analysis.app = thisp;
+	status = _count_symbols( &analysis, histogram );
+	if( libf2_failed( status ) )
+		return status;
+
+	// Get the table and build its layout
+	libhuffman_initialize_context( &context, nullptr );
+	if( nullptr != thisp->table_file )
+		status = apphuffman_load_table_from_file( &desc_array, &desc_count, thisp->table_file );
+	else if( 0 != analysis.input_size )
+		status = _derive_table( &context, histogram, &desc_array, &desc_count );
+	if( libf2_failed( status ) )
+		return status;
+	memset( &layout, 0, sizeof(layout) );
+	if( 0 != desc_count ) {
+		status = libhuffman_decoder_layout_build( &context, thisp->table_bits, desc_array, desc_count, &layout );
+		if( LIBF2_STATUS_ERROR_INVALID_DATA == status )
+			fprintf( stderr, "%s: error: codes of the table are not prefix-free\n", thisp->table_file );
+		if( libf2_succeeded( status ) ) {
+			lookups = (unsigned *) malloc( desc_count * sizeof(*lookups) );
+			status = nullptr == lookups ? LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY : _count_lookups( &layout, desc_count, lookups );
+			if( libf2_failed( status ) )
+				(void) libhuffman_decoder_layout_release( &context, &layout );
+		}
+		if( libf2_failed( status ) ) {
+			free( lookups );
+			free( desc_array );
+			return status;
+		}
+	}
+
+	// Write report
+	f = nullptr == thisp->output_file || apphuffman_is_stdio_name( thisp->output_file ) ? stdout : fopen( thisp->output_file, "w" );
+	if( nullptr == f )
+		status = LIBF2_STATUS_ERROR_NOT_FOUND;
+	else {
+		_report( f, &analysis, histogram, nullptr != thisp->table_file ? thisp->table_file : "derived from the data",
+			desc_array, desc_count, &layout, lookups );
+		if( ferror( f ) )
+			status = LIBF2_STATUS_ERROR_WRITING;
+		if( stdout != f && 0 != fclose( f ) )
+			status = LIBF2_STATUS_ERROR_WRITING;
+	}
+
+	// Exit
+	if( 0 != desc_count )
+		(void) libhuffman_decoder_layout_release( &context, &layout );
+	free( lookups );
+	free( desc_array );
+	return status;
+}
+
+/*END OF analyze.c*/
@@ -86,6 +86,247 @@ libf2_status_t	apphuffman_set_context_output_file( apphuffman_context * thisp, c
 	return LIBF2_STATUS_SUCCESS;
 }
 
+libf2_status_t	apphuffman_set_context_lane_count( apphuffman_context * thisp, size_t lane_count )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set lane count
+	thisp->lane_count = lane_count;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+libf2_status_t	apphuffman_set_context_layout( apphuffman_context * thisp, apphuffman_layout_t layout )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( APPHUFFMAN_L_INVALID <= (unsigned) layout )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set layout
+	thisp->layout = layout;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+libf2_status_t	apphuffman_set_context_stream_count( apphuffman_context * thisp, size_t stream_count )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set stream count
+	thisp->stream_count = stream_count;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+libf2_status_t	apphuffman_set_context_table_count( apphuffman_context * thisp, size_t table_count )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( LIBHUFFMAN_MAX_TABLE_COUNT < table_count )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set table count
+	thisp->table_count = table_count;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+libf2_status_t	apphuffman_set_context_rle( apphuffman_context * thisp, int rle )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set mode
+	thisp->rle = rle;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+libf2_status_t	apphuffman_set_context_table_bits( apphuffman_context * thisp, unsigned table_bits )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( LIBHUFFMAN_MAX_LAYOUT_L2_TABLE_SIZE < table_bits )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set table size limit
+	thisp->table_bits = table_bits;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+libf2_status_t	apphuffman_set_context_worker_count( apphuffman_context * thisp, size_t worker_count )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set worker count
+	thisp->worker_count = worker_count;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+libf2_status_t	apphuffman_set_context_block_size( apphuffman_context * thisp, size_t block_size )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( (uint32_t) -1 < block_size )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set block size
+	thisp->block_size = block_size;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+libf2_status_t	apphuffman_set_context_queue_depth( apphuffman_context * thisp, unsigned queue_depth )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( APPHUFFMAN_MAX_QUEUE_DEPTH < queue_depth )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set queue depth
+	thisp->queue_depth = queue_depth;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+libf2_status_t	apphuffman_set_context_iteration_count( apphuffman_context * thisp, size_t iteration_count )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set iteration count
+	thisp->iteration_count = iteration_count;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+libf2_status_t	apphuffman_set_context_json( apphuffman_context * thisp, int json )
+{
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Set output format
+	thisp->json = json;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static libf2_status_t _write_uint32( libf2_ostream * ostream, uint32_t value )
+{
+	uint8_t	buf[4];
+	size_t	nwritten;
+
+	buf[0] = (uint8_t) (value);
+	buf[1] = (uint8_t) (value >> 8);
+	buf[2] = (uint8_t) (value >> 16);
+	buf[3] = (uint8_t) (value >> 24);
+	return ostream->write( ostream, buf, sizeof(buf), &nwritten );
+}
+
+/**
+ * @brief Write the block table after the stream split in lanes.
+ * @internal
+ *
+ *	The table is framed by signatures and its length precedes the last one, so the reader finds it at the end
+ * of the file.
+ */
+static libf2_status_t _write_block_table( libf2_ostream * ostream, const libhuffman_stream * stream )
+{
+	libf2_status_t	status;
+	size_t			size = 0;
+
+	status = _write_uint32( ostream, APPHUFFMAN_BLOCK_TABLE_SIGNATURE );
+	if( libf2_succeeded( status ) )
+		status = apphuffman_write_block_table( ostream, stream, &size );
+	if( libf2_succeeded( status ) )
+		status = _write_uint32( ostream, (uint32_t) (size + 12) );
+	if( libf2_succeeded( status ) )
+		status = _write_uint32( ostream, APPHUFFMAN_BLOCK_TABLE_SIGNATURE );
+	return status;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Encode data as runs of equal values.
+ * @internal
+ *
+ *	Value size is the shortest power of two that holds the shortest run value of the table, so "N : 0" lines of
+ * a fax table give 1-bit values.
+ */
+static libf2_status_t _encode_runs( apphuffman_context * thisp, libhuffman_context * context,
+	void * table_data, size_t table_data_size, libf2_istream * istream, libf2_ostream * ostream )
+{
+	libf2_status_t				status;
+	libhuffman_code_desc *		desc_array;
+	size_t						desc_count, i;
+	unsigned					value_bit_size = 16;
+	libhuffman_run_table		run_table;
+	libhuffman_encoder_table	root_table;
+	libhuffman_encode_context	encode_context;
+
+	// Load table
+	status = apphuffman_load_table_from_memory( &desc_array, &desc_count, table_data, table_data_size, thisp->table_file );
+	if( libf2_failed( status ) )
+		return status;
+	for( i = 0; i < desc_count; ++ i ) {
+		if( (unsigned) -1 != desc_array[i].count && desc_array[i].value.length < value_bit_size )
+			value_bit_size = 0 == desc_array[i].value.length ? 1 : desc_array[i].value.length;
+	}
+	while( 0 != (value_bit_size & (value_bit_size - 1)) )
+		++ value_bit_size;
+
+	// Encode
+	status = libhuffman_run_table_initialize( &run_table, context, value_bit_size, desc_array, desc_count );
+	__debugbreak_ifnot( libf2_succeeded( status ) ) {
+		status = libhuffman_initialize_encoder_table( &root_table, context, 0 );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			status = libhuffman_initialize_encode_context( &encode_context, context, &root_table, istream, ostream );
+			__debugbreak_ifnot( libf2_succeeded( status ) ) {
+				encode_context.value_bit_size = value_bit_size;
+				status = libhuffman_set_encode_context_run_table( &encode_context, &run_table );
+				if( libf2_succeeded( status ) )
+					status = libhuffman_encode( &encode_context );
+				(void) libhuffman_deinitialize_encode_context( &encode_context );
+			}
+			(void) libhuffman_deinitialize_encoder_table( &root_table );
+		}
+		(void) libhuffman_run_table_deinitialize( &run_table );
+	}
+
+	// Exit
+	free( desc_array );
+	return status;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 libf2_status_t	apphuffman_process_context( apphuffman_context * thisp )
@@ -93,7 +334,6 @@ libf2_status_t	apphuffman_process_context( apphuffman_context * thisp )
 	libf2_status_t				status;
 	libhuffman_context			context;
 	libf2_static_memory_istream	istream;
-	libf2_static_memory_istream	table_istream;
 	void *	data;
 	size_t	data_size;
 	void *	table_data;
@@ -104,19 +344,50 @@ libf2_status_t	apphuffman_process_context( apphuffman_context * thisp )
 	__debugbreak_if( nullptr == thisp )
 		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
 
-	// Load files
-	apphuffman_load_file( thisp->input_file, &data, &data_size );
-	apphuffman_load_file( thisp->table_file, &table_data, &table_data_size );
+	// Compile table, there's no input data
+	if( thisp->mode == APPHUFFMAN_M_COMPILE ) {
+		libhuffman_initialize_context( &context, nullptr );
+		return apphuffman_compile_table( thisp, &context );
+	}
+
+	// Analyze, nothing is coded
+	if( thisp->mode == APPHUFFMAN_M_ANALYZE )
+		return apphuffman_analyze( thisp );
+
+	// Time table build and coding
+	if( thisp->mode == APPHUFFMAN_M_BENCH )
+		return apphuffman_bench( thisp );
+
+	// Block tables are stored only in raw and multitable output, run-length coding doesn't split streams
+	if( 1 < thisp->lane_count && APPHUFFMAN_M_ENCODE == thisp->mode && (thisp->rle || apphuffman_is_stdio_name( thisp->input_file ) ||
+		apphuffman_is_stdio_name( thisp->output_file ) || (0 != thisp->worker_count && !thisp->rle && 0 == thisp->table_count)) )
+		return LIBF2_STATUS_ERROR_NOT_SUPPORTED;
+
+	// Stream standard input or output in frames, nothing is loaded as a whole
+	if( apphuffman_is_stdio_name( thisp->input_file ) || apphuffman_is_stdio_name( thisp->output_file ) )
+		return apphuffman_process_framed( thisp );
+
+	// Overlap reading, coding and writing of blocks
+	if( 0 != thisp->worker_count && !thisp->rle && 0 == thisp->table_count )
+		return apphuffman_process_pipeline( thisp );
+
+	// Map files, input data are decoded and the table is parsed right from the mapping
+	status = apphuffman_map_file( thisp->input_file, &data, &data_size );
+	if( libf2_failed( status ) )
+		return status;
+	status = apphuffman_map_file( thisp->table_file, &table_data, &table_data_size );
+	if( libf2_failed( status ) ) {
+		apphuffman_unmap_file( data, data_size );
+		return status;
+	}
 
 	// Initialize libhuffman data
 	libhuffman_initialize_context( &context, nullptr );
 
 	status = libf2_static_buffer_istream_initialize( &istream, data, data_size );
-	__debugbreak_if( libf2_failed( status ) )
-		return status;
-	status = libf2_static_buffer_istream_initialize( &table_istream, table_data, table_data_size );
 	__debugbreak_if( libf2_failed( status ) ) {
-		(void) libf2_static_buffer_istream_deinitialize( &istream );
+		apphuffman_unmap_file( table_data, table_data_size );
+		apphuffman_unmap_file( data, data_size );
 		return status;
 	}
 
@@ -124,10 +395,15 @@ libf2_status_t	apphuffman_process_context( apphuffman_context * thisp )
 	if( thisp->mode == APPHUFFMAN_M_DECODE ) {
 		libhuffman_decoder_table	root_table;
 		libhuffman_decode_context	decode_context;
+		libhuffman_code_desc *		desc_array = nullptr;
 
 		status = libhuffman_initialize_decoder_table( &root_table, &context, nullptr );
 		__debugbreak_ifnot( libf2_succeeded( status ) ) {
-			status = apphuffman_deserialize_decoder_table_stream( &root_table, &table_istream.istream );
+			root_table.layout_memory = nullptr;
+			if( apphuffman_is_binary_table( table_data, table_data_size ) )
+				status = apphuffman_deserialize_decoder_table_bin( &root_table, &context, table_data, table_data_size, &desc_array );
+			else
+				status = apphuffman_deserialize_decoder_table_memory( &root_table, table_data, table_data_size, thisp->table_file, &desc_array );
 			__debugbreak_ifnot( libf2_succeeded( status ) ) {
 				status = libhuffman_initialize_decode_context( &decode_context, &context, &root_table, &istream.istream, &ostream );
 				__debugbreak_ifnot( libf2_succeeded( status ) ) {
@@ -135,19 +411,41 @@ libf2_status_t	apphuffman_process_context( apphuffman_context * thisp )
 					(void) libhuffman_deinitialize_decode_context( &decode_context );
 				}
 			}
+			if( nullptr != root_table.layout_memory )
+				(void) libhuffman_decoder_table_detach_layout( &root_table );
 			(void) libhuffman_deinitialize_decoder_table( &root_table );
+			free( desc_array );
 		}
+	} else if( thisp->mode == APPHUFFMAN_M_ENCODE && thisp->rle ) {
+		status = _encode_runs( thisp, &context, table_data, table_data_size, &istream.istream, &ostream );
+	} else if( thisp->mode == APPHUFFMAN_M_ENCODE && 0 != thisp->table_count ) {
+		status = apphuffman_encode_multitable( thisp, &context, data, data_size, &ostream );
 	} else if( thisp->mode == APPHUFFMAN_M_ENCODE ) {
 		libhuffman_encoder_table	root_table;
 		libhuffman_encode_context	encode_context;
+		libhuffman_binary			binary;
 
 		status = libhuffman_initialize_encoder_table( &root_table, &context, 0 );
 		__debugbreak_ifnot( libf2_succeeded( status ) ) {
-			status = apphuffman_deserialize_encoder_table_stream( &root_table, &table_istream.istream );
+			status = apphuffman_deserialize_encoder_table_memory( &root_table, table_data, table_data_size, thisp->table_file );
 			__debugbreak_ifnot( libf2_succeeded( status ) ) {
 				status = libhuffman_initialize_encode_context( &encode_context, &context, &root_table, &istream.istream, &ostream );
 				__debugbreak_ifnot( libf2_succeeded( status ) ) {
-					status = libhuffman_encode( &encode_context );
+					status = libhuffman_binary_initialize( &binary, &context, nullptr, 1 );
+					__debugbreak_ifnot( libf2_succeeded( status ) ) {
+						binary.streams[0].binary = &binary;
+						if( 1 < thisp->lane_count ) {
+							status = libhuffman_set_encode_context_lanes( &encode_context, &binary.streams[0], thisp->lane_count );
+							if( libf2_succeeded( status ) && APPHUFFMAN_L_INTERLEAVED == thisp->layout )
+								status = libhuffman_stream_set_flags( &binary.streams[0], LIBHUFFMAN_STREAM_F_INTERLEAVED );
+						}
+						if( libf2_succeeded( status ) )
+							status = libhuffman_encode( &encode_context );
+						if( libf2_succeeded( status ) && 0 != binary.streams[0].block_count )
+							status = _write_block_table( &ostream, &binary.streams[0] );
+						(void) libhuffman_stream_set_block_count( &binary.streams[0], 0 );
+						(void) libhuffman_binary_deinitialize( &binary );
+					}
 					(void) libhuffman_deinitialize_encode_context( &encode_context );
 				}
 			}
@@ -157,8 +455,9 @@ libf2_status_t	apphuffman_process_context( apphuffman_context * thisp )
 		status = LIBF2_STATUS_ERROR_INVALID_STATE;
 
 	// Done
-	(void) libf2_static_buffer_istream_deinitialize( &table_istream );
 	(void) libf2_static_buffer_istream_deinitialize( &istream );
+	apphuffman_unmap_file( table_data, table_data_size );
+	apphuffman_unmap_file( data, data_size );
 
 	// Exit
 	return status;
@@ -0,0 +1,407 @@
+/*bench.c*/
+#include "pch.h"
+#include "main.h"
+
+#if defined( _WIN32 )
+# include <windows.h>
+# include <intrin.h>
+#else
+# include <time.h>
+# if defined( __i386__ ) || defined( __x86_64__ )
+#  include <x86intrin.h>
+# endif // defined( __i386__ ) || defined( __x86_64__ )
+#endif // defined( _WIN32 )
+
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __i386__ ) || defined( __x86_64__ )
+# define APPHUFFMAN_BENCH_TSC		1		//< cycles are read from the time stamp counter
+#endif // defined( _M_IX86 ) || defined( _M_X64 ) || defined( __i386__ ) || defined( __x86_64__ )
+#define APPHUFFMAN_BENCH_MIN_TIME	1e-9	//< runs are never shorter than the timer resolution, so rates stay finite
+
+//! Best run of a benchmark phase
+typedef struct _bench_result {
+	double		seconds;
+	uint64_t	cycles;			//< time stamp counter ticks, 0 if there's no counter
+} _bench_result;
+
+//! Source segment coded by one thread
+typedef struct _bench_segment {
+	apphuffman_buffer	encoded;
+	apphuffman_buffer	decoded;
+	libf2_status_t		status;
+} _bench_segment;
+
+typedef struct _bench {
+	libhuffman_context *		context;
+	libhuffman_encoder_table *	encoder_table;	//< shared by threads, read only
+	libhuffman_decoder_table *	decoder_table;	//< shared by threads, read only
+	const uint8_t *				data;
+	size_t						data_size;
+	size_t						segment_size;
+	_bench_segment *			segments;
+	int							decoding;		//< non-0 to decode segments, encode them otherwise
+} _bench;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Timing
+
+static double _get_time( void )
+{
+#if defined( _WIN32 )
+	LARGE_INTEGER	counter, frequency;
+
+	(void) QueryPerformanceCounter( &counter );
+	(void) QueryPerformanceFrequency( &frequency );
+	return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+	struct timespec	ts;
+
+	(void) clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif // defined( _WIN32 )
+}
+static uint64_t _get_cycles( void )
+{
+#if defined( APPHUFFMAN_BENCH_TSC )
+	return (uint64_t) __rdtsc();
+#else
+	return 0;
+#endif // defined( APPHUFFMAN_BENCH_TSC )
+}
+
+/**
+ * @brief Time building of encoder and decoder tables from code descriptors.
+ * @internal
+ */
+static libf2_status_t _time_build( libhuffman_context * context, const libhuffman_code_desc * desc_array, size_t desc_count,
+	size_t iteration_count, _bench_result * result )
+{
+	libf2_status_t				status = LIBF2_STATUS_SUCCESS;
+	libhuffman_encoder_table	encoder_table;
+	libhuffman_decoder_table	decoder_table;
+	double						seconds;
+	uint64_t					cycles;
+	size_t						i;
+
+	for( i = 0; i < iteration_count && libf2_succeeded( status ); ++ i ) {
+		seconds = _get_time();
+		cycles = _get_cycles();
+		status = libhuffman_initialize_encoder_table( &encoder_table, context, 0 );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			status = libhuffman_encoder_table_append_codes( &encoder_table, desc_array, desc_count );
+			(void) libhuffman_deinitialize_encoder_table( &encoder_table );
+		}
+		if( libf2_succeeded( status ) )
+			status = libhuffman_initialize_decoder_table( &decoder_table, context, nullptr );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			status = libhuffman_decoder_table_append_codes( &decoder_table, desc_array, desc_count );
+			(void) libhuffman_deinitialize_decoder_table( &decoder_table );
+		}
+		cycles = _get_cycles() - cycles;
+		seconds = _get_time() - seconds;
+		if( seconds < APPHUFFMAN_BENCH_MIN_TIME )
+			seconds = APPHUFFMAN_BENCH_MIN_TIME;
+		if( 0 == i || seconds < result->seconds ) {
+			result->seconds = seconds;
+			result->cycles = cycles;
+		}
+	}
+	return status;
+}
+
+/**
+ * @brief Thread procedure: encode or decode one segment with the shared tables.
+ * @internal
+ */
+static void _code_segment( void * param, size_t index )
+{
+	_bench *					bench = (_bench *) param;
+	_bench_segment *			segment = &bench->segments[index];
+	libf2_status_t				status;
+	libf2_static_memory_istream	istream;
+	apphuffman_buffer_ostream	ostream;
+	libhuffman_encode_context	encode_context;
+	libhuffman_decode_context	decode_context;
+	size_t						offset, size;
+
+	offset = index * bench->segment_size;
+	size = offset >= bench->data_size ? 0 : bench->data_size - offset < bench->segment_size ? bench->data_size - offset : bench->segment_size;
+
+	if( bench->decoding ) {
+		segment->decoded.size = 0;
+		apphuffman_buffer_ostream_initialize( &ostream, &segment->decoded );
+		status = libf2_static_buffer_istream_initialize( &istream, segment->encoded.data, segment->encoded.size );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			status = libhuffman_initialize_decode_context( &decode_context, bench->context, bench->decoder_table, &istream.istream, &ostream.ostream );
+			__debugbreak_ifnot( libf2_succeeded( status ) ) {
+				status = libhuffman_decode( &decode_context );
+				(void) libhuffman_deinitialize_decode_context( &decode_context );
+			}
+			(void) libf2_static_buffer_istream_deinitialize( &istream );
+		}
+	} else {
+		segment->encoded.size = 0;
+		apphuffman_buffer_ostream_initialize( &ostream, &segment->encoded );
+		status = libf2_static_buffer_istream_initialize( &istream, bench->data + offset, size );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			status = libhuffman_initialize_encode_context( &encode_context, bench->context, bench->encoder_table, &istream.istream, &ostream.ostream );
+			__debugbreak_ifnot( libf2_succeeded( status ) ) {
+				encode_context.value_bit_size = APPHUFFMAN_VALUE_BIT_SIZE;
+				status = libhuffman_encode( &encode_context );
+				(void) libhuffman_deinitialize_encode_context( &encode_context );
+			}
+			(void) libf2_static_buffer_istream_deinitialize( &istream );
+		}
+	}
+	segment->status = status;
+}
+
+/**
+ * @brief Time coding of all segments by thread_count threads.
+ * @internal
+ *
+ *	Thread start is timed too; it's negligible next to coding of inputs large enough to be measured.
+ */
+static libf2_status_t _time_coding( _bench * bench, size_t thread_count, size_t iteration_count, _bench_result * result )
+{
+	libf2_status_t	status = LIBF2_STATUS_SUCCESS;
+	double			seconds;
+	uint64_t		cycles;
+	size_t			i, j;
+
+	for( i = 0; i < iteration_count && libf2_succeeded( status ); ++ i ) {
+		seconds = _get_time();
+		cycles = _get_cycles();
+		status = apphuffman_run_threads( thread_count, _code_segment, bench );
+		cycles = _get_cycles() - cycles;
+		seconds = _get_time() - seconds;
+		if( seconds < APPHUFFMAN_BENCH_MIN_TIME )
+			seconds = APPHUFFMAN_BENCH_MIN_TIME;
+		for( j = 0; j < thread_count && libf2_succeeded( status ); ++ j )
+			status = bench->segments[j].status;
+		if( 0 == i || seconds < result->seconds ) {
+			result->seconds = seconds;
+			result->cycles = cycles;
+		}
+	}
+	return status;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Report
+
+static void _write_json_string( FILE * f, const char * s )
+{
+	fputc( '"', f );
+	for( ; '\0' != *s; ++ s ) {
+		if( '"' == *s || '\\' == *s )
+			fprintf( f, "\\%c", *s );
+		else if( (unsigned char) *s < 0x20 )
+			fprintf( f, "\\u%04X", (unsigned) (unsigned char) *s );
+		else
+			fputc( *s, f );
+	}
+	fputc( '"', f );
+}
+
+/**
+ * @brief Write results of the coding phase for 1..thread_count threads.
+ * @internal
+ *
+ *	Cycles per symbol are summed over threads; efficiency is throughput relative to thread_count single threads.
+ */
+static void _report_phase( FILE * f, int json, const char * name, const _bench_result * results, size_t thread_count, size_t symbol_count )
+{
+	double	rate, base_rate;
+	size_t	t;
+
+	if( json )
+		fprintf( f, ",\n\t\"%s\": [", name );
+	base_rate = (double) symbol_count / results[0].seconds;
+	for( t = 1; t <= thread_count; ++ t ) {
+		rate = (double) symbol_count / results[t - 1].seconds;
+		if( json ) {
+			fprintf( f, "%s\n\t\t{ \"threads\": %u, \"seconds\": %.9f, \"mb_per_s\": %.3f, \"symbols_per_s\": %.0f, \"cycles_per_symbol\": ",
+				1 == t ? "" : ",", (unsigned) t, results[t - 1].seconds, rate * (APPHUFFMAN_VALUE_BIT_SIZE / 8) / 1e6, rate );
+			if( 0 == results[t - 1].cycles )
+				fprintf( f, "null" );
+			else
+				fprintf( f, "%.3f", (double) results[t - 1].cycles * t / (double) symbol_count );
+			fprintf( f, ", \"efficiency\": %.4f }", rate / (base_rate * t) );
+		} else {
+			fprintf( f, "%s\t%u\t%.1f\t%.0f\t", name, (unsigned) t, rate * (APPHUFFMAN_VALUE_BIT_SIZE / 8) / 1e6, rate );
+			if( 0 == results[t - 1].cycles )
+				fprintf( f, "-" );
+			else
+				fprintf( f, "%.2f", (double) results[t - 1].cycles * t / (double) symbol_count );
+			fprintf( f, "\t%.1f%%\n", 100 * rate / (base_rate * t) );
+		}
+	}
+	if( json )
+		fprintf( f, "\n\t]" );
+}
+
+static void _report( FILE * f, const apphuffman_context * thisp, size_t desc_count, size_t iteration_count, size_t symbol_count,
+	const _bench_result * build, const _bench_result * encode, const _bench_result * decode, size_t thread_count )
+{
+	if( thisp->json ) {
+		fprintf( f, "{\n\t\"file\": " );
+		_write_json_string( f, thisp->input_file );
+		fprintf( f, ",\n\t\"symbols\": %llu,\n\t\"table\": ", (unsigned long long) symbol_count );
+		_write_json_string( f, thisp->table_file );
+		fprintf( f, ",\n\t\"codes\": %u,\n\t\"iterations\": %u", (unsigned) desc_count, (unsigned) iteration_count );
+		fprintf( f, ",\n\t\"build\": { \"seconds\": %.9f, \"cycles\": ", build->seconds );
+		if( 0 == build->cycles )
+			fprintf( f, "null }" );
+		else
+			fprintf( f, "%llu }", (unsigned long long) build->cycles );
+	} else {
+		fprintf( f, "File: %s, %llu symbols\n", thisp->input_file, (unsigned long long) symbol_count );
+		fprintf( f, "Table: %s, %u codes\n", thisp->table_file, (unsigned) desc_count );
+		fprintf( f, "Iterations: %u, best run of each is reported\n", (unsigned) iteration_count );
+		fprintf( f, "Build: %.3f ms", build->seconds * 1e3 );
+		if( 0 != build->cycles )
+			fprintf( f, ", %llu cycles", (unsigned long long) build->cycles );
+		fprintf( f, "\n\nPHASE\tTHREADS\tMB/S\tSYMBOLS/S\tCYCLES/SYMBOL\tEFFICIENCY\n" );
+	}
+	_report_phase( f, thisp->json, "encode", encode, thread_count, symbol_count );
+	_report_phase( f, thisp->json, "decode", decode, thread_count, symbol_count );
+	if( thisp->json )
+		fprintf( f, "\n}\n" );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Time table build, encoding and decoding of the input file with 1..N threads.
+ * @param[in] thisp (apphuffman_context *) application context; input_file is coded with table_file, N is worker_count
+ * (all processors if 0), each phase is run iteration_count times; the report goes to output_file (or stdout), as JSON
+ * if json is set.
+ * @return (libf2_status_t) operation status code; LIBF2_STATUS_ERROR_INVALID_DATA if decoded data differ from the source.
+ *
+ *	The table and the input are loaded once. With T threads the input is split in T segments, each thread encodes
+ * its segment, then decodes what it has encoded, all threads share the tables. Every phase reports its best run, so
+ * results of repeated runs on the same machine can be compared between builds of libhuffman.
+ */
+libf2_status_t	apphuffman_bench( apphuffman_context * thisp )
+{
+	libf2_status_t				status;
+	libhuffman_context			context;
+	libhuffman_encoder_table	encoder_table;
+	libhuffman_decoder_table	decoder_table;
+	libhuffman_code_desc *		desc_array;
+	size_t						desc_count;
+	void *						data;
+	size_t						data_size;
+	_bench						bench;
+	_bench_result				build;
+	_bench_result *				results;
+	size_t						thread_count, iteration_count, t, i, offset;
+	FILE *						f;
+
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( nullptr == thisp->input_file || nullptr == thisp->table_file )
+		return LIBF2_STATUS_ERROR_INVALID_STATE;
+	thread_count = 0 == thisp->worker_count ? apphuffman_get_processor_count() : thisp->worker_count;
+	iteration_count = 0 == thisp->iteration_count ? APPHUFFMAN_DEFAULT_ITERATION_COUNT : thisp->iteration_count;
+
+	// Load input and table once
+	status = apphuffman_map_file( thisp->input_file, &data, &data_size );
+	if( libf2_failed( status ) )
+		return status;
+	if( 0 == data_size ) {
+		fprintf( stderr, "%s: error: input is empty, nothing to measure\n", thisp->input_file );
+		apphuffman_unmap_file( data, data_size );
+		return LIBF2_STATUS_ERROR_INVALID_DATA;
+	}
+	status = apphuffman_load_table_from_file( &desc_array, &desc_count, thisp->table_file );
+	if( libf2_failed( status ) ) {
+		apphuffman_unmap_file( data, data_size );
+		return status;
+	}
+
+	// Set up segments of the largest split and results of 1..thread_count threads for both coding phases
+	libhuffman_initialize_context( &context, nullptr );
+	memset( &bench, 0, sizeof(bench) );
+	bench.context = &context;
+	bench.encoder_table = &encoder_table;
+	bench.decoder_table = &decoder_table;
+	bench.data = (const uint8_t *) data;
+	bench.data_size = data_size;
+	bench.segments = (_bench_segment *) calloc( thread_count, sizeof(*bench.segments) );
+	results = (_bench_result *) calloc( 2 * thread_count, sizeof(*results) );
+	status = nullptr == bench.segments || nullptr == results ? LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY : LIBF2_STATUS_SUCCESS;
+
+	// Time table build, then build the tables used for coding
+	memset( &build, 0, sizeof(build) );
+	if( libf2_succeeded( status ) )
+		status = _time_build( &context, desc_array, desc_count, iteration_count, &build );
+	if( libf2_succeeded( status ) ) {
+		status = libhuffman_initialize_encoder_table( &encoder_table, &context, 0 );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			status = libhuffman_encoder_table_append_codes( &encoder_table, desc_array, desc_count );
+			if( libf2_succeeded( status ) ) {
+				status = libhuffman_initialize_decoder_table( &decoder_table, &context, nullptr );
+				__debugbreak_ifnot( libf2_succeeded( status ) ) {
+					status = libhuffman_decoder_table_append_codes( &decoder_table, desc_array, desc_count );
+
+					// Time coding with 1..thread_count threads, check the round trip
+					for( t = 1; t <= thread_count && libf2_succeeded( status ); ++ t ) {
+						bench.segment_size = (data_size + t - 1) / t;
+						for( i = 0; i < t && libf2_succeeded( status ); ++ i )
+							status = apphuffman_buffer_reserve( &bench.segments[i].decoded, bench.segment_size );
+						bench.decoding = 0;
+						if( libf2_succeeded( status ) )
+							status = _time_coding( &bench, t, iteration_count, &results[t - 1] );
+						bench.decoding = 1;
+						if( libf2_succeeded( status ) )
+							status = _time_coding( &bench, t, iteration_count, &results[thread_count + t - 1] );
+						for( offset = 0, i = 0; i < t && libf2_succeeded( status ); offset += bench.segments[i ++].decoded.size ) {
+							if( bench.segments[i].decoded.size > data_size - offset
+								|| 0 != memcmp( bench.segments[i].decoded.data, bench.data + offset, bench.segments[i].decoded.size ) )
+								status = LIBF2_STATUS_ERROR_INVALID_DATA;
+						}
+						if( libf2_succeeded( status ) && offset != data_size )
+							status = LIBF2_STATUS_ERROR_INVALID_DATA;
+						if( LIBF2_STATUS_ERROR_INVALID_DATA == status )
+							fprintf( stderr, "%s: error: decoded data differ from the source\n", thisp->input_file );
+					}
+					(void) libhuffman_deinitialize_decoder_table( &decoder_table );
+				}
+			}
+			(void) libhuffman_deinitialize_encoder_table( &encoder_table );
+		}
+	}
+
+	// Write report
+	if( libf2_succeeded( status ) ) {
+		f = nullptr == thisp->output_file || apphuffman_is_stdio_name( thisp->output_file ) ? stdout : fopen( thisp->output_file, "w" );
+		if( nullptr == f )
+			status = LIBF2_STATUS_ERROR_NOT_FOUND;
+		else {
+			_report( f, thisp, desc_count, iteration_count, data_size, &build, results, results + thread_count, thread_count );
+			if( ferror( f ) )
+				status = LIBF2_STATUS_ERROR_WRITING;
+			if( stdout != f && 0 != fclose( f ) )
+				status = LIBF2_STATUS_ERROR_WRITING;
+		}
+	}
+
+	// Clean up
+	if( nullptr != bench.segments ) {
+		for( i = 0; i < thread_count; ++ i ) {
+			free( bench.segments[i].encoded.data );
+			free( bench.segments[i].decoded.data );
+		}
+		free( bench.segments );
+	}
+	free( results );
+	free( desc_array );
+	apphuffman_unmap_file( data, data_size );
+
+	// Exit
+	return status;
+}
+
+/*END OF bench.c*/
@@ -0,0 +1,397 @@
+/*compile.c*/
+#include "pch.h"
+#include "main.h"
+
+#define APPHUFFMAN_MAX_NAME_LENGTH		63		//< maximum length of the generated identifier prefix
+
+/**
+ * @brief Make C identifier from the file name: directories and extension are removed, other characters are replaced
+ * with underscores.
+ * @internal
+ */
+static void _make_name( char * name, const char * file )
+{
+	const char *	s;
+	size_t			i;
+
+	for( s = file + strlen( file ); s > file && '/' != s[-1] && '\\' != s[-1] && ':' != s[-1]; -- s )
+		;
+	for( i = 0; i < APPHUFFMAN_MAX_NAME_LENGTH && '\0' != s[i] && '.' != s[i]; ++ i )
+		name[i] = isalnum( (unsigned char) s[i] ) ? s[i] : '_';
+	name[i] = '\0';
+	if( 0 == i || isdigit( (unsigned char) name[0] ) ) {
+		memmove( name + 1, name, i < APPHUFFMAN_MAX_NAME_LENGTH ? i + 1 : i );
+		name[0] = '_';
+		name[APPHUFFMAN_MAX_NAME_LENGTH] = '\0';
+	}
+}
+
+//! Decoder tables of one root compiled from a subset of the code descriptors
+typedef struct _compile_root {
+	libhuffman_code_desc *		desc_array;		//< descriptors of the root
+	size_t *					desc_index;		//< index of each descriptor of the root in the whole table
+	libhuffman_decoder_layout	layout;
+	uint8_t *					entry_bits;		//< entry_bits of each layout entry
+	size_t						first_table;	//< index of the first subtable of the root in the NAME_subtables array
+	size_t						first_entry;	//< index of the first entry of the root in the entry arrays
+} _compile_root;
+
+static void _emit_uint8_array( FILE * f, const char * name, const char * suffix, const uint8_t * values, size_t count )
+{
+	size_t i;
+
+	fprintf( f, "static const unsigned char %s_%s[%u] = {", name, suffix, (unsigned) count );
+	for( i = 0; i < count; ++ i )
+		fprintf( f, "%s%u,", 0 == i % 32 ? "\n\t" : " ", values[i] );
+	fprintf( f, "\n};\n\n" );
+}
+
+/**
+ * @brief Check that the descriptor goes to all roots (actions and events) rather than to the root of its value.
+ * @internal
+ */
+static int _is_shared_code( const libhuffman_code_desc * desc )
+{
+	return nullptr != desc->escape || (unsigned) -1 == desc->count;
+}
+
+/**
+ * @brief Split descriptors in roots and build decoder layouts of all roots.
+ * @internal
+ *
+ *	Codes of the table file are in transmission order and are reversed for the layout, as in fax tables. A prefix-free
+ * table gets a single root. Otherwise the table holds several code sets for alternating decoder states, like fax
+ * white and black runs: the codes of runs of value R go to root R, actions and events go to all roots.
+ */
+static libf2_status_t _build_roots( libhuffman_context * context, unsigned table_bits,
+	const libhuffman_code_desc * desc_array, size_t desc_count, _compile_root * roots, size_t * root_count )
+{
+	libf2_status_t	status;
+	size_t			r, i, count;
+
+	// Single root
+	*root_count = 1;
+	roots[0].desc_array = (libhuffman_code_desc *) malloc( (0 != desc_count ? desc_count : 1) * sizeof(*roots[0].desc_array) );
+	roots[0].desc_index = (size_t *) malloc( (0 != desc_count ? desc_count : 1) * sizeof(*roots[0].desc_index) );
+	__debugbreak_if( nullptr == roots[0].desc_array || nullptr == roots[0].desc_index )
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	for( i = 0; i < desc_count; ++ i ) {
+		roots[0].desc_array[i] = desc_array[i];
+		roots[0].desc_array[i].code.bits = libhuffman_reverse_code( desc_array[i].code.bits, desc_array[i].code.length );
+		roots[0].desc_index[i] = i;
+	}
+	status = libhuffman_decoder_layout_build( context, table_bits, roots[0].desc_array, desc_count, &roots[0].layout );
+	if( LIBF2_STATUS_ERROR_INVALID_DATA != status )
+		return status;
+
+	// Count roots by run values
+	*root_count = 0;
+	for( i = 0; i < desc_count; ++ i ) {
+		if( !_is_shared_code( &desc_array[i] ) && *root_count <= desc_array[i].value.bits ) {
+			if( BTL_MAX_ROOT_COUNT <= desc_array[i].value.bits )
+				return LIBF2_STATUS_ERROR_INVALID_DATA;
+			*root_count = (size_t) desc_array[i].value.bits + 1;
+		}
+	}
+	if( 2 > *root_count )
+		return LIBF2_STATUS_ERROR_INVALID_DATA;
+
+	// Build layout of each root from the reversed codes
+	for( r = 1; r < *root_count; ++ r ) {
+		roots[r].desc_array = (libhuffman_code_desc *) malloc( desc_count * sizeof(*roots[r].desc_array) );
+		roots[r].desc_index = (size_t *) malloc( desc_count * sizeof(*roots[r].desc_index) );
+		__debugbreak_if( nullptr == roots[r].desc_array || nullptr == roots[r].desc_index )
+			return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	}
+	for( r = *root_count; 0 < r --; ) {		// root 0 holds the reversed codes of all roots, it's compacted the last
+		for( count = i = 0; i < desc_count; ++ i ) {
+			if( _is_shared_code( &desc_array[i] ) || r == desc_array[i].value.bits ) {
+				roots[r].desc_array[count] = roots[0].desc_array[i];
+				roots[r].desc_index[count ++] = i;
+			}
+		}
+		status = libhuffman_decoder_layout_build( context, table_bits, roots[r].desc_array, count, &roots[r].layout );
+		if( libf2_failed( status ) )
+			return status;
+	}
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Mark terminating run codes, which switch the decoder to the next root.
+ * @internal
+ *
+ *	Terminating codes are found as by the run-length encoder (see libhuffman_run_table): codes of runs 0, 1, 2... of
+ * a value. Make-up codes, actions and events keep the root.
+ */
+static libf2_status_t _find_switch_codes( libhuffman_context * context, const libhuffman_code_desc * desc_array,
+	size_t desc_count, uint8_t * switch_codes )
+{
+	libf2_status_t				status;
+	libhuffman_run_table		run_table;
+	const libhuffman_run_code *	code;
+	unsigned					value_bit_size = 0;
+	size_t						i;
+
+	// Build run table with the value size of run codes; other values aren't runs of symbols
+	memset( switch_codes, 0, desc_count );
+	for( i = 0; i < desc_count && 0 == value_bit_size; ++ i ) {
+		if( !_is_shared_code( &desc_array[i] ) )
+			value_bit_size = desc_array[i].value.length;
+	}
+	if( 0 == value_bit_size || 16 < value_bit_size || 0 != (value_bit_size & (value_bit_size - 1)) )
+		return LIBF2_STATUS_SUCCESS;
+	status = libhuffman_run_table_initialize( &run_table, context, value_bit_size, desc_array, desc_count );
+	if( libf2_failed( status ) )
+		return status;
+
+	// Find descriptors of terminating codes
+	for( i = 0; i < desc_count; ++ i ) {
+		if( _is_shared_code( &desc_array[i] ) || ((libhuffman_code_t) 1 << value_bit_size) <= desc_array[i].value.bits )
+			continue;
+		for( code = run_table.codes + run_table.first[desc_array[i].value.bits];
+			code < run_table.codes + run_table.first[desc_array[i].value.bits + 1]; ++ code ) {
+			if( code->code == desc_array[i].code.bits && code->length == desc_array[i].code.length )
+				switch_codes[i] = code->terminating;
+		}
+	}
+
+	// Exit
+	(void) libhuffman_run_table_deinitialize( &run_table );
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Write btl_table initializer.
+ * @internal
+ */
+static void _emit_btl_table( FILE * f, const char * name, const char * parent, size_t parent_index,
+	const libhuffman_layout_table * table, size_t first_entry )
+{
+	first_entry += table->first_entry;
+	fprintf( f, "\t{ (unsigned char *) %s_entry_types + %u, (btl_entry_data *) %s_entry_data + %u, NULL, %s, %u, %u, BTL_TABLE_F_EXT_ARRAYS,\n",
+		name, (unsigned) first_entry, name, (unsigned) first_entry, parent, (unsigned) parent_index, table->l2_table_size );
+	fprintf( f, "\t\tNULL, 0, (unsigned char *) %s_entry_bits + %u },\n", name, (unsigned) first_entry );
+}
+
+/**
+ * @brief Write C source with code descriptors and ready btl tables.
+ * @return (libf2_status_t) operation status code.
+ * @internal
+ *
+ *	Subtables and entries are emitted as btl_table and btl_entry_data initializers referring to each other, so
+ * the decoder only copies the root table objects to its context. Nothing is written if memory is short.
+ */
+static libf2_status_t _emit_table( FILE * f, const char * name, const char * table_file,
+	const libhuffman_code_desc * desc_array, size_t desc_count, const _compile_root * roots, size_t root_count,
+	const uint8_t * switch_codes )
+{
+	const libhuffman_decoder_layout *	layout;
+	const libhuffman_layout_table *		table;
+	uint8_t *	types;
+	char		parent[APPHUFFMAN_MAX_NAME_LENGTH + 64];
+	size_t		r, t, i, k, escape_count, table_count, entry_count;
+	uint32_t	value;
+
+	// Allocate entry type and bit buffer
+	table_count = roots[root_count - 1].first_table + roots[root_count - 1].layout.table_count - 1;
+	entry_count = roots[root_count - 1].first_entry + roots[root_count - 1].layout.entry_count;
+	types = (uint8_t *) malloc( 0 != entry_count ? entry_count : 1 );
+	__debugbreak_if( nullptr == types )
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+
+	// Header
+	fprintf( f, "/*%s.h*/\n", name );
+	fprintf( f, "/** @file\n" );
+	fprintf( f, " * @brief Huffman decoder table compiled from %s.\n", table_file );
+	fprintf( f, " *\n" );
+	fprintf( f, " *\tGenerated by the huffman tool, do not edit. The tables are attached without building or allocation:\n" );
+	fprintf( f, " * libhuffman_decoder_table_attach_tables( table, context, %s_roots, %u ).\n", name, (unsigned) root_count );
+	fprintf( f, " */\n" );
+	fprintf( f, "#include <libhuffman.h>\n\n" );
+
+	// Escapes of action codes
+	escape_count = 0;
+	for( i = 0; i < desc_count; ++ i ) {
+		if( nullptr == desc_array[i].escape )
+			continue;
+		if( 0 == escape_count )
+			fprintf( f, "static const libhuffman_escape %s_escapes[] = {\n", name );
+		fprintf( f, "\t{ \"%.*s\", { 0x%08llX, %u }, %u },\n", (int) desc_array[i].escape->name_length, desc_array[i].escape->name,
+			(unsigned long long) desc_array[i].code.bits, (unsigned) desc_array[i].code.length, (unsigned) desc_array[i].escape->name_length );
+		++ escape_count;
+	}
+	if( 0 != escape_count )
+		fprintf( f, "};\n\n" );
+
+	// Code descriptors
+	fprintf( f, "static const libhuffman_code_desc %s_codes[%u] = {\n", name, (unsigned) desc_count );
+	escape_count = 0;
+	for( i = 0; i < desc_count; ++ i ) {
+		fprintf( f, "\t{ { 0x%08llX, %2u }, { 0x%08llX, %2u }, ", (unsigned long long) desc_array[i].code.bits, (unsigned) desc_array[i].code.length,
+			(unsigned long long) desc_array[i].value.bits, (unsigned) desc_array[i].value.length );
+		if( (unsigned) -1 == desc_array[i].count )
+			fprintf( f, "(unsigned) -1, " );
+		else
+			fprintf( f, "%u, ", desc_array[i].count );
+		if( nullptr != desc_array[i].escape )
+			fprintf( f, "(libhuffman_escape *) &%s_escapes[%u], 0 },\n", name, (unsigned) escape_count ++ );
+		else
+			fprintf( f, "NULL, 0 },\n" );
+	}
+	fprintf( f, "};\n\n" );
+
+	// Tables refer to entries and entries refer to subtables
+	fprintf( f, "static const btl_table %s_roots[%u];\n", name, (unsigned) root_count );
+	if( 0 != table_count )
+		fprintf( f, "static const btl_table %s_subtables[%u];\n", name, (unsigned) table_count );
+	fprintf( f, "\n" );
+
+	// Entry types; terminating codes switch to the next root
+	for( r = 0; r < root_count; ++ r ) {
+		layout = &roots[r].layout;
+		for( i = 0; i < layout->entry_count; ++ i ) {
+			types[roots[r].first_entry + i] = layout->entry_types[i];
+			if( (uint8_t) btl_et_data == layout->entry_types[i] && 0 != switch_codes[roots[r].desc_index[layout->entry_values[i]]] )
+				types[roots[r].first_entry + i] = BTL_ET_SWITCH_ROOT( (r + 1) % root_count );
+		}
+	}
+	_emit_uint8_array( f, name, "entry_types", types, entry_count );
+	for( r = 0; r < root_count; ++ r )
+		memcpy( types + roots[r].first_entry, roots[r].entry_bits, roots[r].layout.entry_count );
+	_emit_uint8_array( f, name, "entry_bits", types, entry_count );
+	free( types );
+
+	// Entry data
+	fprintf( f, "static const btl_entry_data %s_entry_data[%u] = {\n", name, (unsigned) entry_count );
+	for( r = 0; r < root_count; ++ r ) {
+		layout = &roots[r].layout;
+		for( i = 0; i < layout->entry_count; ++ i ) {
+			value = layout->entry_values[i];
+			switch( layout->entry_types[i] ) {
+			case btl_et_subtable:
+				fprintf( f, "\t{ { (btl_table *) &%s_subtables[%u] }, { 0 } },\n", name, (unsigned) (roots[r].first_table + value - 1) );
+				break;
+			case btl_et_data:
+				fprintf( f, "\t{ { .entry_ptr_param = &%s_codes[%u] }, { %u } },\n", name, (unsigned) roots[r].desc_index[value],
+					(unsigned) roots[r].desc_index[value] );
+				break;
+			default:
+				fprintf( f, "\t{ { NULL }, { 0 } },\n" );
+				break;
+			}
+		}
+	}
+	fprintf( f, "};\n\n" );
+
+	// Tables
+	fprintf( f, "static const btl_table %s_roots[%u] = {\n", name, (unsigned) root_count );
+	for( r = 0; r < root_count; ++ r )
+		_emit_btl_table( f, name, "NULL", 0, &roots[r].layout.tables[0], roots[r].first_entry );
+	fprintf( f, "};\n\n" );
+	if( 0 != table_count ) {
+		fprintf( f, "static const btl_table %s_subtables[%u] = {\n", name, (unsigned) table_count );
+		for( r = 0; r < root_count; ++ r ) {
+			for( t = 1; t < roots[r].layout.table_count; ++ t ) {
+				table = &roots[r].layout.tables[t];
+				k = table->parent_table;
+				if( 0 == k )
+					sprintf( parent, "(btl_table *) &%s_roots[%u]", name, (unsigned) r );
+				else
+					sprintf( parent, "(btl_table *) &%s_subtables[%u]", name, (unsigned) (roots[r].first_table + k - 1) );
+				_emit_btl_table( f, name, parent, table->parent_index, table, roots[r].first_entry );
+			}
+		}
+		fprintf( f, "};\n\n" );
+	}
+	fprintf( f, "/*END OF %s.h*/\n", name );
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Compile table file to C source with static decoder tables.
+ * @param[in] thisp (apphuffman_context *) application context; table_file is compiled to output_file (or stdout).
+ * @param[in] context (libhuffman_context *) library context.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	All generated data are static const btl tables, so fixed tables cost nothing to load and are shared in read-only
+ * pages by all processes. Tables with alternating code sets get a root per set (see _build_roots).
+ */
+libf2_status_t	apphuffman_compile_table( apphuffman_context * thisp, libhuffman_context * context )
+{
+	libf2_status_t				status;
+	libhuffman_code_desc *		desc_array;
+	size_t						desc_count;
+	_compile_root				roots[BTL_MAX_ROOT_COUNT];
+	size_t						root_count = 0, r;
+	uint8_t *					switch_codes = nullptr;
+	char						name[APPHUFFMAN_MAX_NAME_LENGTH + 1];
+	FILE *						f;
+
+	// Check current state
+	__debugbreak_if( nullptr == thisp || nullptr == context )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( nullptr == thisp->table_file )
+		return LIBF2_STATUS_ERROR_INVALID_STATE;
+
+	// Load table and build layouts
+	status = apphuffman_load_table_from_file( &desc_array, &desc_count, thisp->table_file );
+	if( libf2_failed( status ) )
+		return status;
+	memset( roots, 0, sizeof(roots) );
+	status = _build_roots( context, thisp->table_bits, desc_array, desc_count, roots, &root_count );
+	if( LIBF2_STATUS_ERROR_INVALID_DATA == status )
+		fprintf( stderr, "%s: error: codes of the table are not prefix-free\n", thisp->table_file );
+
+	// Place roots one after another and get entry bits
+	for( r = 0; r < root_count && libf2_succeeded( status ); ++ r ) {
+		roots[r].first_table = 0 == r ? 0 : roots[r - 1].first_table + roots[r - 1].layout.table_count - 1;
+		roots[r].first_entry = 0 == r ? 0 : roots[r - 1].first_entry + roots[r - 1].layout.entry_count;
+		roots[r].entry_bits = (uint8_t *) malloc( roots[r].layout.entry_count );
+		__debugbreak_if( nullptr == roots[r].entry_bits )
+			status = LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+		else
+			status = libhuffman_decoder_layout_get_entry_bits( &roots[r].layout, roots[r].entry_bits );
+	}
+	if( libf2_succeeded( status ) ) {
+		switch_codes = (uint8_t *) malloc( 0 != desc_count ? desc_count : 1 );
+		__debugbreak_if( nullptr == switch_codes )
+			status = LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+		else if( 1 < root_count )
+			status = _find_switch_codes( context, desc_array, desc_count, switch_codes );
+		else
+			memset( switch_codes, 0, desc_count );
+	}
+
+	// Write source
+	if( libf2_succeeded( status ) ) {
+		f = nullptr == thisp->output_file ? stdout : fopen( thisp->output_file, "w" );
+		if( nullptr == f )
+			status = LIBF2_STATUS_ERROR_NOT_FOUND;
+		else {
+			_make_name( name, nullptr != thisp->output_file ? thisp->output_file : thisp->table_file );
+			status = _emit_table( f, name, thisp->table_file, desc_array, desc_count, roots, root_count, switch_codes );
+			if( libf2_succeeded( status ) && ferror( f ) )
+				status = LIBF2_STATUS_ERROR_WRITING;
+			if( stdout != f && 0 != fclose( f ) )
+				status = LIBF2_STATUS_ERROR_WRITING;
+		}
+	}
+
+	// Exit
+	for( r = 0; r < BTL_MAX_ROOT_COUNT; ++ r ) {
+		(void) libhuffman_decoder_layout_release( context, &roots[r].layout );
+		free( roots[r].entry_bits );
+		free( roots[r].desc_index );
+		free( roots[r].desc_array );
+	}
+	free( switch_codes );
+	free( desc_array );
+	return status;
+}
+
+/*END OF compile.c*/
@@ -5,7 +5,8 @@
 libf2_status_t	apphuffman_load_file( const char * file, void ** data_ptr, size_t * data_size_ptr )
 {
 	int h;
-	long file_size, nread;
+	int64_t file_size64;
+	size_t file_size, nread;
 	void * data;
 
 	__debugbreak_if( nullptr == data_ptr )
@@ -19,12 +20,19 @@ libf2_status_t	apphuffman_load_file( const char * file, void ** data_ptr, size_t
 	if( -1 == h )
 		return LIBF2_STATUS_ERROR_NOT_FOUND;
 
-	file_size = _filelength( h );
-	data = malloc( file_size );
-	if( nullptr == data )
+	file_size64 = _filelengthi64( h );
+	if( 0 > file_size64 || (uint64_t) file_size64 > (unsigned) -1 ) {
+		_close( h );
+		return 0 > file_size64 ? LIBF2_STATUS_ERROR_READING : LIBF2_STATUS_ERROR_NOT_SUPPORTED;
+	}
+	file_size = (size_t) file_size64;
+	data = malloc( 0 == file_size ? 1 : file_size );
+	if( nullptr == data ) {
+		_close( h );
 		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	}
 
-	nread = _read( h, data, file_size );
+	nread = (size_t) _read( h, data, (unsigned) file_size );
 	_close( h );
 
 	if( nread != file_size ) {
@@ -37,6 +45,89 @@ libf2_status_t	apphuffman_load_file( const char * file, void ** data_ptr, size_t
 
 	return LIBF2_STATUS_SUCCESS;
 }
+
+/**
+ * @brief Map file to memory for reading.
+ * @param[in] file (const char *) file name.
+ * @param[out] data_ptr (void **) variable that receives pointer to the read-only file data.
+ * @param[out] data_size_ptr (size_t *) variable that receives size of the file, in bytes.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	On Linux the file is mapped without copying: pages are read in on demand, so decoding starts at once and large
+ * files don't take resident heap. Where mapping is not available the file is loaded as by apphuffman_load_file.
+ * Data must not be modified and are released by apphuffman_unmap_file.
+ */
+libf2_status_t	apphuffman_map_file( const char * file, void ** data_ptr, size_t * data_size_ptr )
+{
+#if defined( __linux__ )
+	int h;
+	struct stat st;
+	void * data;
+
+	__debugbreak_if( nullptr == data_ptr )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	*data_ptr = nullptr;
+	__debugbreak_if( nullptr == data_size_ptr )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	*data_size_ptr = 0;
+
+	h = open( file, O_RDONLY );
+	if( -1 == h )
+		return LIBF2_STATUS_ERROR_NOT_FOUND;
+	if( 0 != fstat( h, &st ) ) {
+		close( h );
+		return LIBF2_STATUS_ERROR_READING;
+	}
+	if( (uint64_t) st.st_size > (size_t) -1 ) {
+		close( h );
+		return LIBF2_STATUS_ERROR_NOT_SUPPORTED;
+	}
+	if( 0 == st.st_size ) {
+		close( h );
+		return LIBF2_STATUS_SUCCESS;
+	}
+
+	// Map the file; the mapping holds its own reference to the file
+	data = mmap( nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, h, 0 );
+	close( h );
+	if( MAP_FAILED == data )
+		return LIBF2_STATUS_ERROR_READING;
+
+	// The data are read once from start to end: read ahead aggressively and drop pages behind
+	(void) madvise( data, (size_t) st.st_size, MADV_SEQUENTIAL );
+#if defined( MADV_HUGEPAGE )
+	(void) madvise( data, (size_t) st.st_size, MADV_HUGEPAGE );
+#endif // defined( MADV_HUGEPAGE )
+
+	*data_ptr = data;
+	*data_size_ptr = (size_t) st.st_size;
+
+	return LIBF2_STATUS_SUCCESS;
+#else
+	return apphuffman_load_file( file, data_ptr, data_size_ptr );
+#endif // defined( __linux__ )
+}
+void			apphuffman_unmap_file( void * data, size_t data_size )
+{
+#if defined( __linux__ )
+	if( nullptr != data )
+		(void) munmap( data, data_size );
+#else
+	libf2_unreferenced_parameter( data_size );
+	free( data );
+#endif // defined( __linux__ )
+}
+
+/**
+ * @brief Read entire stream to memory.
+ * @param[in] istream (libf2_istream *) stream to read.
+ * @param[out] data_ptr (void **) variable that receives pointer to the data, released by free.
+ * @param[out] data_size_ptr (size_t *) variable that receives size of the data, in bytes.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	Only for streams that are not backed by a file: files are mapped by apphuffman_map_file and parsed in place,
+ * see apphuffman_deserialize_decoder_table_memory, so no copy of them is made.
+ */
 libf2_status_t	apphuffman_load_stream( libf2_istream * istream, void ** data_ptr, size_t * data_size_ptr )
 {
 	libf2_status_t	status;
@@ -61,11 +152,11 @@ libf2_status_t	apphuffman_load_stream( libf2_istream * istream, void ** data_ptr
 	if( libf2_failed( status ) )
 		return status;
 	file_size = (size_t) file_size64;
-	if( file_size == file_size64 )
-		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	if( file_size != file_size64 )
+		return LIBF2_STATUS_ERROR_NOT_SUPPORTED;
 
 	// Allocate memory
-	data = malloc( (size_t) file_size );
+	data = malloc( 0 == file_size ? 1 : file_size );
 	if( nullptr == data )
 		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
 
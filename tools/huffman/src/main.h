@@ -8,16 +8,108 @@
 #define libhuffman_free( p )				free( p )
 #define libhuffman_strdup( s )				_strdup( s )
 
+#define APPHUFFMAN_VALUE_BIT_SIZE			8	//< size of the source symbol, in bits
+
 libf2_status_t	apphuffman_load_file( const char * file, void ** data, size_t * data_size );
+libf2_status_t	apphuffman_map_file( const char * file, void ** data_ptr, size_t * data_size_ptr );
+void			apphuffman_unmap_file( void * data, size_t data_size );
 libf2_status_t	apphuffman_load_stream( libf2_istream * istream, void ** data_ptr, size_t * data_size_ptr );
 
 //libf2_status_t	apphuffman_load_encoder_table_file( libhuffman_encoder_table * table, const char * file );
 //libf2_status_t	apphuffman_load_decoder_table_file( libhuffman_decoder_table * table, const char * file );
 
-libf2_status_t	apphuffman_load_table_txt ( libhuffman_code_desc ** desc_array_out, size_t * desc_count_out, const void * data, size_t data_size );
+libf2_status_t	apphuffman_load_table_from_txt( libhuffman_code_desc ** desc_array_out, size_t * desc_count_out, const void * data, size_t data_size, const char * file );
+
+int				apphuffman_is_binary_table( const void * data, size_t data_size );
+libf2_status_t	apphuffman_load_table_from_bin( libhuffman_code_desc ** desc_array_out, size_t * desc_count_out, libhuffman_decoder_layout * layout, const void * data, size_t data_size );
+libf2_status_t	apphuffman_store_table_to_bin( const libhuffman_code_desc * desc_array, size_t desc_count, const libhuffman_decoder_layout * layout, libf2_ostream * ostream );
+libf2_status_t	apphuffman_deserialize_decoder_table_bin( libhuffman_decoder_table * table, libhuffman_context * context, const void * data, size_t data_size, libhuffman_code_desc ** desc_array_out );
 
 libf2_status_t	apphuffman_load_table_from_file( libhuffman_code_desc ** desc_array_out, size_t * desc_count_out, const char * file );
 libf2_status_t	apphuffman_load_table_from_memory( libhuffman_code_desc ** desc_array_out, size_t * desc_count_out, void * data, size_t data_size, const char * file );
 libf2_status_t	apphuffman_load_table_from_stream( libhuffman_code_desc ** desc_array_out, size_t * desc_count_out, libf2_istream * istream, const char * file );
 
+libf2_status_t	apphuffman_compile_table( apphuffman_context * thisp, libhuffman_context * context );
+libf2_status_t	apphuffman_analyze( apphuffman_context * thisp );
+libf2_status_t	apphuffman_bench( apphuffman_context * thisp );
+
+//! Growable memory buffer
+typedef struct apphuffman_buffer {
+	uint8_t *	data;
+	size_t		size;			//< number of used bytes
+	size_t		capacity;		//< number of allocated bytes
+} apphuffman_buffer;
+libf2_status_t	apphuffman_buffer_reserve( apphuffman_buffer * thisp, size_t capacity );
+
+//! Output stream that appends to the buffer
+typedef struct apphuffman_buffer_ostream {
+	libf2_ostream		ostream;
+	apphuffman_buffer *	buffer;
+} apphuffman_buffer_ostream;
+void			apphuffman_buffer_ostream_initialize( apphuffman_buffer_ostream * thisp, apphuffman_buffer * buffer );
+
+//! Asynchronous read or write
+typedef struct apphuffman_aio_request {
+	void *				tag;		//< value returned on completion
+	apphuffman_buffer *	buffer;
+	uint8_t *			data;		//< data not transferred yet
+	size_t				size;
+	uint64_t			offset;
+	int					h;
+	int					write;
+	libf2_status_t		status;
+} apphuffman_aio_request;
+
+//! Asynchronous file I/O: io_uring where available, synchronous pread/pwrite otherwise
+typedef struct apphuffman_aio {
+	unsigned					queue_depth;		//< maximum number of requests in flight
+	unsigned					pending_count;		//< number of submitted, not returned requests
+	apphuffman_aio_request *	requests;
+	unsigned *					free_requests;		//< stack of free request indices
+	unsigned					free_count;
+	unsigned *					completed;			//< queue of requests completed synchronously
+	unsigned					completed_head;
+	unsigned					completed_count;
+	void *						ring;				//< io_uring, nullptr if not used
+} apphuffman_aio;
+libf2_status_t	apphuffman_aio_initialize( apphuffman_aio * thisp, unsigned queue_depth, apphuffman_buffer * const * buffers, size_t buffer_count );
+libf2_status_t	apphuffman_aio_deinitialize( apphuffman_aio * thisp );
+libf2_status_t	apphuffman_aio_submit( apphuffman_aio * thisp, int h, apphuffman_buffer * buffer, size_t size, uint64_t offset, int writing, void * tag );
+libf2_status_t	apphuffman_aio_complete( apphuffman_aio * thisp, void ** tag, int wait );
+#define apphuffman_aio_is_full( thisp )		( 0 == (thisp)->free_count )
+
+//! Block passed through the pipeline stages
+typedef struct apphuffman_pipeline_job {
+	apphuffman_buffer	input;	//< block as read
+	apphuffman_buffer	output;	//< block as processed
+	size_t				index;	//< index of the block
+} apphuffman_pipeline_job;
+
+//! Reader/worker/writer pipeline
+typedef struct apphuffman_pipeline apphuffman_pipeline;
+struct apphuffman_pipeline {
+	libf2_status_t	(* locate)( apphuffman_pipeline * thisp, size_t index, uint64_t * offset, size_t * size );	//< input range, called in block order
+	libf2_status_t	(* process)( apphuffman_pipeline * thisp, size_t worker_index, const apphuffman_buffer * input, apphuffman_buffer * output );
+	libf2_status_t	(* complete)( apphuffman_pipeline * thisp, size_t index, const apphuffman_buffer * output );	//< optional, called in block order before output is written
+	void *			param;
+	int				input;			//< input file handle
+	int				output;			//< output file handle
+	uint64_t		output_offset;	//< offset of the next output block, (uint64_t) -1 to write at the current position
+	size_t			block_count;	//< number of blocks
+	size_t			block_size;		//< expected size of input and output blocks, buffers are registered with this size
+	size_t			worker_count;	//< number of worker threads
+	size_t			job_count;		//< number of jobs (buffer pairs) in flight
+	unsigned		queue_depth;	//< number of reads and writes in flight, 0 = synchronous I/O
+};
+libf2_status_t	apphuffman_run_pipeline( apphuffman_pipeline * thisp );
+size_t			apphuffman_get_processor_count( void );
+libf2_status_t	apphuffman_run_threads( size_t count, void (* proc)( void * param, size_t index ), void * param );
+libf2_status_t	apphuffman_process_pipeline( apphuffman_context * thisp );
+libf2_status_t	apphuffman_process_framed( apphuffman_context * thisp );
+#define apphuffman_is_stdio_name( name )	( nullptr != (name) && 0 == strcmp( (name), "-" ) )
+
+libf2_status_t	apphuffman_write_block_table( libf2_ostream * ostream, const libhuffman_stream * stream, size_t * size );
+libf2_status_t	apphuffman_encode_multitable( apphuffman_context * thisp, libhuffman_context * context,
+	const void * data, size_t data_size, libf2_ostream * ostream );
+
 /*END OF main.h*/
@@ -0,0 +1,217 @@
+/*multitable.c*/
+#include "pch.h"
+#include "main.h"
+
+static libf2_status_t _write_uint32( libf2_ostream * ostream, uint32_t value )
+{
+	uint8_t	buf[4];
+	size_t	nwritten;
+
+	buf[0] = (uint8_t) (value);
+	buf[1] = (uint8_t) (value >> 8);
+	buf[2] = (uint8_t) (value >> 16);
+	buf[3] = (uint8_t) (value >> 24);
+	return ostream->write( ostream, buf, sizeof(buf), &nwritten );
+}
+
+static libf2_status_t _write_uint64( libf2_ostream * ostream, uint64_t value )
+{
+	libf2_status_t	status;
+
+	status = _write_uint32( ostream, (uint32_t) value );
+	if( libf2_succeeded( status ) )
+		status = _write_uint32( ostream, (uint32_t) (value >> 32) );
+	return status;
+}
+
+/**
+ * @brief Write the block table of the stream.
+ * @param[in] ostream (libf2_ostream *) output stream.
+ * @param[in] stream (const libhuffman_stream *) encoded stream.
+ * @param[out] size (size_t *) number of written bytes (optional).
+ * @return (libf2_status_t) operation status code.
+ *
+ *	Stream flags and the number of blocks are followed by bit length and code count of each block; block offsets
+ * are not stored since blocks follow one another (or are lanes of the interleaved layout).
+ */
+libf2_status_t	apphuffman_write_block_table( libf2_ostream * ostream, const libhuffman_stream * stream, size_t * size )
+{
+	libf2_status_t	status;
+	size_t			i;
+
+	// Check current state
+	__debugbreak_if( nullptr == ostream || nullptr == stream )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Write table
+	status = _write_uint32( ostream, (uint32_t) stream->flags );
+	if( libf2_succeeded( status ) )
+		status = _write_uint32( ostream, (uint32_t) stream->block_count );
+	for( i = 0; i < stream->block_count && libf2_succeeded( status ); ++ i ) {
+		status = _write_uint64( ostream, (uint64_t) stream->blocks[i].bit_length );
+		if( libf2_succeeded( status ) )
+			status = _write_uint64( ostream, (uint64_t) stream->blocks[i].symbol_count );
+	}
+
+	// Exit
+	if( nullptr != size )
+		*size = 8 + stream->block_count * 16;
+	return status;
+}
+
+/**
+ * @brief Encode one segment with the table assigned to it.
+ * @internal
+ */
+static libf2_status_t _encode_segment( apphuffman_context * thisp, libhuffman_context * context,
+	const libhuffman_multitable_plan * plan, size_t segment_index, const void * data, size_t data_size,
+	libhuffman_stream * stream, libf2_ostream * ostream )
+{
+	libf2_status_t				status;
+	libhuffman_code_desc *		desc_array;
+	size_t						desc_count;
+	libhuffman_encoder_table	table;
+	libhuffman_encode_context	encode_context;
+	libf2_static_memory_istream	istream;
+
+	// Get code descriptors
+	desc_array = (libhuffman_code_desc *) malloc( ((size_t) 1 << APPHUFFMAN_VALUE_BIT_SIZE) * sizeof(*desc_array) );
+	if( nullptr == desc_array )
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	status = libhuffman_multitable_plan_get_code_descs( plan, plan->segment_tables[segment_index], desc_array, &desc_count );
+	if( libf2_failed( status ) ) {
+		free( desc_array );
+		return status;
+	}
+
+	// Encode segment
+	status = libhuffman_initialize_encoder_table( &table, context, 0 );
+	__debugbreak_ifnot( libf2_succeeded( status ) ) {
+		status = libhuffman_encoder_table_append_codes( &table, desc_array, desc_count );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			status = libf2_static_buffer_istream_initialize( &istream, data, data_size );
+			__debugbreak_ifnot( libf2_succeeded( status ) ) {
+				status = libhuffman_initialize_encode_context( &encode_context, context, &table, &istream.istream, ostream );
+				__debugbreak_ifnot( libf2_succeeded( status ) ) {
+					encode_context.value_bit_size = APPHUFFMAN_VALUE_BIT_SIZE;
+					status = libhuffman_set_encode_context_lanes( &encode_context, stream, thisp->lane_count );
+					if( libf2_succeeded( status ) && 1 < thisp->lane_count && APPHUFFMAN_L_INTERLEAVED == thisp->layout )
+						status = libhuffman_stream_set_flags( stream, LIBHUFFMAN_STREAM_F_INTERLEAVED );
+					if( libf2_succeeded( status ) )
+						status = libhuffman_encode( &encode_context );
+					(void) libhuffman_deinitialize_encode_context( &encode_context );
+				}
+				(void) libf2_static_buffer_istream_deinitialize( &istream );
+			}
+		}
+		(void) libhuffman_deinitialize_encoder_table( &table );
+	}
+
+	// Exit
+	free( desc_array );
+	return status;
+}
+
+/**
+ * @brief Encode data to the multitable streamed file.
+ * @param[in] thisp (apphuffman_context *) application context.
+ * @param[in] context (libhuffman_context *) library context.
+ * @param[in] data (const void *) source data.
+ * @param[in] data_size (size_t) size of source data, in bytes.
+ * @param[in] ostream (libf2_ostream *) output stream.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	Source data are split in stream_count segments of equal size. Segments with similar statistics share a table,
+ * so no more than table_count tables are stored.
+ */
+libf2_status_t	apphuffman_encode_multitable( apphuffman_context * thisp, libhuffman_context * context,
+	const void * data, size_t data_size, libf2_ostream * ostream )
+{
+	libf2_status_t				status;
+	libhuffman_multitable_plan	plan;
+	libhuffman_binary			binary;
+	size_t						stream_count, segment_size, segment_index, offset, size, directory_size;
+
+	// Check current state
+	__debugbreak_if( nullptr == thisp || nullptr == context || nullptr == ostream )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( nullptr == data && 0 != data_size )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	stream_count = 0 == thisp->stream_count ? 1 : thisp->stream_count;
+	segment_size = (data_size + stream_count - 1) / stream_count;
+
+	// Collect statistics and build tables
+	status = libhuffman_multitable_plan_initialize( &plan, context, APPHUFFMAN_VALUE_BIT_SIZE, stream_count,
+		0 == thisp->table_count ? 1 : thisp->table_count );
+	if( libf2_failed( status ) )
+		return status;
+
+	for( segment_index = 0; segment_index < stream_count; ++ segment_index ) {
+		offset = segment_index * segment_size;
+		size = offset >= data_size ? 0 : data_size - offset < segment_size ? data_size - offset : segment_size;
+		status = libhuffman_multitable_plan_count( &plan, segment_index, (const uint8_t *) data + offset, size );
+		if( libf2_failed( status ) )
+			break;
+	}
+	if( libf2_succeeded( status ) )
+		status = libhuffman_multitable_plan_build( &plan );
+	if( libf2_failed( status ) ) {
+		(void) libhuffman_multitable_plan_deinitialize( &plan );
+		return status;
+	}
+
+	// Write file header
+	status = libhuffman_binary_initialize( &binary, context, nullptr, stream_count );
+	if( libf2_succeeded( status ) ) {
+		status = _write_uint32( ostream, APPHUFFMAN_MULTITABLE_SIGNATURE );
+		if( libf2_succeeded( status ) )
+			status = _write_uint32( ostream, (uint32_t) stream_count );
+		if( libf2_succeeded( status ) )
+			status = _write_uint32( ostream, (uint32_t) plan.table_count );
+
+		// Write streams
+		for( segment_index = 0; segment_index < stream_count && libf2_succeeded( status ); ++ segment_index ) {
+			offset = segment_index * segment_size;
+			size = offset >= data_size ? 0 : data_size - offset < segment_size ? data_size - offset : segment_size;
+			binary.streams[segment_index].binary = &binary;
+			status = _encode_segment( thisp, context, &plan, segment_index, (const uint8_t *) data + offset, size,
+				&binary.streams[segment_index], ostream );
+		}
+
+		// Write tables
+		for( segment_index = 0; segment_index < plan.table_count && libf2_succeeded( status ); ++ segment_index )
+			status = libhuffman_multitable_plan_write_table( &plan, segment_index, ostream );
+
+		// Write stream directory
+		directory_size = 12;
+		if( libf2_succeeded( status ) )
+			status = _write_uint32( ostream, APPHUFFMAN_DIRECTORY_SIGNATURE );
+		for( segment_index = 0; segment_index < stream_count && libf2_succeeded( status ); ++ segment_index ) {
+			status = _write_uint32( ostream, (uint32_t) ((binary.streams[segment_index].data_bit_count + 7) / 8) );
+			if( libf2_succeeded( status ) )
+				status = _write_uint32( ostream, (uint32_t) plan.segment_tables[segment_index] );
+			if( libf2_succeeded( status ) ) {
+				status = apphuffman_write_block_table( ostream, &binary.streams[segment_index], &size );
+				directory_size += 8 + size;
+			}
+		}
+		if( libf2_succeeded( status ) )
+			status = _write_uint32( ostream, (uint32_t) directory_size );
+		if( libf2_succeeded( status ) )
+			status = _write_uint32( ostream, APPHUFFMAN_DIRECTORY_SIGNATURE );
+
+		// Clean up
+		for( segment_index = 0; segment_index < stream_count; ++ segment_index ) {
+			if( 0 != binary.streams[segment_index].block_count )
+				(void) libhuffman_stream_set_block_count( &binary.streams[segment_index], 0 );
+		}
+		(void) libhuffman_binary_deinitialize( &binary );
+	}
+
+	// Exit
+	(void) libhuffman_multitable_plan_deinitialize( &plan );
+	return status;
+}
+
+/*END OF multitable.c*/
@@ -3,13 +3,47 @@
 
 #include <ctype.h>
 #include <fcntl.h>
-#include <io.h>
 #include <memory.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined( _WIN32 )
+# include <io.h>
+#endif // defined( _WIN32 )
+#if defined( __linux__ )
+# include <strings.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+
+// POSIX equivalents of the CRT low-level I/O used by the tool
+# define _O_RDONLY				O_RDONLY
+# define _O_WRONLY				O_WRONLY
+# define _O_CREAT				O_CREAT
+# define _O_TRUNC				O_TRUNC
+# define _O_BINARY				0
+# define _O_SEQUENTIAL			0
+# define _S_IREAD				(S_IRUSR | S_IRGRP | S_IROTH)
+# define _S_IWRITE				S_IWUSR
+# define _open					open
+# define _read					read
+# define _write					write
+# define _close					close
+# define _fileno				fileno
+# define _setmode( h, mode )	((void) (h), (mode))
+# define _lseeki64( h, offset, origin )	((int64_t) lseek( h, (off_t) (offset), origin ))
+# define stricmp				strcasecmp
+# define _strdup				strdup
+
+static inline int64_t _filelengthi64( int h )
+{
+	struct stat	st;
+
+	return 0 == fstat( h, &st ) ? (int64_t) st.st_size : -1;
+}
+#endif // defined( __linux__ )
 
 
 //#define __debugbreak_if( expr )		if( expr )
@@ -0,0 +1,1112 @@
+/*pipeline.c*/
+#include "pch.h"
+#include "main.h"
+
+#include <sys/stat.h>
+#if defined( _WIN32 )
+# include <windows.h>
+# include <process.h>
+#else
+# include <pthread.h>
+# include <sched.h>
+# include <unistd.h>
+#endif // defined( _WIN32 )
+
+#define APPHUFFMAN_CACHE_LINE_SIZE		64		//< queue indices are kept in separate cache lines
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Atomic operations and threads
+
+#if defined( _WIN32 )
+static size_t _atomic_load( volatile size_t * p )
+{
+	return (size_t) InterlockedCompareExchangePointer( (PVOID volatile *) p, nullptr, nullptr );
+}
+static void _atomic_store( volatile size_t * p, size_t value )
+{
+	(void) InterlockedExchangePointer( (PVOID volatile *) p, (PVOID) value );
+}
+static int _atomic_cas( volatile size_t * p, size_t expected, size_t value )
+{
+	return (PVOID) expected == InterlockedCompareExchangePointer( (PVOID volatile *) p, (PVOID) value, (PVOID) expected );
+}
+static void _atomic_increment( volatile size_t * p )
+{
+	size_t value;
+
+	do
+		value = _atomic_load( p );
+	while( !_atomic_cas( p, value, value + 1 ) );
+}
+static void _yield( void )
+{
+	(void) SwitchToThread();
+}
+#else
+static size_t _atomic_load( volatile size_t * p )
+{
+	return __atomic_load_n( p, __ATOMIC_ACQUIRE );
+}
+static void _atomic_store( volatile size_t * p, size_t value )
+{
+	__atomic_store_n( p, value, __ATOMIC_RELEASE );
+}
+static int _atomic_cas( volatile size_t * p, size_t expected, size_t value )
+{
+	return __atomic_compare_exchange_n( p, &expected, value, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+}
+static void _atomic_increment( volatile size_t * p )
+{
+	(void) __atomic_fetch_add( p, 1, __ATOMIC_ACQ_REL );
+}
+static void _yield( void )
+{
+	(void) sched_yield();
+}
+#endif // defined( _WIN32 )
+
+/**
+ * @brief Get number of processors available to the process.
+ * @return (size_t) number of processors, at least 1.
+ */
+size_t	apphuffman_get_processor_count( void )
+{
+#if defined( _WIN32 )
+	SYSTEM_INFO	info;
+
+	GetSystemInfo( &info );
+	return 0 == info.dwNumberOfProcessors ? 1 : (size_t) info.dwNumberOfProcessors;
+#else
+	long count = sysconf( _SC_NPROCESSORS_ONLN );
+
+	return count < 1 ? 1 : (size_t) count;
+#endif // defined( _WIN32 )
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bounded lock-free queue of jobs
+
+typedef struct _queue_cell {
+	volatile size_t				sequence;	//< position the cell is ready for
+	apphuffman_pipeline_job *	job;
+} _queue_cell;
+
+/**
+ * @brief Bounded multi-producer multi-consumer queue.
+ * @internal
+ *
+ *	Each cell holds a sequence number: the cell is free for the push at position P when its sequence is P, and holds
+ * the job for the pop at position P when its sequence is P + 1. Producers and consumers only race for positions.
+ */
+typedef struct _queue {
+	_queue_cell *	cells;
+	size_t			mask;
+	uint8_t			pad0[APPHUFFMAN_CACHE_LINE_SIZE];
+	volatile size_t	push_position;
+	uint8_t			pad1[APPHUFFMAN_CACHE_LINE_SIZE];
+	volatile size_t	pop_position;
+	uint8_t			pad2[APPHUFFMAN_CACHE_LINE_SIZE];
+} _queue;
+
+static libf2_status_t _queue_initialize( _queue * thisp, size_t capacity )
+{
+	size_t i;
+
+	memset( thisp, 0, sizeof(*thisp) );
+	for( thisp->mask = 1; thisp->mask < capacity; thisp->mask <<= 1 )
+		;
+	thisp->cells = (_queue_cell *) malloc( thisp->mask * sizeof(*thisp->cells) );
+	if( nullptr == thisp->cells )
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	for( i = 0; i < thisp->mask; ++ i )
+		thisp->cells[i].sequence = i;
+	-- thisp->mask;
+	return LIBF2_STATUS_SUCCESS;
+}
+static void _queue_deinitialize( _queue * thisp )
+{
+	free( thisp->cells );
+	thisp->cells = nullptr;
+}
+
+static int _queue_push( _queue * thisp, apphuffman_pipeline_job * job )
+{
+	_queue_cell *	cell;
+	size_t			position;
+	ptrdiff_t		diff;
+
+	position = _atomic_load( &thisp->push_position );
+	for( ;; ) {
+		cell = &thisp->cells[position & thisp->mask];
+		diff = (ptrdiff_t) _atomic_load( &cell->sequence ) - (ptrdiff_t) position;
+		if( 0 == diff && _atomic_cas( &thisp->push_position, position, position + 1 ) )
+			break;
+		if( diff < 0 )
+			return 0;	// full
+		position = _atomic_load( &thisp->push_position );
+	}
+	cell->job = job;
+	_atomic_store( &cell->sequence, position + 1 );
+	return 1;
+}
+static int _queue_pop( _queue * thisp, apphuffman_pipeline_job ** job )
+{
+	_queue_cell *	cell;
+	size_t			position;
+	ptrdiff_t		diff;
+
+	position = _atomic_load( &thisp->pop_position );
+	for( ;; ) {
+		cell = &thisp->cells[position & thisp->mask];
+		diff = (ptrdiff_t) _atomic_load( &cell->sequence ) - (ptrdiff_t) (position + 1);
+		if( 0 == diff && _atomic_cas( &thisp->pop_position, position, position + 1 ) )
+			break;
+		if( diff < 0 )
+			return 0;	// empty
+		position = _atomic_load( &thisp->pop_position );
+	}
+	*job = cell->job;
+	_atomic_store( &cell->sequence, position + thisp->mask + 1 );
+	return 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pipeline
+
+typedef struct _pipeline_state {
+	apphuffman_pipeline *	pipeline;
+	_queue					free_queue;		//< jobs ready to be filled by the reader
+	_queue					work_queue;		//< read jobs waiting for a worker
+	_queue					done_queue;		//< processed jobs waiting for the writer
+	volatile size_t			taken_count;	//< number of blocks taken by workers
+	volatile size_t			failed;			//< non-0 if any stage has failed, all stages stop
+	libf2_status_t			status;			//< status of the first failed stage
+	apphuffman_aio			read_aio;		//< reads of the reader, input buffers of jobs are registered
+	apphuffman_aio			write_aio;		//< writes of the writer, output buffers of jobs are registered
+} _pipeline_state;
+
+//! Thread that runs proc( param, index )
+typedef struct _thread {
+	void				(* proc)( void * param, size_t index );
+	void *				param;
+	size_t				index;
+#if defined( _WIN32 )
+	HANDLE				handle;
+#else
+	pthread_t			handle;
+#endif // defined( _WIN32 )
+} _thread;
+
+static void _fail( _pipeline_state * state, libf2_status_t status )
+{
+	if( _atomic_cas( &state->failed, 0, 1 ) )
+		state->status = status;
+}
+
+/**
+ * @brief Reader stage: read blocks to free jobs and pass them to workers as reads complete.
+ * @internal
+ *
+ *	Up to queue_depth reads are in flight; on failure submitted reads are drained before the jobs are left.
+ */
+static void _read_blocks( _pipeline_state * state )
+{
+	apphuffman_pipeline *		pipeline = state->pipeline;
+	apphuffman_pipeline_job *	job;
+	apphuffman_aio *			aio = &state->read_aio;
+	libf2_status_t				status;
+	uint64_t					offset;
+	size_t						index, size;
+	void *						tag;
+
+	for( index = 0; (index < pipeline->block_count && !_atomic_load( &state->failed )) || 0 != aio->pending_count; ) {
+		// Submit reads of the next blocks while there are free jobs
+		while( index < pipeline->block_count && !apphuffman_aio_is_full( aio ) && !_atomic_load( &state->failed )
+			&& _queue_pop( &state->free_queue, &job ) ) {
+			job->index = index;
+			status = pipeline->locate( pipeline, index, &offset, &size );
+			if( libf2_succeeded( status ) )
+				status = apphuffman_buffer_reserve( &job->input, size );
+			if( libf2_succeeded( status ) ) {
+				job->input.size = size;
+				status = apphuffman_aio_submit( aio, pipeline->input, &job->input, size, offset, 0, job );
+			}
+			if( libf2_failed( status ) ) {
+				_fail( state, status );
+				break;
+			}
+			++ index;
+		}
+		if( 0 == aio->pending_count ) {
+			_yield();
+			continue;
+		}
+
+		// Nothing more can be submitted now: wait for a read and pass the block to workers
+		status = apphuffman_aio_complete( aio, &tag, 1 );
+		if( libf2_failed( status ) )
+			_fail( state, status );
+		else if( nullptr != tag && !_atomic_load( &state->failed ) )
+			(void) _queue_push( &state->work_queue, (apphuffman_pipeline_job *) tag );	// never full: queues hold all jobs
+	}
+}
+
+/**
+ * @brief Worker stage: process blocks in any order until all of them are taken.
+ * @internal
+ */
+static void _process_blocks( _pipeline_state * state, size_t worker_index )
+{
+	apphuffman_pipeline *		pipeline = state->pipeline;
+	apphuffman_pipeline_job *	job;
+	libf2_status_t				status;
+
+	while( !_atomic_load( &state->failed ) ) {
+		if( !_queue_pop( &state->work_queue, &job ) ) {
+			if( _atomic_load( &state->taken_count ) >= pipeline->block_count )
+				return;
+			_yield();
+			continue;
+		}
+		_atomic_increment( &state->taken_count );
+		job->output.size = 0;
+		status = pipeline->process( pipeline, worker_index, &job->input, &job->output );
+		if( libf2_failed( status ) ) {
+			_fail( state, status );
+			return;
+		}
+		(void) _queue_push( &state->done_queue, job );
+	}
+}
+
+static void _run_stage( void * param, size_t worker_index )
+{
+	if( (size_t) -1 == worker_index )
+		_read_blocks( (_pipeline_state *) param );
+	else
+		_process_blocks( (_pipeline_state *) param, worker_index );
+}
+
+#if defined( _WIN32 )
+static unsigned __stdcall _thread_proc( void * param )
+{
+	((_thread *) param)->proc( ((_thread *) param)->param, ((_thread *) param)->index );
+	return 0;
+}
+static int _thread_start( _thread * thread )
+{
+	thread->handle = (HANDLE) _beginthreadex( nullptr, 0, _thread_proc, thread, 0, nullptr );
+	return nullptr != thread->handle;
+}
+static void _thread_join( _thread * thread )
+{
+	(void) WaitForSingleObject( thread->handle, INFINITE );
+	(void) CloseHandle( thread->handle );
+}
+#else
+static void * _thread_proc( void * param )
+{
+	((_thread *) param)->proc( ((_thread *) param)->param, ((_thread *) param)->index );
+	return nullptr;
+}
+static int _thread_start( _thread * thread )
+{
+	return 0 == pthread_create( &thread->handle, nullptr, _thread_proc, thread );
+}
+static void _thread_join( _thread * thread )
+{
+	(void) pthread_join( thread->handle, nullptr );
+}
+#endif // defined( _WIN32 )
+
+/**
+ * @brief Writer stage: write processed blocks in order and recycle their jobs as writes complete.
+ * @internal
+ *
+ *	Up to queue_depth writes are in flight, each at its own offset; unpositioned output (pipe etc.) is written
+ * synchronously.
+ */
+static void _write_blocks( _pipeline_state * state, apphuffman_pipeline_job ** pending )
+{
+	apphuffman_pipeline *		pipeline = state->pipeline;
+	apphuffman_pipeline_job *	job;
+	apphuffman_aio *			aio = &state->write_aio;
+	libf2_status_t				status;
+	size_t						index, written_count;
+	int							progress, wait;
+	void *						tag;
+
+	for( index = written_count = 0; (written_count < pipeline->block_count && !_atomic_load( &state->failed )) || 0 != aio->pending_count; ) {
+		// Collect processed blocks; no more than job_count blocks are in flight, so their slots never collide
+		progress = 0;
+		while( _queue_pop( &state->done_queue, &job ) ) {
+			pending[job->index % pipeline->job_count] = job;
+			progress = 1;
+		}
+
+		// Submit writes in block order
+		while( index < pipeline->block_count && !apphuffman_aio_is_full( aio ) && !_atomic_load( &state->failed )
+			&& nullptr != (job = pending[index % pipeline->job_count]) ) {
+			pending[index % pipeline->job_count] = nullptr;
+			status = nullptr == pipeline->complete ? LIBF2_STATUS_SUCCESS : pipeline->complete( pipeline, index, &job->output );
+			if( libf2_succeeded( status ) )
+				status = apphuffman_aio_submit( aio, pipeline->output, &job->output, job->output.size, pipeline->output_offset, 1, job );
+			if( libf2_failed( status ) ) {
+				_fail( state, status );
+				break;
+			}
+			if( (uint64_t) -1 != pipeline->output_offset )
+				pipeline->output_offset += job->output.size;
+			++ index;
+			progress = 1;
+		}
+
+		// Recycle written jobs; wait only if nothing else can be done
+		wait = !progress && (apphuffman_aio_is_full( aio ) || index >= pipeline->block_count || _atomic_load( &state->failed ));
+		for( ;; ) {
+			status = apphuffman_aio_complete( aio, &tag, wait );
+			if( libf2_failed( status ) )
+				_fail( state, status );
+			if( nullptr == tag )
+				break;
+			(void) _queue_push( &state->free_queue, (apphuffman_pipeline_job *) tag );
+			++ written_count;
+			progress = 1;
+			wait = 0;
+		}
+		if( !progress )
+			_yield();
+	}
+}
+
+/**
+ * @brief Reserve buffer memory.
+ * @param[in] thisp (apphuffman_buffer *) buffer.
+ * @param[in] capacity (size_t) required capacity, in bytes.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	Buffers only grow, so after the first few blocks jobs are recycled without allocations.
+ */
+libf2_status_t	apphuffman_buffer_reserve( apphuffman_buffer * thisp, size_t capacity )
+{
+	uint8_t *	data;
+
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	if( capacity <= thisp->capacity )
+		return LIBF2_STATUS_SUCCESS;
+	if( capacity < thisp->capacity * 2 )
+		capacity = thisp->capacity * 2;
+	data = (uint8_t *) realloc( thisp->data, capacity );
+	if( nullptr == data )
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	thisp->data = data;
+	thisp->capacity = capacity;
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Run the reader/worker/writer pipeline.
+ * @param[in] thisp (apphuffman_pipeline *) pipeline with stage callbacks, block_count, worker_count and job_count set.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	The reader and workers run in their own threads, the writer runs in the calling thread. Stages pass jobs through
+ * bounded lock-free queues and idle stages yield, so reading, coding and writing of different blocks overlap.
+ * job_count bounds the memory: blocks are read no further ahead than the writer has recycled their jobs.
+ *	The reader and the writer keep up to queue_depth transfers in flight (see apphuffman_aio), so striped storage
+ * is kept busy. On return output_offset is the offset past the last block.
+ */
+libf2_status_t	apphuffman_run_pipeline( apphuffman_pipeline * thisp )
+{
+	_pipeline_state				state;
+	apphuffman_pipeline_job *	jobs;
+	apphuffman_pipeline_job **	pending;
+	_thread *					threads;
+	apphuffman_buffer **		buffers;
+	size_t						i, thread_count, started_count;
+	int							aio_initialized;
+	libf2_status_t				status;
+
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( nullptr == thisp->locate || nullptr == thisp->process )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( 0 == thisp->worker_count || 0 == thisp->job_count )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	if( 0 == thisp->block_count )
+		return LIBF2_STATUS_SUCCESS;
+
+	// Allocate jobs and queues
+	thread_count = thisp->worker_count + 1;
+	jobs = (apphuffman_pipeline_job *) calloc( thisp->job_count, sizeof(*jobs) );
+	pending = (apphuffman_pipeline_job **) calloc( thisp->job_count, sizeof(*pending) );
+	threads = (_thread *) calloc( thread_count, sizeof(*threads) );
+	memset( &state, 0, sizeof(state) );
+	state.pipeline = thisp;
+	buffers = (apphuffman_buffer **) malloc( 2 * thisp->job_count * sizeof(*buffers) );
+	status = nullptr == jobs || nullptr == pending || nullptr == threads || nullptr == buffers ?
+		LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY : LIBF2_STATUS_SUCCESS;
+	for( i = 0; i < thisp->job_count && libf2_succeeded( status ); ++ i ) {
+		buffers[i] = &jobs[i].input;
+		buffers[thisp->job_count + i] = &jobs[i].output;
+		status = apphuffman_buffer_reserve( &jobs[i].input, thisp->block_size );
+		if( libf2_succeeded( status ) )
+			status = apphuffman_buffer_reserve( &jobs[i].output, thisp->block_size );
+	}
+
+	// Set up I/O before workers can reallocate buffers
+	if( libf2_succeeded( status ) ) {
+		status = apphuffman_aio_initialize( &state.read_aio, thisp->queue_depth, buffers, thisp->job_count );
+		if( libf2_succeeded( status ) ) {
+			status = apphuffman_aio_initialize( &state.write_aio, thisp->queue_depth, buffers + thisp->job_count, thisp->job_count );
+			if( libf2_failed( status ) )
+				(void) apphuffman_aio_deinitialize( &state.read_aio );
+		}
+	}
+	aio_initialized = libf2_succeeded( status );
+	if( libf2_succeeded( status ) )
+		status = _queue_initialize( &state.free_queue, thisp->job_count );
+	if( libf2_succeeded( status ) )
+		status = _queue_initialize( &state.work_queue, thisp->job_count );
+	if( libf2_succeeded( status ) )
+		status = _queue_initialize( &state.done_queue, thisp->job_count );
+	for( i = 0; i < thisp->job_count && libf2_succeeded( status ); ++ i )
+		(void) _queue_push( &state.free_queue, &jobs[i] );
+
+	// Start the reader and workers, write in this thread
+	started_count = 0;
+	if( libf2_succeeded( status ) ) {
+		for( ; started_count < thread_count; ++ started_count ) {
+			threads[started_count].proc = _run_stage;
+			threads[started_count].param = &state;
+			threads[started_count].index = 0 == started_count ? (size_t) -1 : started_count - 1;
+			if( !_thread_start( &threads[started_count] ) ) {
+				_fail( &state, LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY );
+				break;
+			}
+		}
+		if( started_count == thread_count )
+			_write_blocks( &state, pending );
+		for( i = 0; i < started_count; ++ i )
+			_thread_join( &threads[i] );
+		if( state.failed )
+			status = state.status;
+	}
+
+	// Clean up
+	_queue_deinitialize( &state.done_queue );
+	_queue_deinitialize( &state.work_queue );
+	_queue_deinitialize( &state.free_queue );
+	if( aio_initialized ) {
+		(void) apphuffman_aio_deinitialize( &state.write_aio );
+		(void) apphuffman_aio_deinitialize( &state.read_aio );
+	}
+	if( nullptr != jobs ) {
+		for( i = 0; i < thisp->job_count; ++ i ) {
+			free( jobs[i].input.data );
+			free( jobs[i].output.data );
+		}
+	}
+	free( buffers );
+	free( threads );
+	free( pending );
+	free( jobs );
+
+	// Exit
+	return status;
+}
+
+/**
+ * @brief Run proc( param, index ) in count threads, index is 0..count - 1, and wait for all of them.
+ * @param[in] count (size_t) number of threads.
+ * @param[in] proc (void (*)( void *, size_t )) thread procedure.
+ * @param[in] param (void *) parameter of proc.
+ * @return (libf2_status_t) operation status code; if not all threads could be started, the started ones are waited
+ * for and LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY is returned.
+ */
+libf2_status_t	apphuffman_run_threads( size_t count, void (* proc)( void * param, size_t index ), void * param )
+{
+	_thread *	threads;
+	size_t		i, started_count;
+
+	// Check current state
+	__debugbreak_if( 0 == count || nullptr == proc )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+
+	// Start and wait
+	threads = (_thread *) calloc( count, sizeof(*threads) );
+	if( nullptr == threads )
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	for( started_count = 0; started_count < count; ++ started_count ) {
+		threads[started_count].proc = proc;
+		threads[started_count].param = param;
+		threads[started_count].index = started_count;
+		if( !_thread_start( &threads[started_count] ) )
+			break;
+	}
+	for( i = 0; i < started_count; ++ i )
+		_thread_join( &threads[i] );
+	free( threads );
+
+	// Exit
+	return started_count == count ? LIBF2_STATUS_SUCCESS : LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Streamed file coding
+
+typedef struct _codec {
+	apphuffman_context *		app;
+	libhuffman_context *		context;
+	libhuffman_encoder_table *	encoder_table;	//< shared by workers, read only
+	libhuffman_decoder_table *	decoder_table;	//< shared by workers, read only
+	int							input;			//< input file handle
+	int							output;			//< output file handle
+	uint64_t					input_size;
+	uint64_t					read_offset;	//< offset of the next stream to read
+	uint32_t *					lengths;		//< sizes of streams, in bytes
+} _codec;
+
+static libf2_status_t libf2_callconv _buffer_ostream_write( libf2_ostream * ostream, const void * data, size_t size, size_t * nwritten )
+{
+	apphuffman_buffer_ostream *	thisp = (apphuffman_buffer_ostream *) ostream;
+	libf2_status_t		status;
+
+	*nwritten = 0;
+	status = apphuffman_buffer_reserve( thisp->buffer, thisp->buffer->size + size );
+	if( libf2_failed( status ) )
+		return status;
+	memcpy( thisp->buffer->data + thisp->buffer->size, data, size );
+	thisp->buffer->size += size;
+	*nwritten = size;
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Initialize output stream that appends to the buffer.
+ * @param[out] thisp (apphuffman_buffer_ostream *) stream to initialize.
+ * @param[in] buffer (apphuffman_buffer *) buffer the data are appended to.
+ */
+void	apphuffman_buffer_ostream_initialize( apphuffman_buffer_ostream * thisp, apphuffman_buffer * buffer )
+{
+	memset( thisp, 0, sizeof(*thisp) );
+	thisp->ostream.write = _buffer_ostream_write;
+	thisp->buffer = buffer;
+}
+
+static libf2_status_t _read_exact( int h, void * data, size_t size )
+{
+	int nread;
+
+	for( ; 0 != size; size -= (size_t) nread, data = (uint8_t *) data + nread ) {
+		nread = _read( h, data, size < 0x40000000 ? (unsigned) size : 0x40000000 );
+		if( nread <= 0 )
+			return LIBF2_STATUS_ERROR_READING;
+	}
+	return LIBF2_STATUS_SUCCESS;
+}
+static libf2_status_t _write_exact( int h, const void * data, size_t size )
+{
+	int nwritten;
+
+	for( ; 0 != size; size -= (size_t) nwritten, data = (const uint8_t *) data + nwritten ) {
+		nwritten = _write( h, data, size < 0x40000000 ? (unsigned) size : 0x40000000 );
+		if( nwritten <= 0 )
+			return LIBF2_STATUS_ERROR_WRITING;
+	}
+	return LIBF2_STATUS_SUCCESS;
+}
+static libf2_status_t _write_uint32_array( int h, const uint32_t * values, size_t count )
+{
+	uint8_t			buf[256];
+	size_t			i, n;
+	libf2_status_t	status = LIBF2_STATUS_SUCCESS;
+
+	for( n = 0, i = 0; i < count && libf2_succeeded( status ); ++ i ) {
+		buf[n ++] = (uint8_t) (values[i]);
+		buf[n ++] = (uint8_t) (values[i] >> 8);
+		buf[n ++] = (uint8_t) (values[i] >> 16);
+		buf[n ++] = (uint8_t) (values[i] >> 24);
+		if( sizeof(buf) == n || i + 1 == count ) {
+			status = _write_exact( h, buf, n );
+			n = 0;
+		}
+	}
+	return status;
+}
+static uint32_t _get_uint32( const uint8_t * p )
+{
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static libf2_status_t _locate_source_block( apphuffman_pipeline * thisp, size_t index, uint64_t * offset, size_t * size )
+{
+	_codec * codec = (_codec *) thisp->param;
+
+	*offset = (uint64_t) index * codec->app->block_size;
+	*size = codec->input_size - *offset < codec->app->block_size ? (size_t) (codec->input_size - *offset) : codec->app->block_size;
+	return LIBF2_STATUS_SUCCESS;
+}
+static libf2_status_t _locate_stream_block( apphuffman_pipeline * thisp, size_t index, uint64_t * offset, size_t * size )
+{
+	_codec * codec = (_codec *) thisp->param;
+
+	*offset = codec->read_offset;
+	*size = codec->lengths[index];
+	codec->read_offset += codec->lengths[index];
+	return LIBF2_STATUS_SUCCESS;
+}
+
+static libf2_status_t _encode_block( apphuffman_pipeline * thisp, size_t worker_index, const apphuffman_buffer * input, apphuffman_buffer * output )
+{
+	_codec *					codec = (_codec *) thisp->param;
+	libf2_status_t				status;
+	libf2_static_memory_istream	istream;
+	apphuffman_buffer_ostream	ostream;
+	libhuffman_encode_context	encode_context;
+
+	libf2_unreferenced_parameter( worker_index );
+
+	apphuffman_buffer_ostream_initialize( &ostream, output );
+
+	status = libf2_static_buffer_istream_initialize( &istream, input->data, input->size );
+	__debugbreak_ifnot( libf2_succeeded( status ) ) {
+		status = libhuffman_initialize_encode_context( &encode_context, codec->context, codec->encoder_table, &istream.istream, &ostream.ostream );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			encode_context.value_bit_size = APPHUFFMAN_VALUE_BIT_SIZE;
+			status = libhuffman_encode( &encode_context );
+			(void) libhuffman_deinitialize_encode_context( &encode_context );
+		}
+		(void) libf2_static_buffer_istream_deinitialize( &istream );
+	}
+	return status;
+}
+static libf2_status_t _decode_block( apphuffman_pipeline * thisp, size_t worker_index, const apphuffman_buffer * input, apphuffman_buffer * output )
+{
+	_codec *					codec = (_codec *) thisp->param;
+	libf2_status_t				status;
+	libf2_static_memory_istream	istream;
+	apphuffman_buffer_ostream	ostream;
+	libhuffman_decode_context	decode_context;
+
+	libf2_unreferenced_parameter( worker_index );
+
+	apphuffman_buffer_ostream_initialize( &ostream, output );
+
+	status = libf2_static_buffer_istream_initialize( &istream, input->data, input->size );
+	__debugbreak_ifnot( libf2_succeeded( status ) ) {
+		status = libhuffman_initialize_decode_context( &decode_context, codec->context, codec->decoder_table, &istream.istream, &ostream.ostream );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			status = libhuffman_decode( &decode_context );
+			(void) libhuffman_deinitialize_decode_context( &decode_context );
+		}
+		(void) libf2_static_buffer_istream_deinitialize( &istream );
+	}
+	return status;
+}
+
+static libf2_status_t _complete_stream_block( apphuffman_pipeline * thisp, size_t index, const apphuffman_buffer * output )
+{
+	_codec * codec = (_codec *) thisp->param;
+
+	if( (uint32_t) -1 < output->size )
+		return LIBF2_STATUS_ERROR_NOT_SUPPORTED;
+	codec->lengths[index] = (uint32_t) output->size;
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Read header and stream directory of the streamed file.
+ * @internal
+ *
+ *	Streams are read at their offsets, starting from read_offset.
+ */
+static libf2_status_t _read_stream_directory( _codec * codec, size_t * stream_count_ptr )
+{
+	uint8_t			header[8];
+	uint8_t *		directory;
+	size_t			stream_count, directory_size, i;
+	uint64_t		data_size;
+	libf2_status_t	status;
+
+	status = _read_exact( codec->input, header, sizeof(header) );
+	if( libf2_failed( status ) )
+		return status;
+	if( APPHUFFMAN_STREAMED_SIGNATURE != _get_uint32( header ) )
+		return LIBF2_STATUS_ERROR_FORMAT_NOT_SUPPORTED;
+	stream_count = _get_uint32( header + 4 );
+	directory_size = 4 * stream_count + 8;
+	if( codec->input_size < sizeof(header) + directory_size )
+		return LIBF2_STATUS_ERROR_INVALID_DATA;
+
+	codec->lengths = (uint32_t *) malloc( (stream_count + 1) * sizeof(*codec->lengths) );
+	directory = (uint8_t *) malloc( directory_size );
+	status = nullptr == codec->lengths || nullptr == directory ? LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY : LIBF2_STATUS_SUCCESS;
+	if( libf2_succeeded( status ) && -1 == _lseeki64( codec->input, (int64_t) (codec->input_size - directory_size), SEEK_SET ) )
+		status = LIBF2_STATUS_ERROR_READING;
+	if( libf2_succeeded( status ) )
+		status = _read_exact( codec->input, directory, directory_size );
+	if( libf2_succeeded( status ) && (APPHUFFMAN_DIRECTORY_SIGNATURE != _get_uint32( directory )
+		|| APPHUFFMAN_DIRECTORY_SIGNATURE != _get_uint32( directory + directory_size - 4 )) )
+		status = LIBF2_STATUS_ERROR_INVALID_DATA;
+	for( data_size = 0, i = 0; i < stream_count && libf2_succeeded( status ); ++ i ) {
+		codec->lengths[i] = _get_uint32( directory + 4 + 4 * i );
+		data_size += codec->lengths[i];
+	}
+	if( libf2_succeeded( status ) && sizeof(header) + data_size + directory_size != codec->input_size )
+		status = LIBF2_STATUS_ERROR_INVALID_DATA;
+	codec->read_offset = sizeof(header);
+	free( directory );
+
+	*stream_count_ptr = stream_count;
+	return status;
+}
+
+/**
+ * @brief Encode or decode the streamed file with the reader/worker/writer pipeline.
+ * @param[in] thisp (apphuffman_context *) application context.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	Encoder splits input in blocks of block_size bytes and codes each of them as a stream of the streamed file;
+ * decoder decodes streams of the streamed file. Blocks are coded by worker_count threads while the next blocks are read
+ * and the previous ones are written, so the whole run takes about as long as the slowest stage.
+ */
+libf2_status_t	apphuffman_process_pipeline( apphuffman_context * thisp )
+{
+	libf2_status_t				status;
+	libhuffman_context			context;
+	libhuffman_encoder_table	encoder_table;
+	libhuffman_decoder_table	decoder_table;
+	libhuffman_code_desc *		desc_array = nullptr;
+	apphuffman_pipeline			pipeline;
+	_codec						codec;
+	uint32_t					header[2], signature;
+
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( nullptr == thisp->input_file || nullptr == thisp->table_file )
+		return LIBF2_STATUS_ERROR_INVALID_STATE;
+	__debugbreak_if( APPHUFFMAN_M_ENCODE != thisp->mode && APPHUFFMAN_M_DECODE != thisp->mode )
+		return LIBF2_STATUS_ERROR_INVALID_STATE;
+	if( 0 == thisp->block_size )
+		thisp->block_size = APPHUFFMAN_DEFAULT_BLOCK_SIZE;
+
+	// Open files
+	memset( &codec, 0, sizeof(codec) );
+	codec.app = thisp;
+	codec.context = &context;
+	codec.input = _open( thisp->input_file, _O_RDONLY | _O_BINARY | _O_SEQUENTIAL );
+	if( -1 == codec.input )
+		return LIBF2_STATUS_ERROR_NOT_FOUND;
+	codec.input_size = (uint64_t) _filelengthi64( codec.input );
+	if( nullptr != thisp->output_file )
+		codec.output = _open( thisp->output_file, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY | _O_SEQUENTIAL, _S_IREAD | _S_IWRITE );
+	else {
+		codec.output = _fileno( stdout );
+		(void) _setmode( codec.output, _O_BINARY );
+	}
+	if( -1 == codec.output ) {
+		_close( codec.input );
+		return LIBF2_STATUS_ERROR_NOT_FOUND;
+	}
+
+	// Set up the pipeline; output at the current position if it can't be positioned (pipe etc.)
+	libhuffman_initialize_context( &context, nullptr );
+	memset( &pipeline, 0, sizeof(pipeline) );
+	pipeline.param = &codec;
+	pipeline.input = codec.input;
+	pipeline.output = codec.output;
+	pipeline.output_offset = -1 == _lseeki64( codec.output, 0, SEEK_CUR ) ? (uint64_t) -1 : 0;
+	pipeline.block_size = thisp->block_size;
+	pipeline.worker_count = thisp->worker_count;
+	pipeline.queue_depth = thisp->queue_depth;
+	pipeline.job_count = 2 * (thisp->worker_count + thisp->queue_depth) + 2;
+
+	// Encode: header, streams, directory
+	if( APPHUFFMAN_M_ENCODE == thisp->mode ) {
+		pipeline.locate = _locate_source_block;
+		pipeline.process = _encode_block;
+		pipeline.complete = _complete_stream_block;
+		pipeline.block_count = (size_t) ((codec.input_size + thisp->block_size - 1) / thisp->block_size);
+		codec.lengths = (uint32_t *) malloc( (pipeline.block_count + 1) * sizeof(*codec.lengths) );
+		status = nullptr == codec.lengths ? LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY : LIBF2_STATUS_SUCCESS;
+		if( libf2_succeeded( status ) && (uint32_t) -1 < pipeline.block_count )
+			status = LIBF2_STATUS_ERROR_NOT_SUPPORTED;
+		if( libf2_succeeded( status ) )
+			status = libhuffman_initialize_encoder_table( &encoder_table, &context, 0 );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			codec.encoder_table = &encoder_table;
+			status = apphuffman_deserialize_encoder_table_file( &encoder_table, thisp->table_file );
+			if( libf2_succeeded( status ) ) {
+				header[0] = APPHUFFMAN_STREAMED_SIGNATURE;
+				header[1] = (uint32_t) pipeline.block_count;
+				status = _write_uint32_array( codec.output, header, 2 );
+				if( (uint64_t) -1 != pipeline.output_offset )
+					pipeline.output_offset = sizeof(header);
+			}
+			if( libf2_succeeded( status ) )
+				status = apphuffman_run_pipeline( &pipeline );
+			if( libf2_succeeded( status ) && (uint64_t) -1 != pipeline.output_offset
+				&& -1 == _lseeki64( codec.output, (int64_t) pipeline.output_offset, SEEK_SET ) )
+				status = LIBF2_STATUS_ERROR_WRITING;
+			signature = APPHUFFMAN_DIRECTORY_SIGNATURE;
+			if( libf2_succeeded( status ) )
+				status = _write_uint32_array( codec.output, &signature, 1 );
+			if( libf2_succeeded( status ) )
+				status = _write_uint32_array( codec.output, codec.lengths, pipeline.block_count );
+			if( libf2_succeeded( status ) )
+				status = _write_uint32_array( codec.output, &signature, 1 );
+			(void) libhuffman_deinitialize_encoder_table( &encoder_table );
+		}
+	}
+
+	// Decode: streams in order
+	else {
+		pipeline.locate = _locate_stream_block;
+		pipeline.process = _decode_block;
+		status = libhuffman_initialize_decoder_table( &decoder_table, &context, nullptr );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			codec.decoder_table = &decoder_table;
+			status = apphuffman_deserialize_decoder_table_file( &decoder_table, thisp->table_file, &desc_array );
+			if( libf2_succeeded( status ) )
+				status = _read_stream_directory( &codec, &pipeline.block_count );
+			if( libf2_succeeded( status ) )
+				status = apphuffman_run_pipeline( &pipeline );
+			(void) libhuffman_deinitialize_decoder_table( &decoder_table );
+			free( desc_array );
+		}
+	}
+
+	// Clean up
+	free( codec.lengths );
+	if( nullptr != thisp->output_file )
+		_close( codec.output );
+	_close( codec.input );
+
+	// Exit
+	return status;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Framed stream coding
+
+/**
+ * @brief Read up to size bytes, less only at the end of input.
+ * @internal
+ */
+static libf2_status_t _read_some( int h, void * data, size_t size, size_t * nread_ptr )
+{
+	int nread;
+
+	*nread_ptr = 0;
+	for( ; 0 != size; size -= (size_t) nread, data = (uint8_t *) data + nread, *nread_ptr += (size_t) nread ) {
+		nread = _read( h, data, size < 0x40000000 ? (unsigned) size : 0x40000000 );
+		if( 0 == nread )
+			break;
+		if( nread < 0 )
+			return LIBF2_STATUS_ERROR_READING;
+	}
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Encode input in frames of up to frame_count streams of block_size source bytes.
+ * @internal
+ */
+static libf2_status_t _encode_frames( apphuffman_pipeline * pipeline, size_t frame_count, apphuffman_buffer * buffers )
+{
+	_codec *			codec = (_codec *) pipeline->param;
+	apphuffman_buffer	block;
+	libf2_status_t		status;
+	size_t				block_size = codec->app->block_size;
+	size_t				size, count, i;
+	uint32_t			header[2];
+
+	// Frames until the end of input; the short frame is the last one
+	status = apphuffman_buffer_reserve( &buffers[0], frame_count * block_size );
+	for( size = frame_count * block_size; libf2_succeeded( status ) && frame_count * block_size == size; ) {
+		status = _read_some( codec->input, buffers[0].data, frame_count * block_size, &size );
+		if( libf2_failed( status ) || 0 == size )
+			break;
+		count = (size + block_size - 1) / block_size;
+		for( i = 0; i < count && libf2_succeeded( status ); ++ i ) {
+			block.data = buffers[0].data + i * block_size;
+			block.size = size - i * block_size < block_size ? size - i * block_size : block_size;
+			block.capacity = block.size;
+			buffers[i + 1].size = 0;
+			status = _encode_block( pipeline, 0, &block, &buffers[i + 1] );
+			if( libf2_succeeded( status ) )
+				status = _complete_stream_block( pipeline, i, &buffers[i + 1] );
+		}
+		header[0] = APPHUFFMAN_FRAME_SIGNATURE;
+		header[1] = (uint32_t) count;
+		if( libf2_succeeded( status ) )
+			status = _write_uint32_array( codec->output, header, 2 );
+		if( libf2_succeeded( status ) )
+			status = _write_uint32_array( codec->output, codec->lengths, count );
+		for( i = 0; i < count && libf2_succeeded( status ); ++ i )
+			status = _write_exact( codec->output, buffers[i + 1].data, buffers[i + 1].size );
+	}
+
+	// Terminating frame tells the end of data from truncated input
+	header[0] = APPHUFFMAN_FRAME_SIGNATURE;
+	header[1] = 0;
+	if( libf2_succeeded( status ) )
+		status = _write_uint32_array( codec->output, header, 2 );
+	return status;
+}
+
+/**
+ * @brief Decode frames stream by stream up to the terminating frame.
+ * @internal
+ */
+static libf2_status_t _decode_frames( apphuffman_pipeline * pipeline, apphuffman_buffer * buffers )
+{
+	_codec *		codec = (_codec *) pipeline->param;
+	libf2_status_t	status;
+	uint8_t			header[8];
+	size_t			count, i;
+
+	for( ;; ) {
+		status = _read_exact( codec->input, header, sizeof(header) );
+		if( libf2_failed( status ) )
+			return status;
+		if( APPHUFFMAN_FRAME_SIGNATURE != _get_uint32( header ) )
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+		count = _get_uint32( header + 4 );
+		if( 0 == count )
+			return LIBF2_STATUS_SUCCESS;
+		if( APPHUFFMAN_MAX_FRAME_STREAM_COUNT < count )
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+
+		// Directory of the frame, then its streams
+		status = apphuffman_buffer_reserve( &buffers[0], 4 * count );
+		if( libf2_succeeded( status ) )
+			status = _read_exact( codec->input, buffers[0].data, 4 * count );
+		for( i = 0; i < count && libf2_succeeded( status ); ++ i )
+			codec->lengths[i] = _get_uint32( buffers[0].data + 4 * i );
+		for( i = 0; i < count && libf2_succeeded( status ); ++ i ) {
+			status = apphuffman_buffer_reserve( &buffers[0], codec->lengths[i] );
+			if( libf2_succeeded( status ) )
+				status = _read_exact( codec->input, buffers[0].data, codec->lengths[i] );
+			buffers[0].size = codec->lengths[i];
+			buffers[1].size = 0;
+			if( libf2_succeeded( status ) )
+				status = _decode_block( pipeline, 0, &buffers[0], &buffers[1] );
+			if( libf2_succeeded( status ) )
+				status = _write_exact( codec->output, buffers[1].data, buffers[1].size );
+		}
+		if( libf2_failed( status ) )
+			return status;
+	}
+}
+
+/**
+ * @brief Encode or decode the framed stream, "-" is standard input or output.
+ * @param[in] thisp (apphuffman_context *) application context.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	Each frame carries its own stream directory ahead of the streams, so neither side seeks or needs the input size:
+ * encoder holds one frame (stream_count blocks of block_size bytes, one if stream_count is 0) and decoder holds one
+ * stream at a time, whatever the length of the input.
+ */
+libf2_status_t	apphuffman_process_framed( apphuffman_context * thisp )
+{
+	libf2_status_t				status;
+	libhuffman_context			context;
+	libhuffman_encoder_table	encoder_table;
+	libhuffman_decoder_table	decoder_table;
+	libhuffman_code_desc *		desc_array = nullptr;
+	apphuffman_pipeline			pipeline;
+	_codec						codec;
+	apphuffman_buffer *			buffers;
+	size_t						frame_count, i;
+
+	// Check current state
+	__debugbreak_if( nullptr == thisp )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( nullptr == thisp->input_file || nullptr == thisp->table_file )
+		return LIBF2_STATUS_ERROR_INVALID_STATE;
+	__debugbreak_if( APPHUFFMAN_M_ENCODE != thisp->mode && APPHUFFMAN_M_DECODE != thisp->mode )
+		return LIBF2_STATUS_ERROR_INVALID_STATE;
+	if( thisp->rle || 0 != thisp->table_count )
+		return LIBF2_STATUS_ERROR_NOT_SUPPORTED;
+	if( 0 == thisp->block_size )
+		thisp->block_size = APPHUFFMAN_DEFAULT_BLOCK_SIZE;
+	frame_count = 0 == thisp->stream_count ? 1 : thisp->stream_count;
+	if( APPHUFFMAN_MAX_FRAME_STREAM_COUNT < frame_count )
+		return LIBF2_STATUS_ERROR_NOT_SUPPORTED;
+
+	// Open files
+	memset( &codec, 0, sizeof(codec) );
+	codec.app = thisp;
+	codec.context = &context;
+	if( apphuffman_is_stdio_name( thisp->input_file ) ) {
+		codec.input = _fileno( stdin );
+		(void) _setmode( codec.input, _O_BINARY );
+	} else
+		codec.input = _open( thisp->input_file, _O_RDONLY | _O_BINARY | _O_SEQUENTIAL );
+	if( -1 == codec.input )
+		return LIBF2_STATUS_ERROR_NOT_FOUND;
+	if( nullptr != thisp->output_file && !apphuffman_is_stdio_name( thisp->output_file ) )
+		codec.output = _open( thisp->output_file, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY | _O_SEQUENTIAL, _S_IREAD | _S_IWRITE );
+	else {
+		codec.output = _fileno( stdout );
+		(void) _setmode( codec.output, _O_BINARY );
+	}
+	if( -1 == codec.output ) {
+		if( !apphuffman_is_stdio_name( thisp->input_file ) )
+			_close( codec.input );
+		return LIBF2_STATUS_ERROR_NOT_FOUND;
+	}
+
+	// Frame buffers: source data and coded streams of the frame, or one coded and one decoded stream
+	libhuffman_initialize_context( &context, nullptr );
+	memset( &pipeline, 0, sizeof(pipeline) );
+	pipeline.param = &codec;
+	codec.lengths = (uint32_t *) malloc( APPHUFFMAN_MAX_FRAME_STREAM_COUNT * sizeof(*codec.lengths) );
+	buffers = (apphuffman_buffer *) calloc( frame_count + 1, sizeof(*buffers) );
+	status = nullptr == codec.lengths || nullptr == buffers ? LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY : LIBF2_STATUS_SUCCESS;
+
+	// Code
+	if( libf2_succeeded( status ) && APPHUFFMAN_M_ENCODE == thisp->mode ) {
+		status = libhuffman_initialize_encoder_table( &encoder_table, &context, 0 );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			codec.encoder_table = &encoder_table;
+			status = apphuffman_deserialize_encoder_table_file( &encoder_table, thisp->table_file );
+			if( libf2_succeeded( status ) )
+				status = _encode_frames( &pipeline, frame_count, buffers );
+			(void) libhuffman_deinitialize_encoder_table( &encoder_table );
+		}
+	} else if( libf2_succeeded( status ) ) {
+		status = libhuffman_initialize_decoder_table( &decoder_table, &context, nullptr );
+		__debugbreak_ifnot( libf2_succeeded( status ) ) {
+			codec.decoder_table = &decoder_table;
+			status = apphuffman_deserialize_decoder_table_file( &decoder_table, thisp->table_file, &desc_array );
+			if( libf2_succeeded( status ) )
+				status = _decode_frames( &pipeline, buffers );
+			(void) libhuffman_deinitialize_decoder_table( &decoder_table );
+			free( desc_array );
+		}
+	}
+
+	// Clean up
+	if( nullptr != buffers ) {
+		for( i = 0; i < frame_count + 1; ++ i )
+			free( buffers[i].data );
+		free( buffers );
+	}
+	free( codec.lengths );
+	if( nullptr != thisp->output_file && !apphuffman_is_stdio_name( thisp->output_file ) )
+		_close( codec.output );
+	if( !apphuffman_is_stdio_name( thisp->input_file ) )
+		_close( codec.input );
+
+	// Exit
+	return status;
+}
+
+/*END OF pipeline.c*/
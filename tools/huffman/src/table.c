@@ -20,14 +20,15 @@ libf2_status_t	libhuffman_callconv apphuffman_deserialize_decoder_table( libhuff
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-libf2_status_t	libhuffman_callconv apphuffman_deserialize_encoder_table_file( libhuffman_encoder_table * table, const char * file )
+libf2_status_t	libhuffman_callconv apphuffman_deserialize_encoder_table_memory( libhuffman_encoder_table * table,
+	void * data, size_t data_size, const char * file )
 {
 	libf2_status_t	status;
 	libhuffman_code_desc * desc_array;
 	size_t desc_count;
 
-	// Load table file
-	status = apphuffman_load_table_from_file( &desc_array, &desc_count, file );
+	// Load table
+	status = apphuffman_load_table_from_memory( &desc_array, &desc_count, data, data_size, file );
 	if( libf2_failed(status) )
 		return status;
 
@@ -38,60 +39,119 @@ libf2_status_t	libhuffman_callconv apphuffman_deserialize_encoder_table_file( li
 	// Exit
 	return status;
 }
+libf2_status_t	libhuffman_callconv apphuffman_deserialize_encoder_table_file( libhuffman_encoder_table * table, const char * file )
+{
+	libf2_status_t	status;
+	void * data;
+	size_t data_size;
+
+	// Map table file, codes are parsed right from the mapping
+	status = apphuffman_map_file( file, &data, &data_size );
+	if( libf2_failed(status) )
+		return status;
+
+	// Add all codes
+	status = apphuffman_deserialize_encoder_table_memory( table, data, data_size, file );
+	apphuffman_unmap_file( data, data_size );
+
+	// Exit
+	return status;
+}
 libf2_status_t	libhuffman_callconv apphuffman_deserialize_encoder_table_stream( libhuffman_encoder_table * table,
 	libf2_istream * istream )
 {
 	libf2_status_t	status;
-	libhuffman_code_desc * desc_array;
-	size_t desc_count;
+	void * data;
+	size_t data_size;
 
-	// Load table file
-	status = apphuffman_load_table_from_stream( &desc_array, &desc_count, istream, nullptr );
+	// Read entire stream
+	status = apphuffman_load_stream( istream, &data, &data_size );
 	if( libf2_failed(status) )
 		return status;
 
 	// Add all codes
-	status = libhuffman_encoder_table_append_codes( table, desc_array, desc_count );
-	free( desc_array );
+	status = apphuffman_deserialize_encoder_table_memory( table, data, data_size, nullptr );
+	free( data );
 
 	// Exit
 	return status;
 }
 
 
-libf2_status_t	libhuffman_callconv apphuffman_deserialize_decoder_table_file( libhuffman_decoder_table * table, const char * file )
+libf2_status_t	libhuffman_callconv apphuffman_deserialize_decoder_table_memory( libhuffman_decoder_table * table,
+	void * data, size_t data_size, const char * file,
+	libhuffman_code_desc ** desc_array_out )
 {
 	libf2_status_t	status;
 	libhuffman_code_desc * desc_array;
 	size_t desc_count;
 
-	// Load table file
-	status = apphuffman_load_table_from_file( &desc_array, &desc_count, file );
+	// Check current state
+	__debugbreak_if( nullptr == desc_array_out )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	*desc_array_out = nullptr;
+
+	// Load table
+	status = apphuffman_load_table_from_memory( &desc_array, &desc_count, data, data_size, file );
 	if( libf2_failed(status) )
 		return status;
 
-	// Add all codes
+	// Add all codes; table entries refer to escapes stored with the descriptors, so they're kept until the table is released
 	status = libhuffman_decoder_table_append_codes( table, desc_array, desc_count );
-	free( desc_array );
+	if( libf2_failed(status) ) {
+		free( desc_array );
+		return status;
+	}
+
+	// Exit
+	*desc_array_out = desc_array;
+	return status;
+}
+libf2_status_t	libhuffman_callconv apphuffman_deserialize_decoder_table_file( libhuffman_decoder_table * table, const char * file,
+	libhuffman_code_desc ** desc_array_out )
+{
+	libf2_status_t	status;
+	void * data;
+	size_t data_size;
+
+	// Check current state
+	__debugbreak_if( nullptr == desc_array_out )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	*desc_array_out = nullptr;
+
+	// Map table file, codes are parsed right from the mapping
+	status = apphuffman_map_file( file, &data, &data_size );
+	if( libf2_failed(status) )
+		return status;
+
+	// Add all codes
+	status = apphuffman_deserialize_decoder_table_memory( table, data, data_size, file, desc_array_out );
+	apphuffman_unmap_file( data, data_size );
 
 	// Exit
 	return status;
 }
 libf2_status_t	libhuffman_callconv apphuffman_deserialize_decoder_table_stream( libhuffman_decoder_table * table,
-	libf2_istream * istream )
+	libf2_istream * istream,
+	libhuffman_code_desc ** desc_array_out )
 {
 	libf2_status_t	status;
-	libhuffman_code_desc * desc_array;
-	size_t desc_count;
+	void * data;
+	size_t data_size;
 
-	// Load table file
-	status = apphuffman_load_table_from_stream( &desc_array, &desc_count, istream, nullptr );
+	// Check current state
+	__debugbreak_if( nullptr == desc_array_out )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	*desc_array_out = nullptr;
+
+	// Read entire stream
+	status = apphuffman_load_stream( istream, &data, &data_size );
 	if( libf2_failed(status) )
 		return status;
 
 	// Add all codes
-	status = libhuffman_decoder_table_append_codes( table, desc_array, desc_count );
-	free( desc_array );
+	status = apphuffman_deserialize_decoder_table_memory( table, data, data_size, nullptr, desc_array_out );
+	free( data );
 
 	// Exit
 	return status;
@@ -131,7 +191,33 @@ libf2_status_t	libhuffman_callconv apphuffman_deserialize_decoder_table_stream(
 */
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static unsigned char_to_digit( int c )
+/**
+ * @brief Text table parser state.
+ * @internal
+ *
+ *	The file is parsed twice: the first pass only counts descriptors and escape names, so all results are stored
+ * in a single block that is allocated between the passes.
+ */
+typedef struct _txt_parser {
+	const char *			s;				//< current position
+	const char *			end_s;			//< end of the file data
+	unsigned				line;			//< current line number, 1-based
+	const char *			error;			//< error message, nullptr if no error occurred
+	libhuffman_code_desc *	desc_array;		//< descriptors; nullptr in the counting pass
+	libhuffman_escape *		escape_array;	//< escapes of action lines
+	char *					names;			//< zero-terminated escape names
+	size_t					desc_count;
+	size_t					escape_count;
+	size_t					name_size;		//< size of all names including terminating zeroes, in bytes
+} _txt_parser;
+
+static int _parse_error( _txt_parser * p, const char * error )
+{
+	p->error = error;
+	return 0;
+}
+
+static unsigned _char_to_digit( int c )
 {
 	if( '0' <= c && c <= '9' )
 		return c - '0';
@@ -142,192 +228,322 @@ static unsigned char_to_digit( int c )
 	return (unsigned) -1;
 }
 
-int fetch_uint64( const char ** in_s, const char * end_s, uint64_t * out_value )
+/**
+ * @brief Skip spaces and comments up to the end of line.
+ * @internal
+ */
+static void _skip_spaces( _txt_parser * p )
+{
+	const char * s = p->s;
+
+	while( s < p->end_s ) {
+		if( '\x20' == *s || '\t' == *s || '\f' == *s || '\r' == *s || '\v' == *s )
+			++ s;
+		else if( '/' == *s && s + 1 < p->end_s && '/' == s[1] ) {
+			for( s += 2; s < p->end_s && '\n' != *s; ++ s )
+				;
+		} else if( '/' == *s && s + 1 < p->end_s && '*' == s[1] ) {
+			for( s += 2; s < p->end_s && !('*' == s[0] && s + 1 < p->end_s && '/' == s[1]); ++ s ) {
+				if( '\n' == *s )
+					++ p->line;
+			}
+			s = s < p->end_s ? s + 2 : s;
+		} else
+			break;
+	}
+	p->s = s;
+}
+
+/**
+ * @brief Skip spaces and comments and the end of line.
+ * @internal
+ */
+static int _skip_line_end( _txt_parser * p )
+{
+	_skip_spaces( p );
+	if( p->s < p->end_s ) {
+		if( '\n' != *p->s )
+			return _parse_error( p, "unexpected characters at the end of line" );
+		++ p->s;
+		++ p->line;
+	}
+	return 1;
+}
+
+static int _skip_colon( _txt_parser * p )
+{
+	_skip_spaces( p );
+	if( p->s >= p->end_s || ':' != *p->s )
+		return _parse_error( p, "':' expected" );
+	++ p->s;
+	_skip_spaces( p );
+	return 1;
+}
+
+/**
+ * @brief Fetch number in any radix; digits can be separated with underscores.
+ * @internal
+ */
+static int _fetch_number( _txt_parser * p, uint64_t * value_ptr )
 {
-	const char * s = *in_s;
-	unsigned radix = 10;
-	uint64_t value = 0;
-	int res;
+	const char *	s = p->s;
+	unsigned		radix = 10, digit, digit_count = 0;
+	uint64_t		value = 0;
 
 	// Fetch prefix
-	if( '0' == s[0] ) {
+	if( s + 1 < p->end_s && '0' == s[0] ) {
 		switch( s[1] ) {
-		case 'b':case 'B':	radix =  2; s += 2; *in_s += 2; break;
-		case 'o':case 'O':	radix =  8; s += 2; *in_s += 2; break;
-		case 'd':case 'D':	radix = 10; s += 2; *in_s += 2; break;
-		case 'x':case 'X':	radix = 16; s += 2; *in_s += 2; break;
+		case 'b':case 'B':	radix =  2; s += 2; break;
+		case 'o':case 'O':	radix =  8; s += 2; break;
+		case 'd':case 'D':	radix = 10; s += 2; break;
+		case 'x':case 'X':	radix = 16; s += 2; break;
 		}
 	}
 
 	// Fetch number
-	for( ; s < end_s; ++ s ) {
-		unsigned digit = char_to_digit( *s );
-		if( (unsigned) -1 == digit )
+	for( ; s < p->end_s; ++ s ) {
+		if( '_' == *s && 0 != digit_count )
+			continue;
+		digit = _char_to_digit( *s );
+		if( digit >= radix )
 			break;
+		if( value > (UINT64_MAX - digit) / radix )
+			return _parse_error( p, "number is too large" );
 		value = value * radix + digit;
+		++ digit_count;
 	}
-
-	// Done
-	* out_value = value;
-	res = *in_s != s;
+	if( 0 == digit_count )
+		return _parse_error( p, "number expected" );
 
 	// Exit
-	*in_s = s;
-	return res;
-}
-int fetch_uint32( const char ** s, const char * end_s, uint32_t * value )
-{
-	uint64_t value64;
-	if( !fetch_uint64( s, end_s, &value64 ) )
-		return 0;
-	*value = (uint32_t) value64;
-	return *s < end_s;
+	*value_ptr = value;
+	p->s = s;
+	return 1;
 }
-int skip_spaces( const char ** in_s, const char * end_s )
+
+/**
+ * @brief Fetch sequence of binary digits, the first digit is the most significant bit.
+ * @internal
+ *
+ *	Digits are converted eight at a time: each byte of the word is checked to be '0' or '1' and the bytes are
+ * gathered into a single byte with a multiplication.
+ */
+static int _fetch_bits( _txt_parser * p, libhuffman_bit_run * run )
 {
-	const char * s = *in_s;
-	for( ; s < end_s; ++ s ) {
-		if( '\x20' == *s || '\t' == *s || '\f' == *s )
-			continue;
-		if( '\n' == *s || '\r' == *s )
-			continue;
-		if( '/' == *s ) {
-			if( '/' == s[1] ) {
-				for( ; s < end_s; ++ s ) {
-					if( '\n' == *s || '\r' == *s )
-						break;
-				}
-			} else if( '*' == s[1] ) {
-				for( ; ; ) {
-					s += 2;
-					if( s >= end_s - 1 )
-						break;
-					if( '*' == s[0] || '/' == s[1] )
-						break;
-				}
-			} else
-				break;
-		}
-		break;
+	const uint8_t *	s = (const uint8_t *) p->s;
+	const uint8_t *	end_s = (const uint8_t *) p->end_s;
+	uint64_t		bits = 0, word;
+	unsigned		length = 0;
+
+	// Convert eight digits at a time
+	while( end_s - s >= 8 && length <= LIBHUFFMAN_MAX_CODE_LENGTH ) {
+		word =	(uint64_t) s[0]		   | ((uint64_t) s[1] <<  8) | ((uint64_t) s[2] << 16) | ((uint64_t) s[3] << 24) |
+				((uint64_t) s[4] << 32) | ((uint64_t) s[5] << 40) | ((uint64_t) s[6] << 48) | ((uint64_t) s[7] << 56);
+		word ^= 0x3030303030303030ULL;		// '0' and '1' become 0 and 1
+		if( 0 != (word & 0xFEFEFEFEFEFEFEFEULL) )
+			break;
+		bits = (bits << 8) | ((word * 0x8040201008040201ULL) >> 56);
+		length += 8;
+		s += 8;
+	}
+
+	// Convert the rest
+	for( ; s < end_s && ('0' == *s || '1' == *s) && length <= LIBHUFFMAN_MAX_CODE_LENGTH; ++ s ) {
+		bits = (bits << 1) | (unsigned) (*s - '0');
+		++ length;
 	}
-	*in_s = s;
-	return s < end_s;
+	if( 0 == length )
+		return _parse_error( p, "binary digits expected" );
+	if( LIBHUFFMAN_MAX_CODE_LENGTH < length )
+		return _parse_error( p, "bit sequence is too long" );
+
+	// Exit
+	run->bits = (libhuffman_code_t) bits;
+	run->length = (uint8_t) length;
+	p->s = (const char *) s;
+	return 1;
 }
-int skip_new_line( const char ** s, const char * end_s )
+
+static int _fetch_name( _txt_parser * p, const char ** name, size_t * name_length )
 {
-	if( !skip_spaces( s, end_s ) )
-		return 0;
-	while( *s < end_s && ('\n' == **s || '\r' == **s) )
-		++ *s;
-	return *s < end_s;
+	const char * s = p->s;
+
+	for( ; s < p->end_s && ('_' == *s || isalnum( (unsigned char) *s )); ++ s )
+		;
+	*name = p->s;
+	*name_length = s - p->s;
+	p->s = s;
+	return 1;
 }
 
-libf2_status_t	apphuffman_load_table_from_txt(
-	libhuffman_code_desc ** desc_array_out, size_t * desc_count_out,
-	const void * data, size_t data_size )
+/**
+ * @brief Parse the code line.
+ * @internal
+ *
+ *	Supported forms (values and parameters are binary, their length is the number of digits):
+ *	code : count : value			(count in any numeric format)
+ *	code : E : parameter			(event)
+ *	code : NAME [: parameter]		(action, reported to the client with escape name)
+ */
+static int _parse_code_line( _txt_parser * p )
 {
-	libf2_status_t	status;
-	const char * s, * end_s;
-	size_t desc_array_size = 0;
-	//libhuffman_code_desc code_desc;
-	libhuffman_code_desc * desc_array = nullptr;
-	libhuffman_code_desc * desc;// = &code_desc;
+	libhuffman_code_desc	desc;
+	libhuffman_escape *		escape;
+	const char *			name;
+	size_t					name_length;
+	uint64_t				value;
 
-	// Prepare
-	s = (const char *) data;
-	end_s = (const char *) data + data_size;
+	memset( &desc, 0, sizeof(desc) );
 
-	// Process file data
-	status = LIBF2_STATUS_ERROR_FORMAT_NOT_SUPPORTED;
-	for(;;) {
-		if( !skip_spaces( &s, end_s ) )
-			break;
+	// Code
+	if( !_fetch_bits( p, &desc.code ) || !_skip_colon( p ) )
+		return 0;
 
-		// Resize buffer
-		desc = 0 == desc_array_size ?
-			(libhuffman_code_desc *) malloc( sizeof(libhuffman_code_desc) ):
-			(libhuffman_code_desc *) realloc( desc_array, (desc_array_size + 1) * sizeof(libhuffman_code_desc) );
-		__debugbreak_if( nullptr == desc ) {
-			status = LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
-			break;
-		}
-		desc_array = desc;
-		desc = desc + desc_array_size;
-		desc_array_size ++;
-		memset( desc, 0, sizeof(*desc) );
-
-		// Read bit run
-		desc->code = desc->code_bit_len = 0;
-		while( s < end_s && ('0' == *s || '1' == *s) ) {
-			++ desc->code_bit_len;
-			desc->code = (desc->code << 1) | (*s - '0');
+	if( p->s < p->end_s && (isalpha( (unsigned char) *p->s ) || '_' == *p->s) ) {
+
+		// Event or action
+		_fetch_name( p, &name, &name_length );
+		desc.count = (unsigned) -1;
+		_skip_spaces( p );
+		if( p->s < p->end_s && ':' == *p->s ) {
+			if( !_skip_colon( p ) || !_fetch_bits( p, &desc.value ) )
+				return 0;
+		} else if( 1 == name_length && ('E' == *name || 'e' == *name) )
+			return _parse_error( p, "event parameter expected" );
+
+		if( !(1 == name_length && ('E' == *name || 'e' == *name)) ) {
+			if( (uint16_t) -1 < name_length )
+				return _parse_error( p, "action name is too long" );
+			if( nullptr != p->desc_array ) {
+				escape = &p->escape_array[p->escape_count];
+				escape->name = p->names + p->name_size;
+				escape->name_length = (uint16_t) name_length;
+				escape->code = desc.code;
+				memcpy( p->names + p->name_size, name, name_length );
+				p->names[p->name_size + name_length] = '\0';
+				desc.escape = escape;
+			}
+			++ p->escape_count;
+			p->name_size += name_length + 1;
 		}
-		if( !skip_spaces( &s, end_s ) )
-			break;
+	} else {
 
-		// Read event id or value count
-		if( ':' != *s )
-			break;
-		if( 'E' == *s || 'e' == *s ){
-			++ s;
-			if( !skip_spaces( &s, end_s ) )
-				break;
-			desc->count = (unsigned) -1;
-		} else {
-			if( !fetch_uint32( &s, end_s, &desc->count ) )
-				break;
-			if( !skip_spaces( &s, end_s ) )
-				break;
-
-			// Read value length
-			if( ':' != *s )
-				break;
-			if( !fetch_uint32( &s, end_s, &desc->value_bit_len ) )
-				break;
-			if( !skip_spaces( &s, end_s ) )
-				break;
-		}
+		// Count
+		if( !_fetch_number( p, &value ) || !_skip_colon( p ) )
+			return 0;
+		if( (unsigned) -1 <= value )
+			return _parse_error( p, "count is too large" );
+		desc.count = (unsigned) value;
+
+		// Value
+		if( p->s < p->end_s && ('\"' == *p->s || '\'' == *p->s || '`' == *p->s) )
+			return _parse_error( p, "string values are not supported" );
+		if( !_fetch_bits( p, &desc.value ) )
+			return 0;
+	}
 
-		// Read value
-		if( ':' != *s )
-			break;
-		if( '\"' == *s || '\'' == *s || '`' == *s ) {
-			status = LIBF2_STATUS_ERROR_NOT_SUPPORTED;
-			//unsigned char end_ch = *s ++;
-		} else if( isdigit( *s ) ) {
-			uint64_t value;
-			if( !fetch_uint64( &s, end_s, &value ) )
-				break;
-
-			desc->value = (libhuffman_value_t) value;
-			if( desc->value != value )
-				return LIBF2_STATUS_ERROR_INVALID_STATE;
-		}
-		if( !skip_spaces( &s, end_s ) )
-			break;
+	// Store descriptor
+	if( nullptr != p->desc_array )
+		p->desc_array[p->desc_count] = desc;
+	++ p->desc_count;
+
+	// Exit
+	return _skip_line_end( p );
+}
 
-		// Set table entry
-		//status = libhuffman_decoder_table_append_codes( table, desc, 1 );
-		//if( libf2_failed( status ) )
-		//	break;
+/**
+ * @brief Parse the whole file.
+ * @internal
+ */
+static int _parse_table( _txt_parser * p, const char * data, size_t data_size )
+{
+	p->s = data;
+	p->end_s = data + data_size;
+	p->line = 1;
+	p->error = nullptr;
+	p->desc_count = p->escape_count = p->name_size = 0;
 
-		// Skip new line
-		if( !skip_new_line( &s, end_s ) )
+	for(;;) {
+		_skip_spaces( p );
+		if( p->s >= p->end_s )
 			break;
+
+		// Empty line
+		if( '\n' == *p->s ) {
+			++ p->s;
+			++ p->line;
+			continue;
+		}
+
+		// Code line
+		if( '0' != *p->s && '1' != *p->s )
+			return _parse_error( p, "code expected" );
+		if( !_parse_code_line( p ) )
+			return 0;
 	}
 
-	// Done
-	if( libf2_failed( status ) ) {
-		free( desc_array );
-		*desc_array_out = nullptr;
-		*desc_count_out = 0;
-	} else {
-		*desc_array_out = desc_array;
-		*desc_count_out = desc_array_size;
+	// Exit
+	return 1;
+}
+
+/**
+ * @brief Load code descriptors from the text table file.
+ * @param[out] desc_array_out (libhuffman_code_desc **) pointer to variable receiving the descriptor array (free it with free).
+ * @param[out] desc_count_out (size_t *) pointer to variable receiving number of descriptors.
+ * @param[in] data (const void *) file data.
+ * @param[in] data_size (size_t) size of file data, in bytes.
+ * @param[in] file (const char *) optional file name used in error messages.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	Descriptors, escapes and escape names are stored in a single block, so the result is released with a single
+ * free call. Errors are reported to stderr with line numbers.
+ */
+libf2_status_t	apphuffman_load_table_from_txt(
+	libhuffman_code_desc ** desc_array_out, size_t * desc_count_out,
+	const void * data, size_t data_size, const char * file )
+{
+	_txt_parser		parser;
+	size_t			desc_count, escape_count, name_size, block_size;
+	void *			block;
+
+	// Check current state
+	__debugbreak_if( nullptr == desc_array_out || nullptr == desc_count_out || (nullptr == data && 0 != data_size) )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	*desc_array_out = nullptr;
+	*desc_count_out = 0;
+
+	// Count descriptors
+	memset( &parser, 0, sizeof(parser) );
+	if( !_parse_table( &parser, (const char *) data, data_size ) ) {
+		fprintf( stderr, "%s(%u): error: %s\n", nullptr != file ? file : "table", parser.line, parser.error );
+		return LIBF2_STATUS_ERROR_INVALID_DATA;
+	}
+	if( 0 == parser.desc_count )
+		return LIBF2_STATUS_SUCCESS;
+	desc_count = parser.desc_count;
+	escape_count = parser.escape_count;
+	name_size = parser.name_size;
+
+	// Allocate all results at once
+	block_size = desc_count * sizeof(libhuffman_code_desc) + escape_count * sizeof(libhuffman_escape) + name_size;
+	block = malloc( block_size );
+	__debugbreak_if( nullptr == block )
+		return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+	parser.desc_array = (libhuffman_code_desc *) block;
+	parser.escape_array = (libhuffman_escape *) (parser.desc_array + desc_count);
+	parser.names = (char *) (parser.escape_array + escape_count);
+
+	// Store descriptors
+	if( !_parse_table( &parser, (const char *) data, data_size ) ) {
+		fprintf( stderr, "%s(%u): error: %s\n", nullptr != file ? file : "table", parser.line, parser.error );
+		free( block );
+		return LIBF2_STATUS_ERROR_INVALID_DATA;
 	}
 
 	// Exit
-	return status;
+	*desc_array_out = parser.desc_array;
+	*desc_count_out = desc_count;
+	return LIBF2_STATUS_SUCCESS;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -343,9 +559,11 @@ libf2_status_t	apphuffman_load_table_from_memory(
 	const char * ext;
 
 	// Load file
-	ext = strrchr( file, '.' );
-	if( nullptr != ext && !stricmp( ext, ".txt" ) )
-		status = apphuffman_load_table_from_txt( &desc_array, &desc_array_size, data, data_size );
+	ext = nullptr == file ? nullptr : strrchr( file, '.' );
+	if( apphuffman_is_binary_table( data, data_size ) )
+		status = apphuffman_load_table_from_bin( &desc_array, &desc_array_size, nullptr, data, data_size );
+	else if( nullptr != ext && (!stricmp( ext, ".txt" ) || !stricmp( ext, ".httf" )) )
+		status = apphuffman_load_table_from_txt( &desc_array, &desc_array_size, data, data_size, file );
 	else
 		status = LIBF2_STATUS_ERROR_FORMAT_NOT_SUPPORTED;
 
@@ -366,13 +584,13 @@ libf2_status_t	apphuffman_load_table_from_file(
 	size_t data_size;
 
 	// Open file
-	status = apphuffman_load_file( file, &data, &data_size );
+	status = apphuffman_map_file( file, &data, &data_size );
 	if( libf2_failed(status) )
 		return status;
 
 	// Load file and exit
 	status = apphuffman_load_table_from_memory( desc_array_out, desc_count_out, data, data_size, file );
-	free( data );
+	apphuffman_unmap_file( data, data_size );
 
 	// Exit
 	return status;
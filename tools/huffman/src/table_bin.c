@@ -0,0 +1,389 @@
+/*table_bin.c*/
+#include "pch.h"
+#include "main.h"
+
+#define APPHUFFMAN_TABLE_HEADER_SIZE		16		//< size of the binary table file header, in bytes
+#define APPHUFFMAN_TABLE_CODE_SIZE			24		//< size of the code record, in bytes
+#define APPHUFFMAN_TABLE_CODE_F_ACTION		0x01	//< code record flag: the code is an action, its name is the next one in the name section
+#define APPHUFFMAN_TABLE_LAYOUT_HEADER_SIZE	8		//< size of the layout header, in bytes
+#define APPHUFFMAN_TABLE_LAYOUT_TABLE_SIZE	16		//< size of the layout table record, in bytes
+
+static uint32_t _load_uint32( const uint8_t * p )
+{
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+static uint64_t _load_uint64( const uint8_t * p )
+{
+	return (uint64_t) _load_uint32( p ) | ((uint64_t) _load_uint32( p + 4 ) << 32);
+}
+static void _store_uint32( uint8_t * p, uint32_t value )
+{
+	p[0] = (uint8_t) (value);
+	p[1] = (uint8_t) (value >> 8);
+	p[2] = (uint8_t) (value >> 16);
+	p[3] = (uint8_t) (value >> 24);
+}
+static void _store_uint64( uint8_t * p, uint64_t value )
+{
+	_store_uint32( p, (uint32_t) value );
+	_store_uint32( p + 4, (uint32_t) (value >> 32) );
+}
+
+/**
+ * @brief Update Adler-32 checksum.
+ * @internal
+ */
+static uint32_t _adler32( uint32_t adler, const void * data, size_t size )
+{
+	const uint8_t *	p = (const uint8_t *) data;
+	uint32_t		a = adler & 0xFFFF, b = adler >> 16;
+	size_t			n;
+
+	while( 0 != size ) {
+		n = size < 5552 ? size : 5552;	// largest n that can't overflow b before the modulo
+		size -= n;
+		for( ; 0 != n; -- n ) {
+			a += *p ++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return (b << 16) | a;
+}
+
+/**
+ * @brief Write data and update the checksum.
+ * @internal
+ */
+static libf2_status_t _write_data( libf2_ostream * ostream, uint32_t * checksum, const void * data, size_t size )
+{
+	size_t	nwritten;
+
+	*checksum = _adler32( *checksum, data, size );
+	return ostream->write( ostream, data, size, &nwritten );
+}
+static libf2_status_t _write_uint32( libf2_ostream * ostream, uint32_t * checksum, uint32_t value )
+{
+	uint8_t	buf[4];
+
+	_store_uint32( buf, value );
+	return _write_data( ostream, checksum, buf, sizeof(buf) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int apphuffman_is_binary_table( const void * data, size_t data_size )
+{
+	return nullptr != data && 4 <= data_size && APPHUFFMAN_TABLE_SIGNATURE == _load_uint32( (const uint8_t *) data );
+}
+
+/**
+ * @brief Load code descriptors from the binary table file image.
+ * @param[out] desc_array_out (libhuffman_code_desc **) pointer to variable receiving the descriptor array (free it with free).
+ * @param[out] desc_count_out (size_t *) pointer to variable receiving number of descriptors.
+ * @param[out] layout (libhuffman_decoder_layout *) optional pointer to variable receiving the frozen decode layout;
+ *		table_count is 0 if the file has no layout. Layout arrays point into the file image.
+ * @param[in] data (const void *) file image; must be 4-byte aligned to use the layout in place.
+ * @param[in] data_size (size_t) size of file image, in bytes.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	The whole image is verified with the checksum first, then code records are converted. Descriptors, escapes and
+ * escape names are stored in a single block, as the text loader does. The layout is used in place, so it's skipped on
+ * big-endian hosts or misaligned images and the caller builds the tables from codes instead.
+ */
+libf2_status_t	apphuffman_load_table_from_bin(
+	libhuffman_code_desc ** desc_array_out, size_t * desc_count_out, libhuffman_decoder_layout * layout,
+	const void * data, size_t data_size )
+{
+	const uint8_t *			p = (const uint8_t *) data;
+	const uint16_t			one = 1;
+	libhuffman_code_desc *	desc_array = nullptr;
+	libhuffman_escape *		escape_array = nullptr;
+	char *					names = nullptr;
+	const char *			name;
+	size_t					desc_count, escape_count, table_count, entry_count, name_size, name_length;
+	size_t					code_offset, layout_offset, offset, end, i, j;
+	uint32_t				flags;
+	uint64_t				code_bits, value_bits;
+
+	// Check current state
+	__debugbreak_if( nullptr == desc_array_out || nullptr == desc_count_out )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	*desc_array_out = nullptr;
+	*desc_count_out = 0;
+	if( nullptr != layout )
+		memset( layout, 0, sizeof(*layout) );
+
+	// Check header and checksum
+	if( !apphuffman_is_binary_table( data, data_size ) || APPHUFFMAN_TABLE_HEADER_SIZE + 4 > data_size )
+		return LIBF2_STATUS_ERROR_FORMAT_NOT_SUPPORTED;
+	if( APPHUFFMAN_TABLE_VERSION_MAJOR != (p[4] | (p[5] << 8)) )
+		return LIBF2_STATUS_ERROR_FORMAT_NOT_SUPPORTED;
+	if( _adler32( 1, p, data_size - 4 ) != _load_uint32( p + data_size - 4 ) )
+		return LIBF2_STATUS_ERROR_INVALID_DATA;
+	end = data_size - 4;
+	flags = _load_uint32( p + 8 );
+	desc_count = _load_uint32( p + 12 );
+	code_offset = APPHUFFMAN_TABLE_HEADER_SIZE;
+	if( desc_count > (end - code_offset) / APPHUFFMAN_TABLE_CODE_SIZE )
+		return LIBF2_STATUS_ERROR_INVALID_DATA;
+
+	// Count actions
+	escape_count = 0;
+	for( i = 0, offset = code_offset; i < desc_count; ++ i, offset += APPHUFFMAN_TABLE_CODE_SIZE ) {
+		if( 0 != (p[offset + 22] & APPHUFFMAN_TABLE_CODE_F_ACTION) )
+			++ escape_count;
+	}
+
+	// Skip layout
+	layout_offset = offset;
+	table_count = entry_count = 0;
+	if( 0 != (flags & APPHUFFMAN_TABLE_F_LAYOUT) ) {
+		if( APPHUFFMAN_TABLE_LAYOUT_HEADER_SIZE > end - offset )
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+		table_count = _load_uint32( p + offset );
+		entry_count = _load_uint32( p + offset + 4 );
+		offset += APPHUFFMAN_TABLE_LAYOUT_HEADER_SIZE;
+		if( table_count > (end - offset) / APPHUFFMAN_TABLE_LAYOUT_TABLE_SIZE ||
+			entry_count > (end - offset - table_count * APPHUFFMAN_TABLE_LAYOUT_TABLE_SIZE) / 5 )
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+		offset += table_count * APPHUFFMAN_TABLE_LAYOUT_TABLE_SIZE + entry_count * 5;
+		offset += (4 - (entry_count & 3)) & 3;
+		if( offset > end )
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+	}
+
+	// Check escape names: one zero-terminated name per action
+	name = nullptr;
+	name_size = 0;
+	if( 0 != (flags & APPHUFFMAN_TABLE_F_ESCAPES) ) {
+		if( 4 > end - offset )
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+		name_size = _load_uint32( p + offset );
+		name = (const char *) (p + offset + 4);
+		if( name_size > end - offset - 4 )
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+	}
+	for( i = j = 0; i < escape_count; ++ i, j += name_length + 1 ) {
+		if( j >= name_size )
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+		name_length = strnlen( name + j, name_size - j );
+		if( name_length == name_size - j || (uint16_t) -1 < name_length )
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+	}
+	if( j != name_size )
+		return LIBF2_STATUS_ERROR_INVALID_DATA;
+
+	// Allocate all results at once
+	if( 0 != desc_count ) {
+		desc_array = (libhuffman_code_desc *) malloc( desc_count * sizeof(*desc_array) + escape_count * sizeof(libhuffman_escape) + name_size );
+		__debugbreak_if( nullptr == desc_array )
+			return LIBF2_STATUS_ERROR_INSUFFICIENT_MEMORY;
+		memset( desc_array, 0, desc_count * sizeof(*desc_array) );
+		escape_array = (libhuffman_escape *) (desc_array + desc_count);
+		names = (char *) (escape_array + escape_count);
+		if( 0 != name_size )
+			memcpy( names, name, name_size );
+	}
+
+	// Convert codes
+	for( i = 0, offset = code_offset; i < desc_count; ++ i, offset += APPHUFFMAN_TABLE_CODE_SIZE ) {
+		code_bits = _load_uint64( p + offset );
+		value_bits = _load_uint64( p + offset + 8 );
+		desc_array[i].code.bits		= (libhuffman_code_t) code_bits;
+		desc_array[i].value.bits	= (libhuffman_code_t) value_bits;
+		desc_array[i].count			= _load_uint32( p + offset + 16 );
+		desc_array[i].code.length	= p[offset + 20];
+		desc_array[i].value.length	= p[offset + 21];
+		if( 0 == desc_array[i].code.length || LIBHUFFMAN_MAX_CODE_LENGTH < desc_array[i].code.length ||
+			code_bits != desc_array[i].code.bits || value_bits != desc_array[i].value.bits ) {
+			free( desc_array );
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+		}
+		if( 0 != (p[offset + 22] & APPHUFFMAN_TABLE_CODE_F_ACTION) ) {
+			escape_array->name = names;
+			escape_array->name_length = (uint16_t) strlen( names );
+			escape_array->code = desc_array[i].code;
+			desc_array[i].escape = escape_array ++;
+			names += strlen( names ) + 1;
+		}
+	}
+
+	// Reference frozen decode layout
+	if( 0 != table_count && nullptr != layout && 1 == *(const uint8_t *) &one && 0 == ((uintptr_t) p & 3) ) {
+		offset = layout_offset + APPHUFFMAN_TABLE_LAYOUT_HEADER_SIZE;
+		layout->tables = (const libhuffman_layout_table *) (p + offset);
+		layout->table_count = table_count;
+		layout->entry_values = (const uint32_t *) (p + offset + table_count * APPHUFFMAN_TABLE_LAYOUT_TABLE_SIZE);
+		layout->entry_types = (const uint8_t *) (layout->entry_values + entry_count);
+		layout->entry_count = entry_count;
+		if( libf2_failed( libhuffman_decoder_layout_validate( layout, desc_count ) ) ) {
+			memset( layout, 0, sizeof(*layout) );
+			free( desc_array );
+			return LIBF2_STATUS_ERROR_INVALID_DATA;
+		}
+	}
+
+	// Done
+	*desc_array_out = desc_array;
+	*desc_count_out = desc_count;
+
+	// Exit
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Store code descriptors in the binary table format.
+ * @param[in] desc_array (const libhuffman_code_desc *) code descriptors.
+ * @param[in] desc_count (size_t) number of descriptors.
+ * @param[in] layout (const libhuffman_decoder_layout *) optional frozen decode layout built from the same descriptors.
+ * @param[in] ostream (libf2_ostream *) output stream.
+ * @return (libf2_status_t) operation status code.
+ */
+libf2_status_t	apphuffman_store_table_to_bin(
+	const libhuffman_code_desc * desc_array, size_t desc_count, const libhuffman_decoder_layout * layout,
+	libf2_ostream * ostream )
+{
+	libf2_status_t	status;
+	uint8_t			buf[APPHUFFMAN_TABLE_CODE_SIZE];
+	uint32_t		checksum = 1, flags = 0;
+	size_t			i, name_size, nwritten;
+
+	// Check current state
+	__debugbreak_if( nullptr == ostream || (nullptr == desc_array && 0 != desc_count) )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	__debugbreak_if( (uint32_t) -1 < desc_count )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	name_size = 0;
+	for( i = 0; i < desc_count; ++ i ) {
+		if( nullptr != desc_array[i].escape )
+			name_size += desc_array[i].escape->name_length + 1;
+	}
+	__debugbreak_if( (uint32_t) -1 < name_size )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	if( nullptr != layout && 0 != layout->table_count ) {
+		status = libhuffman_decoder_layout_validate( layout, desc_count );
+		if( libf2_failed( status ) )
+			return status;
+		flags |= APPHUFFMAN_TABLE_F_LAYOUT;
+	}
+	if( 0 != name_size )
+		flags |= APPHUFFMAN_TABLE_F_ESCAPES;
+
+	// Write header
+	_store_uint32( buf, APPHUFFMAN_TABLE_SIGNATURE );
+	_store_uint32( buf + 4, APPHUFFMAN_TABLE_VERSION_MAJOR | (APPHUFFMAN_TABLE_VERSION_MINOR << 16) );
+	_store_uint32( buf + 8, flags );
+	_store_uint32( buf + 12, (uint32_t) desc_count );
+	status = _write_data( ostream, &checksum, buf, APPHUFFMAN_TABLE_HEADER_SIZE );
+
+	// Write codes
+	for( i = 0; i < desc_count && libf2_succeeded( status ); ++ i ) {
+		_store_uint64( buf, (uint64_t) desc_array[i].code.bits );
+		_store_uint64( buf + 8, (uint64_t) desc_array[i].value.bits );
+		_store_uint32( buf + 16, desc_array[i].count );
+		buf[20] = desc_array[i].code.length;
+		buf[21] = desc_array[i].value.length;
+		buf[22] = nullptr != desc_array[i].escape ? APPHUFFMAN_TABLE_CODE_F_ACTION : 0;
+		buf[23] = 0;
+		status = _write_data( ostream, &checksum, buf, APPHUFFMAN_TABLE_CODE_SIZE );
+	}
+
+	// Write layout
+	if( 0 != (flags & APPHUFFMAN_TABLE_F_LAYOUT) ) {
+		if( libf2_succeeded( status ) )
+			status = _write_uint32( ostream, &checksum, (uint32_t) layout->table_count );
+		if( libf2_succeeded( status ) )
+			status = _write_uint32( ostream, &checksum, (uint32_t) layout->entry_count );
+		for( i = 0; i < layout->table_count && libf2_succeeded( status ); ++ i ) {
+			_store_uint32( buf, layout->tables[i].first_entry );
+			_store_uint32( buf + 4, layout->tables[i].parent_table );
+			_store_uint32( buf + 8, layout->tables[i].parent_index );
+			_store_uint32( buf + 12, layout->tables[i].l2_table_size );
+			status = _write_data( ostream, &checksum, buf, APPHUFFMAN_TABLE_LAYOUT_TABLE_SIZE );
+		}
+		for( i = 0; i < layout->entry_count && libf2_succeeded( status ); ++ i )
+			status = _write_uint32( ostream, &checksum, layout->entry_values[i] );
+		if( libf2_succeeded( status ) )
+			status = _write_data( ostream, &checksum, layout->entry_types, layout->entry_count );
+		if( libf2_succeeded( status ) && 0 != (layout->entry_count & 3) ) {
+			memset( buf, 0, sizeof(buf) );
+			status = _write_data( ostream, &checksum, buf, 4 - (layout->entry_count & 3) );
+		}
+	}
+
+	// Write escape names in the order of action codes
+	if( 0 != (flags & APPHUFFMAN_TABLE_F_ESCAPES) ) {
+		if( libf2_succeeded( status ) )
+			status = _write_uint32( ostream, &checksum, (uint32_t) name_size );
+		for( i = 0; i < desc_count && libf2_succeeded( status ); ++ i ) {
+			if( nullptr == desc_array[i].escape )
+				continue;
+			status = _write_data( ostream, &checksum, desc_array[i].escape->name, desc_array[i].escape->name_length );
+			if( libf2_succeeded( status ) )
+				status = _write_data( ostream, &checksum, "", 1 );
+		}
+		if( libf2_succeeded( status ) && 0 != (name_size & 3) ) {
+			memset( buf, 0, sizeof(buf) );
+			status = _write_data( ostream, &checksum, buf, 4 - (name_size & 3) );
+		}
+	}
+
+	// Write checksum
+	if( libf2_succeeded( status ) ) {
+		_store_uint32( buf, checksum );
+		status = ostream->write( ostream, buf, 4, &nwritten );
+	}
+
+	// Exit
+	return status;
+}
+
+/**
+ * @brief Set up decoder table from the binary table file image.
+ * @param[in] table (libhuffman_decoder_table *) decoder table; if layout is attached, detach it with
+ *		libhuffman_decoder_table_detach_layout.
+ * @param[in] context (libhuffman_context *) library context.
+ * @param[in] data (const void *) file image.
+ * @param[in] data_size (size_t) size of file image, in bytes.
+ * @param[out] desc_array_out (libhuffman_code_desc **) pointer to variable receiving the descriptor array the table
+ *		entries refer to; free it with free once the table is detached or deinitialized.
+ * @return (libf2_status_t) operation status code.
+ *
+ *	If the file holds a frozen decode layout, it's attached as is; otherwise the codes are inserted one by one.
+ */
+libf2_status_t	apphuffman_deserialize_decoder_table_bin( libhuffman_decoder_table * table, libhuffman_context * context,
+	const void * data, size_t data_size, libhuffman_code_desc ** desc_array_out )
+{
+	libf2_status_t				status;
+	libhuffman_code_desc *		desc_array;
+	size_t						desc_count;
+	libhuffman_decoder_layout	layout;
+
+	// Check current state
+	__debugbreak_if( nullptr == desc_array_out )
+		return LIBF2_STATUS_ERROR_INVALID_PARAMETER;
+	*desc_array_out = nullptr;
+
+	// Load table
+	status = apphuffman_load_table_from_bin( &desc_array, &desc_count, &layout, data, data_size );
+	if( libf2_failed( status ) )
+		return status;
+
+	// Attach layout or add all codes; data entries of the layout point to the descriptors
+	if( 0 != layout.table_count )
+		status = libhuffman_decoder_table_attach_layout( table, context, &layout, desc_array );
+	else
+		status = libhuffman_decoder_table_append_codes( table, desc_array, desc_count );
+	if( libf2_failed( status ) ) {
+		free( desc_array );
+		return status;
+	}
+
+	// Exit
+	*desc_array_out = desc_array;
+	return LIBF2_STATUS_SUCCESS;
+}
+
+/*END OF table_bin.c*/